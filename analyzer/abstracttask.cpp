@@ -53,7 +53,6 @@
 
 #include "analyzer/abstracttask.h"
 #include "analyzer/traceanalyzer.h"
-#include "ui/taskgraph.h"
 #include "vtl/tlist.h"
 
 #define SCHED_HEIGHT ((double) 0.5)
@@ -63,13 +62,12 @@
 
 AbstractTask::AbstractTask() :
 	pid(0), accTime(), accPct(0), cursorTime(), cursorPct(0), isNew(true),
-	offset(0), scale(0), graph(nullptr), events(nullptr)
+	hasTail(false), offset(0), scale(0), graph(nullptr), events(nullptr)
 {}
 
+/* The graph belongs to the GUI, which deletes it */
 AbstractTask::~AbstractTask()
 {
-	if (graph != nullptr)
-		delete graph;
 }
 
 bool AbstractTask::doScale()
@@ -107,7 +105,7 @@ bool AbstractTask::doStats()
 	end = endTime;
 	delta = end - start;
 
-	vtl::Time firstTime = (*events)[schedEventIdx[0]].time;
+	vtl::Time firstTime = (*events)[schedEventIdx[0]].getTime();
 
 	if (s < 2) {
 		if (firstTime < start) {
@@ -132,8 +130,8 @@ bool AbstractTask::doStats()
 	startidx = 0;
 	endidx = s - 1;
 
-	startIdxTime = (*events)[schedEventIdx[startidx]].time;
-	endIdxTime = (*events)[schedEventIdx[endidx]].time;
+	startIdxTime = (*events)[schedEventIdx[startidx]].getTime();
+	endIdxTime = (*events)[schedEventIdx[endidx]].getTime();
 
 	if (startIdxTime >= end || endIdxTime <= start)
 		return false;
@@ -147,7 +145,7 @@ bool AbstractTask::doStats()
 
 	/* Todo fix this */
 	for (i = startidx; i <= endidx; i++) {
-		t = (*events)[schedEventIdx[i]].time;
+		t = (*events)[schedEventIdx[i]].getTime();
 		state = schedData.read(i);
 		if (SCHED_BIT == prevState) {
 			accTime += t - prevTime;
@@ -188,7 +186,7 @@ bool AbstractTask::doStatsTimeLimited()
 	const vtl::Time &end = higherTimeLimit;
 	delta = end - start;
 
-	vtl::Time firstTime = (*events)[schedEventIdx[0]].time;
+	vtl::Time firstTime = (*events)[schedEventIdx[0]].getTime();
 
 	if (s < 2) {
 		if (firstTime < start) {
@@ -210,7 +208,7 @@ bool AbstractTask::doStatsTimeLimited()
 		return false;
 	}
 
-	vtl::Time lastTime = (*events)[schedEventIdx[s - 1]].time;
+	vtl::Time lastTime = (*events)[schedEventIdx[s - 1]].getTime();
 
 
 	if (lastTime < start)
@@ -230,7 +228,7 @@ bool AbstractTask::doStatsTimeLimited()
 	startidx = findLower(start);
 	endidx = findLower(end);
 
-	startIdxTime = (*events)[schedEventIdx[startidx]].time;
+	startIdxTime = (*events)[schedEventIdx[startidx]].getTime();
 
 	if (startIdxTime >= end)
 		return false;
@@ -242,7 +240,7 @@ bool AbstractTask::doStatsTimeLimited()
 	prevState = schedData.read(startidx);
 
 	for (i = startidx + 1; i <= endidx; i++) {
-		t = (*events)[schedEventIdx[i]].time;
+		t = (*events)[schedEventIdx[i]].getTime();
 		state = schedData.read(i);
 		if (SCHED_BIT == prevState) {
 			cursorTime += t - prevTime;
@@ -326,7 +324,7 @@ int AbstractTask::_binarySearch(const vtl::Time &time, int lowerIdx,
 {
 	int pivot = (lowerIdx + higherIdx) / 2;
 	int width = higherIdx - lowerIdx;
-	const vtl::Time &pTime = (*events)[schedEventIdx[pivot]].time;
+	const vtl::Time &pTime = (*events)[schedEventIdx[pivot]].getTime();
 	bool pSmaller = pTime < time;
 
 	if (width < 2) {
@@ -352,7 +350,7 @@ int AbstractTask::findLower(const vtl::Time &time)
 	int idxmax = schedEventIdx.size() - 1;
 	int idx = _binarySearch(time, 0, idxmax);
 
-	vtl::Time idxtime = (*events)[schedEventIdx[idx]].time;
+	vtl::Time idxtime = (*events)[schedEventIdx[idx]].getTime();
 	/*
 	 * In normal circumstances this could only do one loop iteration but
 	 * if we have many identical timestamps, we could end up in a situation
@@ -362,7 +360,7 @@ int AbstractTask::findLower(const vtl::Time &time)
 	 */
 	while (idxtime > time && idx > 0) {
 		idx--;
-		idxtime = (*events)[schedEventIdx[idx]].time;
+		idxtime = (*events)[schedEventIdx[idx]].getTime();
 	}
 	return idx;
 }
@@ -372,7 +370,7 @@ int AbstractTask::findHigher(const vtl::Time &time)
 	int idxmax = schedEventIdx.size() - 1;
 	int idx = _binarySearch(time, 0, idxmax);
 
-	vtl::Time idxtime = (*events)[schedEventIdx[idx]].time;
+	vtl::Time idxtime = (*events)[schedEventIdx[idx]].getTime();
 	/*
 	 * In normal circumstances this could only do one loop iteration but
 	 * if we have many identical timestamps, we could end up in a situation
@@ -382,7 +380,7 @@ int AbstractTask::findHigher(const vtl::Time &time)
 	 */
 	while (idxtime < time && idx < idxmax) {
 		idx++;
-		idxtime = (*events)[schedEventIdx[idx]].time;
+		idxtime = (*events)[schedEventIdx[idx]].getTime();
 	}
 	return idx;
 }
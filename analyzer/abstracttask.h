@@ -57,6 +57,7 @@
 #include "vtl/bitvector.h"
 
 #include "vtl/time.h"
+#include "vtl/timevector.h"
 #include "misc/traceshark.h"
 
 class TaskGraph;
@@ -71,6 +72,7 @@ namespace vtl {
 }
 
 class AbstractTask {
+	friend class AnalysisCache;
 	friend class StatsModel;
 	friend class StatsLimitedModel;
 	friend class TraceAnalyzer;
@@ -81,11 +83,11 @@ public:
 	/* is really tid as all other pids here */
 	int pid;
 
-	QVector<double> schedTimev;
+	vtl::TimeVector<QVector> schedTimev;
 	QVector<int>    schedEventIdx;
 	vtl::BitVector  schedData;
 	QVector<double> scaledSchedData;
-	QVector<double> wakeTimev;
+	vtl::TimeVector<QVector> wakeTimev;
 	QVector<double> wakeDelay;
 	QVector<double> wakeHeight;
 	QVector<double> wakeZero;
@@ -103,6 +105,8 @@ public:
 
 	/* Only used during extraction */
 	bool isNew;
+	/* True if the last sched entry was added by processSchedAddTail() */
+	bool hasTail;
 
 	/* These are for scaling purposes */
 	double offset;
@@ -0,0 +1,590 @@
+// SPDX-License-Identifier: (GPL-2.0-or-later OR BSD-2-Clause)
+/*
+ * Traceshark - a visualizer for visualizing ftrace and perf traces
+ * Copyright (C) 2019  Viktor Rosendahl <viktor.rosendahl@gmail.com>
+ *
+ * This file is dual licensed: you can use it either under the terms of
+ * the GPL, or the BSD license, at your option.
+ *
+ *  a) This program is free software; you can redistribute it and/or
+ *     modify it under the terms of the GNU General Public License as
+ *     published by the Free Software Foundation; either version 2 of the
+ *     License, or (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public
+ *     License along with this library; if not, write to the Free
+ *     Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ *     MA 02110-1301 USA
+ *
+ * Alternatively,
+ *
+ *  b) Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *     1. Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *     2. Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *     CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *     INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *     MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *     DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *     CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *     NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *     LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *     HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *     CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ *     OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *     EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <QByteArray>
+#include <QVector>
+
+#include "analyzer/analysiscache.h"
+#include "analyzer/cpufreq.h"
+#include "analyzer/cpuidle.h"
+#include "analyzer/cputask.h"
+#include "analyzer/migration.h"
+#include "analyzer/task.h"
+#include "analyzer/traceanalyzer.h"
+#include "mm/stringpool.h"
+#include "parser/indexwriter.h"
+#include "misc/errors.h"
+#include "misc/traceshark.h"
+#include "misc/tstring.h"
+#include "vtl/error.h"
+#include "vtl/timevector.h"
+#include "vtl/tlist.h"
+
+extern "C" {
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+}
+
+#define ANALYSISCACHE_MAGIC "TSANA\0\0\0"
+#define ANALYSISCACHE_MAGIC_SIZE (8)
+/* This needs to be bumped if the analyzer starts to produce other vectors */
+#define ANALYSISCACHE_VERSION (1)
+#define ANALYSISCACHE_BYTE_ORDER (0x01020304)
+
+/* All fields are stored in the byte order of the machine */
+class CacheHeader {
+public:
+	char magic[ANALYSISCACHE_MAGIC_SIZE];
+	uint32_t version;
+	uint32_t byteOrder;
+	FileStamp stamp;
+	int64_t nrEvents;
+	uint32_t maxCPU;
+	uint32_t minFreq;
+	uint32_t maxFreq;
+	int32_t minIdleState;
+	int32_t maxIdleState;
+	uint32_t nrTasks;
+	uint64_t nrMigrations;
+};
+
+class CacheMigration {
+public:
+	int32_t pid;
+	int32_t oldcpu;
+	int32_t newcpu;
+	uint32_t precision;
+	int64_t time;
+};
+
+/*
+ * A bounds checked reader of the records of the cache. All the get functions
+ * return false if the data would extend beyond the end of the cache.
+ */
+class CacheReader {
+public:
+	CacheReader(const char *d, int64_t s, int64_t p);
+	__always_inline bool getBytes(uint64_t count, uint64_t elemSize,
+				      const char **ptr);
+	template<class T> __always_inline bool get(T *value);
+	template<class T> bool getVector(QVector<T> *v);
+	bool getTimes(vtl::TimeVector<QVector> *tv);
+	const char *data;
+	int64_t size;
+	int64_t pos;
+};
+
+CacheReader::CacheReader(const char *d, int64_t s, int64_t p)
+	: data(d), size(s), pos(p)
+{}
+
+__always_inline bool CacheReader::getBytes(uint64_t count, uint64_t elemSize,
+					   const char **ptr)
+{
+	if (count > (uint64_t) (size - pos) / elemSize)
+		return false;
+	*ptr = data + pos;
+	pos += count * elemSize;
+	return true;
+}
+
+template<class T> __always_inline bool CacheReader::get(T *value)
+{
+	const char *ptr;
+
+	if (!getBytes(1, sizeof(T), &ptr))
+		return false;
+	memcpy(value, ptr, sizeof(T));
+	return true;
+}
+
+template<class T> bool CacheReader::getVector(QVector<T> *v)
+{
+	const char *ptr;
+	uint64_t n;
+
+	if (!get(&n) || n > INT_MAX || !getBytes(n, sizeof(T), &ptr))
+		return false;
+	v->resize(n);
+	memcpy(v->data(), ptr, n * sizeof(T));
+	return true;
+}
+
+bool CacheReader::getTimes(vtl::TimeVector<QVector> *tv)
+{
+	const char *ptr;
+	int64_t t;
+	uint64_t n, i;
+
+	if (!get(&n) || n > INT_MAX || !getBytes(n, sizeof(int64_t), &ptr))
+		return false;
+	tv->clear();
+	for (i = 0; i < n; i++) {
+		memcpy(&t, ptr + i * sizeof(int64_t), sizeof(int64_t));
+		tv->append(t);
+	}
+	return true;
+}
+
+template<class T>
+__always_inline static bool putValue(IndexWriter *w, const T &value)
+{
+	return w->put(&value, sizeof(value));
+}
+
+template<class T>
+static bool putVector(IndexWriter *w, const QVector<T> &v)
+{
+	uint64_t n = v.size();
+
+	return putValue(w, n) && w->put(v.constData(), n * sizeof(T));
+}
+
+static bool putTimes(IndexWriter *w, const vtl::TimeVector<QVector> &tv)
+{
+	uint64_t n = tv.size();
+	uint64_t i;
+	int64_t t;
+
+	if (!putValue(w, n))
+		return false;
+	for (i = 0; i < n; i++) {
+		t = tv.at(i);
+		if (!putValue(w, t))
+			return false;
+	}
+	return true;
+}
+
+__always_inline static int clib_open(const char *pathname, int flags)
+{
+	return open(pathname, flags);
+}
+
+__always_inline static int clib_close(int fd)
+{
+	return close(fd);
+}
+
+__always_inline static int errno_or(int error)
+{
+	return errno != 0 ? errno : error;
+}
+
+/* The pid is written by the caller, so that it can be read before the task */
+static bool writeTaskVectors(IndexWriter *w, const AbstractTask &task)
+{
+	uint64_t n = task.schedData.size();
+	uint64_t i;
+	uint8_t d;
+
+	if (!putTimes(w, task.schedTimev) ||
+	    !putVector(w, task.schedEventIdx) ||
+	    !putValue(w, n))
+		return false;
+	for (i = 0; i < n; i++) {
+		d = task.schedData.read(i);
+		if (!putValue(w, d))
+			return false;
+	}
+	return putTimes(w, task.wakeTimev) &&
+		putVector(w, task.wakeDelay) &&
+		putVector(w, task.preemptedTimev) &&
+		putVector(w, task.runningTimev) &&
+		putVector(w, task.uninterruptibleTimev);
+}
+
+/*
+ * The event indices are checked, because they are used to look up events
+ * without any checks when the task is shown.
+ */
+static bool readTaskVectors(CacheReader *r, AbstractTask *task,
+			    int64_t nrEvents)
+{
+	const char *bits;
+	uint64_t n, i;
+	int idx;
+
+	if (!r->getTimes(&task->schedTimev) ||
+	    !r->getVector(&task->schedEventIdx) ||
+	    !r->get(&n) || n != (uint64_t) task->schedTimev.size() ||
+	    n != (uint64_t) task->schedEventIdx.size() ||
+	    !r->getBytes(n, sizeof(uint8_t), &bits))
+		return false;
+	for (i = 0; i < n; i++) {
+		idx = task->schedEventIdx.at(i);
+		if (idx < 0 || idx >= nrEvents)
+			return false;
+		task->schedData.append(bits[i] != 0 ? SCHED_BIT : FLOOR_BIT);
+	}
+	return r->getTimes(&task->wakeTimev) &&
+		r->getVector(&task->wakeDelay) &&
+		task->wakeDelay.size() == task->wakeTimev.size() &&
+		r->getVector(&task->preemptedTimev) &&
+		r->getVector(&task->runningTimev) &&
+		r->getVector(&task->uninterruptibleTimev);
+}
+
+/* The names are written from the oldest to the newest */
+static bool writeTaskNames(IndexWriter *w, const Task &task)
+{
+	QVector<const TaskName*> names;
+	const TaskName *name;
+	uint32_t len;
+	uint8_t forkname;
+	int i;
+
+	for (name = task.taskName; name != nullptr; name = name->prev)
+		names.append(name);
+	if (!putValue<uint32_t>(w, names.size()))
+		return false;
+	for (i = names.size() - 1; i >= 0; i--) {
+		len = strlen(names[i]->str);
+		forkname = names[i]->forkname ? 1 : 0;
+		if (!putValue(w, forkname) || !putValue(w, len) ||
+		    !w->put(names[i]->str, len))
+			return false;
+	}
+	return true;
+}
+
+static bool readTaskNames(CacheReader *r, Task *task, StringPool *pool)
+{
+	const TString *str;
+	TString ts;
+	const char *ptr;
+	uint32_t n, i, len;
+	uint8_t forkname;
+
+	if (!r->get(&n))
+		return false;
+	for (i = 0; i < n; i++) {
+		if (!r->get(&forkname) || !r->get(&len) ||
+		    !r->getBytes(len, sizeof(char), &ptr))
+			return false;
+		ts.ptr = (char*) ptr;
+		ts.len = len;
+		str = pool->allocString(&ts, TShark::StrHash32(&ts), 0);
+		if (str == nullptr)
+			return false;
+		task->addName(str->ptr);
+		task->taskName->forkname = forkname != 0;
+	}
+	return true;
+}
+
+static bool writeCache(int fd, const CacheHeader *header,
+		       const TraceAnalyzer *analyzer)
+{
+	IndexWriter w(fd);
+	CacheMigration m;
+	unsigned int cpu;
+	uint32_t n;
+	int i;
+
+	if (!w.put(header, sizeof(*header)))
+		return false;
+
+	for (cpu = 0; cpu <= header->maxCPU; cpu++) {
+		const CpuFreq &freq = analyzer->cpuFreq[cpu];
+		const CpuIdle &idle = analyzer->cpuIdle[cpu];
+		const vtl::PidMap<CPUTask> &cpuTasks =
+			analyzer->cpuTaskMaps[cpu];
+
+		if (!putVector(&w, freq.timev) || !putVector(&w, freq.data) ||
+		    !putVector(&w, idle.timev) || !putVector(&w, idle.data))
+			return false;
+		n = cpuTasks.size();
+		if (!putValue(&w, n))
+			return false;
+		DEFINE_CPUTASKMAP_ITERATOR(iter) = cpuTasks.begin();
+		while (iter != cpuTasks.end()) {
+			const CPUTask &task = iter.value();
+			iter++;
+			if (!putValue<int32_t>(&w, task.pid) ||
+			    !writeTaskVectors(&w, task))
+				return false;
+		}
+	}
+
+	DEFINE_TASKMAP_ITERATOR(iter) = analyzer->taskMap.begin();
+	while (iter != analyzer->taskMap.end()) {
+		const Task &task = iter.value();
+		iter++;
+		if (!putValue<int32_t>(&w, task.pid) ||
+		    !writeTaskVectors(&w, task) ||
+		    !putValue<uint32_t>(&w, task.exitStatus) ||
+		    !writeTaskNames(&w, task))
+			return false;
+	}
+
+	memset(&m, 0, sizeof(m));
+	for (i = 0; i < analyzer->migrations.size(); i++) {
+		const Migration &migration = analyzer->migrations.at(i);
+		m.pid = migration.pid;
+		m.oldcpu = migration.oldcpu;
+		m.newcpu = migration.newcpu;
+		m.precision = migration.time.getPrecision();
+		m.time = migration.time.toNanoseconds();
+		if (!putValue(&w, m))
+			return false;
+	}
+	return w.flush();
+}
+
+AnalysisCache::AnalysisCache()
+	: map(nullptr), mapSize(0)
+{}
+
+AnalysisCache::~AnalysisCache()
+{
+	close();
+}
+
+/*
+ * This maps the cache and checks that it belongs to the trace file that info
+ * describes and to a trace index with nrEvents events.
+ */
+int AnalysisCache::open(const char *name, const FileInfo *info,
+			int64_t nrEvents)
+{
+	const CacheHeader *header;
+	struct stat st;
+	void *m;
+	int fd;
+	int ts_errno;
+
+	if (map != nullptr)
+		return -TS_ERROR_INTERNAL;
+
+	fd = clib_open(name, O_RDONLY);
+	if (fd < 0)
+		return errno_or(-TS_ERROR_OPEN);
+	if (fstat(fd, &st) != 0) {
+		ts_errno = errno_or(-TS_ERROR_FILE_READ);
+		clib_close(fd);
+		return ts_errno;
+	}
+	if (st.st_size < (off_t) sizeof(CacheHeader)) {
+		clib_close(fd);
+		return -TS_ERROR_FILEFORMAT;
+	}
+	m = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	clib_close(fd);
+	if (m == MAP_FAILED)
+		return -TS_ERROR_FILE_RESOURCE;
+	map = (const char*) m;
+	mapSize = st.st_size;
+
+	header = (const CacheHeader*) map;
+	if (memcmp(header->magic, ANALYSISCACHE_MAGIC,
+		   ANALYSISCACHE_MAGIC_SIZE) != 0 ||
+	    header->byteOrder != ANALYSISCACHE_BYTE_ORDER ||
+	    header->maxCPU >= NR_CPUS_ALLOWED) {
+		ts_errno = -TS_ERROR_FILEFORMAT;
+		goto err;
+	}
+	if (header->version != ANALYSISCACHE_VERSION) {
+		ts_errno = -TS_ERROR_NEWFORMAT;
+		goto err;
+	}
+	if (!info->cmpStamp(&header->stamp) || header->nrEvents != nrEvents) {
+		ts_errno = -TS_ERROR_FILECHANGED;
+		goto err;
+	}
+
+	madvise((void*) map, mapSize, MADV_SEQUENTIAL);
+	return 0;
+err:
+	close();
+	return ts_errno;
+}
+
+void AnalysisCache::close()
+{
+	if (map != nullptr && munmap((void*) map, mapSize) != 0)
+		munmap_err();
+	map = nullptr;
+	mapSize = 0;
+}
+
+/*
+ * This fills in the vectors of the analyzer, which must be empty. If false is
+ * returned, the cache was broken and the caller must discard whatever was
+ * restored. The events of the analyzer must have been set.
+ */
+bool AnalysisCache::restore(TraceAnalyzer *analyzer)
+{
+	const CacheHeader *header = (const CacheHeader*) map;
+	CacheReader r(map, mapSize, sizeof(CacheHeader));
+	const char *ptr;
+	CacheMigration m;
+	Migration migration;
+	unsigned int cpu;
+	uint32_t n, i;
+	uint32_t exitStatus;
+	uint64_t j;
+	int32_t pid;
+
+	analyzer->maxCPU = header->maxCPU;
+	analyzer->minFreq = header->minFreq;
+	analyzer->maxFreq = header->maxFreq;
+	analyzer->minIdleState = header->minIdleState;
+	analyzer->maxIdleState = header->maxIdleState;
+
+	for (cpu = 0; cpu <= header->maxCPU; cpu++) {
+		CpuFreq &freq = analyzer->cpuFreq[cpu];
+		CpuIdle &idle = analyzer->cpuIdle[cpu];
+		vtl::PidMap<CPUTask> &cpuTasks = analyzer->cpuTaskMaps[cpu];
+
+		if (!r.getVector(&freq.timev) || !r.getVector(&freq.data) ||
+		    freq.timev.size() != freq.data.size() ||
+		    !r.getVector(&idle.timev) || !r.getVector(&idle.data) ||
+		    idle.timev.size() != idle.data.size() ||
+		    !r.get(&n))
+			return false;
+		for (i = 0; i < n; i++) {
+			if (!r.get(&pid) || cpuTasks.contains(pid))
+				return false;
+			CPUTask &task = cpuTasks[pid];
+			task.pid = pid;
+			task.isNew = false;
+			task.events = analyzer->events;
+			if (!readTaskVectors(&r, &task, header->nrEvents))
+				return false;
+		}
+	}
+
+	for (i = 0; i < header->nrTasks; i++) {
+		if (!r.get(&pid) || analyzer->taskMap.contains(pid))
+			return false;
+		Task &task = analyzer->taskMap[pid];
+		task.pid = pid;
+		task.isNew = false;
+		task.events = analyzer->events;
+		if (!readTaskVectors(&r, &task, header->nrEvents) ||
+		    !r.get(&exitStatus) || exitStatus > STATUS_FINAL ||
+		    !readTaskNames(&r, &task, analyzer->taskNamePool))
+			return false;
+		task.exitStatus = (exitstatus_t) exitStatus;
+	}
+
+	if (!r.getBytes(header->nrMigrations, sizeof(CacheMigration), &ptr))
+		return false;
+	for (j = 0; j < header->nrMigrations; j++) {
+		memcpy(&m, ptr + j * sizeof(CacheMigration), sizeof(m));
+		migration.pid = m.pid;
+		migration.oldcpu = m.oldcpu;
+		migration.newcpu = m.newcpu;
+		migration.time = vtl::Time(false, 0, m.time, m.precision);
+		analyzer->migrations.append(migration);
+	}
+	return r.pos == r.size;
+}
+
+/*
+ * This must be called after the processing, before the tails have been added.
+ * The cache is written to a temporary file that is renamed when it is
+ * complete, so that another instance never sees a partially written cache.
+ */
+int AnalysisCache::write(const char *name, const FileInfo *info,
+			 int64_t nrEvents, const TraceAnalyzer *analyzer)
+{
+	CacheHeader header;
+	QByteArray tmpName(name);
+	int fd;
+	int ts_errno = 0;
+	bool ok;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, ANALYSISCACHE_MAGIC, ANALYSISCACHE_MAGIC_SIZE);
+	header.version = ANALYSISCACHE_VERSION;
+	header.byteOrder = ANALYSISCACHE_BYTE_ORDER;
+	info->getStamp(&header.stamp);
+	header.nrEvents = nrEvents;
+	header.maxCPU = analyzer->maxCPU;
+	header.minFreq = analyzer->minFreq;
+	header.maxFreq = analyzer->maxFreq;
+	header.minIdleState = analyzer->minIdleState;
+	header.maxIdleState = analyzer->maxIdleState;
+	header.nrTasks = analyzer->taskMap.size();
+	header.nrMigrations = analyzer->migrations.size();
+
+	tmpName.append(".XXXXXX");
+	fd = mkstemp(tmpName.data());
+	if (fd < 0)
+		return errno_or(-TS_ERROR_FILE_WRITE);
+
+	ok = writeCache(fd, &header, analyzer);
+	if (!ok)
+		ts_errno = errno_or(-TS_ERROR_FILE_WRITE);
+	if (clib_close(fd) != 0 && ok) {
+		ok = false;
+		ts_errno = errno_or(-TS_ERROR_FILE_WRITE);
+	}
+	if (ok && rename(tmpName.data(), name) != 0) {
+		ok = false;
+		ts_errno = errno_or(-TS_ERROR_FILE_RENAME);
+	}
+	if (!ok)
+		unlink(tmpName.data());
+	return ts_errno;
+}
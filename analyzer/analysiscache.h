@@ -0,0 +1,101 @@
+// SPDX-License-Identifier: (GPL-2.0-or-later OR BSD-2-Clause)
+/*
+ * Traceshark - a visualizer for visualizing ftrace and perf traces
+ * Copyright (C) 2019  Viktor Rosendahl <viktor.rosendahl@gmail.com>
+ *
+ * This file is dual licensed: you can use it either under the terms of
+ * the GPL, or the BSD license, at your option.
+ *
+ *  a) This program is free software; you can redistribute it and/or
+ *     modify it under the terms of the GNU General Public License as
+ *     published by the Free Software Foundation; either version 2 of the
+ *     License, or (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public
+ *     License along with this library; if not, write to the Free
+ *     Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ *     MA 02110-1301 USA
+ *
+ * Alternatively,
+ *
+ *  b) Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *     1. Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *     2. Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *     CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *     INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *     MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *     DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *     CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *     NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *     LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *     HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *     CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ *     OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *     EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ANALYSISCACHE_H
+#define ANALYSISCACHE_H
+
+#include <cstdint>
+
+#include "parser/fileinfo.h"
+#include "vtl/compiler.h"
+
+class TraceAnalyzer;
+
+#define ANALYSISCACHE_SUFFIX ".tsana"
+
+/*
+ * An analysis cache is a sidecar file that contains the result of the
+ * processing of a trace: the scheduling, wakeup and state vectors of the tasks
+ * and the CPU tasks, the frequency and idle vectors of the CPUs and the
+ * migrations. It is written after the trace has been processed and it is used
+ * together with the trace index the next time that the same file is opened,
+ * so that only the event columns and the postings need to be rebuilt. The
+ * cache is only used if the size and the timestamps of the trace file are the
+ * same as when it was written and if the trace index has the same number of
+ * events.
+ *
+ * Unlike the trace index, the cache is a stream of variable sized records, it
+ * is read from start to end by restore(). The tails that are added after the
+ * processing are not stored.
+ */
+class AnalysisCache
+{
+public:
+	AnalysisCache();
+	~AnalysisCache();
+	int open(const char *name, const FileInfo *info, int64_t nrEvents);
+	void close();
+	__always_inline bool isOpen() const;
+	bool restore(TraceAnalyzer *analyzer);
+	static int write(const char *name, const FileInfo *info,
+			 int64_t nrEvents, const TraceAnalyzer *analyzer);
+private:
+	const char *map;
+	int64_t mapSize;
+};
+
+__always_inline bool AnalysisCache::isOpen() const
+{
+	return map != nullptr;
+}
+
+#endif /* ANALYSISCACHE_H */
@@ -52,6 +52,10 @@
 
 #include "analyzer/cpufreq.h"
 
+CpuFreq::CpuFreq() :
+	offset(0), scale(0), hasTail(false)
+{}
+
 bool CpuFreq::doScale()
 {
 	int i;
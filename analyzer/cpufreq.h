@@ -57,11 +57,14 @@
 
 class CpuFreq {
 public:
+	CpuFreq();
 	QVector<double> timev;
 	QVector<double> data;
 	QVector<double> scaledData;
 	double offset;
 	double scale;
+	/* True if the last entry was added by processFreqAddTail() */
+	bool hasTail;
 	bool doScale();
 };
 
@@ -0,0 +1,118 @@
+// SPDX-License-Identifier: (GPL-2.0-or-later OR BSD-2-Clause)
+/*
+ * Traceshark - a visualizer for visualizing ftrace and perf traces
+ * Copyright (C) 2019  Viktor Rosendahl <viktor.rosendahl@gmail.com>
+ *
+ * This file is dual licensed: you can use it either under the terms of
+ * the GPL, or the BSD license, at your option.
+ *
+ *  a) This program is free software; you can redistribute it and/or
+ *     modify it under the terms of the GNU General Public License as
+ *     published by the Free Software Foundation; either version 2 of the
+ *     License, or (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public
+ *     License along with this library; if not, write to the Free
+ *     Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ *     MA 02110-1301 USA
+ *
+ * Alternatively,
+ *
+ *  b) Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *     1. Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *     2. Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *     CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *     INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *     MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *     DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *     CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *     NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *     LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *     HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *     CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ *     OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *     EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CPUSCHED_H
+#define CPUSCHED_H
+
+#include <QVector>
+
+#include "vtl/compiler.h"
+#include "vtl/time.h"
+
+class CPUTask;
+class TraceAnalyzer;
+
+/*
+ * The outcome of the per CPU extraction of a sched_switch event, i.e. what the
+ * merge needs to know in order to update the Tasks, which are shared by all
+ * CPUs.
+ */
+class SchedRecord {
+public:
+	/* Index of the sched_switch event */
+	int idx;
+	/* True if the CPU had another task on it than the outgoing task */
+	bool wrongTask;
+	/* True if the wakeup of a new incoming task can be estimated */
+	bool newDelayOK;
+	/* The task that we thought was on the CPU, if wrongTask is true */
+	int wrongPid;
+	int wrongIdx;
+	vtl::Time wrongTime;
+	/* The CPUTask of the incoming task, for the wakeup delay */
+	CPUTask *newTask;
+};
+
+/*
+ * This holds the events of one CPU that have been seen by the analyzer but
+ * not yet extracted. The extraction of the CPUTasks of different CPUs is done
+ * in parallel, since a CPUTask only depends on the events of its own CPU.
+ */
+class CPUSched {
+public:
+	CPUSched();
+	bool extract();
+	__always_inline bool isEmpty() const;
+	__always_inline int nextIdx() const;
+	void clear();
+	TraceAnalyzer *analyzer;
+	unsigned int cpu;
+	/* Indices of the events, in the order they occurred */
+	QVector<int> eventIdx;
+	/* One record for each sched_switch event that has a payload */
+	QVector<SchedRecord> records;
+	/* The positions of the merge in eventIdx and records */
+	int nextEvent;
+	int nextRecord;
+};
+
+__always_inline bool CPUSched::isEmpty() const
+{
+	return nextEvent >= eventIdx.size();
+}
+
+__always_inline int CPUSched::nextIdx() const
+{
+	return eventIdx.at(nextEvent);
+}
+
+#endif /* CPUSCHED_H */
@@ -0,0 +1,98 @@
+// SPDX-License-Identifier: (GPL-2.0-or-later OR BSD-2-Clause)
+/*
+ * Traceshark - a visualizer for visualizing ftrace and perf traces
+ * Copyright (C) 2019  Viktor Rosendahl <viktor.rosendahl@gmail.com>
+ *
+ * This file is dual licensed: you can use it either under the terms of
+ * the GPL, or the BSD license, at your option.
+ *
+ *  a) This program is free software; you can redistribute it and/or
+ *     modify it under the terms of the GNU General Public License as
+ *     published by the Free Software Foundation; either version 2 of the
+ *     License, or (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public
+ *     License along with this library; if not, write to the Free
+ *     Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ *     MA 02110-1301 USA
+ *
+ * Alternatively,
+ *
+ *  b) Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *     1. Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *     2. Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *     CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *     INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *     MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *     DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *     CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *     NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *     LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *     HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *     CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ *     OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *     EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef EVENTCOLUMNS_H
+#define EVENTCOLUMNS_H
+
+#include "parser/traceevent.h"
+#include "vtl/compiler.h"
+#include "vtl/time.h"
+#include "vtl/timevector.h"
+#include "vtl/tlist.h"
+
+/*
+ * This class holds the times of the events in a column, so that searching for
+ * a time only touches the column, instead of pulling a whole TraceEvent into
+ * the cache for every event that is looked at. An event has the same index
+ * here as in the event list of the parser. The times are stored as 32-bit
+ * deltas from per block bases, see vtl/timevector.h. The other fields are
+ * read from the TraceEvent, which the scans need for the arguments anyway.
+ */
+class EventColumns {
+public:
+	typedef vtl::Time::timeint_t timeint_t;
+	__always_inline void append(const TraceEvent &event);
+	__always_inline int size() const;
+	__always_inline timeint_t time(int index) const;
+	void clear();
+	int findIndexBefore(const vtl::Time &time) const;
+	int findIndexAfter(const vtl::Time &time) const;
+private:
+	vtl::TimeVector<vtl::TList> timev;
+};
+
+__always_inline void EventColumns::append(const TraceEvent &event)
+{
+	timev.append(event.timeNs);
+}
+
+__always_inline int EventColumns::size() const
+{
+	return timev.size();
+}
+
+__always_inline EventColumns::timeint_t EventColumns::time(int index) const
+{
+	return timev.at(index);
+}
+
+#endif /* EVENTCOLUMNS_H */
@@ -0,0 +1,135 @@
+// SPDX-License-Identifier: (GPL-2.0-or-later OR BSD-2-Clause)
+/*
+ * Traceshark - a visualizer for visualizing ftrace and perf traces
+ * Copyright (C) 2019  Viktor Rosendahl <viktor.rosendahl@gmail.com>
+ *
+ * This file is dual licensed: you can use it either under the terms of
+ * the GPL, or the BSD license, at your option.
+ *
+ *  a) This program is free software; you can redistribute it and/or
+ *     modify it under the terms of the GNU General Public License as
+ *     published by the Free Software Foundation; either version 2 of the
+ *     License, or (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public
+ *     License along with this library; if not, write to the Free
+ *     Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ *     MA 02110-1301 USA
+ *
+ * Alternatively,
+ *
+ *  b) Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *     1. Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *     2. Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *     CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *     INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *     MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *     DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *     CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *     NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *     LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *     HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *     CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ *     OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *     EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <algorithm>
+
+#include "analyzer/eventpostings.h"
+
+void EventPostings::clear()
+{
+	int i;
+
+	pidMap.clear();
+	for (i = 0; i < NR_EVENTS; i++)
+		undecoded[i].clear();
+}
+
+/* Returns the last index in list that is at most from, or -1 */
+int EventPostings::findLast(const QVector<int> &list, int from)
+{
+	QVector<int>::const_iterator iter;
+
+	iter = std::upper_bound(list.constBegin(), list.constEnd(), from);
+	if (iter == list.constBegin())
+		return -1;
+	return *(iter - 1);
+}
+
+/* Returns the first index in list that is at least from, or -1 */
+int EventPostings::findFirst(const QVector<int> &list, int from)
+{
+	QVector<int>::const_iterator iter;
+
+	iter = std::lower_bound(list.constBegin(), list.constEnd(), from);
+	if (iter == list.constEnd())
+		return -1;
+	return *iter;
+}
+
+/*
+ * Returns the index of the last event of kind for pid that is at from or
+ * before it, or -1 if there is none.
+ */
+int EventPostings::findPrevious(int pid, posting_t kind, int from) const
+{
+	const PidPostings *postings = pidMap.findValue(pid);
+
+	if (postings == nullptr)
+		return -1;
+	return findLast(postings->list[kind], from);
+}
+
+/*
+ * Returns the index of the first event of kind for pid that is at from or
+ * after it, or -1 if there is none.
+ */
+int EventPostings::findNext(int pid, posting_t kind, int from) const
+{
+	const PidPostings *postings = pidMap.findValue(pid);
+
+	if (postings == nullptr)
+		return -1;
+	return findFirst(postings->list[kind], from);
+}
+
+/*
+ * Returns the index of the event that caused the event at idx, which must be
+ * of kind and concern pid, or -1 if it is not known.
+ */
+int EventPostings::findCause(int pid, posting_t kind, int idx) const
+{
+	const PidPostings *postings = pidMap.findValue(pid);
+	QVector<int>::const_iterator iter;
+	const QVector<int> *list;
+
+	if (postings == nullptr)
+		return -1;
+	list = &postings->list[kind];
+	if (postings->cause[kind].size() != list->size())
+		return -1;
+
+	iter = std::lower_bound(list->constBegin(), list->constEnd(), idx);
+	if (iter == list->constEnd() || *iter != idx)
+		return -1;
+	return postings->cause[kind].at(iter - list->constBegin());
+}
@@ -0,0 +1,194 @@
+// SPDX-License-Identifier: (GPL-2.0-or-later OR BSD-2-Clause)
+/*
+ * Traceshark - a visualizer for visualizing ftrace and perf traces
+ * Copyright (C) 2019  Viktor Rosendahl <viktor.rosendahl@gmail.com>
+ *
+ * This file is dual licensed: you can use it either under the terms of
+ * the GPL, or the BSD license, at your option.
+ *
+ *  a) This program is free software; you can redistribute it and/or
+ *     modify it under the terms of the GNU General Public License as
+ *     published by the Free Software Foundation; either version 2 of the
+ *     License, or (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public
+ *     License along with this library; if not, write to the Free
+ *     Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ *     MA 02110-1301 USA
+ *
+ * Alternatively,
+ *
+ *  b) Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *     1. Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *     2. Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *     CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *     INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *     MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *     DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *     CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *     NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *     LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *     HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *     CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ *     OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *     EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef EVENTPOSTINGS_H
+#define EVENTPOSTINGS_H
+
+#include <QVector>
+
+#include "misc/traceshark.h"
+#include "parser/schedpayload.h"
+#include "parser/traceevent.h"
+#include "vtl/compiler.h"
+#include "vtl/pidmap.h"
+
+/* The kinds of events that are indexed for each pid */
+typedef enum {
+	POSTING_SWITCH_IN = 0,	/* sched_switch with the pid as newpid */
+	POSTING_SLEEP,		/* sched_switch from the pid to a sleep state */
+	POSTING_WAKEUP,		/* sched_wakeup of the pid */
+	POSTING_WAKEUP_NEW,	/* sched_wakeup_new of the pid */
+	POSTING_WAKING,		/* sched_waking of the pid */
+	NR_POSTINGS
+} posting_t;
+
+class PidPostings {
+public:
+	QVector<int> list[NR_POSTINGS];
+	/*
+	 * The event that caused each event in list, or -1 if it is not known.
+	 * This is the wakeup of a switch in and the waking of a wakeup. The
+	 * other kinds have no causes and their lists here are empty.
+	 */
+	QVector<int> cause[NR_POSTINGS];
+};
+
+/*
+ * This class holds sorted lists of the indices of the scheduler events, one
+ * list for each pid and kind of event, so that the searches for the previous
+ * or next event of a kind that concerns a particular task are binary searches
+ * instead of scans over all events. The events whose payload could not be
+ * decoded are kept in a list per event type, since they may concern any pid.
+ * The lists are appended to in the order of the events, so they are always
+ * sorted.
+ *
+ * When an event is added, it is also linked to the event that caused it:
+ * a switch in to the latest wakeup or wakeup_new of the task and a wakeup
+ * to the latest waking of the task. A wakeup is not linked to a waking if
+ * there is an undecoded waking between them, since that may have been the
+ * right one.
+ */
+class EventPostings {
+public:
+	__always_inline void add(const SchedPayloads *payloads,
+				 const TraceEvent &event, int idx);
+	void clear();
+	int findPrevious(int pid, posting_t kind, int from) const;
+	int findNext(int pid, posting_t kind, int from) const;
+	int findCause(int pid, posting_t kind, int idx) const;
+private:
+	__always_inline void append(int pid, posting_t kind, int idx);
+	__always_inline void append(int pid, posting_t kind, int idx,
+				    int cause);
+	__always_inline static int lastIndex(const QVector<int> &list);
+	static int findLast(const QVector<int> &list, int from);
+	static int findFirst(const QVector<int> &list, int from);
+	vtl::PidMap<PidPostings> pidMap;
+	QVector<int> undecoded[NR_EVENTS];
+};
+
+__always_inline void EventPostings::append(int pid, posting_t kind, int idx)
+{
+	pidMap[pid].list[kind].append(idx);
+}
+
+__always_inline void EventPostings::append(int pid, posting_t kind, int idx,
+					   int cause)
+{
+	PidPostings &postings = pidMap[pid];
+
+	postings.list[kind].append(idx);
+	postings.cause[kind].append(cause);
+}
+
+__always_inline int EventPostings::lastIndex(const QVector<int> &list)
+{
+	return list.isEmpty() ? -1 : list.last();
+}
+
+__always_inline void EventPostings::add(const SchedPayloads *payloads,
+					const TraceEvent &event, int idx)
+{
+	const SchedPayload *p;
+	const PidPostings *postings;
+	int cause, cnew;
+
+	switch (event.type) {
+	case SCHED_SWITCH:
+	case SCHED_WAKEUP:
+	case SCHED_WAKEUP_NEW:
+	case SCHED_WAKING:
+		break;
+	default:
+		return;
+	}
+
+	p = payloads->get(event);
+	if (p == nullptr) {
+		undecoded[event.type].append(idx);
+		return;
+	}
+
+	switch (event.type) {
+	case SCHED_SWITCH:
+		postings = pidMap.findValue(p->sw.newpid);
+		cause = -1;
+		if (postings != nullptr) {
+			cause = lastIndex(postings->list[POSTING_WAKEUP]);
+			cnew = lastIndex(postings->list[POSTING_WAKEUP_NEW]);
+			cause = TSMAX(cause, cnew);
+		}
+		append(p->sw.newpid, POSTING_SWITCH_IN, idx, cause);
+		if (!task_state_is_runnable(p->sw.state))
+			append(p->sw.oldpid, POSTING_SLEEP, idx);
+		break;
+	case SCHED_WAKEUP:
+	case SCHED_WAKEUP_NEW:
+		postings = pidMap.findValue(p->wakeup.pid);
+		cause = -1;
+		if (postings != nullptr)
+			cause = lastIndex(postings->list[POSTING_WAKING]);
+		if (cause < lastIndex(undecoded[SCHED_WAKING]))
+			cause = -1;
+		append(p->wakeup.pid, event.type == SCHED_WAKEUP ?
+		       POSTING_WAKEUP : POSTING_WAKEUP_NEW, idx, cause);
+		break;
+	case SCHED_WAKING:
+		append(p->wakeup.pid, POSTING_WAKING, idx);
+		break;
+	default:
+		break;
+	}
+}
+
+#endif /* EVENTPOSTINGS_H */
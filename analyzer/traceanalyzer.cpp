@@ -60,6 +60,7 @@ extern "C" {
 }
 
 #include <cerrno>
+#include <cmath>
 
 #include <QtGlobal>
 #include <QList>
@@ -70,12 +71,12 @@ extern "C" {
 
 #include "analyzer/cpufreq.h"
 #include "analyzer/cpuidle.h"
+#include "parser/eventargs.h"
 #include "parser/genericparams.h"
 #include "analyzer/traceanalyzer.h"
 #include "parser/tracefile.h"
 #include "parser/traceparser.h"
 #include "misc/errors.h"
-#include "misc/setting.h"
 #include "misc/traceshark.h"
 #include "threads/workthread.h"
 #include "threads/workitem.h"
@@ -92,18 +93,28 @@ __always_inline static int clib_close(int fd)
 	return close(fd);
 }
 
+AnalysisPreview::AnalysisPreview():
+	nrEvents(0), nrCPUs(0), startTime(VTL_TIME_ZERO),
+	endTime(VTL_TIME_ZERO), maxFreq(0), maxIdleState(0)
+{}
+
 TraceAnalyzer::TraceAnalyzer()
 	: events(nullptr), cpuTaskMaps(nullptr), cpuFreq(nullptr),
-	  cpuIdle(nullptr), black(0, 0, 0), white(255, 255, 255),
-	  migrationOffset(0), migrationScale(0), maxCPU(0), nrCPUs(0),
-	  endTime(false, 0, 0, 6), startTime(false, 0, 0, 6), endTimeDbl(0),
-	  startTimeDbl(0), endTimeIdx(0), maxFreq(0), minFreq(0),
-	  maxIdleState(0), minIdleState(0), timePrecision(0), CPUs(nullptr),
-	  customPlot(nullptr), pidFilterInclusive(false),
-	  OR_pidFilterInclusive(false)
+	  cpuIdle(nullptr), processing(false), black(0, 0, 0),
+	  white(255, 255, 255),
+	  maxCPU(0), nrCPUs(0),
+	  endTime(false, 0, 0, 6), startTime(false, 0, 0, 6), endTimeIdx(0),
+	  maxFreq(0), minFreq(0),
+	  maxIdleState(0), minIdleState(0), timePrecision(0), processedIndex(0),
+	  CPUs(nullptr), cpuSched(nullptr),
+	  pidFilterInclusive(false),
+	  OR_pidFilterInclusive(false), previewRequested(0),
+	  previewReady(false)
 {
 	taskNamePool = new StringPool(16384, 256);
 	parser = new TraceParser();
+	processThread = new WorkThread<TraceAnalyzer>
+		(QString("processThread"), this, &TraceAnalyzer::threadProcess);
 	filterState.disableAll();
 	OR_filterState.disableAll();
 }
@@ -113,26 +124,122 @@ TraceAnalyzer::~TraceAnalyzer()
 	int dummy;
 
 	TraceAnalyzer::close(&dummy);
+	delete processThread;
 	delete parser;
 	delete taskNamePool;
 }
 
-int TraceAnalyzer::open(const QString &fileName)
+/*
+ * If follow is true, the trace is not processed with processTrace(), instead
+ * updateTrace() should be called periodically.
+ */
+int TraceAnalyzer::open(const QString &fileName, bool follow,
+			int64_t startPos)
 {
-	int retval = parser->open(fileName);
-	if (retval == 0)
+	int retval = parser->open(fileName, follow, startPos);
+	if (retval == 0) {
 		prepareDataStructures();
+		resetProperties();
+		openAnalysisCache(fileName);
+	}
 	return retval;
 }
 
+/*
+ * The analysis cache belongs to the events of the trace index, so it can only
+ * be used if the events are restored from the index.
+ */
+void TraceAnalyzer::openAnalysisCache(const QString &fileName)
+{
+	int64_t nrEvents = parser->getIndexedEvents();
+
+	cacheName = fileName.toLocal8Bit();
+	cacheName.append(ANALYSISCACHE_SUFFIX);
+	if (nrEvents > 0)
+		analysisCache.open(cacheName.data(),
+				   &parser->traceFile->fileInfo, nrEvents);
+}
+
+/*
+ * This is called by processThread before any events have been processed.
+ * Returns true if the tasks, the CPU vectors and the migrations have been
+ * restored from the cache, in which case only the columns and the postings
+ * need to be built from the events.
+ */
+bool TraceAnalyzer::restoreAnalysis()
+{
+	bool ok;
+
+	if (!analysisCache.isOpen())
+		return false;
+	ok = analysisCache.restore(this);
+	analysisCache.close();
+	if (!ok)
+		clearAnalysis();
+	return ok;
+}
+
+/*
+ * This undoes a restoreAnalysis() that failed half way, or the processing of
+ * the events before they are processed again by slideWindow(). The colors of
+ * the tasks are kept.
+ */
+void TraceAnalyzer::clearAnalysis()
+{
+	unsigned int cpu;
+
+	for (cpu = 0; cpu < NR_CPUS_ALLOWED; cpu++) {
+		cpuTaskMaps[cpu].clear();
+		cpuFreq[cpu].timev.clear();
+		cpuFreq[cpu].data.clear();
+		cpuFreq[cpu].hasTail = false;
+		cpuIdle[cpu].timev.clear();
+		cpuIdle[cpu].data.clear();
+		cpuSched[cpu].clear();
+		CPUs[cpu] = CPU();
+	}
+	taskMap.clear();
+	columns.clear();
+	postings.clear();
+	migrations.clear();
+	taskNamePool->clear();
+	maxCPU = 0;
+	minFreq = UINT_MAX;
+	maxFreq = 0;
+	minIdleState = INT_MAX;
+	maxIdleState = INT_MIN;
+}
+
+/*
+ * This is called by processThread after the processing, before the tails are
+ * added. Failing to write the cache is not an error, it only means that the
+ * trace will be processed again the next time.
+ */
+void TraceAnalyzer::writeAnalysisCache()
+{
+	int ts_errno;
+
+	if (parser->isFollowing() || events == nullptr || events->size() == 0)
+		return;
+	if (!parser->traceFile->isIntact(&ts_errno))
+		return;
+	AnalysisCache::write(cacheName.data(), &parser->traceFile->fileInfo,
+			     events->size(), this);
+}
+
 void TraceAnalyzer::prepareDataStructures()
 {
-	cpuTaskMaps = new vtl::AVLTree<int, CPUTask,
-				       vtl::AVLBALANCE_USEPOINTERS>
-		[NR_CPUS_ALLOWED];
+	unsigned int cpu;
+
+	cpuTaskMaps = new vtl::PidMap<CPUTask>[NR_CPUS_ALLOWED];
 	cpuFreq = new CpuFreq[NR_CPUS_ALLOWED];
 	cpuIdle = new CpuIdle[NR_CPUS_ALLOWED];
 	CPUs = new CPU[NR_CPUS_ALLOWED];
+	cpuSched = new CPUSched[NR_CPUS_ALLOWED];
+	for (cpu = 0; cpu < NR_CPUS_ALLOWED; cpu++) {
+		cpuSched[cpu].analyzer = this;
+		cpuSched[cpu].cpu = cpu;
+	}
 	schedOffset.resize(0);
 	schedOffset.resize(NR_CPUS_ALLOWED);
 	schedScale.resize(0);
@@ -154,6 +261,10 @@ bool TraceAnalyzer::isOpen() const
 
 void TraceAnalyzer::close(int *ts_errno)
 {
+	if (processing) {
+		processThread->wait();
+		processing = false;
+	}
 	if (cpuTaskMaps != nullptr) {
 		delete[] cpuTaskMaps;
 		cpuTaskMaps = nullptr;
@@ -170,18 +281,18 @@ void TraceAnalyzer::close(int *ts_errno)
 		delete[] CPUs;
 		CPUs = nullptr;
 	}
-
-	DEFINE_TASKMAP_ITERATOR(iter) = taskMap.begin();
-	while (iter != taskMap.end()) {
-		Task *task = iter.value().task;
-		delete task;
-		iter++;
+	if (cpuSched != nullptr) {
+		delete[] cpuSched;
+		cpuSched = nullptr;
 	}
 
 	taskMap.clear();
+	columns.clear();
+	postings.clear();
 	disableAllFilters();
 	migrations.clear();
 	colorMap.clear();
+	analysisCache.close();
 	parser->close(ts_errno);
 	taskNamePool->clear();
 }
@@ -190,47 +301,268 @@ void TraceAnalyzer::resetProperties()
 {
 	maxCPU = 0;
 	startTime = VTL_TIME_ZERO;
-	startTimeDbl = 0;
 	endTime = VTL_TIME_ZERO;
-	endTimeDbl = 0;
 	endTimeIdx = 0;
 	minFreq = UINT_MAX;
 	maxFreq = 0;
 	minIdleState = INT_MAX;
 	maxIdleState = INT_MIN;
 	timePrecision = 0;
+	processedIndex = 0;
 	events = nullptr;
+	payloads = nullptr;
 }
 
 void TraceAnalyzer::processTrace()
+{
+	startProcessing();
+	waitProcessing();
+}
+
+/*
+ * This starts the processing in processThread, which consumes the batches of
+ * events as the parser produces them. The caller can use requestPreview() and
+ * takePreview() to show the progress, and must call waitProcessing() when
+ * processingFinished() returns true, or whenever it wants to block.
+ */
+void TraceAnalyzer::startProcessing()
 {
 	resetProperties();
-	/*
-	 * We do the processing from the main thread, since otherwise
-	 * we would have to wait for it
-	 */
-	threadProcess();
+	previewMutex.lock();
+	previewReady = false;
+	previewRequested.storeRelease(0);
+	previewMutex.unlock();
+	processing = true;
+	processThread->start();
+}
+
+bool TraceAnalyzer::processingFinished() const
+{
+	return !processing || processThread->isFinished();
+}
+
+void TraceAnalyzer::waitProcessing()
+{
+	if (!processing)
+		return;
+	processThread->wait();
+	processing = false;
 	colorizeTasks();
 }
 
+/*
+ * The preview is made by processThread after the next batch of events, it can
+ * then be collected with takePreview().
+ */
+void TraceAnalyzer::requestPreview()
+{
+	previewRequested.storeRelease(1);
+}
+
+bool TraceAnalyzer::takePreview(AnalysisPreview &pv)
+{
+	previewMutex.lock();
+	if (!previewReady) {
+		previewMutex.unlock();
+		return false;
+	}
+	pv = preview;
+	/* Don't keep references, so that processThread can append cheaply */
+	preview.cpuFreq.clear();
+	preview.cpuIdle.clear();
+	previewReady = false;
+	previewMutex.unlock();
+	return true;
+}
+
+/*
+ * This is called by processThread. The vectors are implicitly shared, so the
+ * copies are cheap until processThread appends to them again.
+ */
+void TraceAnalyzer::makePreview()
+{
+	unsigned int cpu;
+	unsigned int n = maxCPU + 1;
+	int s = columns.size();
+
+	previewMutex.lock();
+	preview.nrEvents = s;
+	preview.nrCPUs = n;
+	preview.startTime = startTime;
+	preview.endTime = s > 0 ? events->at(s - 1).getTime() : startTime;
+	preview.maxFreq = maxFreq;
+	preview.maxIdleState = maxIdleState;
+	preview.cpuFreq.resize(n);
+	preview.cpuIdle.resize(n);
+	for (cpu = 0; cpu < n; cpu++) {
+		preview.cpuFreq[cpu] = cpuFreq[cpu];
+		preview.cpuIdle[cpu] = cpuIdle[cpu];
+	}
+	previewReady = true;
+	previewRequested.storeRelease(0);
+	previewMutex.unlock();
+}
+
 void TraceAnalyzer::threadProcess()
 {
+	bool restored;
+
 	parser->waitForTraceType();
 	events = parser->getEventsTList();
+	payloads = parser->getSchedPayloads();
 	switch (getTraceType()) {
 	case TRACE_TYPE_FTRACE:
-		processFtrace();
+		restored = restoreAnalysis();
+		processFtrace(restored);
 		break;
 	case TRACE_TYPE_PERF:
-		processPerf();
+		restored = restoreAnalysis();
+		processPerf(restored);
 		break;
 	default:
 		return;
 	}
+	if (!restored)
+		writeAnalysisCache();
 	processSchedAddTail();
 	processFreqAddTail();
 }
 
+/*
+ * This is used instead of processTrace() when the trace is followed. It
+ * processes the events that have been parsed since the previous call, without
+ * blocking. Returns true if there were new events, in which case all the
+ * graphs need to be recreated.
+ */
+bool TraceAnalyzer::updateTrace()
+{
+	bool eof;
+	int index;
+
+	if (!parser->pollTraceType())
+		return false;
+	events = parser->getEventsTList();
+	payloads = parser->getSchedPayloads();
+	if (!tracetype_is_valid(getTraceType()))
+		return false;
+	parser->pollNextBatch(eof, index);
+	if (index <= processedIndex)
+		return false;
+
+	if (processedIndex == 0)
+		updateStartTime();
+	else
+		removeTails();
+
+	if (getTraceType() == TRACE_TYPE_FTRACE)
+		processFtraceEvents(processedIndex, index);
+	else
+		processPerfEvents(processedIndex, index);
+	processedIndex = index;
+
+	updateEndTime();
+	processSchedAddTail();
+	processFreqAddTail();
+	colorizeTasks();
+	if (isFiltered())
+		processAllFilters();
+	return true;
+}
+
+bool TraceAnalyzer::isFollowing() const
+{
+	return parser->isFollowing();
+}
+
+/*
+ * These are used by the next open(). Zero for bufferSize or nrBuffers means
+ * that they are computed from the size of the file and the caches.
+ */
+void TraceAnalyzer::setPipelineConfig(unsigned int bufferSize,
+				      unsigned int nrBuffers, int batchSize)
+{
+	parser->setBufferSize(bufferSize);
+	parser->setNrBuffers(nrBuffers);
+	parser->setBatchSize(batchSize);
+}
+
+const StallStats &TraceAnalyzer::getStallStats() const
+{
+	return parser->getStallStats();
+}
+
+/*
+ * Removes the first nrEvict events of a followed trace and processes the
+ * remaining events again, since the tasks and the CPU vectors refer to the
+ * events by their indices. The caller must have deleted the graphs, because
+ * the tasks that they belong to are deleted.
+ */
+void TraceAnalyzer::slideWindow(int nrEvict)
+{
+	parser->evictEvents(nrEvict);
+	clearAnalysis();
+	processedIndex = 0;
+	updateTrace();
+}
+
+void TraceAnalyzer::updateStartTime()
+{
+	startTime = (*events)[0].getTime();
+	AbstractTask::setStartTime(startTime);
+}
+
+void TraceAnalyzer::updateEndTime()
+{
+	endTime = events->last().getTime();
+	endTimeIdx = events->size() - 1;
+	AbstractTask::setEndTime(endTime);
+	nrCPUs = maxCPU + 1;
+	timePrecision = guessTimePrecision();
+}
+
+/*
+ * Undoes processSchedAddTail() and processFreqAddTail(), so that more events
+ * can be processed.
+ */
+void TraceAnalyzer::removeTails()
+{
+	unsigned int cpu;
+
+	for (cpu = 0; cpu < getNrCPUs(); cpu++) {
+		DEFINE_CPUTASKMAP_ITERATOR(iter) = cpuTaskMaps[cpu].begin();
+		while (iter != cpuTaskMaps[cpu].end()) {
+			CPUTask &task = iter.value();
+			iter++;
+			if (!task.hasTail)
+				continue;
+			task.schedTimev.removeLast();
+			task.schedData.removeLast();
+			task.schedEventIdx.removeLast();
+			task.hasTail = false;
+		}
+	}
+
+	DEFINE_TASKMAP_ITERATOR(iter) = taskMap.begin();
+	while (iter != taskMap.end()) {
+		Task &task = iter.value();
+		iter++;
+		if (!task.hasTail)
+			continue;
+		task.schedTimev.removeLast();
+		task.schedData.removeLast();
+		task.schedEventIdx.removeLast();
+		task.hasTail = false;
+	}
+
+	for (cpu = 0; cpu <= maxCPU; cpu++) {
+		if (!cpuFreq[cpu].hasTail)
+			continue;
+		cpuFreq[cpu].data.removeLast();
+		cpuFreq[cpu].timev.removeLast();
+		cpuFreq[cpu].hasTail = false;
+	}
+}
+
 void TraceAnalyzer::processSchedAddTail()
 {
 	/* Add the "tail" to all tasks, i.e. extend them until endTime */
@@ -240,7 +572,7 @@ void TraceAnalyzer::processSchedAddTail()
 		while (iter != cpuTaskMaps[cpu].end()) {
 			CPUTask &task = iter.value();
 			unsigned int d;
-			double lastTime;
+			vtl::Time::timeint_t lastTime;
 			int lastIndex = task.schedTimev.size() - 1;
 			iter++;
 			/*
@@ -252,33 +584,35 @@ void TraceAnalyzer::processSchedAddTail()
 				continue;
 			/* Check if tail is necessary */
 			lastTime = task.schedTimev[lastIndex];
-			if (lastTime >= endTimeDbl)
+			if (lastTime >= endTime.toNanoseconds())
 				continue;
 			d = task.schedData.read(task.schedData.size() - 1);
-			task.schedTimev.append(endTimeDbl);
+			task.schedTimev.append(endTime);
 			task.schedData.append(d);
 			task.schedEventIdx.append(endTimeIdx);
+			task.hasTail = true;
 		}
 	}
 
 	DEFINE_TASKMAP_ITERATOR(iter) = taskMap.begin();
 	while (iter != taskMap.end()) {
-		Task &task = *iter.value().task;
+		Task &task = iter.value();
 		unsigned int d;
-		double lastTime;
+		vtl::Time::timeint_t lastTime;
 		int s = task.schedTimev.size();
 		iter++;
 		task.generateDisplayName();
 		if (s <= 0)
 			continue;
 		lastTime = task.schedTimev[s - 1];
-		if (lastTime >= endTimeDbl
+		if (lastTime >= endTime.toNanoseconds()
 		    || task.exitStatus == STATUS_FINAL)
 			continue;
 		d = task.schedData.read(task.schedData.size() - 1);
-		task.schedTimev.append(endTimeDbl);
+		task.schedTimev.append(endTime);
 		task.schedData.append(d);
 		task.schedEventIdx.append(endTimeIdx);
+		task.hasTail = true;
 	}
 }
 
@@ -292,6 +626,7 @@ void TraceAnalyzer::processFreqAddTail()
 			double freq = cpuFreq[cpu].data.last();
 			cpuFreq[cpu].data.append(freq);
 			cpuFreq[cpu].timev.append(end);
+			cpuFreq[cpu].hasTail = true;
 		}
 	}
 }
@@ -305,15 +640,15 @@ unsigned int TraceAnalyzer::guessTimePrecision()
 	if (s < 1)
 		return r;
 
-	p = events->at(0).time.getPrecision();
+	p = events->at(0).getTime().getPrecision();
 	if (p > r)
 		r = p;
 
-	p = events->at(s / 2).time.getPrecision();
+	p = events->at(s / 2).getTime().getPrecision();
 	if (p > r)
 		r = p;
 
-	p = events->at(s - 1).time.getPrecision();
+	p = events->at(s - 1).getTime().getPrecision();
 	if (p > r)
 		r = p;
 
@@ -322,37 +657,29 @@ unsigned int TraceAnalyzer::guessTimePrecision()
 
 /*
  * This function is supposed to be called seldom, thus it's ok to not have it
- * as optimized as the other functions, e.g. in terms of inlining
+ * as optimized as the other functions, e.g. in terms of inlining. It does the
+ * CPU part, the Task part is done by mergeWrongTaskOnCPU().
  */
-void TraceAnalyzer::handleWrongTaskOnCPU(const TraceEvent &/*event*/,
-					 unsigned int cpu,
-					 CPU *eventCPU, int oldpid,
+void TraceAnalyzer::handleWrongTaskOnCPU(unsigned int cpu, CPU *eventCPU,
+					 int oldpid,
 					 const vtl::Time &oldtime,
-					 int idx)
+					 int idx, SchedRecord &rec)
 {
 	int epid = eventCPU->pidOnCPU;
-	vtl::Time prevtime, faketime;
-	double fakeDbl;
+	vtl::Time faketime;
 	CPUTask *cpuTask;
-	Task *task;
+
+	rec.wrongPid = epid;
+	rec.wrongIdx = eventCPU->lastSchedIdx;
+	rec.wrongTime = eventCPU->lastSched + FAKE_DELTA;
 
 	if (epid > 0) {
 		cpuTask = &cpuTaskMaps[cpu][epid];
 		Q_ASSERT(!cpuTask->isNew);
 		Q_ASSERT(!cpuTask->schedTimev.isEmpty());
-		prevtime = eventCPU->lastSched;
-		faketime = prevtime + FAKE_DELTA;
-		fakeDbl = faketime.toDouble();
-		cpuTask->schedTimev.append(fakeDbl);
+		cpuTask->schedTimev.append(rec.wrongTime);
 		cpuTask->schedData.append(FLOOR_BIT);
-		cpuTask->schedEventIdx.append(eventCPU->lastSchedIdx);
-
-		task = findTask(epid);
-		Q_ASSERT(task != nullptr);
-		task->lastSleepEntry = faketime;
-		task->schedTimev.append(fakeDbl);
-		task->schedData.append(FLOOR_BIT);
-		task->schedEventIdx.append(eventCPU->lastSchedIdx);
+		cpuTask->schedEventIdx.append(rec.wrongIdx);
 	}
 
 	if (oldpid > 0) {
@@ -362,22 +689,82 @@ void TraceAnalyzer::handleWrongTaskOnCPU(const TraceEvent &/*event*/,
 		}
 		cpuTask->isNew = false;
 		faketime = oldtime - FAKE_DELTA;
-		fakeDbl = faketime.toDouble();
-		cpuTask->schedTimev.append(fakeDbl);
+		cpuTask->schedTimev.append(faketime);
 		cpuTask->schedData.append(SCHED_BIT);
 		cpuTask->schedEventIdx.append(idx);
+	}
+}
 
-		task = &taskMap[oldpid].getTask();
+void TraceAnalyzer::mergeWrongTaskOnCPU(const SchedRecord &rec, int oldpid,
+					const vtl::Time &oldtime, int idx)
+{
+	vtl::Time faketime;
+	Task *task;
+
+	if (rec.wrongPid > 0) {
+		task = findTask(rec.wrongPid);
+		Q_ASSERT(task != nullptr);
+		task->lastSleepEntry = rec.wrongTime;
+		task->schedTimev.append(rec.wrongTime);
+		task->schedData.append(FLOOR_BIT);
+		task->schedEventIdx.append(rec.wrongIdx);
+	}
+
+	if (oldpid > 0) {
+		faketime = oldtime - FAKE_DELTA;
+		task = &taskMap[oldpid];
 		if (task->isNew) {
 			task->pid = oldpid;
 		}
 		task->isNew = false;
-		task->schedTimev.append(fakeDbl);
+		task->schedTimev.append(faketime);
 		task->schedData.append(SCHED_BIT);
 		task->schedEventIdx.append(idx);
 	}
 }
 
+/*
+ * This is the second phase of the processing, it is run in parallel for all
+ * CPUs that have queued events.
+ */
+void TraceAnalyzer::extractCPUSched(CPUSched *sched)
+{
+	int s = sched->eventIdx.size();
+	int i;
+	int idx;
+
+	for (i = 0; i < s; i++) {
+		idx = sched->eventIdx.at(i);
+		const TraceEvent &event = events->at(idx);
+		if (event.type == SCHED_SWITCH)
+			__extractSwitchEvent(event, idx, sched);
+	}
+}
+
+void TraceAnalyzer::extractSched()
+{
+	QList<AbstractWorkItem*> workList;
+	unsigned int cpu;
+	int i, s;
+
+	for (cpu = 0; cpu <= maxCPU; cpu++) {
+		CPUSched *sched = &cpuSched[cpu];
+		if (sched->isEmpty())
+			continue;
+		WorkItem<CPUSched> *schedItem = new WorkItem<CPUSched>
+			(sched, &CPUSched::extract);
+		workList.append(schedItem);
+		processingQueue.addWorkItem(schedItem);
+	}
+
+	processingQueue.start();
+	processingQueue.wait();
+
+	s = workList.size();
+	for (i = 0; i < s; i++)
+		delete workList[i];
+}
+
 void TraceAnalyzer::colorizeTasks()
 {
 	unsigned int cpu;
@@ -470,70 +857,18 @@ retry:
 }
 
 
-int TraceAnalyzer::binarySearch(const vtl::Time &time, int start, int end)
-	const
-{
-	int pivot = (end + start) / 2;
-	if (pivot == start)
-		return pivot;
-	if (time < events->at(pivot).time)
-		return binarySearch(time, start, pivot);
-	else
-		return binarySearch(time, pivot, end);
-}
-
 int TraceAnalyzer::binarySearchFiltered(const vtl::Time &time, int start,
 					int end) const
 {
 	int pivot = (end + start) / 2;
 	if (pivot == start)
 		return pivot;
-	if (time < filteredEvents.at(pivot)->time)
+	if (time < filteredEvents.at(pivot)->getTime())
 		return binarySearchFiltered(time, start, pivot);
 	else
 		return binarySearchFiltered(time, pivot, end);
 }
 
-int TraceAnalyzer::findIndexBefore(const vtl::Time &time) const
-{
-	if (events->size() < 1)
-		return -1;
-
-	int end = events->size() - 1;
-
-	/* Basic sanity checks */
-	if (time > events->at(end).time)
-		return end;
-	if (time < events->at(0).time)
-		return 0;
-
-	int c = binarySearch(time, 0, end);
-
-	while (c > 0 && events->at(c).time >= time)
-		c--;
-	return c;
-}
-
-int TraceAnalyzer::findIndexAfter(const vtl::Time &time) const
-{
-	if (events->size() < 1)
-		return -1;
-
-	int end = events->size() - 1;
-
-	/* Basic sanity checks */
-	if (time > events->at(end).time)
-		return end;
-	if (time < events->at(0).time)
-		return 0;
-
-	int c = binarySearch(time, 0, end);
-
-	while (c < end && events->at(c).time <= time)
-		c++;
-	return c;
-}
-
 int TraceAnalyzer::findFilteredIndexBefore(const vtl::Time &time) const
 {
 	if (filteredEvents.size() < 1)
@@ -542,14 +877,14 @@ int TraceAnalyzer::findFilteredIndexBefore(const vtl::Time &time) const
 	int end = filteredEvents.size() - 1;
 
 	/* Basic sanity checks */
-	if (time > filteredEvents.at(end)->time)
+	if (time > filteredEvents.at(end)->getTime())
 		return end;
-	if (time < filteredEvents.at(0)->time)
+	if (time < filteredEvents.at(0)->getTime())
 		return 0;
 
 	int c = binarySearchFiltered(time, 0, end);
 
-	while (c > 0 && filteredEvents.at(c)->time >= time)
+	while (c > 0 && filteredEvents.at(c)->getTime() >= time)
 		c--;
 	return c;
 }
@@ -558,54 +893,41 @@ const TraceEvent *TraceAnalyzer::findPreviousSchedEvent(const vtl::Time &time,
 							int pid,
 							int *index) const
 {
-	int start = findIndexBefore(time);
-	int i;
+	int i = columns.findIndexBefore(time);
 
-	if (start < 0)
+	if (i < 0)
 		return nullptr;
 
-	for (i = start; i >= 0; i--) {
-		const TraceEvent &event = events->at(i);
-		if (event.type == SCHED_SWITCH  &&
-		    generic_sched_switch_newpid(event) == pid) {
-			if (index != nullptr)
-				*index = i;
-			return &event;
-		}
-	}
-	return nullptr;
+	i = postings.findPrevious(pid, POSTING_SWITCH_IN, i);
+	if (i < 0)
+		return nullptr;
+	if (index != nullptr)
+		*index = i;
+	return &events->at(i);
 }
 
 const TraceEvent *TraceAnalyzer::findNextSchedSleepEvent(const vtl::Time &time,
 							 int pid,
 							 int *index) const
 {
-	int start = findIndexAfter(time);
-	int i;
-	int s = events->size();
+	int i = columns.findIndexAfter(time);
 
-	if (start < 0)
+	if (i < 0)
 		return nullptr;
 
-	for (i = start; i < s; i++) {
-		const TraceEvent &event = events->at(i);
-		if (event.type == SCHED_SWITCH &&
-		    generic_sched_switch_oldpid(event) == pid &&
-		    !task_state_is_runnable(
-			    generic_sched_switch_state(event))) {
-			if (index != nullptr)
-				*index = i;
-			return &event;
-		}
-	}
-	return nullptr;
+	i = postings.findNext(pid, POSTING_SLEEP, i);
+	if (i < 0)
+		return nullptr;
+	if (index != nullptr)
+		*index = i;
+	return &events->at(i);
 }
 
 const TraceEvent *TraceAnalyzer::findFilteredEvent(int index,
 						   int *filterIndex) const
 {
 	const TraceEvent *eptr = &events->at(index);
-	vtl::Time time = eptr->time;
+	vtl::Time time = eptr->getTime();
 	int s = filteredEvents.size();
 	int i;
 	int start = findFilteredIndexBefore(time);
@@ -619,7 +941,7 @@ const TraceEvent *TraceAnalyzer::findFilteredEvent(int index,
 			*filterIndex = i;
 			return cptr;
 		}
-		if (cptr->time > time)
+		if (cptr->getTime() > time)
 			break;
 	}
 	return nullptr;
@@ -630,67 +952,151 @@ const TraceEvent *TraceAnalyzer::findPreviousWakEvent(int startidx,
 						      event_t wanted,
 						      int *index) const
 {
-	int i;
-	int epid = 0;
+	int i, n;
+
+	if (startidx < 0 || startidx >= columns.size())
+		return nullptr;
 
-	if (startidx < 0 || startidx >= (int) events->size())
+	switch (wanted) {
+	case SCHED_WAKEUP:
+		/* The wakeup_new events count as wakeups */
+		i = postings.findPrevious(pid, POSTING_WAKEUP, startidx);
+		n = postings.findPrevious(pid, POSTING_WAKEUP_NEW, startidx);
+		i = TSMAX(i, n);
+		break;
+	case SCHED_WAKEUP_NEW:
+		i = postings.findPrevious(pid, POSTING_WAKEUP_NEW, startidx);
+		break;
+	case SCHED_WAKING:
+		i = postings.findPrevious(pid, POSTING_WAKING, startidx);
+		break;
+	default:
 		return nullptr;
+	}
 
-	if (wanted != SCHED_WAKEUP && wanted != SCHED_WAKEUP_NEW &&
-	    wanted != SCHED_WAKING)
+	if (i < 0)
 		return nullptr;
+	if (index != nullptr)
+		*index = i;
+	return &events->at(i);
+}
 
-	for (i = startidx; i >= 0; i--) {
-		const TraceEvent &event = events->at(i);
-		if ((event.type == wanted ||
-		     (wanted == SCHED_WAKEUP &&
-		      event.type == SCHED_WAKEUP_NEW))) {
-			if (wanted == SCHED_WAKING)
-				epid = generic_sched_waking_pid(event);
-			else
-				epid = generic_sched_wakeup_pid(event);
-			if (epid != pid)
-				continue;
-			if (index != nullptr)
-				*index = i;
-			return &event;
-		}
+/*
+ * Returns the index of event, which must point to one of the processed
+ * events, or -1 if it is not found.
+ */
+int TraceAnalyzer::findEventIndex(const TraceEvent *event) const
+{
+	EventColumns::timeint_t t = event->timeNs;
+	int s = columns.size();
+	int i;
+
+	for (i = columns.findIndexBefore(event->getTime());
+	     i >= 0 && i < s && columns.time(i) <= t; i++) {
+		if (&events->at(i) == event)
+			return i;
+	}
+	return -1;
+}
+
+/*
+ * Returns the index of the sched_waking that the wakeup event at idx is linked
+ * to, or -1 if there is none.
+ */
+int TraceAnalyzer::findWakingIndex(const TraceEvent &wakeup, int idx) const
+{
+	int wpid = generic_sched_wakeup_pid(wakeup);
+
+	if (wpid == INT_MAX)
+		return -1;
+
+	switch (wakeup.type) {
+	case SCHED_WAKEUP:
+		return postings.findCause(wpid, POSTING_WAKEUP, idx);
+	case SCHED_WAKEUP_NEW:
+		return postings.findCause(wpid, POSTING_WAKEUP_NEW, idx);
+	default:
+		return -1;
 	}
-	return nullptr;
 }
 
 const TraceEvent *TraceAnalyzer::findWakingEvent(const TraceEvent *wakeup,
 						 int *index) const
 {
-	int i;
-	int startidx = findIndexBefore(wakeup->time);
-	int wpid = generic_sched_wakeup_pid(*wakeup);
-	int pid;
+	int i = findEventIndex(wakeup);
 
-	if (wpid == INT_MAX)
+	if (i < 0)
 		return nullptr;
 
-	if (startidx < 0 || startidx >= (int) events->size())
+	i = findWakingIndex(*wakeup, i);
+	if (i < 0)
 		return nullptr;
+	if (index != nullptr)
+		*index = i;
+	return &events->at(i);
+}
 
-	for (i = startidx; i >= 0; i--) {
-		const TraceEvent &event = events->at(i);
-		if (event.type != SCHED_WAKING)
-			continue;
-		pid = generic_sched_waking_pid(event);
-		if (pid == wpid) {
-			if (index != nullptr)
-				*index = i;
-			return &event;
-		} else if (pid == INT_MAX) {
-			/*
-			 * If we encounter a single waking event where we
-			 * can not parse the arguments, then we give up
-			 */
+/*
+ * Returns the event of type wanted that caused the sched_switch event at
+ * schedIndex to switch in its new task. If wanted is SCHED_WAKEUP, then this
+ * is the sched_wakeup or sched_wakeup_new, if it's SCHED_WAKING, then this is
+ * the sched_waking of that wakeup.
+ */
+const TraceEvent *TraceAnalyzer::findSchedCause(int schedIndex,
+						event_t wanted,
+						int *index) const
+{
+	int i, pid;
+
+	if (schedIndex < 0 || schedIndex >= columns.size())
+		return nullptr;
+
+	if (wanted != SCHED_WAKEUP && wanted != SCHED_WAKING)
+		return nullptr;
+
+	const TraceEvent &event = events->at(schedIndex);
+	if (event.type != SCHED_SWITCH)
+		return nullptr;
+	pid = generic_sched_switch_newpid(event);
+	if (pid == INT_MAX)
+		return nullptr;
+
+	i = postings.findCause(pid, POSTING_SWITCH_IN, schedIndex);
+	if (i < 0) {
+		/*
+		 * The switch in is not linked to a wakeup, e.g. because only
+		 * the waking events were traced, so we fall back to the
+		 * latest waking of the task
+		 */
+		if (wanted == SCHED_WAKING)
+			return findPreviousWakEvent(schedIndex, pid,
+						    SCHED_WAKING, index);
+		return nullptr;
+	}
+
+	if (wanted == SCHED_WAKING) {
+		i = findWakingIndex(events->at(i), i);
+		if (i < 0)
 			return nullptr;
-		}
 	}
-	return nullptr;
+	if (index != nullptr)
+		*index = i;
+	return &events->at(i);
+}
+
+/*
+ * Tells which task on which CPU did the wakeup or waking at index. A wakeup
+ * is done by the task that did the waking that it is linked to, if any,
+ * otherwise by the task that is on the CPU of the wakeup.
+ */
+void TraceAnalyzer::findWaker(int index, int *pid, unsigned int *cpu) const
+{
+	int i = findWakingIndex(events->at(index), index);
+
+	if (i >= 0)
+		index = i;
+	*pid = events->at(index).pid;
+	*cpu = events->at(index).cpu;
 }
 
 void TraceAnalyzer::setSchedOffset(unsigned int cpu, double offset)
@@ -723,21 +1129,6 @@ void TraceAnalyzer::setCpuFreqScale(unsigned int cpu, double scale)
 	cpuFreqScale[cpu] = scale / maxFreq;
 }
 
-void TraceAnalyzer::setMigrationOffset(double offset)
-{
-	migrationOffset = offset;
-}
-
-void TraceAnalyzer::setMigrationScale(double scale)
-{
-	migrationScale = scale;
-}
-
-void TraceAnalyzer::setQCustomPlot(QCustomPlot *plot)
-{
-	customPlot = plot;
-}
-
 void TraceAnalyzer::addCpuFreqWork(unsigned int cpu,
 				   QList<AbstractWorkItem*> &list)
 {
@@ -794,73 +1185,46 @@ void TraceAnalyzer::addCpuSchedWork(unsigned int cpu,
 }
 
 /*
- * This function must be called from the application mainthread because it
- * creates objects that are children customPlot, which is created by the
- * mainthread
+ * This starts the scaling of the graphs in the background, so that the caller
+ * can do other work, such as creating the migration arrows, at the same time.
+ * It must be followed by waitScale().
  */
-void TraceAnalyzer::scaleMigration()
-{
-	QList<Migration>::iterator iter;
-	double unit = migrationScale / getNrCPUs();
-	for (iter = migrations.begin(); iter != migrations.end(); iter++) {
-		Migration &m = *iter;
-		double s = migrationOffset + (m.oldcpu + 1) * unit;
-		double e = migrationOffset + (m.newcpu + 1) * unit;
-		QColor color = getTaskColor(m.pid);
-		/*
-		 * The constructor will save a pointer to the MigrationArrow
-		 * object in the customPlot object.
-		 */
-		new MigrationArrow(s, e, m.time.toDouble(), color,
-				   customPlot);
-	}
-}
-
-bool TraceAnalyzer::enableMigrations()
+void TraceAnalyzer::startScale(bool cpuFreqGraphs, bool cpuIdleGraphs,
+			       bool schedGraphs)
 {
-	return (Setting::isEnabled(Setting::SHOW_MIGRATION_GRAPHS) &&
-		(Setting::isEnabled(Setting::SHOW_MIGRATION_UNLIMITED) ||
-		 migrations.size() < MAX_NR_MIGRATIONS));
+	unsigned int cpu;
+	int i;
+
+	if (!cpuFreqGraphs && !cpuIdleGraphs && !schedGraphs)
+		return;
+
+	for (cpu = 0; cpu <= getMaxCPU(); cpu++) {
+		/* CpuFreq items */
+		if (cpuFreqGraphs)
+			addCpuFreqWork(cpu, scalingList);
+		/* CpuIdle items */
+		if (cpuIdleGraphs)
+			addCpuIdleWork(cpu, scalingList);
+		/* Task items */
+		if (schedGraphs)
+			addCpuSchedWork(cpu, scalingList);
+	}
+	for (i = 0; i < scalingList.size(); i++)
+		scalingQueue.addWorkItem(scalingList[i]);
+	scalingQueue.start();
 }
 
-void TraceAnalyzer::doScale()
+void TraceAnalyzer::waitScale()
 {
-	QList<AbstractWorkItem*> workList;
-	unsigned int cpu;
 	int i;
-	int s = 0;
-	bool useWorkList =
-		Setting::isEnabled(Setting::SHOW_CPUFREQ_GRAPHS) ||
-		Setting::isEnabled(Setting::SHOW_CPUIDLE_GRAPHS) ||
-		Setting::isEnabled(Setting::SHOW_SCHED_GRAPHS);
-
-	if (useWorkList) {
-		for (cpu = 0; cpu <= getMaxCPU(); cpu++) {
-			/* CpuFreq items */
-			if (Setting::isEnabled(Setting::SHOW_CPUFREQ_GRAPHS))
-				addCpuFreqWork(cpu, workList);
-			/* CpuIdle items */
-			if (Setting::isEnabled(Setting::SHOW_CPUIDLE_GRAPHS))
-				addCpuIdleWork(cpu, workList);
-			/* Task items */
-			if (Setting::isEnabled(Setting::SHOW_SCHED_GRAPHS))
-				addCpuSchedWork(cpu, workList);
-		}
-		s = workList.size();
-		for (i = 0; i < s; i++)
-			scalingQueue.addWorkItem(workList[i]);
-		scalingQueue.start();
-	}
 
-	/* Migration scaling is done from the mainthread */
-	if (enableMigrations())
-		scaleMigration();
+	if (scalingList.isEmpty())
+		return;
 
-	if (useWorkList) {
-		scalingQueue.wait();
-		for (i = 0; i < s; i++)
-			delete workList[i];
-	}
+	scalingQueue.wait();
+	for (i = 0; i < scalingList.size(); i++)
+		delete scalingList[i];
+	scalingList.clear();
 }
 
 void TraceAnalyzer::doStats()
@@ -870,7 +1234,7 @@ void TraceAnalyzer::doStats()
 
 	DEFINE_TASKMAP_ITERATOR(iter);
 	for(iter = taskMap.begin(); iter != taskMap.end(); iter++) {
-		Task *task = iter.value().task;
+		Task *task = &iter.value();
 		WorkItem<Task> *taskItem = new WorkItem<Task>
 			(task, &Task::doStats);
 		workList.append(taskItem);
@@ -892,7 +1256,7 @@ void TraceAnalyzer::doLimitedStats()
 
 	DEFINE_TASKMAP_ITERATOR(iter);
 	for(iter = taskMap.begin(); iter != taskMap.end(); iter++) {
-		Task *task = iter.value().task;
+		Task *task = &iter.value();
 		WorkItem<Task> *taskItem = new WorkItem<Task>
 			(task, &Task::doStatsTimeLimited);
 		workList.append(taskItem);
@@ -907,64 +1271,83 @@ void TraceAnalyzer::doLimitedStats()
 		delete workList[i];
 }
 
-void TraceAnalyzer::processFtrace()
+void TraceAnalyzer::processFtrace(bool restored)
+{
+	__processGeneric(TRACE_TYPE_FTRACE, restored);
+}
+
+void TraceAnalyzer::processPerf(bool restored)
 {
-	__processGeneric(TRACE_TYPE_FTRACE);
+	__processGeneric(TRACE_TYPE_PERF, restored);
 }
 
-void TraceAnalyzer::processPerf()
+void TraceAnalyzer::processFtraceEvents(int from, int to)
 {
-	__processGeneric(TRACE_TYPE_PERF);
+	__processEvents(TRACE_TYPE_FTRACE, from, to);
+	extractSched();
+	__mergeTasks(TRACE_TYPE_FTRACE);
+}
+
+void TraceAnalyzer::processPerfEvents(int from, int to)
+{
+	__processEvents(TRACE_TYPE_PERF, from, to);
+	extractSched();
+	__mergeTasks(TRACE_TYPE_PERF);
 }
 
 void TraceAnalyzer::processAllFilters()
 {
 	int i;
-	int s = events->size();
+	int s = columns.size();
 	const TraceEvent *eptr;
+	event_t type;
+	EventColumns::timeint_t time;
+	EventColumns::timeint_t OR_low = OR_filterTimeLow.toNanoseconds();
+	EventColumns::timeint_t OR_high = OR_filterTimeHigh.toNanoseconds();
+	EventColumns::timeint_t low = filterTimeLow.toNanoseconds();
+	EventColumns::timeint_t high = filterTimeHigh.toNanoseconds();
 
 	filteredEvents.clear();
 
 	for (i = 0; i < s; i++) {
-		const TraceEvent &event = events->at(i);
-		eptr = &event;
+		eptr = &events->at(i);
+		type = eptr->type;
+		time = eptr->timeNs;
 		/* OR filters */
 		if (OR_filterState.isEnabled(FilterState::FILTER_PID) &&
-		    !__processPidFilter(event, OR_filterPidMap,
+		    !__processPidFilter(i, OR_filterPidMap,
 					OR_pidFilterInclusive)) {
 			filteredEvents.append(eptr);
 			continue;
 		}
 		if (OR_filterState.isEnabled(FilterState::FILTER_EVENT)) {
 			DEFINE_FILTER_EVENTMAP_ITERATOR(iter);
-			iter = OR_filterEventMap.find(event.type);
+			iter = OR_filterEventMap.find(type);
 			if (iter != OR_filterEventMap.end()) {
 				filteredEvents.append(eptr);
 				continue;
 			}
 		}
 		if (OR_filterState.isEnabled(FilterState::FILTER_TIME)) {
-			if (event.time >= OR_filterTimeLow &&
-			    event.time <= OR_filterTimeHigh) {
+			if (time >= OR_low && time <= OR_high) {
 				filteredEvents.append(eptr);
 				continue;
 			}
 		}
 		/* AND filters */
 		if (filterState.isEnabled(FilterState::FILTER_PID) &&
-		    __processPidFilter(event, filterPidMap,
+		    __processPidFilter(i, filterPidMap,
 				       pidFilterInclusive)) {
 			continue;
 		}
 		if (filterState.isEnabled(FilterState::FILTER_EVENT)) {
 			DEFINE_FILTER_EVENTMAP_ITERATOR(iter);
-			iter = filterEventMap.find(event.type);
+			iter = filterEventMap.find(type);
 			if (iter == filterEventMap.end())
 				continue;
 		}
 		if (filterState.isEnabled(FilterState::FILTER_TIME)) {
-			if (event.time < filterTimeLow ||
-			    event.time > filterTimeHigh)
+			if (time < low || time > high)
 				continue;
 		}
 		if (filterState.isEnabled(FilterState::FILTER_CPU)) {
@@ -1284,7 +1667,7 @@ bool TraceAnalyzer::exportTraceFile(const char *fileName, int *ts_errno,
 			if (export_type == EXPORT_TYPE_CPU_CYCLES &&
 			    eptr->type != cpuevent_type)
 				continue;
-			eptr->time.sprint(tbuf);
+			eptr->getTime().sprint(tbuf);
 			w = snprintf(wb, space,
 				     "%s %5u [%03u] %s: ",
 				     eptr->taskName->ptr, eptr->pid,
@@ -1321,9 +1704,10 @@ bool TraceAnalyzer::exportTraceFile(const char *fileName, int *ts_errno,
 				wb      += w;
 			}
 
-			for (i = 0; i < eptr->argc; i++) {
+			EventArgs args(*eptr);
+			for (i = 0; i < args.argc; i++) {
 				w = snprintf(wb, space, " %s",
-					     eptr->argv[i]->ptr);
+					     args.argv[i]->ptr);
 				if (w > 0) {
 					written += w;
 					space   -= w;
@@ -1338,9 +1722,7 @@ bool TraceAnalyzer::exportTraceFile(const char *fileName, int *ts_errno,
 			}
 			if (eptr->postEventInfo != nullptr &&
 			    eptr->postEventInfo->len > 0) {
-				size_t cs = TSMIN(space,
-						  eptr->postEventInfo->len);
-				parser->traceFile->readChunk(
+				int cs = parser->traceFile->readChunk(
 					eptr->postEventInfo, wb, space,
 					ts_errno);
 				if (*ts_errno != 0) {
@@ -52,7 +52,10 @@
 #ifndef TRACEANALYZER_H
 #define TRACEANALYZER_H
 
+#include <QAtomicInt>
+#include <QByteArray>
 #include <QColor>
+#include <QMutex>
 #include <QString>
 #include <QStringList>
 #include <QVector>
@@ -62,20 +65,25 @@
 #include <limits>
 
 #include "vtl/avltree.h"
+#include "vtl/pidmap.h"
 #include "vtl/tlist.h"
 
+#include "analyzer/analysiscache.h"
 #include "analyzer/cpu.h"
 #include "analyzer/cpufreq.h"
+#include "analyzer/cpusched.h"
 #include "analyzer/cpuidle.h"
+#include "analyzer/eventcolumns.h"
+#include "analyzer/eventpostings.h"
 #include "analyzer/filterstate.h"
 #include "parser/genericparams.h"
+#include "parser/schedpayload.h"
 #include "mm/mempool.h"
 #include "analyzer/abstracttask.h"
 #include "analyzer/cputask.h"
 #include "analyzer/tcolor.h"
 #include "parser/traceevent.h"
 #include "analyzer/migration.h"
-#include "ui/migrationarrow.h"
 #include "analyzer/task.h"
 #include "parser/traceparser.h"
 #include "misc/traceshark.h"
@@ -97,10 +105,29 @@
 #define WAKEUP_MAX ((double) 0.020)
 
 class TraceFile;
-class QCustomPlot;
+
+/*
+ * A snapshot of the analysis of a trace that is still being processed. The
+ * cpufreq and cpuidle data cover the events up to endTime, the scheduling
+ * graphs are only available when the processing has finished.
+ */
+class AnalysisPreview {
+public:
+	AnalysisPreview();
+	int nrEvents;
+	unsigned int nrCPUs;
+	vtl::Time startTime;
+	vtl::Time endTime;
+	unsigned int maxFreq;
+	int maxIdleState;
+	QVector<CpuFreq> cpuFreq;
+	QVector<CpuIdle> cpuIdle;
+};
 
 class TraceAnalyzer
 {
+	friend class AnalysisCache;
+	friend class CPUSched;
 public:
 	typedef enum {
 		EXPORT_TYPE_ALL = 0,
@@ -108,10 +135,22 @@ public:
 	} exporttype_t;
 	TraceAnalyzer();
 	~TraceAnalyzer();
-	int open(const QString &fileName);
+	int open(const QString &fileName, bool follow = false,
+		 int64_t startPos = 0);
 	bool isOpen() const;
 	void close(int *ts_errno);
 	void processTrace();
+	void startProcessing();
+	bool processingFinished() const;
+	void waitProcessing();
+	void requestPreview();
+	bool takePreview(AnalysisPreview &pv);
+	bool updateTrace();
+	bool isFollowing() const;
+	void slideWindow(int nrEvict);
+	void setPipelineConfig(unsigned int bufferSize, unsigned int nrBuffers,
+			       int batchSize);
+	const StallStats &getStallStats() const;
 	const TraceEvent *findPreviousSchedEvent(const vtl::Time &time,
 						 int pid,
 						 int *index) const;
@@ -124,6 +163,9 @@ public:
 					       int *index) const;
 	const TraceEvent *findWakingEvent(const TraceEvent *wakeup,
 					  int *index) const;
+	const TraceEvent *findSchedCause(int schedIndex, event_t wanted,
+					 int *index) const;
+	void findWaker(int index, int *pid, unsigned int *cpu) const;
 	const TraceEvent *findFilteredEvent(int index, int *filterIndex) const;
 	__always_inline unsigned int getMaxCPU() const;
 	__always_inline unsigned int getNrCPUs() const;
@@ -142,13 +184,11 @@ public:
 	void setCpuIdleScale(unsigned int cpu, double scale);
 	void setCpuFreqOffset(unsigned int cpu, double offset);
 	void setCpuFreqScale(unsigned int cpu, double scale);
-	void setMigrationOffset(double offset);
-	void setMigrationScale(double scale);
-	bool enableMigrations();
-	void doScale();
+	void startScale(bool cpuFreqGraphs, bool cpuIdleGraphs,
+			bool schedGraphs);
+	void waitScale();
 	void doStats();
 	void doLimitedStats();
-	void setQCustomPlot(QCustomPlot *plot);
 	__always_inline Task *findTask(int pid);
 	void createPidFilter(QMap<int, int> &map,
 			     bool orlogic, bool inclusive);
@@ -166,25 +206,34 @@ public:
 	TraceFile *getTraceFile();
 	vtl::TList<TraceEvent> *events;
 	vtl::TList <const TraceEvent*> filteredEvents;
-	vtl::AVLTree<int, CPUTask, vtl::AVLBALANCE_USEPOINTERS>
-		*cpuTaskMaps;
-	vtl::AVLTree<int, TaskHandle> taskMap;
+	vtl::PidMap<CPUTask> *cpuTaskMaps;
+	vtl::PidMap<Task> taskMap;
 	CpuFreq *cpuFreq;
 	CpuIdle *cpuIdle;
 	QList<Migration> migrations;
 private:
 	TraceParser *parser;
+	/* The decoded arguments of the scheduler events in events */
+	const SchedPayloads *payloads;
+	/* The times of the processed events, for the time searches */
+	EventColumns columns;
+	/* The indices of the scheduler events of each task */
+	EventPostings postings;
 	void prepareDataStructures();
 	void resetProperties();
+	void openAnalysisCache(const QString &fileName);
+	bool restoreAnalysis();
+	void clearAnalysis();
+	void writeAnalysisCache();
 	void threadProcess();
-	int binarySearch(const vtl::Time &time, int start, int end) const;
+	void makePreview();
 	int binarySearchFiltered(const vtl::Time &time, int start, int end)
 		const;
 	void colorizeTasks();
 	event_t determineCPUEvent(bool &ok);
-	int findIndexBefore(const vtl::Time &time) const;
-	int findIndexAfter(const vtl::Time &time) const;
 	int findFilteredIndexBefore(const vtl::Time &time) const;
+	int findEventIndex(const TraceEvent *event) const;
+	int findWakingIndex(const TraceEvent &wakeup, int idx) const;
 	__always_inline int
 		generic_sched_switch_newpid(const TraceEvent &event) const;
 	__always_inline int
@@ -195,20 +244,22 @@ private:
 		generic_sched_wakeup_pid(const TraceEvent &event) const;
 	__always_inline int
 		generic_sched_waking_pid(const TraceEvent &event) const;
-	__always_inline vtl::Time estimateWakeUpNew(const CPU *eventCPU,
-						    const vtl::Time &newTime,
-						    const vtl::Time &startTime,
-						    bool &valid) const;
+	__always_inline bool wakeUpNewIsValid(const CPU *eventCPU) const;
 	__always_inline vtl::Time estimateWakeUp(const Task *task,
 						 const vtl::Time &newTime,
 						 bool &valid) const;
-	void handleWrongTaskOnCPU(const TraceEvent &event, unsigned int cpu,
-				  CPU *eventCPU, int oldpid,
-				  const vtl::Time &oldtime,
-				  int idx);
-	__always_inline void __processSwitchEvent(tracetype_t ttype,
-						  const TraceEvent &event,
-						  int idx);
+	void handleWrongTaskOnCPU(unsigned int cpu, CPU *eventCPU,
+				  int oldpid, const vtl::Time &oldtime,
+				  int idx, SchedRecord &rec);
+	void mergeWrongTaskOnCPU(const SchedRecord &rec, int oldpid,
+				 const vtl::Time &oldtime, int idx);
+	__always_inline void __extractSwitchEvent(const TraceEvent &event,
+						  int idx,
+						  CPUSched *sched);
+	__always_inline void __mergeSwitchEvent(tracetype_t ttype,
+						const TraceEvent &event,
+						int idx,
+						CPUSched *sched);
 	__always_inline void __processWakeupEvent(tracetype_t ttype,
 						  const TraceEvent &event,
 						  int idx);
@@ -233,25 +284,42 @@ private:
 			    QList<AbstractWorkItem*> &list);
 	void addCpuSchedWork(unsigned int cpu,
 			     QList<AbstractWorkItem*> &list);
-	void scaleMigration();
 	void processSchedAddTail();
 	void processFreqAddTail();
+	void removeTails();
+	void updateStartTime();
+	void updateEndTime();
 	unsigned int guessTimePrecision();
-	__always_inline void __processGeneric(tracetype_t ttype);
+	__always_inline void __processEvents(tracetype_t ttype, int from,
+					     int to);
+	__always_inline void __indexEvents(int from, int to);
+	__always_inline void __processGeneric(tracetype_t ttype,
+					      bool restored);
+	void extractCPUSched(CPUSched *sched);
+	void extractSched();
+	__always_inline static void siftDownSched(CPUSched **heap, int root,
+						  int n);
+	__always_inline void __mergeEvent(tracetype_t ttype, int idx,
+					  CPUSched *sched);
+	__always_inline void __mergeTasks(tracetype_t ttype);
 	__always_inline void updateMaxCPU(unsigned int cpu);
 	__always_inline void updateMaxFreq(unsigned int freq);
 	__always_inline void updateMinFreq(unsigned int freq);
 	__always_inline void updateMaxIdleState(int state);
 	__always_inline void updateMinIdleState(int state);
-	void processFtrace();
-	void processPerf();
+	void processFtrace(bool restored);
+	void processPerf(bool restored);
+	void processFtraceEvents(int from, int to);
+	void processPerfEvents(int from, int to);
 	void processAllFilters();
 	__always_inline
-		bool __processPidFilter(const TraceEvent &event,
-					QMap<int, int> &map,
+		bool __processPidFilter(int index, QMap<int, int> &map,
 					bool inclusive);
+	WorkThread<TraceAnalyzer> *processThread;
+	bool processing;
 	WorkQueue processingQueue;
 	WorkQueue scalingQueue;
+	QList<AbstractWorkItem*> scalingList;
 	WorkQueue statsQueue;
 	WorkQueue statsLimitedQueue;
 	vtl::AVLTree <int, TColor> colorMap;
@@ -263,23 +331,25 @@ private:
 	QVector<double> cpuIdleScale;
 	QVector<double> cpuFreqOffset;
 	QVector<double> cpuFreqScale;
-	double migrationOffset;
-	double migrationScale;
 	unsigned int maxCPU;
 	unsigned int nrCPUs;
 	vtl::Time endTime;
 	vtl::Time startTime;
-	double endTimeDbl;
-	double startTimeDbl;
 	int endTimeIdx;
 	unsigned int maxFreq;
 	unsigned int minFreq;
 	int maxIdleState;
 	int minIdleState;
 	unsigned int timePrecision;
+	/* The number of events that have been processed */
+	int processedIndex;
 	CPU *CPUs;
+	/* The events of each CPU that are waiting for extraction */
+	CPUSched *cpuSched;
 	StringPool *taskNamePool;
-	QCustomPlot *customPlot;
+	/* The result of the previous processing of the trace, if it is valid */
+	AnalysisCache analysisCache;
+	QByteArray cacheName;
 	FilterState filterState;
 	FilterState OR_filterState;
 	QMap<int, int> filterPidMap;
@@ -292,31 +362,28 @@ private:
 	vtl::Time filterTimeHigh;
 	vtl::Time OR_filterTimeLow;
 	vtl::Time OR_filterTimeHigh;
+	/* Set by the GUI when it wants a new preview */
+	QAtomicInt previewRequested;
+	QMutex previewMutex;
+	AnalysisPreview preview;
+	bool previewReady;
 	static const char spaceStr[];
 	static const int spaceStrLen;
 	static const char *const cpuevents[];
 	static const int CPUEVENTS_NR;
 };
 
+/*
+ * Tells whether the wakeup of a task that is scheduled for the first time can
+ * be estimated, in which case the delay is taken from the start of the trace.
+ */
 __always_inline
-vtl::Time TraceAnalyzer::estimateWakeUpNew(const CPU *eventCPU,
-					   const vtl::Time &newTime,
-					   const vtl::Time &startTime,
-					   bool &valid) const
+bool TraceAnalyzer::wakeUpNewIsValid(const CPU *eventCPU) const
 {
-	vtl::Time delay;
-
 	if (!eventCPU->hasBeenScheduled)
-		goto regular;
+		return true;
 
-	if (eventCPU->lastEnterIdle < eventCPU->lastExitIdle) {
-		valid = false;
-		return 0;
-	}
-regular:
-	valid = true;
-	delay = newTime - startTime;
-	return delay;
+	return !(eventCPU->lastEnterIdle < eventCPU->lastExitIdle);
 }
 
 __always_inline
@@ -337,67 +404,48 @@ vtl::Time TraceAnalyzer::estimateWakeUp(const Task *task,
 	return delay;
 }
 
+/*
+ * The functions below must only be called with events of the right type, the
+ * type selects which member of the payload is valid.
+ */
 __always_inline int
 TraceAnalyzer::generic_sched_switch_newpid(const TraceEvent &event) const
 {
-	sched_switch_handle_t handle;
-	tracetype_t ttype = getTraceType();
+	const SchedPayload *p = payloads->get(event);
 
-	if (!tracetype_is_valid(ttype))
-		return INT_MAX;
-	if (!sched_switch_parse(ttype, event, handle))
-		return INT_MAX;
-	return sched_switch_handle_newpid(ttype, event, handle);;
+	return p != nullptr ? p->sw.newpid : INT_MAX;
 }
 
 __always_inline int
 TraceAnalyzer::generic_sched_switch_oldpid(const TraceEvent &event) const
 {
-	sched_switch_handle_t handle;
-	tracetype_t ttype = getTraceType();
+	const SchedPayload *p = payloads->get(event);
 
-	if (!tracetype_is_valid(ttype))
-		return INT_MAX;
-	if (!sched_switch_parse(ttype, event, handle))
-		return INT_MAX;
-	return sched_switch_handle_oldpid(ttype, event, handle);;
+	return p != nullptr ? p->sw.oldpid : INT_MAX;
 }
 
 __always_inline taskstate_t
 TraceAnalyzer::generic_sched_switch_state(const TraceEvent &event) const
 {
-	sched_switch_handle_t handle;
-	tracetype_t ttype = getTraceType();
+	const SchedPayload *p = payloads->get(event);
 
-	if (!tracetype_is_valid(ttype))
-		return 0;
-	if (!sched_switch_parse(ttype, event, handle))
-		return 0;
-	return sched_switch_handle_state(ttype, event, handle);
+	return p != nullptr ? p->sw.state : 0;
 }
 
 __always_inline int
 TraceAnalyzer::generic_sched_wakeup_pid(const TraceEvent &event) const
 {
-	tracetype_t ttype = getTraceType();
+	const SchedPayload *p = payloads->get(event);
 
-	if (!tracetype_is_valid(ttype))
-		return INT_MAX;
-	if (!sched_wakeup_args_ok(ttype, event))
-		return INT_MAX;
-	return sched_wakeup_pid(ttype, event);
+	return p != nullptr ? p->wakeup.pid : INT_MAX;
 }
 
 __always_inline int
 TraceAnalyzer::generic_sched_waking_pid(const TraceEvent &event) const
 {
-	tracetype_t ttype = getTraceType();
+	const SchedPayload *p = payloads->get(event);
 
-	if (!tracetype_is_valid(ttype))
-		return INT_MAX;
-	if (!sched_waking_args_ok(ttype, event))
-		return INT_MAX;
-	return sched_waking_pid(ttype, event);
+	return p != nullptr ? p->wakeup.pid : INT_MAX;
 }
 
 __always_inline unsigned int TraceAnalyzer::getMaxCPU() const
@@ -444,10 +492,7 @@ __always_inline QColor TraceAnalyzer::getTaskColor(int pid) const
 __always_inline CPUTask *TraceAnalyzer::findCPUTask(int pid,
 						    unsigned int cpu)
 {
-	if (cpuTaskMaps[cpu].contains(pid))
-		return &cpuTaskMaps[cpu][pid];
-	else
-		return nullptr;
+	return cpuTaskMaps[cpu].findValue(pid);
 }
 
 __always_inline tracetype_t TraceAnalyzer::getTraceType() const
@@ -457,27 +502,24 @@ __always_inline tracetype_t TraceAnalyzer::getTraceType() const
 
 __always_inline Task *TraceAnalyzer::findTask(int pid)
 {
-	DEFINE_TASKMAP_ITERATOR(iter) = taskMap.find(pid);
-	if (iter == taskMap.end())
-		return nullptr;
-	else
-		return iter.value().task;
+	return taskMap.findValue(pid);
 }
 
 __always_inline
-void TraceAnalyzer::__processMigrateEvent(tracetype_t ttype,
+void TraceAnalyzer::__processMigrateEvent(tracetype_t /* ttype */,
 					  const TraceEvent &event,
 					  int /* idx */)
 {
+	const SchedPayload *p = payloads->get(event);
 	Migration m;
 	unsigned int oldcpu;
 	unsigned int newcpu;
 
-	if (!sched_migrate_args_ok(ttype, event))
+	if (p == nullptr)
 		return;
 
-	oldcpu = sched_migrate_origCPU(ttype, event);
-	newcpu = sched_migrate_destCPU(ttype, event);
+	oldcpu = p->migrate.origCPU;
+	newcpu = p->migrate.destCPU;
 
 	if (!isValidCPU(oldcpu) || !isValidCPU(newcpu))
 		return;
@@ -485,10 +527,10 @@ void TraceAnalyzer::__processMigrateEvent(tracetype_t ttype,
 	updateMaxCPU(oldcpu);
 	updateMaxCPU(newcpu);
 
-	m.pid = sched_migrate_pid(ttype, event);
+	m.pid = p->migrate.pid;
 	m.oldcpu = oldcpu;
 	m.newcpu = newcpu;
-	m.time = event.time;
+	m.time = event.getTime();
 	migrations.append(m);
 }
 
@@ -505,16 +547,16 @@ __always_inline void TraceAnalyzer::__processForkEvent(tracetype_t ttype,
 	m.pid = sched_process_fork_childpid(ttype, event);
 	m.oldcpu = -1;
 	m.newcpu = event.cpu;
-	m.time = event.time;
+	m.time = event.getTime();
 	migrations.append(m);
 
-	Task *task = &taskMap[m.pid].getTask();
+	Task *task = &taskMap[m.pid];
 	if (task->isNew) {
 		/* This should be very likely for a task that just forked !*/
 		task->isNew = false;
 		task->pid = m.pid;
 		task->events = events;
-		task->schedTimev.append(event.time.toDouble());
+		task->schedTimev.append(event.getTime());
 		task->schedData.append(FLOOR_BIT);
 		task->schedEventIdx.append(idx);
 		childname = sched_process_fork_childname_strdup(ttype, event,
@@ -535,10 +577,10 @@ __always_inline void TraceAnalyzer::__processExitEvent(tracetype_t ttype,
 	m.pid = sched_process_exit_pid(ttype, event);
 	m.oldcpu = event.cpu;
 	m.newcpu = -1;
-	m.time = event.time;
+	m.time = event.getTime();
 	migrations.append(m);
 
-	Task *task = &taskMap[m.pid].getTask();
+	Task *task = &taskMap[m.pid];
 	if (task->isNew) {
 		task->pid = m.pid;
 		task->events = events;
@@ -546,37 +588,174 @@ __always_inline void TraceAnalyzer::__processExitEvent(tracetype_t ttype,
 	task->exitStatus = STATUS_EXITCALLED;
 }
 
+/*
+ * This does the per CPU part of a sched_switch event, i.e. it updates the CPU
+ * and the CPUTasks of the CPU. It is called in parallel for different CPUs, so
+ * it must not touch anything that is shared between CPUs, such as the Tasks.
+ * What the merge needs to know is stored in a SchedRecord.
+ */
 __always_inline
-void TraceAnalyzer::__processSwitchEvent(tracetype_t ttype,
-					 const TraceEvent &event,
-					 int idx)
+void TraceAnalyzer::__extractSwitchEvent(const TraceEvent &event, int idx,
+					 CPUSched *sched)
 {
-	sched_switch_handle_t handle;
+	const SchedPayload *p = payloads->get(event);
 	unsigned int cpu = event.cpu;
-	vtl::Time oldtime = event.time - FAKE_DELTA;
-	vtl::Time newtime = event.time + FAKE_DELTA;
-	double oldtimeDbl, newtimeDbl;
+	vtl::Time oldtime = event.getTime() - FAKE_DELTA;
+	vtl::Time newtime = event.getTime() + FAKE_DELTA;
+	double oldtimeDbl;
 	int oldpid;
 	int newpid;
 	CPUTask *cpuTask;
+	CPU *eventCPU = &CPUs[cpu];
+	taskstate_t state;
+	bool runnable;
+	bool preempted;
+	bool uint;
+	SchedRecord rec;
+
+	if (p == nullptr)
+		return;
+
+	oldpid = p->sw.oldpid;
+	newpid = p->sw.newpid;
+
+	rec.idx = idx;
+	rec.wrongTask = eventCPU->pidOnCPU != oldpid &&
+		eventCPU->hasBeenScheduled;
+	rec.newDelayOK = false;
+	rec.newTask = nullptr;
+
+	if (rec.wrongTask)
+		handleWrongTaskOnCPU(cpu, eventCPU, oldpid, oldtime, idx, rec);
+
+	if (oldpid <= 0) {
+		eventCPU->lastExitIdle = oldtime;
+		/*
+		 * We don't care about the idle task. Neither do we care if the
+		 * pid is negative. I am not aware of any kernel version that
+		 * would have a negative oldpid but let's include that case as
+		 * well.
+		 */
+		goto skip;
+	}
+
+	oldtimeDbl = oldtime.toDouble();
+
+	/* Handle the outgoing task */
+	cpuTask = &cpuTaskMaps[cpu][oldpid];
+	state = p->sw.state;
+	runnable = task_state_is_runnable(state);
+	if (runnable)
+		preempted = task_state_is_flag_set(state, TASK_FLAG_PREEMPT);
+	else
+		uint = task_state_is_flag_set(state, TASK_FLAG_UNINTERRUPTIBLE);
+
+	if (cpuTask->isNew) {
+		/* true means task is newly constructed above */
+		cpuTask->pid = oldpid;
+		cpuTask->isNew = false;
+		cpuTask->events = events;
+
+		/* Apparently this task was on CPU when we started tracing */
+		cpuTask->schedTimev.append(startTime);
+		cpuTask->schedData.append(SCHED_BIT);
+		cpuTask->schedEventIdx.append(0);
+	}
+	cpuTask->schedTimev.append(oldtime);
+	cpuTask->schedData.append(FLOOR_BIT);
+	cpuTask->schedEventIdx.append(idx);
+	if (runnable) {
+		if (preempted) {
+			cpuTask->preemptedTimev.append(oldtimeDbl);
+		} else {
+			cpuTask->runningTimev.append(oldtimeDbl);
+		}
+	} else {
+		if (uint)
+			cpuTask->uninterruptibleTimev.append(oldtimeDbl);
+	}
+
+skip:
+	if (newpid <= 0) {
+		eventCPU->lastEnterIdle = newtime;
+		/*
+		 * We don't care about the idle task. Neither do we care if the
+		 * pid is negative. I am not aware of any kernel version that
+		 * would have a negative newpid but let's include that case as
+		 * well.
+		 */
+		goto out;
+	}
+
+	/* Handle the incoming task */
+	rec.newDelayOK = wakeUpNewIsValid(eventCPU);
+
+	cpuTask = &cpuTaskMaps[cpu][newpid];
+	if (cpuTask->isNew) {
+		/* true means task is newly constructed above */
+		cpuTask->pid = newpid;
+		cpuTask->isNew = false;
+		cpuTask->events = events;
+
+		cpuTask->schedTimev.append(startTime);
+		cpuTask->schedData.append(FLOOR_BIT);
+		cpuTask->schedEventIdx.append(idx);
+	}
+
+	/* The wakeup delay is added by the merge, it depends on the Task */
+	rec.newTask = cpuTask;
+
+	cpuTask->schedTimev.append(newtime);
+	cpuTask->schedData.append(SCHED_BIT);
+	cpuTask->schedEventIdx.append(idx);
+
+out:
+	eventCPU->hasBeenScheduled = true;
+	eventCPU->pidOnCPU = newpid;
+	eventCPU->lastSched = newtime;
+	eventCPU->lastSchedIdx = idx;
+	sched->records.append(rec);
+}
+
+/*
+ * This does the Task part of a sched_switch event, after the CPU part has been
+ * done by __extractSwitchEvent(). The events are merged in the order that they
+ * occurred, so that the Tasks are updated exactly as if all events had been
+ * processed by a single thread.
+ */
+__always_inline
+void TraceAnalyzer::__mergeSwitchEvent(tracetype_t ttype,
+				       const TraceEvent &event,
+				       int idx,
+				       CPUSched *sched)
+{
+	const SchedPayload *p = payloads->get(event);
+	sched_switch_handle_t handle;
+	vtl::Time oldtime = event.getTime() - FAKE_DELTA;
+	vtl::Time newtime = event.getTime() + FAKE_DELTA;
+	double oldtimeDbl;
+	int oldpid;
+	int newpid;
 	Task *task;
 	vtl::Time delay;
 	bool delayOK;
-	CPU *eventCPU = &CPUs[cpu];
 	taskstate_t state;
+	const TString *tname;
 	const char *name;
 	bool runnable;
 	bool preempted;
 	bool uint;
 
-	if (!sched_switch_parse(ttype, event, handle))
+	/* The extraction did not produce a record for this event */
+	if (p == nullptr)
 		return;
 
-	oldpid = sched_switch_handle_oldpid(ttype, event, handle);
-	newpid = sched_switch_handle_newpid(ttype, event, handle);
+	const SchedRecord &rec = sched->records.at(sched->nextRecord);
+	sched->nextRecord++;
+	Q_ASSERT(rec.idx == idx);
 
-	if (!isValidCPU(cpu))
-		return;
+	oldpid = p->sw.oldpid;
+	newpid = p->sw.newpid;
 
 	/*
 	 * This is done to update the names of existing tasks. Here we will
@@ -588,7 +767,7 @@ void TraceAnalyzer::__processSwitchEvent(tracetype_t ttype,
 	 * switched out after exit has been called.
 	 */
 	if (event.pid != 0) {
-		task = &taskMap[event.pid].getTask();
+		task = &taskMap[event.pid];
 		task->checkName(event.taskName->ptr);
 		if (task->isNew) {
 			task->pid = event.pid;
@@ -596,52 +775,51 @@ void TraceAnalyzer::__processSwitchEvent(tracetype_t ttype,
 		}
 	}
 
-	if (eventCPU->pidOnCPU != oldpid && eventCPU->hasBeenScheduled)
-		handleWrongTaskOnCPU(event, cpu, eventCPU, oldpid, oldtime,
-				     idx);
+	if (rec.wrongTask)
+		mergeWrongTaskOnCPU(rec, oldpid, oldtime, idx);
 
-	if (oldpid <= 0) {
-		eventCPU->lastExitIdle = oldtime;
-		/*
-		 * We don't care about the idle task. Neither do we care if the
-		 * pid is negative. I am not aware of any kernel version that
-		 * would have a negative oldpid but let's include that case as
-		 * well.
-		 */
+	if (oldpid <= 0)
 		goto skip;
-	}
 
 	oldtimeDbl = oldtime.toDouble();
 
 	/* Handle the outgoing task */
-	cpuTask = &cpuTaskMaps[cpu][oldpid];
-	task = &taskMap[oldpid].getTask();
-	state = sched_switch_handle_state(ttype, event, handle);
+	task = &taskMap[oldpid];
+	state = p->sw.state;
 
-	/* First handle the global task */
 	if (task->isNew) {
 		/* true means task is newly constructed above */
 		task->pid = oldpid;
 		task->isNew = false;
 		task->events = events;
-		name = sched_switch_handle_oldname_strdup(ttype,
-							  event,
-							  taskNamePool,
-							  handle);
-		task->checkName(name);
+		/*
+		 * The names are only needed for new tasks, so they are only
+		 * in the payload if the reader could decode them cheaply.
+		 */
+		tname = payloads->getName(p->sw.oldname);
+		if (tname != nullptr) {
+			task->checkName(tname->ptr);
+		} else if (event.hasArgv() &&
+			   sched_switch_parse(ttype, event, handle)) {
+			name = sched_switch_handle_oldname_strdup(ttype,
+								  event,
+								  taskNamePool,
+								  handle);
+			task->checkName(name);
+		}
 
 		/* Apparently this task was running when we started tracing */
-		task->schedTimev.append(startTimeDbl);
+		task->schedTimev.append(startTime);
 		task->schedData.append(SCHED_BIT);
 		task->schedEventIdx.append(0);
 
-		task->schedTimev.append(oldtimeDbl);
+		task->schedTimev.append(oldtime);
 		task->schedData.append(FLOOR_BIT);
 		task->schedEventIdx.append(idx);
 	}
 	if (task->exitStatus == STATUS_EXITCALLED)
 		task->exitStatus = STATUS_FINAL;
-	task->schedTimev.append(oldtimeDbl);
+	task->schedTimev.append(oldtime);
 	task->schedData.append(FLOOR_BIT);
 	task->schedEventIdx.append(idx);
 
@@ -662,62 +840,32 @@ void TraceAnalyzer::__processSwitchEvent(tracetype_t ttype,
 			task->uninterruptibleTimev.append(oldtimeDbl);
 	}
 
-	/* ... then handle the per CPU task */
-	if (cpuTask->isNew) {
-		/* true means task is newly constructed above */
-		cpuTask->pid = oldpid;
-		cpuTask->isNew = false;
-		cpuTask->events = events;
-
-		/* Apparently this task was on CPU when we started tracing */
-		cpuTask->schedTimev.append(startTimeDbl);
-		cpuTask->schedData.append(SCHED_BIT);
-		cpuTask->schedEventIdx.append(0);
-	}
-	cpuTask->schedTimev.append(oldtimeDbl);
-	cpuTask->schedData.append(FLOOR_BIT);
-	cpuTask->schedEventIdx.append(idx);
-	if (runnable) {
-		if (preempted) {
-			cpuTask->preemptedTimev.append(oldtimeDbl);
-		} else {
-			cpuTask->runningTimev.append(oldtimeDbl);
-		}
-	} else {
-		if (uint)
-			cpuTask->uninterruptibleTimev.append(oldtimeDbl);
-	}
-
 skip:
-	if (newpid <= 0) {
-		eventCPU->lastEnterIdle = newtime;
-		/*
-		 * We don't care about the idle task. Neither do we care if the
-		 * pid is negative. I am not aware of any kernel version that
-		 * would have a negative newpid but let's include that case as
-		 * well.
-		 */
-		goto out;
-	}
-
-	newtimeDbl = newtime.toDouble();
+	if (newpid <= 0)
+		return;
 
 	/* Handle the incoming task */
-	task = &taskMap[newpid].getTask();
+	task = &taskMap[newpid];
 	if (task->isNew) {
 		task->pid = newpid;
 		task->isNew = false;
 		task->events = events;
-		name = sched_switch_handle_newname_strdup(ttype,
-							  event,
-							  taskNamePool,
-							  handle);
-		if (name != nullptr)
-			task->checkName(name);
-		delay = estimateWakeUpNew(eventCPU, newtime, startTime,
-					  delayOK);
+		tname = payloads->getName(p->sw.newname);
+		if (tname != nullptr) {
+			task->checkName(tname->ptr);
+		} else if (event.hasArgv() &&
+			   sched_switch_parse(ttype, event, handle)) {
+			name = sched_switch_handle_newname_strdup(ttype,
+								  event,
+								  taskNamePool,
+								  handle);
+			if (name != nullptr)
+				task->checkName(name);
+		}
+		delay = newtime - startTime;
+		delayOK = rec.newDelayOK;
 
-		task->schedTimev.append(startTimeDbl);
+		task->schedTimev.append(startTime);
 		task->schedData.append(FLOOR_BIT);
 		task->schedEventIdx.append(0);
 	} else
@@ -727,41 +875,15 @@ skip:
 
 	if (delayOK) {
 		delayDbl = delay.toDouble();
-		task->wakeTimev.append(newtimeDbl);
+		task->wakeTimev.append(newtime);
 		task->wakeDelay.append(delayDbl);
+		rec.newTask->wakeTimev.append(newtime);
+		rec.newTask->wakeDelay.append(delayDbl);
 	}
 
-	task->schedTimev.append(newtimeDbl);
+	task->schedTimev.append(newtime);
 	task->schedData.append(SCHED_BIT);
 	task->schedEventIdx.append(idx);
-
-	cpuTask = &cpuTaskMaps[cpu][newpid];
-	if (cpuTask->isNew) {
-		/* true means task is newly constructed above */
-		cpuTask->pid = newpid;
-		cpuTask->isNew = false;
-		cpuTask->events = events;
-
-		cpuTask->schedTimev.append(startTimeDbl);
-		cpuTask->schedData.append(FLOOR_BIT);
-		cpuTask->schedEventIdx.append(idx);
-	}
-
-	if (delayOK) {
-		cpuTask->wakeTimev.append(newtimeDbl);
-		cpuTask->wakeDelay.append(delayDbl);
-	}
-
-	cpuTask->schedTimev.append(newtimeDbl);
-	cpuTask->schedData.append(SCHED_BIT);
-	cpuTask->schedEventIdx.append(idx);
-
-out:
-	eventCPU->hasBeenScheduled = true;
-	eventCPU->pidOnCPU = newpid;
-	eventCPU->lastSched = newtime;
-	eventCPU->lastSchedIdx = idx;
-	return;
 }
 
 __always_inline
@@ -769,51 +891,60 @@ void TraceAnalyzer::__processWakeupEvent(tracetype_t ttype,
 					 const TraceEvent &event,
 					 int /* idx */)
 {
+	const SchedPayload *p = payloads->get(event);
 	int pid;
 	Task *task;
 	vtl::Time time;
+	const TString *tname;
 	const char *name;
 
-	if (!sched_wakeup_args_ok(ttype, event))
+	if (p == nullptr)
 		return;
 
 	/* Only interested in success */
-	if (!sched_wakeup_success(ttype, event))
+	if (!p->wakeup.success)
 		return;
 
-	time = event.time;
-	pid = sched_wakeup_pid(ttype, event);
+	time = event.getTime();
+	pid = p->wakeup.pid;
 
 	/* Handle the woken up task */
-	task = &taskMap[pid].getTask();
+	task = &taskMap[pid];
 	task->lastWakeUP = time;
 	if (task->isNew) {
 		task->pid = pid;
 		task->isNew = false;
 		task->events = events;
-		name = sched_wakeup_name_strdup(ttype, event, taskNamePool);
-		if (name != nullptr)
-			task->checkName(name);
-		task->schedTimev.append(startTimeDbl);
+		tname = payloads->getName(p->wakeup.name);
+		if (tname != nullptr) {
+			task->checkName(tname->ptr);
+		} else if (event.hasArgv()) {
+			name = sched_wakeup_name_strdup(ttype, event,
+							taskNamePool);
+			if (name != nullptr)
+				task->checkName(name);
+		}
+		task->schedTimev.append(startTime);
 		task->schedData.append(FLOOR_BIT);
 		task->schedEventIdx.append(0);
 	}
 }
 
 __always_inline
-void TraceAnalyzer::__processCPUfreqEvent(tracetype_t ttype,
+void TraceAnalyzer::__processCPUfreqEvent(tracetype_t /* ttype */,
 					  const TraceEvent &event,
 					  int /* idx */)
 {
+	const SchedPayload *p = payloads->get(event);
 	unsigned int cpu;
 	unsigned int freq;
-	vtl::Time time = event.time;
+	vtl::Time time = event.getTime();
 
-	if(!cpufreq_args_ok(ttype, event))
+	if (p == nullptr)
 		return;
 
-	cpu = cpufreq_cpu(ttype, event);
-	freq = cpufreq_freq(ttype, event);
+	cpu = p->cpufreq.cpu;
+	freq = p->cpufreq.freq;
 
 	if (!isValidCPU(cpu))
 		return;
@@ -833,20 +964,21 @@ void TraceAnalyzer::__processCPUfreqEvent(tracetype_t ttype,
 }
 
 __always_inline
-void TraceAnalyzer::__processCPUidleEvent(tracetype_t ttype,
+void TraceAnalyzer::__processCPUidleEvent(tracetype_t /* ttype */,
 					  const TraceEvent &event,
 					  int /* idx */)
 {
+	const SchedPayload *p = payloads->get(event);
 	unsigned int cpu;
 	double time;
 	unsigned int state;
 
-	if (!cpuidle_args_ok(ttype, event))
+	if (p == nullptr)
 		return;
 
-	cpu = cpuidle_cpu(ttype, event);
-	time = event.time.toDouble();
-	state = cpuidle_state(ttype, event) + 1;
+	cpu = p->cpuidle.cpu;
+	time = event.getTime().toDouble();
+	state = p->cpuidle.state + 1;
 
 	if (!isValidCPU(cpu))
 		return;
@@ -889,9 +1021,148 @@ __always_inline void TraceAnalyzer::updateMinIdleState(int state)
 		minIdleState = state;
 }
 
-__always_inline void TraceAnalyzer::__processGeneric(tracetype_t ttype)
+/*
+ * This is the first of the three phases of the processing. The events that
+ * only affect a single CPU graph are processed right away, the scheduling
+ * events are queued on the CPU that they occurred on. The migrate events are
+ * queued too, although they do not concern the CPU, so that the migrations
+ * are appended in the order of the events.
+ */
+__always_inline void TraceAnalyzer::__processEvents(tracetype_t ttype,
+						    int from, int to)
 {
 	int i;
+
+	for (i = from; i < to; i++) {
+		TraceEvent &event = (*events)[i];
+		columns.append(event);
+		postings.add(payloads, event, i);
+		if (!isValidCPU(event.cpu))
+			continue;
+		updateMaxCPU(event.cpu);
+		switch (event.type) {
+		case CPU_FREQUENCY:
+			__processCPUfreqEvent(ttype, event, i);
+			break;
+		case CPU_IDLE:
+			__processCPUidleEvent(ttype, event, i);
+			break;
+		case SCHED_MIGRATE_TASK:
+		case SCHED_SWITCH:
+		case SCHED_WAKEUP:
+		case SCHED_WAKEUP_NEW:
+		case SCHED_PROCESS_FORK:
+		case SCHED_PROCESS_EXIT:
+			cpuSched[event.cpu].eventIdx.append(i);
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+/*
+ * This is used instead of __processEvents() when the analysis has been
+ * restored from the cache, then only the columns and the postings are built.
+ */
+__always_inline void TraceAnalyzer::__indexEvents(int from, int to)
+{
+	int i;
+
+	for (i = from; i < to; i++) {
+		const TraceEvent &event = (*events)[i];
+		columns.append(event);
+		postings.add(payloads, event, i);
+	}
+}
+
+/*
+ * The heap of the merge is ordered by the index of the next event of each
+ * CPU, so that the top of the heap is the CPU with the earliest event.
+ */
+__always_inline void TraceAnalyzer::siftDownSched(CPUSched **heap, int root,
+						  int n)
+{
+	CPUSched *tmp;
+	int child;
+
+	while ((child = 2 * root + 1) < n) {
+		if (child + 1 < n &&
+		    heap[child + 1]->nextIdx() < heap[child]->nextIdx())
+			child++;
+		if (heap[root]->nextIdx() <= heap[child]->nextIdx())
+			return;
+		tmp = heap[root];
+		heap[root] = heap[child];
+		heap[child] = tmp;
+		root = child;
+	}
+}
+
+__always_inline void TraceAnalyzer::__mergeEvent(tracetype_t ttype, int idx,
+						 CPUSched *sched)
+{
+	const TraceEvent &event = events->at(idx);
+
+	switch (event.type) {
+	case SCHED_MIGRATE_TASK:
+		__processMigrateEvent(ttype, event, idx);
+		break;
+	case SCHED_SWITCH:
+		__mergeSwitchEvent(ttype, event, idx, sched);
+		break;
+	case SCHED_WAKEUP:
+	case SCHED_WAKEUP_NEW:
+		__processWakeupEvent(ttype, event, idx);
+		break;
+	case SCHED_PROCESS_FORK:
+		__processForkEvent(ttype, event, idx);
+		break;
+	case SCHED_PROCESS_EXIT:
+		__processExitEvent(ttype, event, idx);
+		break;
+	default:
+		break;
+	}
+}
+
+/*
+ * This is the third phase, it does a k-way merge of the queued events of all
+ * CPUs, so that the Tasks, the wakeups and the migrations are processed in the
+ * order of the events. The CPUTasks have already been built by extractSched().
+ */
+__always_inline void TraceAnalyzer::__mergeTasks(tracetype_t ttype)
+{
+	QVector<CPUSched*> heap;
+	CPUSched *sched;
+	unsigned int cpu;
+	int i, n;
+
+	for (cpu = 0; cpu <= maxCPU; cpu++) {
+		if (!cpuSched[cpu].isEmpty())
+			heap.append(&cpuSched[cpu]);
+	}
+
+	n = heap.size();
+	for (i = n / 2 - 1; i >= 0; i--)
+		siftDownSched(heap.data(), i, n);
+
+	while (n > 0) {
+		sched = heap[0];
+		__mergeEvent(ttype, sched->nextIdx(), sched);
+		sched->nextEvent++;
+		if (sched->isEmpty()) {
+			sched->clear();
+			n--;
+			heap[0] = heap[n];
+		}
+		siftDownSched(heap.data(), 0, n);
+	}
+}
+
+__always_inline void TraceAnalyzer::__processGeneric(tracetype_t ttype,
+						     bool restored)
+{
 	bool eof = false;
 	int indexReady = 0;
 	int prevIndex = 0;
@@ -902,62 +1173,34 @@ __always_inline void TraceAnalyzer::__processGeneric(tracetype_t ttype)
 	if (indexReady <= 0)
 		return;
 
-	startTime = (*events)[0].time;
-	AbstractTask::setStartTime(startTime);
-	startTimeDbl = startTime.toDouble();
+	updateStartTime();
 
 	while(true) {
-		for (i = prevIndex; i < indexReady; i++) {
-			TraceEvent &event = (*events)[i];
-			if (!isValidCPU(event.cpu))
-				continue;
-			updateMaxCPU(event.cpu);
-			switch (event.type) {
-			case CPU_FREQUENCY:
-				__processCPUfreqEvent(ttype, event, i);
-				break;
-			case CPU_IDLE:
-				__processCPUidleEvent(ttype, event, i);
-				break;
-			case SCHED_MIGRATE_TASK:
-				__processMigrateEvent(ttype, event, i);
-				break;
-			case SCHED_SWITCH:
-				__processSwitchEvent(ttype, event, i);
-				break;
-			case SCHED_WAKEUP:
-			case SCHED_WAKEUP_NEW:
-				__processWakeupEvent(ttype, event, i);
-				break;
-			case SCHED_PROCESS_FORK:
-				__processForkEvent(ttype, event, i);
-				break;
-			case SCHED_PROCESS_EXIT:
-				__processExitEvent(ttype, event, i);
-				break;
-			default:
-				break;
-			}
-		}
+		if (restored)
+			__indexEvents(prevIndex, indexReady);
+		else
+			__processEvents(ttype, prevIndex, indexReady);
+		if (previewRequested.loadAcquire() != 0)
+			makePreview();
 		if (eof)
 			break;
 		prevIndex = indexReady;
 		parser->waitForNextBatch(eof, indexReady);
 	}
-	endTime = events->last().time;
-	endTimeIdx = events->size() - 1;
-	AbstractTask::setEndTime(endTime);
-	endTimeDbl = endTime.toDouble();
-	nrCPUs = maxCPU + 1;
-	timePrecision = guessTimePrecision();
+	if (!restored) {
+		extractSched();
+		__mergeTasks(ttype);
+	}
+	processedIndex = indexReady;
+	updateEndTime();
 }
 
 __always_inline
-bool TraceAnalyzer::__processPidFilter(const TraceEvent &event,
-				       QMap<int, int> &map,
+bool TraceAnalyzer::__processPidFilter(int index, QMap<int, int> &map,
 				       bool inclusive)
 {
-	sched_switch_handle sw_handle;
+	const SchedPayload *p;
+	const TraceEvent &event = events->at(index);
 	DEFINE_FILTER_PIDMAP_ITERATOR(iter);
 	iter = map.find(event.pid);
 	if (iter == map.end()) {
@@ -968,14 +1211,11 @@ bool TraceAnalyzer::__processPidFilter(const TraceEvent &event,
 		switch (event.type) {
 		case SCHED_WAKEUP:
 		case SCHED_WAKEUP_NEW:
-			if (!sched_wakeup_args_ok(ttype, event))
-				return true;
-			pid = sched_wakeup_pid(ttype, event);
-			break;
 		case SCHED_WAKING:
-			if (!sched_waking_args_ok(ttype, event))
+			p = payloads->get(event);
+			if (p == nullptr)
 				return true;
-			pid = sched_waking_pid(ttype, event);
+			pid = p->wakeup.pid;
 			break;
 		case SCHED_PROCESS_FORK:
 			if (!sched_process_fork_args_ok(ttype, event))
@@ -983,10 +1223,10 @@ bool TraceAnalyzer::__processPidFilter(const TraceEvent &event,
 			pid = sched_process_fork_childpid(ttype, event);
 			break;
 		case SCHED_SWITCH:
-			if (!sched_switch_parse(ttype, event, sw_handle))
+			p = payloads->get(event);
+			if (p == nullptr)
 				return true;
-			pid = sched_switch_handle_newpid(ttype, event,
-							 sw_handle);
+			pid = p->sw.newpid;
 			if (pid == 0)
 				return true;
 			break;
@@ -0,0 +1,459 @@
+// SPDX-License-Identifier: (GPL-2.0-or-later OR BSD-2-Clause)
+/*
+ * Traceshark - a visualizer for visualizing ftrace and perf traces
+ * Copyright (C) 2019  Viktor Rosendahl <viktor.rosendahl@gmail.com>
+ *
+ * This file is dual licensed: you can use it either under the terms of
+ * the GPL, or the BSD license, at your option.
+ *
+ *  a) This program is free software; you can redistribute it and/or
+ *     modify it under the terms of the GNU General Public License as
+ *     published by the Free Software Foundation; either version 2 of the
+ *     License, or (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public
+ *     License along with this library; if not, write to the Free
+ *     Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ *     MA 02110-1301 USA
+ *
+ * Alternatively,
+ *
+ *  b) Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *     1. Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *     2. Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *     CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *     INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *     MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *     DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *     CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *     NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *     LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *     HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *     CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ *     OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *     EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This is a headless benchmark of the text parsing pipeline. It generates a
+ * synthetic ftrace or perf script trace, or uses an existing one, and then
+ * measures:
+ *
+ * 1. The stages of the pipeline one at a time. The file is loaded with a
+ *    single buffer, so that the LoadThread, the tokenizer and the grammar
+ *    never run at the same time and the time of each can be measured
+ *    separately.
+ *
+ * 2. The whole pipeline, i.e. TraceAnalyzer::open() and processTrace() with
+ *    all threads, as it is done when a trace is opened in the GUI.
+ */
+
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+extern "C" {
+#include <sys/resource.h>
+#include <unistd.h>
+}
+
+#include <QByteArray>
+#include <QCoreApplication>
+#include <QString>
+
+#include "analyzer/traceanalyzer.h"
+#include "benchmark/tracegen.h"
+#include "misc/errors.h"
+#include "parser/ftrace/ftracegrammar.h"
+#include "parser/perf/perfgrammar.h"
+#include "parser/traceevent.h"
+#include "parser/tracefile.h"
+#include "parser/traceindex.h"
+#include "parser/traceline.h"
+#include "parser/traceparser.h"
+#include "threads/stallstats.h"
+#include "threads/threadbuffer.h"
+#include "vtl/error.h"
+#include "vtl/time.h"
+
+#define DEFAULT_FILE_NAME "traceshark-benchmark.txt"
+#define DEFAULT_STAGE_BUFFER_SIZE (1024 * 1024)
+#define BYTES_PER_MB (1024.0 * 1024.0)
+
+class StageResult
+{
+public:
+	StageResult();
+	int64_t nrBytes;
+	int64_t nrLines;
+	int64_t nrEvents;
+	int64_t loadNs;
+	int64_t tokenizeNs;
+	int64_t grammarNs;
+};
+
+StageResult::StageResult():
+	nrBytes(0), nrLines(0), nrEvents(0), loadNs(0), tokenizeNs(0),
+	grammarNs(0)
+{}
+
+static char *prgname;
+static TraceGenConfig genConfig;
+static QByteArray fileName(DEFAULT_FILE_NAME);
+static bool haveInput = false;
+static bool keepFiles = false;
+static unsigned int bufferKiB = 0;
+static unsigned int nrBuffers = 0;
+
+static void usage()
+{
+	fprintf(stderr,
+"Usage: %s [options]\n"
+"\n"
+"  --ftrace          Generate an ftrace trace (default)\n"
+"  --perf            Generate a perf script trace\n"
+"  --events N        Number of events to generate (default %" PRId64 ")\n"
+"  --cpus N          Number of CPUs (default %u)\n"
+"  --tasks N         Number of tasks (default %u)\n"
+"  --depth N         Backtrace depth of perf events (default %u)\n"
+"  --mix LIST        Event weights, e.g. sched_switch=50,other=0\n"
+"  --seed N          Seed of the random generator (default %" PRIu64 ")\n"
+"  --file NAME       Name of the generated trace (default %s)\n"
+"  --keep            Do not remove the generated trace and index\n"
+"  --input NAME      Benchmark an existing trace instead, use --perf if\n"
+"                    it is a perf script trace\n"
+"  --buffer-kb N     Size of the load buffers, zero means automatic\n"
+"  --buffers N       Number of load buffers, zero means automatic\n",
+		prgname, genConfig.nrEvents, genConfig.nrCPUs,
+		genConfig.nrTasks, genConfig.backtraceDepth, genConfig.seed,
+		DEFAULT_FILE_NAME);
+	exit(1);
+}
+
+static unsigned long long parseNumber(const char *opt, const char *arg)
+{
+	unsigned long long value;
+	char *end;
+
+	if (arg == nullptr)
+		vtl::errx(1, "%s requires an argument", opt);
+	errno = 0;
+	value = strtoull(arg, &end, 10);
+	if (errno != 0 || *end != '\0' || end == arg)
+		vtl::errx(1, "Invalid argument to %s: %s", opt, arg);
+	return value;
+}
+
+/* Returns the number of arguments consumed */
+static int parseOption(const char *opt, const char *arg)
+{
+	if (strcmp(opt, "--ftrace") == 0) {
+		genConfig.traceType = TRACE_TYPE_FTRACE;
+		return 1;
+	} else if (strcmp(opt, "--perf") == 0) {
+		genConfig.traceType = TRACE_TYPE_PERF;
+		return 1;
+	} else if (strcmp(opt, "--keep") == 0) {
+		keepFiles = true;
+		return 1;
+	} else if (strcmp(opt, "--help") == 0 || strcmp(opt, "-h") == 0) {
+		usage();
+	} else if (strcmp(opt, "--events") == 0) {
+		genConfig.nrEvents = parseNumber(opt, arg);
+	} else if (strcmp(opt, "--cpus") == 0) {
+		genConfig.nrCPUs = parseNumber(opt, arg);
+	} else if (strcmp(opt, "--tasks") == 0) {
+		genConfig.nrTasks = parseNumber(opt, arg);
+	} else if (strcmp(opt, "--depth") == 0) {
+		genConfig.backtraceDepth = parseNumber(opt, arg);
+	} else if (strcmp(opt, "--seed") == 0) {
+		genConfig.seed = parseNumber(opt, arg);
+	} else if (strcmp(opt, "--buffer-kb") == 0) {
+		bufferKiB = parseNumber(opt, arg);
+	} else if (strcmp(opt, "--buffers") == 0) {
+		nrBuffers = parseNumber(opt, arg);
+	} else if (strcmp(opt, "--mix") == 0) {
+		if (arg == nullptr || !genConfig.setMix(arg))
+			vtl::errx(1, "Invalid event mix: %s",
+				  arg == nullptr ? "" : arg);
+	} else if (strcmp(opt, "--file") == 0 || strcmp(opt, "--input") == 0) {
+		if (arg == nullptr)
+			vtl::errx(1, "%s requires an argument", opt);
+		fileName = QByteArray(arg);
+		haveInput = strcmp(opt, "--input") == 0;
+	} else {
+		fprintf(stderr, "Unknown option: %s\n", opt);
+		usage();
+	}
+	return 2;
+}
+
+static void parseArguments(int argc, char* argv[])
+{
+	int n;
+
+	prgname = *argv;
+	argc--;
+	argv++;
+
+	while (argc > 0) {
+		n = parseOption(argv[0], argc > 1 ? argv[1] : nullptr);
+		argc -= n;
+		argv += n;
+	}
+}
+
+static long peakRSSKiB()
+{
+	struct rusage usage;
+
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return -1;
+	return usage.ru_maxrss;
+}
+
+static __always_inline double nsToSecs(int64_t ns)
+{
+	return (double) ns / NSECS_PER_SEC;
+}
+
+static void printRate(const char *stage, int64_t ns, int64_t nrBytes,
+		      int64_t nrItems, const char *itemName)
+{
+	double secs = nsToSecs(ns);
+
+	if (secs <= 0) {
+		printf("%-10s %10.6lf s\n", stage, secs);
+		return;
+	}
+	printf("%-10s %10.6lf s %10.2lf MB/s %14.0lf %s/s\n", stage, secs,
+	       nrBytes / BYTES_PER_MB / secs, nrItems / secs, itemName);
+}
+
+/*
+ * Runs the stages of the pipeline one after another on one thread. Only the
+ * LoadThread runs in parallel, but since there is only one buffer, it is idle
+ * while the buffer is tokenized and parsed, so the time that we wait for it
+ * is the time it takes to load the buffer. Note that an uncompressed regular
+ * file is mapped, so loading is almost free and the page faults are paid by
+ * the tokenizer.
+ */
+template<class Grammar>
+static int stagePass(const char *name, Grammar *grammar, StageResult *r)
+{
+	ThreadBuffer<TraceLine> tbuf(TBUFSIZE);
+	const TString *argv[EVENT_MAX_NR_ARGS];
+	TraceFile *traceFile;
+	TraceEvent event;
+	unsigned int bufSize;
+	unsigned int i, s;
+	int64_t t0, t1, t2, t3;
+	int ts_errno;
+	bool eof;
+	QByteArray nameArray(name);
+
+	bufSize = bufferKiB != 0 ? bufferKiB * 1024 :
+		DEFAULT_STAGE_BUFFER_SIZE;
+	traceFile = new TraceFile(nameArray.data(), ts_errno, bufSize, 1, 1);
+	if (ts_errno != 0) {
+		delete traceFile;
+		return ts_errno;
+	}
+
+	TraceEvent::setStringTree(grammar->eventTree);
+	tbuf.loadBuffer = traceFile->getLoadBuffer(0);
+	traceFile->startLoad();
+
+	while (true) {
+		t0 = StallCounter::now();
+		tbuf.beginProduceBuffer();
+		t1 = StallCounter::now();
+		r->loadNs += t1 - t0;
+
+		eof = tbuf.loadBuffer->isEOF();
+		if (eof && tbuf.loadBuffer->nRead == 0) {
+			tbuf.endProduceBuffer();
+			tbuf.beginConsumeBuffer();
+			tbuf.endConsumeBuffer();
+			break;
+		}
+		r->nrBytes += tbuf.loadBuffer->nRead;
+		do {
+			TraceLine *line = &tbuf.list.increase();
+			traceFile->ReadLine(line, &tbuf);
+		} while (!tbuf.bufferSwitch);
+		tbuf.endProduceBuffer();
+		t2 = StallCounter::now();
+		r->tokenizeNs += t2 - t1;
+
+		/*
+		 * The events are not kept, so the same TraceEvent and argument
+		 * vector is reused for every line.
+		 */
+		tbuf.beginConsumeBuffer();
+		s = tbuf.list.size();
+		for (i = 0; i < s; i++) {
+			event.argc = 0;
+			event.argv = argv;
+			if (grammar->parseLine(tbuf.list[i], event))
+				r->nrEvents++;
+		}
+		r->nrLines += s;
+		tbuf.endConsumeBuffer();
+		t3 = StallCounter::now();
+		r->grammarNs += t3 - t2;
+
+		if (eof)
+			break;
+	}
+
+	traceFile->close(&ts_errno);
+	delete traceFile;
+	return ts_errno;
+}
+
+static int runStages(const char *name)
+{
+	StageResult r;
+	int ts_errno;
+
+	if (genConfig.traceType == TRACE_TYPE_PERF) {
+		PerfGrammar grammar;
+		ts_errno = stagePass(name, &grammar, &r);
+	} else {
+		FtraceGrammar grammar;
+		ts_errno = stagePass(name, &grammar, &r);
+	}
+	if (ts_errno != 0)
+		return ts_errno;
+
+	printf("\nStages, one buffer, %" PRId64 " lines, %" PRId64
+	       " events:\n", r.nrLines, r.nrEvents);
+	printRate("load", r.loadNs, r.nrBytes, r.nrLines, "lines");
+	printRate("tokenize", r.tokenizeNs, r.nrBytes, r.nrLines, "lines");
+	printRate("grammar", r.grammarNs, r.nrBytes, r.nrEvents, "events");
+	printf("peak RSS %ld KiB\n", peakRSSKiB());
+	if (r.nrEvents == 0 && r.nrLines > 0)
+		vtl::warnx("No events were parsed, wrong trace type?");
+	return 0;
+}
+
+static int runPipeline(const char *name)
+{
+	TraceAnalyzer *analyzer = new TraceAnalyzer();
+	const StallCounter *counter;
+	int64_t t0, t1, wallNs, busyNs;
+	int64_t nrBytes;
+	int nrEvents;
+	int ts_errno;
+	int i;
+
+	analyzer->setPipelineConfig(bufferKiB * 1024, nrBuffers, 0);
+
+	t0 = StallCounter::now();
+	ts_errno = analyzer->open(QString(name));
+	if (ts_errno != 0) {
+		delete analyzer;
+		return ts_errno;
+	}
+	analyzer->processTrace();
+	t1 = StallCounter::now();
+	wallNs = t1 - t0;
+
+	nrBytes = analyzer->getTraceFile()->getFileSize();
+	nrEvents = analyzer->events->size();
+	const StallStats &stats = analyzer->getStallStats();
+
+	printf("\nPipeline, %d events:\n", nrEvents);
+	printRate("total", wallNs, nrBytes, nrEvents, "events");
+	counter = stats.getCounter(STALL_ANALYZE);
+	busyNs = wallNs - counter->getNanoSecs();
+	printRate("analyze", busyNs, nrBytes, nrEvents, "events");
+	for (i = 0; i < NR_STALL_STAGES; i++) {
+		counter = stats.getCounter((stallstage_t) i);
+		printf("%s stage was blocked %.6lf s in %lld waits\n",
+		       StallStats::getStageName((stallstage_t) i),
+		       nsToSecs(counter->getNanoSecs()),
+		       (long long) counter->getCount());
+	}
+
+	analyzer->close(&ts_errno);
+	delete analyzer;
+	printf("peak RSS %ld KiB\n", peakRSSKiB());
+	return ts_errno;
+}
+
+int main(int argc, char* argv[])
+{
+	QCoreApplication app(argc, argv);
+	QByteArray indexName;
+	bool hadIndex;
+	int64_t nrBytes;
+	int64_t t0, t1;
+	int ts_errno;
+	int rval;
+
+	vtl::set_strerror(ts_strerror);
+	parseArguments(argc, argv);
+
+	if (!haveInput) {
+		TraceGen gen(genConfig);
+
+		t0 = StallCounter::now();
+		rval = gen.generate(fileName.constData(), &nrBytes);
+		t1 = StallCounter::now();
+		if (rval != 0)
+			vtl::errx(1, "Failed to generate %s: %s",
+				  fileName.constData(), strerror(rval));
+		printf("Generated %s, %" PRId64 " events, %.2lf MB in "
+		       "%.3lf s\n", fileName.constData(), genConfig.nrEvents,
+		       nrBytes / BYTES_PER_MB, nsToSecs(t1 - t0));
+	}
+
+	/*
+	 * The pipeline writes an index after parsing, which would be used
+	 * instead of parsing the next time the same file is opened.
+	 */
+	indexName = fileName;
+	indexName.append(TRACEINDEX_SUFFIX);
+	hadIndex = access(indexName.constData(), F_OK) == 0;
+	if (hadIndex)
+		vtl::warnx("%s exists, the pipeline will restore it instead of "
+			   "parsing the trace", indexName.constData());
+
+	ts_errno = runStages(fileName.constData());
+	if (ts_errno != 0)
+		vtl::errx(1, "Stage benchmark of %s failed: %s",
+			  fileName.constData(), ts_strerror(ts_errno));
+
+	ts_errno = runPipeline(fileName.constData());
+	if (ts_errno != 0)
+		vtl::errx(1, "Pipeline benchmark of %s failed: %s",
+			  fileName.constData(), ts_strerror(ts_errno));
+
+	if (!keepFiles) {
+		if (!hadIndex)
+			unlink(indexName.constData());
+		if (!haveInput)
+			unlink(fileName.constData());
+	}
+	return 0;
+}
@@ -0,0 +1,403 @@
+// SPDX-License-Identifier: (GPL-2.0-or-later OR BSD-2-Clause)
+/*
+ * Traceshark - a visualizer for visualizing ftrace and perf traces
+ * Copyright (C) 2019  Viktor Rosendahl <viktor.rosendahl@gmail.com>
+ *
+ * This file is dual licensed: you can use it either under the terms of
+ * the GPL, or the BSD license, at your option.
+ *
+ *  a) This program is free software; you can redistribute it and/or
+ *     modify it under the terms of the GNU General Public License as
+ *     published by the Free Software Foundation; either version 2 of the
+ *     License, or (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public
+ *     License along with this library; if not, write to the Free
+ *     Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ *     MA 02110-1301 USA
+ *
+ * Alternatively,
+ *
+ *  b) Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *     1. Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *     2. Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *     CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *     INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *     MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *     DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *     CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *     NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *     LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *     HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *     CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ *     OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *     EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include "benchmark/tracegen.h"
+
+#define TRACEGEN_PRIO (120)
+#define TRACEGEN_MIN_FREQ (800000)
+#define TRACEGEN_FREQ_STEP (100000)
+#define TRACEGEN_NR_FREQS (20)
+#define TRACEGEN_NR_IDLE_STATES (4)
+#define TRACEGEN_NR_IRQS (32)
+#define TRACEGEN_MAX_DELTA_US (20)
+#define TRACEGEN_FILE_BUFFER (1024 * 1024)
+
+/*
+ * The default mix is roughly what a trace of a busy desktop system with the
+ * scheduler, power and irq events enabled looks like.
+ */
+static const unsigned int defaultWeights[TRACEGEN_NR_WEIGHTS] = {
+	3,  /* CPU_FREQUENCY */
+	10, /* CPU_IDLE */
+	3,  /* SCHED_MIGRATE_TASK */
+	30, /* SCHED_SWITCH */
+	10, /* SCHED_WAKEUP */
+	1,  /* SCHED_WAKEUP_NEW */
+	12, /* SCHED_WAKING */
+	1,  /* SCHED_PROCESS_FORK */
+	1,  /* SCHED_PROCESS_EXIT */
+	10, /* IRQ_HANDLER_ENTRY */
+	10, /* IRQ_HANDLER_EXIT */
+	9   /* The other events */
+};
+
+static const char *const eventSystems[NR_EVENTS] = {
+	"power",
+	"power",
+	"sched",
+	"sched",
+	"sched",
+	"sched",
+	"sched",
+	"sched",
+	"sched",
+	"irq",
+	"irq"
+};
+
+static const char *const prevStates[] = { "R", "R+", "S", "S", "D" };
+
+TraceGenConfig::TraceGenConfig():
+	traceType(TRACE_TYPE_FTRACE), nrEvents(1000000), nrCPUs(8),
+	nrTasks(200), backtraceDepth(0), seed(1)
+{
+	memcpy(weights, defaultWeights, sizeof(weights));
+}
+
+bool TraceGenConfig::setWeight(const char *name, unsigned int weight)
+{
+	int i;
+
+	if (strcmp(name, TRACEGEN_OTHER_NAME) == 0) {
+		weights[EVENT_UNKNOWN] = weight;
+		return true;
+	}
+	for (i = 0; i < NR_EVENTS; i++) {
+		if (strcmp(name, eventstrings[i]) == 0) {
+			weights[i] = weight;
+			return true;
+		}
+	}
+	return false;
+}
+
+/*
+ * The mix is a comma separated list of name=weight pairs, e.g.
+ * "sched_switch=50,sched_waking=20,other=0". The events that are not in the
+ * list keep their default weights.
+ */
+bool TraceGenConfig::setMix(const char *mix)
+{
+	char name[64];
+	const char *c = mix;
+	const char *eq;
+	const char *end;
+	char *num_end;
+	unsigned long weight;
+	size_t len;
+
+	while (*c != '\0') {
+		end = strchr(c, ',');
+		if (end == nullptr)
+			end = c + strlen(c);
+		eq = (const char *) memchr(c, '=', end - c);
+		if (eq == nullptr)
+			return false;
+		len = eq - c;
+		if (len >= sizeof(name))
+			return false;
+		memcpy(name, c, len);
+		name[len] = '\0';
+		weight = strtoul(eq + 1, &num_end, 10);
+		if (num_end != end || !setWeight(name, weight))
+			return false;
+		c = *end == ',' ? end + 1 : end;
+	}
+	return true;
+}
+
+TraceGen::TraceGen(const TraceGenConfig &config):
+	cfg(config), file(nullptr), state(config.seed), timeUs(0),
+	totalWeight(0)
+{
+	int i;
+
+	if (cfg.nrCPUs < 1)
+		cfg.nrCPUs = 1;
+	if (cfg.nrTasks < 1)
+		cfg.nrTasks = 1;
+	/* xorshift gets stuck at zero */
+	if (state == 0)
+		state = 1;
+	for (i = 0; i < TRACEGEN_NR_WEIGHTS; i++)
+		totalWeight += cfg.weights[i];
+	currentPid = new int[cfg.nrCPUs];
+	freq = new unsigned int[cfg.nrCPUs];
+}
+
+TraceGen::~TraceGen()
+{
+	delete[] currentPid;
+	delete[] freq;
+}
+
+event_t TraceGen::randomEvent()
+{
+	unsigned int r;
+	int i;
+
+	if (totalWeight == 0)
+		return SCHED_SWITCH;
+	r = random(totalWeight);
+	for (i = 0; i < TRACEGEN_NR_WEIGHTS; i++) {
+		if (r < cfg.weights[i])
+			return (event_t) i;
+		r -= cfg.weights[i];
+	}
+	return EVENT_UNKNOWN;
+}
+
+void TraceGen::writeHeader(int pid, unsigned int cpu, const char *system,
+			   const char *name)
+{
+	char comm[32];
+	unsigned long long sec = timeUs / 1000000;
+	unsigned long long usec = timeUs % 1000000;
+
+	if (cfg.traceType == TRACE_TYPE_PERF) {
+		if (pid == 0)
+			snprintf(comm, sizeof(comm), "swapper");
+		else
+			snprintf(comm, sizeof(comm), "task%d", pid);
+		fprintf(file, "%16s %6d [%03u] %6llu.%06llu: %s:%s: ", comm,
+			pid, cpu, sec, usec, system, name);
+	} else {
+		if (pid == 0)
+			snprintf(comm, sizeof(comm), "<idle>");
+		else
+			snprintf(comm, sizeof(comm), "task%d", pid);
+		fprintf(file, "%16s-%-5d [%03u] %6llu.%06llu: %s: ", comm, pid,
+			cpu, sec, usec, name);
+	}
+}
+
+/* Only perf traces have backtraces, they follow the event line */
+void TraceGen::writeBacktrace()
+{
+	unsigned int i;
+	unsigned int base;
+
+	if (cfg.traceType != TRACE_TYPE_PERF || cfg.backtraceDepth == 0)
+		return;
+	base = random(4096);
+	for (i = 0; i < cfg.backtraceDepth; i++) {
+		fprintf(file, "\t    ffffffff81%06x func_%u+0x%x "
+			"([kernel.kallsyms])\n", (base + i) * 64, base + i,
+			(i + 1) * 16);
+	}
+	fputc('\n', file);
+}
+
+void TraceGen::writeSwitch(unsigned int cpu)
+{
+	int prev = currentPid[cpu];
+	int next;
+	const char *state;
+	char prevComm[32];
+	char nextComm[32];
+
+	/* Switch to idle now and then, but never from idle to idle */
+	if (prev != 0 && random(4) == 0)
+		next = 0;
+	else
+		next = randomPid();
+	if (prev == next)
+		next = 0;
+	if (prev == 0) {
+		snprintf(prevComm, sizeof(prevComm), "swapper/%u", cpu);
+		state = "R";
+	} else {
+		snprintf(prevComm, sizeof(prevComm), "task%d", prev);
+		state = prevStates[random(sizeof(prevStates) /
+					  sizeof(prevStates[0]))];
+	}
+	if (next == 0)
+		snprintf(nextComm, sizeof(nextComm), "swapper/%u", cpu);
+	else
+		snprintf(nextComm, sizeof(nextComm), "task%d", next);
+
+	writeHeader(prev, cpu, eventSystems[SCHED_SWITCH],
+		    eventstrings[SCHED_SWITCH]);
+	if (cfg.traceType == TRACE_TYPE_PERF)
+		fprintf(file, "prev_comm=%s prev_pid=%d prev_prio=%d "
+			"prev_state=%s ==> next_comm=%s next_pid=%d "
+			"next_prio=%d\n", prevComm, prev, TRACEGEN_PRIO, state,
+			nextComm, next, TRACEGEN_PRIO);
+	else
+		fprintf(file, "%s:%d [%d] %s ==> %s:%d [%d]\n", prevComm,
+			prev, TRACEGEN_PRIO, state, nextComm, next,
+			TRACEGEN_PRIO);
+	currentPid[cpu] = next;
+}
+
+void TraceGen::writeEvent(event_t type, unsigned int cpu)
+{
+	int pid = currentPid[cpu];
+	int other;
+	unsigned int target;
+	unsigned int irq;
+	bool perf = cfg.traceType == TRACE_TYPE_PERF;
+
+	if (type == SCHED_SWITCH) {
+		writeSwitch(cpu);
+		writeBacktrace();
+		return;
+	}
+
+	if (type == EVENT_UNKNOWN) {
+		writeHeader(pid, cpu, "probe", "bench_event");
+		fprintf(file, "arg1=%u arg2=0x%x\n", random(1000),
+			random(65536));
+		writeBacktrace();
+		return;
+	}
+
+	writeHeader(pid, cpu, eventSystems[type], eventstrings[type]);
+	other = randomPid();
+	target = random(cfg.nrCPUs);
+	irq = random(TRACEGEN_NR_IRQS);
+
+	switch (type) {
+	case CPU_FREQUENCY:
+		freq[target] = TRACEGEN_MIN_FREQ + TRACEGEN_FREQ_STEP *
+			random(TRACEGEN_NR_FREQS);
+		fprintf(file, "state=%u cpu_id=%u\n", freq[target], target);
+		break;
+	case CPU_IDLE:
+		/* Exits from idle are shown as state 4294967295 */
+		if (random(2) == 0)
+			fprintf(file, "state=%u cpu_id=%u\n",
+				random(TRACEGEN_NR_IDLE_STATES), cpu);
+		else
+			fprintf(file, "state=4294967295 cpu_id=%u\n", cpu);
+		break;
+	case SCHED_MIGRATE_TASK:
+		fprintf(file, "comm=task%d pid=%d prio=%d orig_cpu=%u "
+			"dest_cpu=%u\n", other, other, TRACEGEN_PRIO, cpu,
+			target);
+		break;
+	case SCHED_WAKEUP:
+	case SCHED_WAKEUP_NEW:
+		if (perf)
+			fprintf(file, "comm=task%d pid=%d prio=%d "
+				"target_cpu=%03u\n", other, other,
+				TRACEGEN_PRIO, target);
+		else
+			fprintf(file, "task%d:%d [%d] success=1 CPU:%03u\n",
+				other, other, TRACEGEN_PRIO, target);
+		break;
+	case SCHED_WAKING:
+		fprintf(file, "comm=task%d pid=%d prio=%d target_cpu=%03u\n",
+			other, other, TRACEGEN_PRIO, target);
+		break;
+	case SCHED_PROCESS_FORK:
+		fprintf(file, "comm=task%d pid=%d child_comm=task%d "
+			"child_pid=%d\n", pid, pid, other, other);
+		break;
+	case SCHED_PROCESS_EXIT:
+		fprintf(file, "comm=task%d pid=%d prio=%d\n", other, other,
+			TRACEGEN_PRIO);
+		break;
+	case IRQ_HANDLER_ENTRY:
+		fprintf(file, "irq=%u name=irq%u\n", irq, irq);
+		break;
+	case IRQ_HANDLER_EXIT:
+		fprintf(file, "irq=%u ret=handled\n", irq);
+		break;
+	default:
+		fputc('\n', file);
+		break;
+	}
+	writeBacktrace();
+}
+
+/*
+ * Writes the trace to fileName. Returns 0 or an errno value. The size of the
+ * file is returned in *nrBytes.
+ */
+int TraceGen::generate(const char *fileName, int64_t *nrBytes)
+{
+	int64_t i;
+	unsigned int cpu;
+	int err = 0;
+
+	file = fopen(fileName, "w");
+	if (file == nullptr)
+		return errno;
+	setvbuf(file, nullptr, _IOFBF, TRACEGEN_FILE_BUFFER);
+
+	timeUs = 1000000;
+	for (cpu = 0; cpu < cfg.nrCPUs; cpu++) {
+		currentPid[cpu] = 0;
+		freq[cpu] = TRACEGEN_MIN_FREQ;
+	}
+
+	if (cfg.traceType == TRACE_TYPE_FTRACE)
+		fprintf(file, "# tracer: nop\n#\n");
+
+	for (i = 0; i < cfg.nrEvents; i++) {
+		timeUs += 1 + random(TRACEGEN_MAX_DELTA_US);
+		writeEvent(randomEvent(), random(cfg.nrCPUs));
+	}
+
+	if (ferror(file))
+		err = EIO;
+	*nrBytes = ftell(file);
+	if (fclose(file) != 0 && err == 0)
+		err = errno;
+	file = nullptr;
+	return err;
+}
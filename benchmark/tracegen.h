@@ -0,0 +1,132 @@
+// SPDX-License-Identifier: (GPL-2.0-or-later OR BSD-2-Clause)
+/*
+ * Traceshark - a visualizer for visualizing ftrace and perf traces
+ * Copyright (C) 2019  Viktor Rosendahl <viktor.rosendahl@gmail.com>
+ *
+ * This file is dual licensed: you can use it either under the terms of
+ * the GPL, or the BSD license, at your option.
+ *
+ *  a) This program is free software; you can redistribute it and/or
+ *     modify it under the terms of the GNU General Public License as
+ *     published by the Free Software Foundation; either version 2 of the
+ *     License, or (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public
+ *     License along with this library; if not, write to the Free
+ *     Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ *     MA 02110-1301 USA
+ *
+ * Alternatively,
+ *
+ *  b) Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *     1. Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *     2. Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *     CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *     INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *     MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *     DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *     CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *     NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *     LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *     HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *     CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ *     OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *     EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TRACEGEN_H
+#define TRACEGEN_H
+
+#include <cstdint>
+#include <cstdio>
+
+#include "parser/traceevent.h"
+#include "misc/traceshark.h"
+
+/* The other events are given the index EVENT_UNKNOWN in the weights */
+#define TRACEGEN_NR_WEIGHTS (NR_EVENTS + 1)
+#define TRACEGEN_OTHER_NAME "other"
+#define TRACEGEN_FIRST_PID (1000)
+
+class TraceGenConfig
+{
+public:
+	TraceGenConfig();
+	bool setWeight(const char *name, unsigned int weight);
+	bool setMix(const char *mix);
+	tracetype_t traceType;
+	int64_t nrEvents;
+	unsigned int nrCPUs;
+	unsigned int nrTasks;
+	unsigned int backtraceDepth;
+	uint64_t seed;
+	unsigned int weights[TRACEGEN_NR_WEIGHTS];
+};
+
+/*
+ * Generates a synthetic trace in the text format of ftrace or perf script.
+ * The scheduling is random but consistent, i.e. a sched_switch always
+ * switches out the task that was switched in last on the same CPU, so that
+ * the analyzer gets realistic work to do.
+ */
+class TraceGen
+{
+public:
+	TraceGen(const TraceGenConfig &config);
+	~TraceGen();
+	int generate(const char *fileName, int64_t *nrBytes);
+private:
+	__always_inline uint64_t random();
+	__always_inline unsigned int random(unsigned int n);
+	__always_inline int randomPid();
+	event_t randomEvent();
+	void writeHeader(int pid, unsigned int cpu, const char *system,
+			 const char *name);
+	void writeBacktrace();
+	void writeEvent(event_t type, unsigned int cpu);
+	void writeSwitch(unsigned int cpu);
+	TraceGenConfig cfg;
+	FILE *file;
+	uint64_t state;
+	uint64_t timeUs;
+	unsigned int totalWeight;
+	int *currentPid;
+	unsigned int *freq;
+};
+
+__always_inline uint64_t TraceGen::random()
+{
+	/* xorshift64*, which is good enough and reproducible */
+	state ^= state >> 12;
+	state ^= state << 25;
+	state ^= state >> 27;
+	return state * 0x2545f4914f6cdd1dULL;
+}
+
+__always_inline unsigned int TraceGen::random(unsigned int n)
+{
+	return (unsigned int) ((random() >> 32) % n);
+}
+
+__always_inline int TraceGen::randomPid()
+{
+	return TRACEGEN_FIRST_PID + random(cfg.nrTasks);
+}
+
+#endif /* TRACEGEN_H */
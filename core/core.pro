@@ -0,0 +1,208 @@
+# SPDX-License-Identifier: (GPL-2.0-or-later OR BSD-2-Clause)
+#
+#  Traceshark - a visualizer for visualizing ftrace and perf traces
+#  Copyright (C) 2014-2019  Viktor Rosendahl <viktor.rosendahl@gmail.com>
+#
+# This file is dual licensed: you can use it either under the terms of
+# the GPL, or the BSD license, at your option.
+#
+#  a) This program is free software; you can redistribute it and/or
+#     modify it under the terms of the GNU General Public License as
+#     published by the Free Software Foundation; either version 2 of the
+#     License, or (at your option) any later version.
+#
+#     This program is distributed in the hope that it will be useful,
+#     but WITHOUT ANY WARRANTY; without even the implied warranty of
+#     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#     GNU General Public License for more details.
+#
+#     You should have received a copy of the GNU General Public
+#     License along with this library; if not, write to the Free
+#     Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+#     MA 02110-1301 USA
+#
+# Alternatively,
+#
+#  b) Redistribution and use in source and binary forms, with or
+#     without modification, are permitted provided that the following
+#     conditions are met:
+#
+#     1. Redistributions of source code must retain the above
+#        copyright notice, this list of conditions and the following
+#        disclaimer.
+#     2. Redistributions in binary form must reproduce the above
+#        copyright notice, this list of conditions and the following
+#        disclaimer in the documentation and/or other materials
+#        provided with the distribution.
+#
+#     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+#     CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+#     INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+#     MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+#     DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+#     CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+#     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+#     NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+#     LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+#     HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+#     CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+#     OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+#     EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#
+
+###############################################################################
+# Library
+#
+# The parser, the analyzer and the code that they need. Nothing in here may
+# depend on QtWidgets, so that the library can be used without a GUI.
+
+TEMPLATE      = lib
+TARGET        = traceshark-core
+CONFIG       += staticlib
+INCLUDEPATH  += ..
+
+include(../traceshark.pri)
+
+###############################################################################
+# Header files
+#
+
+HEADERS       = ../analyzer/abstracttask.h
+HEADERS      +=  ../analyzer/analysiscache.h
+HEADERS      +=  ../analyzer/cpufreq.h
+HEADERS      +=  ../analyzer/cpusched.h
+HEADERS      +=  ../analyzer/cpu.h
+HEADERS      +=  ../analyzer/cpuidle.h
+HEADERS      +=  ../analyzer/eventcolumns.h
+HEADERS      +=  ../analyzer/eventpostings.h
+HEADERS      +=  ../analyzer/cputask.h
+HEADERS      +=  ../analyzer/filterstate.h
+HEADERS      +=  ../analyzer/migration.h
+HEADERS      +=  ../analyzer/task.h
+HEADERS      +=  ../analyzer/tcolor.h
+HEADERS      +=  ../analyzer/traceanalyzer.h
+
+HEADERS      +=  ../parser/charclass.h
+HEADERS      +=  ../parser/datacursor.h
+HEADERS      +=  ../parser/eventargs.h
+HEADERS      +=  ../parser/eventextractor.h
+HEADERS      +=  ../parser/eventformat.h
+HEADERS      +=  ../parser/eventhash.h
+HEADERS      +=  ../parser/fileinfo.h
+HEADERS      +=  ../parser/genericparams.h
+HEADERS      +=  ../parser/indexwriter.h
+HEADERS      +=  ../parser/paramhelpers.h
+HEADERS      +=  ../parser/parsedbuffer.h
+HEADERS      +=  ../parser/schedpayload.h
+HEADERS      +=  ../parser/traceevent.h
+HEADERS      +=  ../parser/traceindex.h
+HEADERS      +=  ../parser/tracefile.h
+HEADERS      +=  ../parser/tracelinedata.h
+HEADERS      +=  ../parser/traceline.h
+HEADERS      +=  ../parser/traceparser.h
+HEADERS      +=  ../parser/ftrace/ftraceparams.h
+HEADERS      +=  ../parser/ftrace/ftracegrammar.h
+HEADERS      +=  ../parser/perf/perfparams.h
+HEADERS      +=  ../parser/perf/perfgrammar.h
+HEADERS      +=  ../parser/tracedat/tracedat.h
+HEADERS      +=  ../parser/tracedat/tracingdata.h
+HEADERS      +=  ../parser/perfdata/perfdata.h
+HEADERS      +=  ../parser/compressed/compressedfile.h
+
+HEADERS      +=  ../threads/handoff.h
+HEADERS      +=  ../threads/indexwatcher.h
+HEADERS      +=  ../threads/loadbuffer.h
+HEADERS      +=  ../threads/loadthread.h
+HEADERS      +=  ../threads/stallstats.h
+HEADERS      +=  ../threads/threadbuffer.h
+HEADERS      +=  ../threads/tthread.h
+HEADERS      +=  ../threads/workitem.h
+HEADERS      +=  ../threads/workqueue.h
+HEADERS      +=  ../threads/workthread.h
+
+HEADERS      +=  ../mm/hashgroup.h
+HEADERS      +=  ../mm/mempool.h
+HEADERS      +=  ../mm/stringpool.h
+HEADERS      +=  ../mm/stringtree.h
+
+HEADERS      +=  ../misc/chunk.h
+HEADERS      +=  ../misc/errors.h
+HEADERS      +=  ../misc/string.h
+HEADERS      +=  ../misc/traceshark.h
+HEADERS      +=  ../misc/translate.h
+HEADERS      +=  ../misc/tstring.h
+
+HEADERS      +=  ../vtl/avltree.h
+HEADERS      +=  ../vtl/bitvector.h
+HEADERS      +=  ../vtl/bsdexits.h
+HEADERS      +=  ../vtl/compiler.h
+HEADERS      +=  ../vtl/error.h
+HEADERS      +=  ../vtl/heapsort.h
+HEADERS      +=  ../vtl/pidmap.h
+HEADERS      +=  ../vtl/tlist.h
+HEADERS      +=  ../vtl/time.h
+HEADERS      +=  ../vtl/timevector.h
+
+###############################################################################
+# Source files
+#
+
+SOURCES       = ../analyzer/abstracttask.cpp
+SOURCES      +=  ../analyzer/analysiscache.cpp
+SOURCES      +=  ../analyzer/cpufreq.cpp
+SOURCES      +=  ../analyzer/cpusched.cpp
+SOURCES      +=  ../analyzer/cpuidle.cpp
+SOURCES      +=  ../analyzer/eventcolumns.cpp
+SOURCES      +=  ../analyzer/eventpostings.cpp
+SOURCES      +=  ../analyzer/cputask.cpp
+SOURCES      +=  ../analyzer/filterstate.cpp
+SOURCES      +=  ../analyzer/task.cpp
+SOURCES      +=  ../analyzer/tcolor.cpp
+SOURCES      +=  ../analyzer/traceanalyzer.cpp
+
+SOURCES      +=  ../parser/charclass.cpp
+SOURCES      +=  ../parser/eventargs.cpp
+SOURCES      +=  ../parser/eventextractor.cpp
+SOURCES      +=  ../parser/eventformat.cpp
+SOURCES      +=  ../parser/eventhash.cpp
+SOURCES      +=  ../parser/fileinfo.cpp
+SOURCES      +=  ../parser/indexwriter.cpp
+SOURCES      +=  ../parser/schedpayload.cpp
+SOURCES      +=  ../parser/traceevent.cpp
+SOURCES      +=  ../parser/traceindex.cpp
+SOURCES      +=  ../parser/tracefile.cpp
+SOURCES      +=  ../parser/traceparser.cpp
+SOURCES      +=  ../parser/ftrace/ftraceparams.cpp
+SOURCES      +=  ../parser/ftrace/ftracegrammar.cpp
+SOURCES      +=  ../parser/perf/perfparams.cpp
+SOURCES      +=  ../parser/perf/perfgrammar.cpp
+SOURCES      +=  ../parser/tracedat/tracedat.cpp
+SOURCES      +=  ../parser/tracedat/tracingdata.cpp
+SOURCES      +=  ../parser/perfdata/perfdata.cpp
+SOURCES      +=  ../parser/compressed/compressedfile.cpp
+
+SOURCES      +=  ../threads/handoff.cpp
+SOURCES      +=  ../threads/indexwatcher.cpp
+SOURCES      +=  ../threads/loadbuffer.cpp
+SOURCES      +=  ../threads/loadthread.cpp
+SOURCES      +=  ../threads/stallstats.cpp
+SOURCES      +=  ../threads/tthread.cpp
+SOURCES      +=  ../threads/workqueue.cpp
+
+SOURCES      +=  ../mm/mempool.cpp
+SOURCES      +=  ../mm/stringpool.cpp
+SOURCES      +=  ../mm/stringtree.cpp
+
+SOURCES      +=  ../misc/errors.cpp
+SOURCES      +=  ../misc/translate.cpp
+
+SOURCES      +=  ../vtl/bitvector.cpp
+SOURCES      +=  ../vtl/error.cpp
+
+###############################################################################
+# Qt Modules
+#
+
+# QtGui is only needed for QColor
+QT            = core
+QT           += gui
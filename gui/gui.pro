@@ -0,0 +1,180 @@
+# SPDX-License-Identifier: (GPL-2.0-or-later OR BSD-2-Clause)
+#
+#  Traceshark - a visualizer for visualizing ftrace and perf traces
+#  Copyright (C) 2014-2019  Viktor Rosendahl <viktor.rosendahl@gmail.com>
+#
+# This file is dual licensed: you can use it either under the terms of
+# the GPL, or the BSD license, at your option.
+#
+#  a) This program is free software; you can redistribute it and/or
+#     modify it under the terms of the GNU General Public License as
+#     published by the Free Software Foundation; either version 2 of the
+#     License, or (at your option) any later version.
+#
+#     This program is distributed in the hope that it will be useful,
+#     but WITHOUT ANY WARRANTY; without even the implied warranty of
+#     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#     GNU General Public License for more details.
+#
+#     You should have received a copy of the GNU General Public
+#     License along with this library; if not, write to the Free
+#     Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+#     MA 02110-1301 USA
+#
+# Alternatively,
+#
+#  b) Redistribution and use in source and binary forms, with or
+#     without modification, are permitted provided that the following
+#     conditions are met:
+#
+#     1. Redistributions of source code must retain the above
+#        copyright notice, this list of conditions and the following
+#        disclaimer.
+#     2. Redistributions in binary form must reproduce the above
+#        copyright notice, this list of conditions and the following
+#        disclaimer in the documentation and/or other materials
+#        provided with the distribution.
+#
+#     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+#     CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+#     INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+#     MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+#     DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+#     CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+#     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+#     NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+#     LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+#     HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+#     CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+#     OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+#     EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#
+
+###############################################################################
+# Application
+#
+
+TEMPLATE      = app
+TARGET        = traceshark
+DESTDIR       = ..
+INCLUDEPATH  += ..
+
+LIBS         += -L$$OUT_PWD/../core -ltraceshark-core
+PRE_TARGETDEPS += $$OUT_PWD/../core/libtraceshark-core.a
+
+include(../traceshark.pri)
+
+###############################################################################
+# Header files
+#
+
+HEADERS       = ../qcustomplot/qcustomplot.h
+HEADERS      +=  ../qcustomplot/qcppointer.h
+HEADERS      +=  ../qcustomplot/qcppointer_impl.h
+HEADERS      +=  ../qcustomplot/qcplist.h
+
+HEADERS      +=  ../ui/abstracttaskmodel.h
+HEADERS      +=  ../ui/cursor.h
+HEADERS      +=  ../ui/cursorinfo.h
+HEADERS      +=  ../ui/errordialog.h
+HEADERS      +=  ../ui/eventinfodialog.h
+HEADERS      +=  ../ui/eventselectdialog.h
+HEADERS      +=  ../ui/eventselectmodel.h
+HEADERS      +=  ../ui/eventselectview.h
+HEADERS      +=  ../ui/eventsmodel.h
+HEADERS      +=  ../ui/eventswidget.h
+HEADERS      +=  ../ui/graphenabledialog.h
+HEADERS      +=  ../ui/infowidget.h
+HEADERS      +=  ../ui/licensedialog.h
+HEADERS      +=  ../ui/mainwindow.h
+HEADERS      +=  ../ui/migrationarrow.h
+HEADERS      +=  ../ui/migrationline.h
+HEADERS      +=  ../ui/qtwidgets.h
+HEADERS      +=  ../ui/statslimitedmodel.h
+HEADERS      +=  ../ui/statsmodel.h
+HEADERS      +=  ../ui/tableview.h
+HEADERS      +=  ../ui/taskgraph.h
+HEADERS      +=  ../ui/taskmodel.h
+HEADERS      +=  ../ui/taskrangeallocator.h
+HEADERS      +=  ../ui/taskselectdialog.h
+HEADERS      +=  ../ui/tasktoolbar.h
+HEADERS      +=  ../ui/taskview.h
+HEADERS      +=  ../ui/tcheckbox.h
+HEADERS      +=  ../ui/traceplot.h
+HEADERS      +=  ../ui/tracesharkstyle.h
+HEADERS      +=  ../ui/yaxisticker.h
+
+HEADERS      +=  ../misc/batchmode.h
+HEADERS      +=  ../misc/resources.h
+HEADERS      +=  ../misc/setting.h
+HEADERS      +=  ../misc/version.h
+
+###############################################################################
+# Source files
+#
+
+SOURCES       = ../qcustomplot/qcustomplot.cpp
+
+SOURCES      +=  ../ui/abstracttaskmodel.cpp
+SOURCES      +=  ../ui/cursor.cpp
+SOURCES      +=  ../ui/cursorinfo.cpp
+SOURCES      +=  ../ui/errordialog.cpp
+SOURCES      +=  ../ui/eventinfodialog.cpp
+SOURCES      +=  ../ui/eventselectdialog.cpp
+SOURCES      +=  ../ui/eventselectmodel.cpp
+SOURCES      +=  ../ui/eventselectview.cpp
+SOURCES      +=  ../ui/eventsmodel.cpp
+SOURCES      +=  ../ui/eventswidget.cpp
+SOURCES      +=  ../ui/graphenabledialog.cpp
+SOURCES      +=  ../ui/infowidget.cpp
+SOURCES      +=  ../ui/licensedialog.cpp
+SOURCES      +=  ../ui/mainwindow.cpp
+SOURCES      +=  ../ui/migrationarrow.cpp
+SOURCES      +=  ../ui/migrationline.cpp
+SOURCES      +=  ../ui/statslimitedmodel.cpp
+SOURCES      +=  ../ui/statsmodel.cpp
+SOURCES      +=  ../ui/tableview.cpp
+SOURCES      +=  ../ui/taskgraph.cpp
+SOURCES      +=  ../ui/taskmodel.cpp
+SOURCES      +=  ../ui/taskrangeallocator.cpp
+SOURCES      +=  ../ui/taskselectdialog.cpp
+SOURCES      +=  ../ui/tasktoolbar.cpp
+SOURCES      +=  ../ui/taskview.cpp
+SOURCES      +=  ../ui/tcheckbox.cpp
+SOURCES      +=  ../ui/traceplot.cpp
+SOURCES      +=  ../ui/tracesharkstyle.cpp
+SOURCES      +=  ../ui/yaxisticker.cpp
+
+SOURCES      +=  ../misc/batchmode.cpp
+SOURCES      +=  ../misc/main.cpp
+SOURCES      +=  ../misc/setting.cpp
+
+###############################################################################
+# Version header
+#
+
+GIT_VERSION_HEADERS = ../misc/gitversion-template.h
+gitversion.output =  obj/gitversion.h
+gitversion.dependency_type = TYPE_C
+gitversion.variable_out = HEADERS
+gitversion.commands = ../scripts/gitversion --input ${QMAKE_FILE_NAME} --output ${QMAKE_FILE_OUT}
+gitversion.input = GIT_VERSION_HEADERS
+QMAKE_EXTRA_COMPILERS += gitversion
+
+###############################################################################
+# Qt Modules
+#
+
+QT           += core
+QT           += widgets
+QT           += printsupport
+!equals(DISABLE_OPENGL, yes): equals(QT_MAJOR_VERSION, 4) {
+QT           += opengl
+}
+
+
+###############################################################################
+# Resources
+#
+
+RESOURCES     = ../traceshark.qrc
@@ -0,0 +1,548 @@
+// SPDX-License-Identifier: (GPL-2.0-or-later OR BSD-2-Clause)
+/*
+ * Traceshark - a visualizer for visualizing ftrace and perf traces
+ * Copyright (C) 2019  Viktor Rosendahl <viktor.rosendahl@gmail.com>
+ *
+ * This file is dual licensed: you can use it either under the terms of
+ * the GPL, or the BSD license, at your option.
+ *
+ *  a) This program is free software; you can redistribute it and/or
+ *     modify it under the terms of the GNU General Public License as
+ *     published by the Free Software Foundation; either version 2 of the
+ *     License, or (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public
+ *     License along with this library; if not, write to the Free
+ *     Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ *     MA 02110-1301 USA
+ *
+ * Alternatively,
+ *
+ *  b) Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *     1. Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *     2. Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *     CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *     INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *     MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *     DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *     CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *     NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *     LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *     HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *     CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ *     OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *     EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include <QString>
+
+#include "analyzer/task.h"
+#include "analyzer/traceanalyzer.h"
+#include "misc/batchmode.h"
+#include "misc/errors.h"
+#include "misc/traceshark.h"
+#include "vtl/bsdexits.h"
+#include "vtl/error.h"
+#include "vtl/heapsort.h"
+#include "vtl/tlist.h"
+
+#define BATCH_OPTION "--batch"
+#define STDOUT_NAME "-"
+
+static const char swappername[] = "swapper";
+
+BatchMode::BatchMode():
+	prgname("traceshark"), analyzer(nullptr), statsName(STDOUT_NAME),
+	format(FORMAT_CSV), formatGiven(false), exportCycles(false),
+	pidInclusive(false), timeLimited(false)
+{}
+
+BatchMode::~BatchMode()
+{
+	delete analyzer;
+}
+
+bool BatchMode::isRequested(int argc, char *argv[])
+{
+	int i;
+
+	for (i = 1; i < argc; i++) {
+		if (strcmp(argv[i], BATCH_OPTION) == 0)
+			return true;
+	}
+	return false;
+}
+
+void BatchMode::usage()
+{
+	fprintf(stderr,
+"Usage: %s --batch [options] FILE\n"
+"\n"
+"  --stats NAME       Write the statistics to NAME, - is stdout (default)\n"
+"  --format FORMAT    csv or json, by default guessed from the stats name\n"
+"  --pid LIST         Only include the events of these comma separated pids\n"
+"  --inclusive        Also include the events that wake up or switch to the\n"
+"                     pids\n"
+"  --events LIST      Only include these comma separated event types\n"
+"  --time LOW,HIGH    Only include events between LOW and HIGH seconds, the\n"
+"                     statistics are then computed for this interval\n"
+"  --export NAME      Export the filtered events of a perf trace to NAME\n"
+"  --export-cycles    Export only the CPU cycles events\n",
+		prgname);
+}
+
+/* Returns the number of arguments consumed, or 0 if there was an error */
+int BatchMode::parseOption(const char *opt, const char *arg)
+{
+	if (strcmp(opt, BATCH_OPTION) == 0)
+		return 1;
+	if (strcmp(opt, "--help") == 0 || strcmp(opt, "-h") == 0)
+		return 0;
+	if (strcmp(opt, "--inclusive") == 0) {
+		pidInclusive = true;
+		return 1;
+	}
+	if (strcmp(opt, "--export-cycles") == 0) {
+		exportCycles = true;
+		return 1;
+	}
+
+	if (arg == nullptr) {
+		vtl::warnx("Unknown option or missing argument: %s", opt);
+		return 0;
+	}
+
+	if (strcmp(opt, "--stats") == 0) {
+		statsName = QByteArray(arg);
+	} else if (strcmp(opt, "--format") == 0) {
+		if (strcmp(arg, "csv") == 0) {
+			format = FORMAT_CSV;
+		} else if (strcmp(arg, "json") == 0) {
+			format = FORMAT_JSON;
+		} else {
+			vtl::warnx("Unknown format: %s", arg);
+			return 0;
+		}
+		formatGiven = true;
+	} else if (strcmp(opt, "--pid") == 0) {
+		if (!parsePids(arg))
+			return 0;
+	} else if (strcmp(opt, "--events") == 0) {
+		eventNames = QByteArray(arg);
+	} else if (strcmp(opt, "--time") == 0) {
+		if (!parseTimes(arg))
+			return 0;
+	} else if (strcmp(opt, "--export") == 0) {
+		exportName = QByteArray(arg);
+	} else {
+		vtl::warnx("Unknown option: %s", opt);
+		return 0;
+	}
+	return 2;
+}
+
+bool BatchMode::parseArguments(int argc, char *argv[])
+{
+	int n;
+
+	if (argc > 0) {
+		prgname = *argv;
+		argc--;
+		argv++;
+	}
+
+	while (argc > 0) {
+		if (**argv == '-' && strcmp(*argv, STDOUT_NAME) != 0) {
+			n = parseOption(argv[0], argc > 1 ? argv[1] : nullptr);
+			if (n == 0)
+				return false;
+		} else {
+			if (!fileName.isEmpty()) {
+				vtl::warnx("Only one trace can be analyzed");
+				return false;
+			}
+			fileName = QByteArray(*argv);
+			n = 1;
+		}
+		argc -= n;
+		argv += n;
+	}
+
+	if (fileName.isEmpty()) {
+		vtl::warnx("No trace file was given");
+		return false;
+	}
+	if (!formatGiven && statsName.endsWith(".json"))
+		format = FORMAT_JSON;
+	return true;
+}
+
+bool BatchMode::parsePids(const char *arg)
+{
+	QList<QByteArray> list = QByteArray(arg).split(',');
+	int i, pid;
+	bool ok;
+
+	for (i = 0; i < list.size(); i++) {
+		pid = list[i].toInt(&ok);
+		if (!ok || pid < 0) {
+			vtl::warnx("Invalid pid: %s", list[i].constData());
+			return false;
+		}
+		pidMap[pid] = pid;
+	}
+	return true;
+}
+
+bool BatchMode::parseTimes(const char *arg)
+{
+	QList<QByteArray> list = QByteArray(arg).split(',');
+	bool ok1 = false;
+	bool ok2 = false;
+
+	if (list.size() == 2) {
+		lowTime = vtl::Time::fromString(list[0].constData(), ok1);
+		highTime = vtl::Time::fromString(list[1].constData(), ok2);
+	}
+	if (!ok1 || !ok2 || highTime < lowTime) {
+		vtl::warnx("Invalid time interval: %s", arg);
+		return false;
+	}
+	timeLimited = true;
+	return true;
+}
+
+bool BatchMode::applyEventFilter()
+{
+	QList<QByteArray> list = eventNames.split(',');
+	QMap<event_t, event_t> map;
+	int nrEvents = TraceEvent::getNrEvents();
+	const TString *name;
+	int i, e;
+
+	for (i = 0; i < list.size(); i++) {
+		for (e = 0; e < nrEvents; e++) {
+			name = TraceEvent::getEventName((event_t) e);
+			if (name != nullptr &&
+			    strcmp(name->ptr, list[i].constData()) == 0)
+				break;
+		}
+		if (e == nrEvents) {
+			vtl::warnx("There are no %s events in the trace",
+				   list[i].constData());
+			continue;
+		}
+		map[(event_t) e] = (event_t) e;
+	}
+
+	/* An empty map would disable the filter, rather than filter all */
+	if (map.isEmpty())
+		return false;
+	analyzer->createEventFilter(map, false);
+	return true;
+}
+
+void BatchMode::applyFilters()
+{
+	if (!pidMap.isEmpty())
+		analyzer->createPidFilter(pidMap, false, pidInclusive);
+	if (!eventNames.isEmpty() && !applyEventFilter())
+		vtl::warnx("None of the events were found, ignoring --events");
+	if (timeLimited)
+		analyzer->createTimeFilter(lowTime, highTime, false);
+}
+
+__always_inline const vtl::Time &BatchMode::taskTime(const Task *task) const
+{
+	return timeLimited ? task->cursorTime : task->accTime;
+}
+
+__always_inline unsigned int BatchMode::taskPct(const Task *task) const
+{
+	return timeLimited ? task->cursorPct : task->accPct;
+}
+
+/*
+ * This computes the statistics in the same way as the statistics dialogs of
+ * the GUI, including the fake idle task.
+ */
+void BatchMode::computeStats(vtl::TList<const Task*> *list, Task *idleTask)
+{
+	vtl::Time delta;
+	vtl::Time idleTime;
+	unsigned int idlePct;
+
+	if (timeLimited) {
+		AbstractTask::setCursorTime(TShark::RED_CURSOR, lowTime);
+		AbstractTask::setCursorTime(TShark::BLUE_CURSOR, highTime);
+		analyzer->doLimitedStats();
+		delta = highTime - lowTime;
+	} else {
+		analyzer->doStats();
+		delta = analyzer->getEndTime() - analyzer->getStartTime();
+	}
+
+	idleTime = delta * analyzer->getNrCPUs();
+	DEFINE_TASKMAP_ITERATOR(iter) = analyzer->taskMap.begin();
+	while (iter != analyzer->taskMap.end()) {
+		Task *task = &iter.value();
+		if (!timeLimited || !task->cursorTime.isZero()) {
+			list->append(task);
+			idleTime -= taskTime(task);
+		}
+		iter++;
+	}
+
+	idlePct = delta.isZero() ? 0 : (unsigned)
+		(10000 * (idleTime.toDouble() / delta.toDouble() + 0.00005));
+	idleTask->pid = 0;
+	idleTask->checkName(swappername, false);
+	idleTask->generateDisplayName();
+	if (timeLimited) {
+		idleTask->cursorTime = idleTime;
+		idleTask->cursorPct = idlePct;
+	} else {
+		idleTask->accTime = idleTime;
+		idleTask->accPct = idlePct;
+	}
+	list->append(idleTask);
+
+	vtl::heapsort<vtl::TList, const Task*>(
+		*list, [this] (const Task *&a, const Task *&b) -> int {
+			const vtl::Time &at = taskTime(a);
+			const vtl::Time &bt = taskTime(b);
+
+			if (at < bt)
+				return 1;
+			if (at > bt)
+				return -1;
+
+			int cmp1 = a->displayName->compare(*b->displayName);
+			if (cmp1 != 0)
+				return cmp1;
+			long cmp2 = (long) a->pid - (long) b->pid;
+			return (int) cmp2;
+		});
+}
+
+void BatchMode::writeJSONString(FILE *file, const char *str)
+{
+	const unsigned char *c;
+
+	fputc('"', file);
+	for (c = (const unsigned char *) str; *c != '\0'; c++) {
+		if (*c == '"' || *c == '\\')
+			fprintf(file, "\\%c", *c);
+		else if (*c < 0x20)
+			fprintf(file, "\\u%04x", *c);
+		else
+			fputc(*c, file);
+	}
+	fputc('"', file);
+}
+
+void BatchMode::writeCSVString(FILE *file, const char *str)
+{
+	const char *c;
+
+	fputc('"', file);
+	for (c = str; *c != '\0'; c++) {
+		if (*c == '"')
+			fputc('"', file);
+		fputc(*c, file);
+	}
+	fputc('"', file);
+}
+
+/* The percentages are in units of 0.01 % */
+void BatchMode::writePct(FILE *file, unsigned int pct)
+{
+	fprintf(file, "%u.%02u", pct / 100, pct % 100);
+}
+
+void BatchMode::writeTime(FILE *file, const vtl::Time &time)
+{
+	char buf[40];
+
+	if (time.sprint(buf))
+		fputs(buf, file);
+	else
+		fputc('0', file);
+}
+
+void BatchMode::writeCSV(FILE *file, const vtl::TList<const Task*> *list)
+{
+	const Task *task;
+	int i;
+
+	fprintf(file, "name,pid,percent,time\n");
+	for (i = 0; i < list->size(); i++) {
+		task = list->at(i);
+		writeCSVString(file, task->displayName->toUtf8().constData());
+		fprintf(file, ",%d,", task->pid);
+		writePct(file, taskPct(task));
+		fputc(',', file);
+		writeTime(file, taskTime(task));
+		fputc('\n', file);
+	}
+}
+
+void BatchMode::writeTask(FILE *file, const Task *task, bool last)
+{
+	fprintf(file, "    { \"name\": ");
+	writeJSONString(file, task->displayName->toUtf8().constData());
+	fprintf(file, ", \"pid\": %d, \"percent\": ", task->pid);
+	writePct(file, taskPct(task));
+	fprintf(file, ", \"time\": ");
+	writeTime(file, taskTime(task));
+	fprintf(file, " }%s\n", last ? "" : ",");
+}
+
+void BatchMode::writeJSON(FILE *file, const vtl::TList<const Task*> *list)
+{
+	const char *type;
+	int i;
+
+	switch (analyzer->getTraceType()) {
+	case TRACE_TYPE_FTRACE:
+		type = "ftrace";
+		break;
+	case TRACE_TYPE_PERF:
+		type = "perf";
+		break;
+	default:
+		type = "unknown";
+		break;
+	}
+
+	fprintf(file, "{\n  \"file\": ");
+	writeJSONString(file, fileName.constData());
+	fprintf(file, ",\n  \"type\": \"%s\",\n", type);
+	fprintf(file, "  \"events\": %d,\n", analyzer->events->size());
+	if (analyzer->isFiltered())
+		fprintf(file, "  \"filtered_events\": %d,\n",
+			analyzer->filteredEvents.size());
+	fprintf(file, "  \"cpus\": %u,\n", analyzer->getNrCPUs());
+	fprintf(file, "  \"start\": ");
+	writeTime(file, timeLimited ? lowTime : analyzer->getStartTime());
+	fprintf(file, ",\n  \"end\": ");
+	writeTime(file, timeLimited ? highTime : analyzer->getEndTime());
+	fprintf(file, ",\n  \"tasks\": [\n");
+	for (i = 0; i < list->size(); i++)
+		writeTask(file, list->at(i), i == list->size() - 1);
+	fprintf(file, "  ]\n}\n");
+}
+
+bool BatchMode::writeStats(const vtl::TList<const Task*> *list)
+{
+	bool toStdout = statsName == STDOUT_NAME;
+	FILE *file;
+	bool rval = true;
+
+	file = toStdout ? stdout : fopen(statsName.constData(), "w");
+	if (file == nullptr) {
+		vtl::warn(errno, "Failed to open %s", statsName.constData());
+		return false;
+	}
+
+	if (format == FORMAT_JSON)
+		writeJSON(file, list);
+	else
+		writeCSV(file, list);
+
+	if (ferror(file)) {
+		vtl::warnx("Failed to write %s", statsName.constData());
+		rval = false;
+	}
+	if (toStdout) {
+		fflush(file);
+	} else if (fclose(file) != 0) {
+		vtl::warn(errno, "Failed to close %s", statsName.constData());
+		rval = false;
+	}
+	return rval;
+}
+
+bool BatchMode::exportEvents()
+{
+	TraceAnalyzer::exporttype_t type = exportCycles ?
+		TraceAnalyzer::EXPORT_TYPE_CPU_CYCLES :
+		TraceAnalyzer::EXPORT_TYPE_ALL;
+	int ts_errno;
+
+	if (analyzer->getTraceType() != TRACE_TYPE_PERF) {
+		vtl::warnx("The trace type is not perf. Only perf traces can "
+			   "be exported");
+		return false;
+	}
+
+	if (!analyzer->exportTraceFile(exportName.constData(), &ts_errno,
+				       type)) {
+		vtl::warn(ts_errno, "Failed to export trace to %s",
+			  exportName.constData());
+		return false;
+	}
+	return true;
+}
+
+int BatchMode::exec(int argc, char *argv[])
+{
+	vtl::TList<const Task*> taskList;
+	Task idleTask;
+	int ts_errno;
+	int rval = BSD_EX_OK;
+
+	if (!parseArguments(argc, argv)) {
+		usage();
+		return BSD_EX_USAGE;
+	}
+
+	analyzer = new TraceAnalyzer();
+	ts_errno = analyzer->open(QString::fromLocal8Bit(fileName));
+	if (ts_errno != 0) {
+		vtl::warn(ts_errno, "Failed to open %s", fileName.constData());
+		return BSD_EX_NOINPUT;
+	}
+	analyzer->processTrace();
+
+	if (analyzer->events->size() <= 0) {
+		vtl::warnx("You have opened an empty trace!");
+		rval = BSD_EX_DATAERR;
+		goto out;
+	}
+
+	applyFilters();
+	computeStats(&taskList, &idleTask);
+	if (!writeStats(&taskList))
+		rval = BSD_EX_CANTCREAT;
+	if (!exportName.isEmpty() && !exportEvents())
+		rval = BSD_EX_CANTCREAT;
+out:
+	analyzer->close(&ts_errno);
+	if (ts_errno != 0) {
+		vtl::warn(ts_errno, "Failed to close %s", fileName.constData());
+		if (rval == BSD_EX_OK)
+			rval = BSD_EX_IOERR;
+	}
+	return rval;
+}
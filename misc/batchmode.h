@@ -0,0 +1,124 @@
+// SPDX-License-Identifier: (GPL-2.0-or-later OR BSD-2-Clause)
+/*
+ * Traceshark - a visualizer for visualizing ftrace and perf traces
+ * Copyright (C) 2019  Viktor Rosendahl <viktor.rosendahl@gmail.com>
+ *
+ * This file is dual licensed: you can use it either under the terms of
+ * the GPL, or the BSD license, at your option.
+ *
+ *  a) This program is free software; you can redistribute it and/or
+ *     modify it under the terms of the GNU General Public License as
+ *     published by the Free Software Foundation; either version 2 of the
+ *     License, or (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public
+ *     License along with this library; if not, write to the Free
+ *     Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ *     MA 02110-1301 USA
+ *
+ * Alternatively,
+ *
+ *  b) Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *     1. Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *     2. Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *     CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *     INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *     MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *     DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *     CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *     NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *     LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *     HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *     CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ *     OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *     EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef BATCHMODE_H
+#define BATCHMODE_H
+
+#include <cstdio>
+
+#include <QByteArray>
+#include <QMap>
+
+#include "parser/traceevent.h"
+#include "vtl/time.h"
+
+class Task;
+class TraceAnalyzer;
+
+namespace vtl {
+	template<class T> class TList;
+}
+
+/*
+ * This runs traceshark without a GUI, so that it can be used on machines that
+ * lack a display. The trace is opened with the TraceAnalyzer, the requested
+ * filters are applied, the statistics are written as CSV or JSON, and the
+ * filtered events can be exported, like with the GUI.
+ */
+class BatchMode
+{
+public:
+	typedef enum : int {
+		FORMAT_CSV = 0,
+		FORMAT_JSON
+	} format_t;
+	BatchMode();
+	~BatchMode();
+	int exec(int argc, char *argv[]);
+	static bool isRequested(int argc, char *argv[]);
+private:
+	void usage();
+	bool parseArguments(int argc, char *argv[]);
+	int parseOption(const char *opt, const char *arg);
+	bool parsePids(const char *arg);
+	bool parseTimes(const char *arg);
+	bool applyEventFilter();
+	void applyFilters();
+	void computeStats(vtl::TList<const Task*> *list, Task *idleTask);
+	bool writeStats(const vtl::TList<const Task*> *list);
+	void writeCSV(FILE *file, const vtl::TList<const Task*> *list);
+	void writeJSON(FILE *file, const vtl::TList<const Task*> *list);
+	void writeTask(FILE *file, const Task *task, bool last);
+	bool exportEvents();
+	__always_inline const vtl::Time &taskTime(const Task *task) const;
+	__always_inline unsigned int taskPct(const Task *task) const;
+	static void writeJSONString(FILE *file, const char *str);
+	static void writeCSVString(FILE *file, const char *str);
+	static void writePct(FILE *file, unsigned int pct);
+	static void writeTime(FILE *file, const vtl::Time &time);
+	const char *prgname;
+	TraceAnalyzer *analyzer;
+	QByteArray fileName;
+	QByteArray statsName;
+	QByteArray exportName;
+	QByteArray eventNames;
+	format_t format;
+	bool formatGiven;
+	bool exportCycles;
+	QMap<int, int> pidMap;
+	bool pidInclusive;
+	bool timeLimited;
+	vtl::Time lowTime;
+	vtl::Time highTime;
+};
+
+#endif /* BATCHMODE_H */
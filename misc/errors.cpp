@@ -85,6 +85,9 @@ static const char errfpos[] = "The position in the file could not be changed.";
 static const char errfrez[] = "The file could not be resized.";
 static const char errfacc[] = "The file could not be accessed.";
 static const char errfcop[] = "The file could not be copied.";
+static const char errfcmp[] =
+	"The file is compressed with an unsupported method.";
+static const char errfdec[] = "The compressed data is corrupt.";
 
 static const char *errorstrings[TS_NR_ERRORS] = {
 	noerror,
@@ -109,7 +112,9 @@ static const char *errorstrings[TS_NR_ERRORS] = {
 	errfpos,
 	errfrez,
 	errfacc,
-	errfcop
+	errfcop,
+	errfcmp,
+	errfdec
 };
 
 const char *ts_strerror(int ts_errno)
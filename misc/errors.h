@@ -77,6 +77,8 @@ typedef enum : int {
 		TS_ERROR_FILE_RESIZE,
 		TS_ERROR_FILE_PERM,
 		TS_ERROR_FILE_COPY,
+		TS_ERROR_COMPRESSION,
+		TS_ERROR_DECOMPRESS,
 		TS_NR_ERRORS
 } tserror_t;
 
@@ -51,9 +51,13 @@
  *     EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <cstring>
+
 #include <QApplication>
+#include <QCoreApplication>
 #include <QString>
 #include <QtCore>
+#include "misc/batchmode.h"
 #include "misc/errors.h"
 #include "misc/resources.h"
 #include "ui/mainwindow.h"
@@ -71,9 +75,13 @@
 "WARNING!!! WARNING!!! WARNING!!! WARNING!!! WARNING!!! WARNING!!!"
 
 static char *prgname;
+static bool follow = false;
 
-static void parseOption(const char */*opt*/)
-{}
+static void parseOption(const char *opt)
+{
+	if (strcmp(opt, "--follow") == 0 || strcmp(opt, "-f") == 0)
+		follow = true;
+}
 
 static void parseArguments(QString *fileName, int argc, char* argv[])
 {
@@ -94,8 +102,21 @@ static void parseArguments(QString *fileName, int argc, char* argv[])
 }
 
 
+static int batchMain(int argc, char* argv[])
+{
+	/* No display is needed, so we must not create a QApplication */
+	QCoreApplication app(argc, argv);
+	BatchMode batch;
+
+	vtl::set_strerror(ts_strerror);
+	return batch.exec(argc, argv);
+}
+
 int main(int argc, char* argv[])
 {
+	if (BatchMode::isRequested(argc, argv))
+		return batchMain(argc, argv);
+
 	QApplication app(argc, argv);
 	MainWindow mainWindow;
 	QPixmap pm(QLatin1String(RESSRC_PNG_SHARK));
@@ -131,8 +152,12 @@ int main(int argc, char* argv[])
 	height = geometry.height() - geometry.height() / 16;
 
 	mainWindow.resize(width, height);
-	if (!fileName.isEmpty())
-		mainWindow.openFile(fileName);
+	if (!fileName.isEmpty()) {
+		if (follow)
+			mainWindow.followFile(fileName);
+		else
+			mainWindow.openFile(fileName);
+	}
 
 	return app.exec();
 }
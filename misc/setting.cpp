@@ -56,6 +56,7 @@
 
 #include "misc/errors.h"
 #include "misc/traceshark.h"
+#include "ui/qtwidgets.h"
 #include "ui/graphenabledialog.h"
 #include "vtl/error.h"
 #include "setting.h"
@@ -130,6 +131,14 @@ void Setting::setupSettings()
 	setOpenGLEnabledKey(QString("OPENGL_ENABLED"));
 	setLineWidth(width);
 	setLineWidthKey(QString("SCHED_GRAPH_LINE_WIDTH"));
+	setFollowWindow(DEFAULT_FOLLOW_WINDOW);
+	setFollowWindowKey(QString("FOLLOW_WINDOW_EVENTS"));
+	setLoadBufferKB(DEFAULT_LOAD_BUFFER_KB);
+	setLoadBufferKBKey(QString("LOAD_BUFFER_KB"));
+	setLoadBuffers(DEFAULT_LOAD_BUFFERS);
+	setLoadBuffersKey(QString("LOAD_BUFFERS"));
+	setEventBatchSize(DEFAULT_EVENT_BATCH_SIZE);
+	setEventBatchSizeKey(QString("EVENT_BATCH_SIZE"));
 }
 
 bool Setting::isWideScreen()
@@ -227,6 +236,14 @@ int Setting::line_width = 0;
 
 bool Setting::opengl = false;
 
+int Setting::follow_window = DEFAULT_FOLLOW_WINDOW;
+
+int Setting::load_buffer_kb = DEFAULT_LOAD_BUFFER_KB;
+
+int Setting::load_buffers = DEFAULT_LOAD_BUFFERS;
+
+int Setting::event_batch_size = DEFAULT_EVENT_BATCH_SIZE;
+
 QMap<QString, enum Setting::SettingIndex> Setting::fileKeyMap;
 
 const int Setting::this_version = 1;
@@ -251,6 +268,46 @@ void Setting::setOpenGLEnabled(bool e)
 	opengl = e;
 }
 
+void Setting::setFollowWindow(int nr)
+{
+	follow_window = nr;
+}
+
+int Setting::getFollowWindow()
+{
+	return follow_window;
+}
+
+void Setting::setLoadBufferKB(int kb)
+{
+	load_buffer_kb = kb;
+}
+
+int Setting::getLoadBufferKB()
+{
+	return load_buffer_kb;
+}
+
+void Setting::setLoadBuffers(int nr)
+{
+	load_buffers = nr;
+}
+
+int Setting::getLoadBuffers()
+{
+	return load_buffers;
+}
+
+void Setting::setEventBatchSize(int nr)
+{
+	event_batch_size = nr;
+}
+
+int Setting::getEventBatchSize()
+{
+	return event_batch_size;
+}
+
 void Setting::setKey(enum SettingIndex idx, const QString &key)
 {
 	fileKeyMap[key] = idx;
@@ -299,6 +356,18 @@ int Setting::saveSettings()
 		} else if (idx == LINE_WIDTH) {
 			stream << key << " ";
 			stream << QString::number(line_width) << "\n";
+		} else if (idx == FOLLOW_WINDOW) {
+			stream << key << " ";
+			stream << QString::number(follow_window) << "\n";
+		} else if (idx == LOAD_BUFFER_KB) {
+			stream << key << " ";
+			stream << QString::number(load_buffer_kb) << "\n";
+		} else if (idx == LOAD_BUFFERS) {
+			stream << key << " ";
+			stream << QString::number(load_buffers) << "\n";
+		} else if (idx == EVENT_BATCH_SIZE) {
+			stream << key << " ";
+			stream << QString::number(event_batch_size) << "\n";
 		}
 	}
 	stream.flush();
@@ -389,6 +458,26 @@ void Setting::setLineWidthKey(const QString &key)
 	setKey(LINE_WIDTH, key);
 }
 
+void Setting::setFollowWindowKey(const QString &key)
+{
+	setKey(FOLLOW_WINDOW, key);
+}
+
+void Setting::setLoadBufferKBKey(const QString &key)
+{
+	setKey(LOAD_BUFFER_KB, key);
+}
+
+void Setting::setLoadBuffersKey(const QString &key)
+{
+	setKey(LOAD_BUFFERS, key);
+}
+
+void Setting::setEventBatchSizeKey(const QString &key)
+{
+	setKey(EVENT_BATCH_SIZE, key);
+}
+
 bool Setting::isIrregularIndex(enum SettingIndex idx)
 {
 	return idx > NR_SETTINGS && idx < END_SETTINGS;
@@ -427,6 +516,7 @@ void Setting::handleIrregularIndex(enum SettingIndex idx,
 {
 	bool enabled, ok;
 	int width;
+	int nr;
 	switch(idx) {
 	case OPENGL_ENABLED:
 		enabled = boolFromValue(&ok, value);
@@ -438,6 +528,27 @@ void Setting::handleIrregularIndex(enum SettingIndex idx,
 		if (ok && width >= 1 && width <= MAX_LINE_WIDTH_OPENGL)
 			line_width = width;
 		break;
+	case FOLLOW_WINDOW:
+		nr = value.toInt(&ok);
+		if (ok && nr >= MIN_FOLLOW_WINDOW)
+			follow_window = nr;
+		break;
+	/* Zero means that the value is computed when a file is opened */
+	case LOAD_BUFFER_KB:
+		nr = value.toInt(&ok);
+		if (ok && nr >= 0 && nr <= MAX_LOAD_BUFFER_KB)
+			load_buffer_kb = nr;
+		break;
+	case LOAD_BUFFERS:
+		nr = value.toInt(&ok);
+		if (ok && nr >= 0)
+			load_buffers = nr;
+		break;
+	case EVENT_BATCH_SIZE:
+		nr = value.toInt(&ok);
+		if (ok && nr > 0)
+			event_batch_size = nr;
+		break;
 	default:
 		break;
 	}
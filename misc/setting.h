@@ -85,6 +85,10 @@ public:
 		/* These are not regular settings but must have unique values */
 		OPENGL_ENABLED,
 		LINE_WIDTH,
+		FOLLOW_WINDOW,
+		LOAD_BUFFER_KB,
+		LOAD_BUFFERS,
+		EVENT_BATCH_SIZE,
 		END_SETTINGS,
 	};
 	static void setupSettings();
@@ -104,6 +108,14 @@ public:
 	static int getLineWidth();
 	static void setOpenGLEnabled(bool e);
 	static bool isOpenGLEnabled();
+	static void setFollowWindow(int nr);
+	static int getFollowWindow();
+	static void setLoadBufferKB(int kb);
+	static int getLoadBufferKB();
+	static void setLoadBuffers(int nr);
+	static int getLoadBuffers();
+	static void setEventBatchSize(int nr);
+	static int getEventBatchSize();
 	static int loadSettings();
 	static int saveSettings();
 	static const QString &getFileName();
@@ -114,6 +126,10 @@ private:
 				  const SettingDependency &d);
 	static void setOpenGLEnabledKey(const QString &key);
 	static void setLineWidthKey(const QString &key);
+	static void setFollowWindowKey(const QString &key);
+	static void setLoadBufferKBKey(const QString &key);
+	static void setLoadBuffersKey(const QString &key);
+	static void setEventBatchSizeKey(const QString &key);
 	static int readKeyValuePair(QTextStream &stream, QString &key,
 				    QString &value);
 	static bool boolFromValue(bool *ok, const QString &value);
@@ -134,6 +150,10 @@ private:
 	static Setting settings[];
 	static int line_width;
 	static bool opengl;
+	static int follow_window;
+	static int load_buffer_kb;
+	static int load_buffers;
+	static int event_batch_size;
 	static QMap<QString, enum SettingIndex> fileKeyMap;
 	static const int this_version;
 };
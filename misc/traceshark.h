@@ -53,10 +53,6 @@
 #ifndef TRACESHARK_H
 #define TRACESHARK_H
 
-#include "gitversion.h"
-
-#define TRACESHARK_VERSION_STRING "0.9.7-beta" TRACESHARK_GIT_VERSION
-
 #include <QtCore>
 #include <cstdint>
 #include <cstdio>
@@ -67,6 +63,26 @@
 #define DEFAULT_LINE_WIDTH_OPENGL (2)
 #define DEFAULT_LINE_WIDTH (1)
 
+/*
+ * When a trace that is followed reaches this many events, the oldest events
+ * are evicted, so that memory use stays bounded. FOLLOW_WINDOW_KEEP() is the
+ * number of events that are kept, so that the eviction doesn't need to be
+ * done every time that new events arrive.
+ */
+#define DEFAULT_FOLLOW_WINDOW (2000000)
+#define MIN_FOLLOW_WINDOW (10000)
+#define FOLLOW_WINDOW_KEEP(WINDOW) ((WINDOW) / 4 * 3)
+
+/*
+ * How many events the analyzer processes at a time while the parsing is going
+ * on. The size and number of the load buffers are by default computed from
+ * the size of the file and the caches.
+ */
+#define DEFAULT_EVENT_BATCH_SIZE (10000)
+#define DEFAULT_LOAD_BUFFER_KB (0)
+#define MAX_LOAD_BUFFER_KB (64 * 1024)
+#define DEFAULT_LOAD_BUFFERS (0)
+
 #ifdef QCUSTOMPLOT_USE_OPENGL
 #define has_opengl() (true)
 #else
@@ -75,12 +91,6 @@
 
 #define EVENT_MAX_NR_ARGS (128)
 
-#if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
-#include <QtGui>
-#else
-#include <QtWidgets>
-#endif
-
 #define MAX_NR_MIGRATIONS (200000)
 
 typedef enum {
@@ -99,11 +109,10 @@ typedef enum {
 #define lastfunc(myint) ((double) myint)
 
 #define DEFINE_CPUTASKMAP_ITERATOR(name) \
-	vtl::AVLTree<int, CPUTask, \
-		vtl::AVLBALANCE_USEPOINTERS>::iterator name
+	vtl::PidMap<CPUTask>::iterator name
 
 #define DEFINE_TASKMAP_ITERATOR(name) \
-	vtl::AVLTree<int, TaskHandle>::iterator name
+	vtl::PidMap<Task>::iterator name
 
 #define DEFINE_COLORMAP_ITERATOR(name) \
 	vtl::AVLTree<int, TColor>::iterator name
@@ -194,25 +203,86 @@ namespace TShark {
 		return 0;
 	}
 
-	union value32 {
-		uint32_t word32;
-		uint8_t word8[4];
-	};
+#define HASH_P0 (0xa0761d6478bd642fULL)
+#define HASH_P1 (0xe7037ed1a0b428dbULL)
+#define HASH_P2 (0x8ebc6af09c88c6e3ULL)
+
+	/*
+	 * The multiply and fold step of wyhash. The 128-bit product is
+	 * folded into 64 bits by xoring the halves.
+	 */
+	__always_inline uint64_t HashMix(uint64_t a, uint64_t b)
+	{
+#ifdef __SIZEOF_INT128__
+		__uint128_t r = (__uint128_t) a * b;
+		return (uint64_t) (r >> 64) ^ (uint64_t) r;
+#else
+		uint64_t ha = a >> 32, hb = b >> 32;
+		uint64_t la = (uint32_t) a, lb = (uint32_t) b;
+		uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la;
+		uint64_t rl = la * lb;
+		uint64_t t = rl + (rm0 << 32);
+		uint64_t c = t < rl;
+		uint64_t lo = t + (rm1 << 32);
+		c += lo < t;
+		uint64_t hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+		return hi ^ lo;
+#endif
+	}
+
+	__always_inline uint64_t HashRead64(const uint8_t *p)
+	{
+		uint64_t v;
+		memcpy(&v, p, sizeof(v));
+		return v;
+	}
+
+	__always_inline uint64_t HashRead32(const uint8_t *p)
+	{
+		uint32_t v;
+		memcpy(&v, p, sizeof(v));
+		return v;
+	}
 
+	/*
+	 * A wyhash style hash of the whole string. It never reads outside of
+	 * str->ptr[0] to str->ptr[str->len - 1], since the strings usually
+	 * point into the trace file and are not null terminated.
+	 */
 	__always_inline uint32_t StrHash32(const TString *str)
 	{
-		union value32 uvalue;
-		uvalue.word32 = 0;
-		unsigned int s = str->len;
-		if (s < 1)
-			return 0;
-		uvalue.word8[3] = str->ptr[0];
-		if (s < 4)
-			return uvalue.word32;
-		uvalue.word8[2] = str->ptr[s - 3];
-		uvalue.word8[1] = str->ptr[s - 2];
-		uvalue.word8[0] = str->ptr[s - 1];
-		return uvalue.word32;
+		const uint8_t *p = (const uint8_t *) str->ptr;
+		uint64_t len = (uint64_t) str->len;
+		uint64_t seed = HASH_P0;
+		uint64_t a, b, i;
+
+		if (len <= 16) {
+			if (len >= 4) {
+				i = (len >> 3) << 2;
+				a = (HashRead32(p) << 32) | HashRead32(p + i);
+				b = (HashRead32(p + len - 4) << 32) |
+					HashRead32(p + len - 4 - i);
+			} else if (len > 0) {
+				a = ((uint64_t) p[0] << 16) |
+					((uint64_t) p[len >> 1] << 8) |
+					p[len - 1];
+				b = 0;
+			} else {
+				a = b = 0;
+			}
+		} else {
+			i = len;
+			do {
+				seed = HashMix(HashRead64(p) ^ HASH_P1,
+					       HashRead64(p + 8) ^ seed);
+				p += 16;
+				i -= 16;
+			} while (i > 16);
+			a = HashRead64(p + i - 16);
+			b = HashRead64(p + i - 8);
+		}
+		return (uint32_t) HashMix(HASH_P2 ^ len,
+					  HashMix(a ^ HASH_P1, b ^ seed));
 	}
 
 	__always_inline bool cmp_timespec(const struct timespec &s1,
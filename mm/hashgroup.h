@@ -0,0 +1,154 @@
+// SPDX-License-Identifier: (GPL-2.0-or-later OR BSD-2-Clause)
+/*
+ * Traceshark - a visualizer for visualizing ftrace and perf traces
+ * Copyright (C) 2019  Viktor Rosendahl <viktor.rosendahl@gmail.com>
+ *
+ * This file is dual licensed: you can use it either under the terms of
+ * the GPL, or the BSD license, at your option.
+ *
+ *  a) This program is free software; you can redistribute it and/or
+ *     modify it under the terms of the GNU General Public License as
+ *     published by the Free Software Foundation; either version 2 of the
+ *     License, or (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public
+ *     License along with this library; if not, write to the Free
+ *     Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ *     MA 02110-1301 USA
+ *
+ * Alternatively,
+ *
+ *  b) Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *     1. Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *     2. Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *     CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *     INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *     MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *     DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *     CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *     NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *     LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *     HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *     CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ *     OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *     EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef HASHGROUP_H
+#define HASHGROUP_H
+
+#include <cstdint>
+#include <cstring>
+
+#include "vtl/compiler.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/*
+ * Helpers for the open addressing tables in StringPool and StringTree. These
+ * work like a Swiss table: every slot has a control byte, which is either
+ * HASHGROUP_EMPTY or the top seven bits of the hash of the string in the
+ * slot. The control bytes are probed HASHGROUP_SIZE at a time, so that only
+ * slots whose control byte matches need to have their strings compared.
+ */
+
+#define HASHGROUP_SIZE (16)
+#define HASHGROUP_EMPTY ((int8_t) -128)
+
+class HashGroup {
+public:
+	static __always_inline int8_t h2(uint32_t hval);
+	static __always_inline uint32_t match(const int8_t *ctrl, int8_t h);
+	static __always_inline uint32_t matchEmpty(const int8_t *ctrl);
+	static __always_inline int nextBit(uint32_t &mask);
+};
+
+__always_inline int8_t HashGroup::h2(uint32_t hval)
+{
+	return (int8_t) (hval >> 25);
+}
+
+#ifdef __SSE2__
+
+__always_inline uint32_t HashGroup::match(const int8_t *ctrl, int8_t h)
+{
+	__m128i g = _mm_loadu_si128((const __m128i *) ctrl);
+
+	return (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(g,
+							   _mm_set1_epi8(h)));
+}
+
+__always_inline uint32_t HashGroup::matchEmpty(const int8_t *ctrl)
+{
+	return match(ctrl, HASHGROUP_EMPTY);
+}
+
+#else /* __SSE2__ not defined */
+
+/*
+ * Without SSE2, two 64-bit words are used. The match bits are computed with
+ * the usual "has zero byte" trick, which can give false positives above a
+ * true match. They are harmless since every match is verified.
+ */
+__always_inline uint32_t HashGroup::match(const int8_t *ctrl, int8_t h)
+{
+	const uint64_t lsb = 0x0101010101010101ULL;
+	const uint64_t msb = 0x8080808080808080ULL;
+	uint64_t w[2], x;
+	uint32_t mask = 0;
+	int i, j;
+
+	memcpy(w, ctrl, sizeof(w));
+	for (i = 0; i < 2; i++) {
+		x = w[i] ^ (lsb * (uint8_t) h);
+		x = (x - lsb) & ~x & msb;
+		for (j = 0; j < 8; j++) {
+			if (x & (0x80ULL << (j * 8)))
+				mask |= 1U << (i * 8 + j);
+		}
+	}
+	return mask;
+}
+
+__always_inline uint32_t HashGroup::matchEmpty(const int8_t *ctrl)
+{
+	uint32_t mask = 0;
+	int i;
+
+	for (i = 0; i < HASHGROUP_SIZE; i++) {
+		if (ctrl[i] == HASHGROUP_EMPTY)
+			mask |= 1U << i;
+	}
+	return mask;
+}
+
+#endif /* __SSE2__ */
+
+/* Returns the lowest set bit of mask and clears it */
+__always_inline int HashGroup::nextBit(uint32_t &mask)
+{
+	int i = __builtin_ctz(mask);
+
+	mask &= mask - 1;
+	return i;
+}
+
+#endif /* HASHGROUP_H */
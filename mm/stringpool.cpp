@@ -57,28 +57,31 @@
 #define MIN(A, B) ((A) < (B) ? A:B)
 
 
-StringPool::StringPool(unsigned int nr_pages, unsigned int hSizeP)
+StringPool::StringPool(unsigned int nr_pages, unsigned int hSizeP):
+	ctrl(nullptr), table(nullptr), hashes(nullptr)
 {
-	unsigned int entryPages, strPages;
+	unsigned int entryPages, size;
 
 	if (hSizeP == 0)
 		hSize = 1;
 	else
 		hSize = hSizeP;
 
-	entryPages = 2 * hSize *
-		sizeof(vtl::AVLNode<TString, __DummySP>) / 4096;
-	entryPages = MAX(1, entryPages);
-	strPages = 2* hSize * sizeof(TString) / 4096;
-	strPages = MAX(16, strPages);
+	entryPages = 2 * MIN(hSize, SP_MAX_INITIAL_SLOTS) * sizeof(TString) /
+		4096;
+	entryPages = MAX(16, entryPages);
 
 	coldCharPool = new MemPool(nr_pages, 1);
 	strPool = new MemPool(nr_pages, sizeof(TString));
 
-	avlPools.charPool = new MemPool(nr_pages, sizeof(char));
-	avlPools.nodePool = new MemPool(entryPages, sizeof(vtl::AVLNode<TString,
-							   __DummySP>));
-	hashTable = new StringPoolEntry*[hSize];
+	charPool = new MemPool(nr_pages, sizeof(char));
+	entryPool = new MemPool(entryPages, sizeof(TString));
+
+	size = HASHGROUP_SIZE;
+	while (size < hSize && size < SP_MAX_INITIAL_SLOTS)
+		size *= 2;
+	allocTable(size);
+
 	countAllocs = new unsigned int[hSize];
 	countReuse = new unsigned int[hSize];
 	clearTable();
@@ -86,40 +89,74 @@ StringPool::StringPool(unsigned int nr_pages, unsigned int hSizeP)
 
 StringPool::~StringPool()
 {
-	unsigned int i, s;
 	delete coldCharPool;
 	delete strPool;
-	delete avlPools.charPool;
-	delete avlPools.nodePool;
-	delete[] hashTable;
+	delete charPool;
+	delete entryPool;
+	delete[] ctrl;
+	delete[] table;
+	delete[] hashes;
 	delete[] countAllocs;
 	delete[] countReuse;
-	s = deleteList.size();
-	for (i = 0; i < s; i++) {
-		delete deleteList[i];
+}
+
+void StringPool::allocTable(unsigned int size)
+{
+	delete[] ctrl;
+	delete[] table;
+	delete[] hashes;
+	nrSlots = size;
+	groupMask = size / HASHGROUP_SIZE - 1;
+	ctrl = new int8_t[size];
+	table = new TString*[size];
+	hashes = new uint32_t[size];
+	memset(ctrl, HASHGROUP_EMPTY, size);
+	nrUsed = 0;
+}
+
+void StringPool::grow()
+{
+	int8_t *oldCtrl = ctrl;
+	TString **oldTable = table;
+	uint32_t *oldHashes = hashes;
+	unsigned int oldSlots = nrSlots;
+	unsigned int i, idx;
+
+	ctrl = nullptr;
+	table = nullptr;
+	hashes = nullptr;
+	allocTable(oldSlots * 2);
+
+	for (i = 0; i < oldSlots; i++) {
+		if (oldCtrl[i] == HASHGROUP_EMPTY)
+			continue;
+		idx = findEmpty(oldHashes[i]);
+		ctrl[idx] = oldCtrl[i];
+		table[idx] = oldTable[i];
+		hashes[idx] = oldHashes[i];
+		nrUsed++;
 	}
+
+	delete[] oldCtrl;
+	delete[] oldTable;
+	delete[] oldHashes;
 }
 
 void StringPool::clearTable()
 {
-	bzero(hashTable, hSize * sizeof(StringPoolEntry*));
+	memset(ctrl, HASHGROUP_EMPTY, nrSlots);
+	nrUsed = 0;
 	bzero(countAllocs, hSize * sizeof(unsigned int));
 	bzero(countReuse, hSize * sizeof(unsigned int));
 }
 
 void StringPool::clear()
 {
-	unsigned int s, i;
 	clearTable();
 	coldCharPool->reset();
 	strPool->reset();
-	avlPools.nodePool->reset();
-	avlPools.charPool->reset();
-	s = deleteList.size();
-	for (i = 0; i < s; i++) {
-		delete deleteList[i];
-	}
-	deleteList.clear();
+	charPool->reset();
+	entryPool->reset();
 }
 
 void StringPool::reset()
@@ -55,81 +55,20 @@
 
 #include <cstdint>
 #include <cstring>
+#include "mm/hashgroup.h"
 #include "mm/mempool.h"
 #include "misc/traceshark.h"
 #include "misc/tstring.h"
-#include "vtl/avltree.h"
-#include "vtl/tlist.h"
 
-class __DummySP {};
-
-class PoolBundleSP {
-public:
-	MemPool *charPool;
-	MemPool *nodePool;
-};
-
-#define __STRINGPOOL_ITERATOR(name) \
-vtl::AVLTree<TString, __DummySP, vtl::AVLBALANCE_USEPOINTERS, \
-AVLAllocatorSP<TString, __DummySP>, AVLCompareSP<TString>>::iterator
-
-template <class T>
-class AVLCompareSP {
-public:
-	__always_inline static int compare(const T &a, const T &b) {
-		return strcmp(a.ptr, b.ptr);
-	}
-};
-
-template <class T, class U>
-class AVLAllocatorSP {
-public:
-	AVLAllocatorSP(void *data) {
-		PoolBundleSP *pb = (PoolBundleSP*) data;
-		pools = *pb;
-	}
-	__always_inline vtl::AVLNode<T, U> *alloc(const T &key) {
-		vtl::AVLNode<T, U> *node = (vtl::AVLNode<T, U> *)
-			pools.nodePool->allocObj();
-		node->key.len = key.len;
-		node->key.ptr = (char*) pools.charPool->allocChars(key.len + 1);
-		strcpy(node->key.ptr, key.ptr);
-		return node;
-	}
-	__always_inline int clear() {
-		/*
-		 * Do nothing because the pools are owned by StringPool. This
-		 * is only called from StringPool, via AVLTree, when the object
-		 * is cleared.
-		 */
-		return 0;
-	}
-private:
-	PoolBundleSP pools;
-};
-
-#define AVLTREE_SIZE ((int)sizeof(vtl::AVLTree<TString, __DummySP,	 \
-vtl::AVLBALANCE_USEPOINTERS, AVLAllocatorSP<TString, __DummySP>, \
-			     AVLCompareSP<TString>>))
-#define TSTRING_PTR_SIZE ((int)sizeof(TString*))
-#define TYPICAL_CACHE_LINE_SIZE (64)
+/*
+ * The table starts with at most this many slots, it grows when needed. The
+ * hSizeP argument to the constructor is the number of counters that are used
+ * for the unique allocation heuristic.
+ */
+#define SP_MAX_INITIAL_SLOTS (65536)
 
-#define SP_CACHE_SIZE (TYPICAL_CACHE_LINE_SIZE - TSTRING_PTR_SIZE - \
-		       AVLTREE_SIZE)
-
-class StringPoolEntry {
-	friend class StringPool;
-public:
-StringPoolEntry(void *data): cachePtr(nullptr), avlTree(data) {
-		bzero(cache, SP_CACHE_SIZE);
-	}
-protected:
-	char cache[SP_CACHE_SIZE];
-	TString *cachePtr;
-	vtl::AVLTree<TString, __DummySP, vtl::AVLBALANCE_USEPOINTERS,
-		AVLAllocatorSP<TString, __DummySP>, AVLCompareSP<TString>>
-		avlTree;
-};
+/* The table grows when it is more than 7/8 full */
+#define SP_MAX_LOAD(SLOTS) ((SLOTS) - (SLOTS) / 8)
 
 class StringPool
 {
@@ -143,66 +82,110 @@ public:
 	void reset();
 private:
 	__always_inline const TString *allocUniqueString(const TString *str);
+	__always_inline TString *newString(const TString *str);
+	__always_inline unsigned int findEmpty(uint32_t hval) const;
+	void allocTable(unsigned int size);
+	void grow();
 	MemPool *coldCharPool;
 	MemPool *strPool;
-	PoolBundleSP avlPools;
-	StringPoolEntry **hashTable;
+	MemPool *charPool;
+	MemPool *entryPool;
+	int8_t *ctrl;
+	TString **table;
+	uint32_t *hashes;
+	unsigned int nrSlots;
+	unsigned int groupMask;
+	unsigned int nrUsed;
 	unsigned int *countAllocs;
 	unsigned int *countReuse;
 	unsigned int hSize;
 	void clearTable();
-	vtl::TList<StringPoolEntry*> deleteList;
 };
 
 __always_inline const TString *StringPool::allocString(const TString *str,
 						       uint32_t hval,
 						       uint32_t cutoff)
 {
-	StringPoolEntry *entry;
-	bool isNew;
-
-	hval = hval % hSize;
-
-	if (cutoff != 0 && countAllocs[hval] > cutoff &&
-	    countAllocs[hval] > countReuse[hval]) {
-		const TString *newstr = allocUniqueString(str);
-		return newstr;
-	}
+	unsigned int cval = hval % hSize;
+	unsigned int group = hval & groupMask;
+	unsigned int step = 0;
+	int8_t h2 = HashGroup::h2(hval);
+	const int8_t *c;
+	unsigned int idx;
+	uint32_t mask;
+	TString *newstr;
 
-	if (hashTable[hval] != nullptr) {
-		entry = hashTable[hval];
-		if (entry->cachePtr != nullptr &&
-		    strcmp(entry->cache, str->ptr) == 0) {
-			if (cutoff != 0)
-				countReuse[hval]++;
-			return entry->cachePtr;
-		}
-		__STRINGPOOL_ITERATOR(iter) iter =
-			entry->avlTree.findInsert(*str, isNew);
-		TString &refStr = iter.key();
-		if (isNew) {
-			if (cutoff != 0)
-				countAllocs[hval]++;
-		} else {
-			if (refStr.len < SP_CACHE_SIZE) {
-				strcpy(entry->cache, refStr.ptr);
-				entry->cachePtr = &refStr;
+	if (cutoff != 0 && countAllocs[cval] > cutoff &&
+	    countAllocs[cval] > countReuse[cval])
+		return allocUniqueString(str);
+
+	while (true) {
+		c = ctrl + group * HASHGROUP_SIZE;
+		mask = HashGroup::match(c, h2);
+		while (mask != 0) {
+			idx = group * HASHGROUP_SIZE + HashGroup::nextBit(mask);
+			if (table[idx]->len == str->len &&
+			    memcmp(table[idx]->ptr, str->ptr, str->len) == 0) {
+				if (cutoff != 0)
+					countReuse[cval]++;
+				return table[idx];
 			}
-			if (cutoff != 0)
-				countReuse[hval]++;
 		}
-		return &refStr;
+		mask = HashGroup::matchEmpty(c);
+		if (mask != 0)
+			break;
+		step++;
+		group = (group + step) & groupMask;
+	}
+
+	newstr = newString(str);
+	if (newstr == nullptr)
+		return nullptr;
+	if (nrUsed >= SP_MAX_LOAD(nrSlots)) {
+		grow();
+		idx = findEmpty(hval);
 	} else {
-		entry = new StringPoolEntry(&avlPools);
-		hashTable[hval] = entry;
-		deleteList.append(entry);
-		__STRINGPOOL_ITERATOR(iter) iter =
-			entry->avlTree.findInsert(*str, isNew);
-		if (cutoff != 0)
-			countAllocs[hval]++;
-		TString &refStr = iter.key();
-		return &refStr;
+		idx = group * HASHGROUP_SIZE + HashGroup::nextBit(mask);
 	}
+	ctrl[idx] = h2;
+	table[idx] = newstr;
+	hashes[idx] = hval;
+	nrUsed++;
+	if (cutoff != 0)
+		countAllocs[cval]++;
+	return newstr;
+}
+
+__always_inline unsigned int StringPool::findEmpty(uint32_t hval) const
+{
+	unsigned int group = hval & groupMask;
+	unsigned int step = 0;
+	uint32_t mask;
+
+	while (true) {
+		mask = HashGroup::matchEmpty(ctrl + group * HASHGROUP_SIZE);
+		if (mask != 0)
+			return group * HASHGROUP_SIZE + HashGroup::nextBit(mask);
+		step++;
+		group = (group + step) & groupMask;
+	}
+}
+
+__always_inline TString *StringPool::newString(const TString *str)
+{
+	TString *newstr;
+
+	newstr = (TString*) entryPool->allocObj();
+	if (newstr == nullptr)
+		return nullptr;
+	newstr->len = str->len;
+	newstr->ptr = (char*) charPool->allocChars(str->len + 1);
+	if (newstr->ptr == nullptr)
+		return nullptr;
+	/* The key is not null terminated but the pooled copy is */
+	memcpy(newstr->ptr, str->ptr, str->len);
+	newstr->ptr[str->len] = '\0';
+	return newstr;
 }
 
 __always_inline const TString *StringPool::allocUniqueString(const TString *str)
@@ -216,11 +199,9 @@ __always_inline const TString *StringPool::allocUniqueString(const TString *str)
 	newstr->ptr = (char*) coldCharPool->allocChars(str->len + 1);
 	if (newstr->ptr == nullptr)
 		return nullptr;
-	strcpy(newstr->ptr, str->ptr);
+	memcpy(newstr->ptr, str->ptr, str->len);
+	newstr->ptr[str->len] = '\0';
 	return newstr;
 }
 
-
-
-
 #endif /* STRINGPOOL_H */
@@ -59,61 +59,122 @@
 
 StringTree::StringTree(unsigned int nr_pages, unsigned int hSizeP,
 		       unsigned int table_size):
+	ctrl(nullptr), slotValues(nullptr), hashes(nullptr),
 	maxEvent((event_t)-1)
 {
-	unsigned int entryPages;
+	unsigned int size = HASHGROUP_SIZE;
 
-	if (hSizeP == 0)
-		hSize = 1;
-	else
-		hSize = hSizeP;
+	while (size < hSizeP)
+		size *= 2;
 
-	entryPages = 2 * hSize *
-		sizeof(vtl::AVLNode<TString, event_t>) / 4096;
-	entryPages = MAX(1, entryPages);
+	charPool = new MemPool(nr_pages, sizeof(char));
+	strPool = new MemPool(MAX(1, 2 * size * sizeof(TString) / 4096),
+			      sizeof(TString));
+	allocSlots(size);
 
-	avlPools.charPool = new MemPool(nr_pages, sizeof(char));
-	avlPools.nodePool = new MemPool(entryPages, sizeof(vtl::AVLNode<TString,
-							   event_t>));
-	hashTable = new StringTreeEntry*[hSize];
-
-	stringTable = new TString*[table_size];
-	tableSize = table_size;
+	tableSize = MAX(1, table_size);
+	stringTable = new TString*[tableSize];
 
 	clearTable();
 }
 
 StringTree::~StringTree()
 {
-	unsigned int i, s;
-	delete avlPools.charPool;
-	delete avlPools.nodePool;
-	delete[] hashTable;
+	delete charPool;
+	delete strPool;
+	delete[] ctrl;
+	delete[] slotValues;
+	delete[] hashes;
 	delete[] stringTable;
-	s = deleteList.size();
-	for (i = 0; i < s; i++) {
-		delete deleteList[i];
+	freeRetiredTables();
+}
+
+void StringTree::allocSlots(unsigned int size)
+{
+	delete[] ctrl;
+	delete[] slotValues;
+	delete[] hashes;
+	nrSlots = size;
+	groupMask = size / HASHGROUP_SIZE - 1;
+	ctrl = new int8_t[size];
+	slotValues = new event_t[size];
+	hashes = new uint32_t[size];
+	memset(ctrl, HASHGROUP_EMPTY, size);
+	nrUsed = 0;
+}
+
+void StringTree::growSlots()
+{
+	int8_t *oldCtrl = ctrl;
+	event_t *oldValues = slotValues;
+	uint32_t *oldHashes = hashes;
+	unsigned int oldSlots = nrSlots;
+	unsigned int i, idx;
+
+	ctrl = nullptr;
+	slotValues = nullptr;
+	hashes = nullptr;
+	allocSlots(oldSlots * 2);
+
+	for (i = 0; i < oldSlots; i++) {
+		if (oldCtrl[i] == HASHGROUP_EMPTY)
+			continue;
+		idx = findEmpty(oldHashes[i]);
+		ctrl[idx] = oldCtrl[i];
+		slotValues[idx] = oldValues[i];
+		hashes[idx] = oldHashes[i];
+		nrUsed++;
 	}
+
+	delete[] oldCtrl;
+	delete[] oldValues;
+	delete[] oldHashes;
+}
+
+/*
+ * The number of distinct event names is not known in advance, so the table
+ * that translates from event_t to the name is grown as needed. The old table
+ * is not freed here, since stringLookup() may be reading it in another thread
+ * while a trace is being parsed. It is freed by clear() or the destructor.
+ */
+void StringTree::growStringTable(event_t value)
+{
+	unsigned int newSize = tableSize;
+	TString **newTable;
+
+	while (newSize <= (unsigned int) value)
+		newSize *= 2;
+	newTable = new TString*[newSize];
+	memcpy(newTable, stringTable, tableSize * sizeof(TString*));
+	bzero(newTable + tableSize, (newSize - tableSize) * sizeof(TString*));
+	retiredTables.append(stringTable);
+	__atomic_store_n(&stringTable, newTable, __ATOMIC_RELEASE);
+	tableSize = newSize;
+}
+
+void StringTree::freeRetiredTables()
+{
+	int i;
+
+	for (i = 0; i < retiredTables.size(); i++)
+		delete[] retiredTables[i];
+	retiredTables.clear();
 }
 
 void StringTree::clearTable()
 {
-	bzero(hashTable, hSize * sizeof(StringTreeEntry*));
+	memset(ctrl, HASHGROUP_EMPTY, nrSlots);
+	nrUsed = 0;
 	bzero(stringTable, tableSize * sizeof(TString*));
 	maxEvent = (event_t) -1;
 }
 
 void StringTree::clear()
 {
-	unsigned int s, i;
 	clearTable();
-	avlPools.nodePool->reset();
-	avlPools.charPool->reset();
-	s = deleteList.size();
-	for (i = 0; i < s; i++) {
-		delete deleteList[i];
-	}
-	deleteList.clear();
+	freeRetiredTables();
+	strPool->reset();
+	charPool->reset();
 }
 
 void StringTree::reset()
@@ -55,77 +55,21 @@
 
 #include <cstdint>
 #include <cstring>
+#include <QVector>
+#include "mm/hashgroup.h"
 #include "mm/mempool.h"
 #include "misc/traceshark.h"
 #include "misc/tstring.h"
 #include "parser/traceevent.h"
-#include "vtl/avltree.h"
-#include "vtl/tlist.h"
 
-class PoolBundleST {
-public:
-	MemPool *charPool;
-	MemPool *nodePool;
-};
-
-#define __STRINGTREE_ITERATOR(name) \
-	vtl::AVLTree<TString, event_t, vtl::AVLBALANCE_USEPOINTERS, \
-AVLAllocatorST<TString, event_t>, AVLCompareST<TString>>::iterator
-
-template <class T>
-class AVLCompareST {
-public:
-	__always_inline static int compare(const T &a, const T &b) {
-		return strcmp(a.ptr, b.ptr);
-	}
-};
-
-template <class T, class U>
-class AVLAllocatorST {
-public:
-	AVLAllocatorST(void *data) {
-		PoolBundleST *pb = (PoolBundleST*) data;
-		pools = *pb;
-	}
-	__always_inline vtl::AVLNode<T, U> *alloc(const T &key) {
-		vtl::AVLNode<T, U> *node = (vtl::AVLNode<T, U> *)
-			pools.nodePool->allocObj();
-		node->key.len = key.len;
-		node->key.ptr = (char*) pools.charPool->allocChars(key.len + 1);
-		strncpy(node->key.ptr, key.ptr, key.len + 1);
-		return node;
-	}
-	__always_inline int clear() {
-		/*
-		 * Do nothing because the pools are owned by StringTree. This
-		 * is only called from StringTree, via AVLTree, when the object
-		 * is cleared.
-		 */
-		return 0;
-	}
-private:
-	PoolBundleST pools;
-};
-
-#define ST_AVLTREE_SIZE (sizeof(vtl::AVLTree<TString, event_t, \
-vtl::AVLBALANCE_USEPOINTERS, AVLAllocatorST<TString, event_t>, \
-				AVLCompareST<TString>>))
-#define ST_TSTRING_PTR_SIZE (sizeof(TString*))
-#define ST_TYPICAL_CACHE_LINE_SIZE (32)
-
-#define ST_CACHE_SIZE (ST_TYPICAL_CACHE_LINE_SIZE - ST_TSTRING_PTR_SIZE - \
-		       ST_AVLTREE_SIZE)
-
-class StringTreeEntry {
-	friend class StringTree;
-public:
-StringTreeEntry(void *data): avlTree(data) { }
-protected:
-	vtl::AVLTree<TString, event_t, vtl::AVLBALANCE_USEPOINTERS,
-		AVLAllocatorST<TString, event_t>, AVLCompareST<TString>>
-		avlTree;
-};
+/* The table grows when it is more than 7/8 full */
+#define ST_MAX_LOAD(SLOTS) ((SLOTS) - (SLOTS) / 8)
 
+/*
+ * This maps strings to event_t values and back. It used to be a hash table of
+ * AVL trees, hence the name, but it is now an open addressing table like the
+ * one in StringPool.
+ */
 class StringTree
 {
 public:
@@ -133,6 +77,8 @@ public:
 		   unsigned int table_size = 4096);
 	~StringTree();
 	__always_inline const TString *stringLookup(event_t value) const;
+	__always_inline event_t searchString(const TString *str,
+					     uint32_t hval) const;
 	__always_inline event_t searchAllocString(const TString *str,
 						  uint32_t hval,
 						  event_t newval);
@@ -140,56 +86,138 @@ public:
 	void clear();
 	void reset();
 private:
-	PoolBundleST avlPools;
-	StringTreeEntry **hashTable;
-	unsigned int hSize;
+	__always_inline unsigned int findEmpty(uint32_t hval) const;
+	void allocSlots(unsigned int size);
+	void growSlots();
+	void growStringTable(event_t value);
+	MemPool *charPool;
+	MemPool *strPool;
+	int8_t *ctrl;
+	event_t *slotValues;
+	uint32_t *hashes;
+	unsigned int nrSlots;
+	unsigned int groupMask;
+	unsigned int nrUsed;
 	unsigned int tableSize;
 	event_t maxEvent;
 	TString **stringTable;
+	/* Old string tables, which may still be read by stringLookup() */
+	QVector<TString**> retiredTables;
 	void clearTable();
-	vtl::TList<StringTreeEntry*> deleteList;
+	void freeRetiredTables();
 };
 
+/*
+ * This may be called without the lock of the writer, while new strings are
+ * added by searchAllocString(). The acquire of maxEvent pairs with the release
+ * in searchAllocString(), so that the slot of the value has been written and
+ * the table that is loaded here is at least as large as value.
+ */
 __always_inline const TString *StringTree::stringLookup(event_t value) const
 {
-	if (value < 0 || value > maxEvent)
+	TString **table;
+
+	if (value < 0 || value > __atomic_load_n(&maxEvent, __ATOMIC_ACQUIRE))
 		return nullptr;
-	return stringTable[value];
+	table = __atomic_load_n(&stringTable, __ATOMIC_ACQUIRE);
+	return table[value];
+}
+
+/* Returns EVENT_ERROR if the string is not in the tree */
+__always_inline event_t StringTree::searchString(const TString *str,
+						 uint32_t hval) const
+{
+	unsigned int group = hval & groupMask;
+	unsigned int step = 0;
+	int8_t h2 = HashGroup::h2(hval);
+	const int8_t *c;
+	const TString *s;
+	unsigned int idx;
+	uint32_t mask;
+
+	while (true) {
+		c = ctrl + group * HASHGROUP_SIZE;
+		mask = HashGroup::match(c, h2);
+		while (mask != 0) {
+			idx = group * HASHGROUP_SIZE + HashGroup::nextBit(mask);
+			s = stringTable[slotValues[idx]];
+			if (s->len == str->len &&
+			    memcmp(s->ptr, str->ptr, str->len) == 0)
+				return slotValues[idx];
+		}
+		if (HashGroup::matchEmpty(c) != 0)
+			return EVENT_ERROR;
+		step++;
+		group = (group + step) & groupMask;
+	}
 }
 
 __always_inline event_t StringTree::searchAllocString(const TString *str,
 						      uint32_t hval,
 						      event_t newval)
 {
-	StringTreeEntry *entry;
-	bool isNew;
-
-	hval = hval % hSize;
-
-	if (hashTable[hval] != nullptr) {
-		entry = hashTable[hval];
-		__STRINGTREE_ITERATOR(iter) iter =
-			entry->avlTree.findInsert(*str, isNew);
-		if (isNew) {
-			event_t &e = iter.value();
-			e = newval;
-			stringTable[newval] = &iter.key();
-			maxEvent = newval;
-			return newval;
-		} else {
-			return iter.value();
+	unsigned int group = hval & groupMask;
+	unsigned int step = 0;
+	int8_t h2 = HashGroup::h2(hval);
+	const int8_t *c;
+	const TString *s;
+	unsigned int idx;
+	uint32_t mask;
+	TString *newstr;
+
+	while (true) {
+		c = ctrl + group * HASHGROUP_SIZE;
+		mask = HashGroup::match(c, h2);
+		while (mask != 0) {
+			idx = group * HASHGROUP_SIZE + HashGroup::nextBit(mask);
+			s = stringTable[slotValues[idx]];
+			if (s->len == str->len &&
+			    memcmp(s->ptr, str->ptr, str->len) == 0)
+				return slotValues[idx];
 		}
+		mask = HashGroup::matchEmpty(c);
+		if (mask != 0)
+			break;
+		step++;
+		group = (group + step) & groupMask;
+	}
+
+	newstr = (TString *) strPool->allocObj();
+	newstr->len = str->len;
+	newstr->ptr = (char*) charPool->allocChars(str->len + 1);
+	memcpy(newstr->ptr, str->ptr, str->len);
+	newstr->ptr[str->len] = '\0';
+
+	if ((unsigned int) newval >= tableSize)
+		growStringTable(newval);
+	stringTable[newval] = newstr;
+	__atomic_store_n(&maxEvent, newval, __ATOMIC_RELEASE);
+
+	if (nrUsed >= ST_MAX_LOAD(nrSlots)) {
+		growSlots();
+		idx = findEmpty(hval);
 	} else {
-		entry = new StringTreeEntry(&avlPools);
-		hashTable[hval] = entry;
-		deleteList.append(entry);
-		__STRINGTREE_ITERATOR(iter) iter =
-			entry->avlTree.findInsert(*str, isNew);
-		event_t &e = iter.value();
-		e = newval;
-		stringTable[newval] = &iter.key();
-		maxEvent = newval;
-		return newval;
+		idx = group * HASHGROUP_SIZE + HashGroup::nextBit(mask);
+	}
+	ctrl[idx] = h2;
+	slotValues[idx] = newval;
+	hashes[idx] = hval;
+	nrUsed++;
+	return newval;
+}
+
+__always_inline unsigned int StringTree::findEmpty(uint32_t hval) const
+{
+	unsigned int group = hval & groupMask;
+	unsigned int step = 0;
+	uint32_t mask;
+
+	while (true) {
+		mask = HashGroup::matchEmpty(ctrl + group * HASHGROUP_SIZE);
+		if (mask != 0)
+			return group * HASHGROUP_SIZE + HashGroup::nextBit(mask);
+		step++;
+		group = (group + step) & groupMask;
 	}
 }
 
@@ -0,0 +1,150 @@
+// SPDX-License-Identifier: (GPL-2.0-or-later OR BSD-2-Clause)
+/*
+ * Traceshark - a visualizer for visualizing ftrace and perf traces
+ * Copyright (C) 2019  Viktor Rosendahl <viktor.rosendahl@gmail.com>
+ *
+ * This file is dual licensed: you can use it either under the terms of
+ * the GPL, or the BSD license, at your option.
+ *
+ *  a) This program is free software; you can redistribute it and/or
+ *     modify it under the terms of the GNU General Public License as
+ *     published by the Free Software Foundation; either version 2 of the
+ *     License, or (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public
+ *     License along with this library; if not, write to the Free
+ *     Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ *     MA 02110-1301 USA
+ *
+ * Alternatively,
+ *
+ *  b) Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *     1. Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *     2. Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *     CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *     INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *     MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *     DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *     CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *     NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *     LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *     HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *     CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ *     OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *     EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "parser/charclass.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CHARCLASS_X86
+extern "C" {
+#include <immintrin.h>
+}
+#endif
+
+static void classifyScalar(const char *str, uint64_t *spaces,
+			   uint64_t *newlines)
+{
+	uint64_t s = 0;
+	uint64_t n = 0;
+	int i;
+
+	for (i = 0; i < CHARCLASS_BLOCK_SIZE; i++) {
+		s |= (uint64_t) (str[i] == ' ') << i;
+		n |= (uint64_t) (str[i] == '\n') << i;
+	}
+	*spaces = s;
+	*newlines = n;
+}
+
+#ifdef CHARCLASS_X86
+
+__attribute__((target("sse2")))
+static void classifySSE2(const char *str, uint64_t *spaces,
+			 uint64_t *newlines)
+{
+	const __m128i vspace = _mm_set1_epi8(' ');
+	const __m128i vnewline = _mm_set1_epi8('\n');
+	__m128i v;
+	uint64_t s = 0;
+	uint64_t n = 0;
+	uint64_t m;
+	int i;
+
+	for (i = 0; i < CHARCLASS_BLOCK_SIZE; i += 16) {
+		v = _mm_loadu_si128((const __m128i *) (str + i));
+		m = (uint16_t) _mm_movemask_epi8(_mm_cmpeq_epi8(v, vspace));
+		s |= m << i;
+		m = (uint16_t) _mm_movemask_epi8(_mm_cmpeq_epi8(v, vnewline));
+		n |= m << i;
+	}
+	*spaces = s;
+	*newlines = n;
+}
+
+__attribute__((target("avx2")))
+static void classifyAVX2(const char *str, uint64_t *spaces,
+			 uint64_t *newlines)
+{
+	const __m256i vspace = _mm256_set1_epi8(' ');
+	const __m256i vnewline = _mm256_set1_epi8('\n');
+	__m256i lo, hi;
+	uint64_t slo, shi, nlo, nhi;
+
+	lo = _mm256_loadu_si256((const __m256i *) str);
+	hi = _mm256_loadu_si256((const __m256i *) (str + 32));
+	slo = (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, vspace));
+	shi = (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, vspace));
+	nlo = (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(lo,
+								 vnewline));
+	nhi = (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(hi,
+								 vnewline));
+	*spaces = slo | (shi << 32);
+	*newlines = nlo | (nhi << 32);
+}
+
+#endif /* CHARCLASS_X86 */
+
+charclass_fn_t CharClass::getClassifier()
+{
+#ifdef CHARCLASS_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return classifyAVX2;
+	if (__builtin_cpu_supports("sse2"))
+		return classifySSE2;
+#endif
+	return classifyScalar;
+}
+
+const char *CharClass::getClassifierName()
+{
+	charclass_fn_t fn = getClassifier();
+
+#ifdef CHARCLASS_X86
+	if (fn == classifyAVX2)
+		return "avx2";
+	if (fn == classifySSE2)
+		return "sse2";
+#endif
+	if (fn == classifyScalar)
+		return "scalar";
+	return "unknown";
+}
@@ -0,0 +1,1057 @@
+// SPDX-License-Identifier: (GPL-2.0-or-later OR BSD-2-Clause)
+/*
+ * Traceshark - a visualizer for visualizing ftrace and perf traces
+ * Copyright (C) 2019  Viktor Rosendahl <viktor.rosendahl@gmail.com>
+ *
+ * This file is dual licensed: you can use it either under the terms of
+ * the GPL, or the BSD license, at your option.
+ *
+ *  a) This program is free software; you can redistribute it and/or
+ *     modify it under the terms of the GNU General Public License as
+ *     published by the Free Software Foundation; either version 2 of the
+ *     License, or (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public
+ *     License along with this library; if not, write to the Free
+ *     Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ *     MA 02110-1301 USA
+ *
+ * Alternatively,
+ *
+ *  b) Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *     1. Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *     2. Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *     CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *     INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *     MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *     DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *     CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *     NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *     LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *     HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *     CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ *     OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *     EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cerrno>
+#include <climits>
+#include <cstring>
+
+#include <QString>
+#include <QThread>
+
+#include "parser/compressed/compressedfile.h"
+#include "parser/datacursor.h"
+#include "misc/errors.h"
+#include "misc/traceshark.h"
+#include "threads/workthread.h"
+#include "vtl/error.h"
+
+extern "C" {
+#include <sys/mman.h>
+#ifdef TRACESHARK_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef TRACESHARK_HAVE_LZMA
+#include <lzma.h>
+#endif
+#ifdef TRACESHARK_HAVE_ZSTD
+#include <zstd.h>
+#endif
+}
+
+#define GZIP_MAGIC "\x1f\x8b"
+#define XZ_MAGIC "\xfd" "7zXZ\0"
+#define ZSTD_MAGIC "\x28\xb5\x2f\xfd"
+
+#define GZIP_HEADER_SIZE (18)
+#define GZIP_FLAG_EXTRA (0x04)
+#define GZIP_TRAILER_SIZE (8)
+
+#define XZ_HEADER_SIZE (12)
+
+#define ZSTD_SKIPPABLE_MAGIC (0x184D2A50)
+#define ZSTD_SKIPPABLE_MASK (0xFFFFFFF0)
+#define ZSTD_SEEKTABLE_MAGIC (0x184D2A5E)
+#define ZSTD_SEEKABLE_MAGIC (0x8F92EAB1)
+#define ZSTD_SEEKTABLE_FOOTER_SIZE (9)
+#define ZSTD_SEEKTABLE_CHECKSUM (0x80)
+#define ZSTD_SEEKTABLE_RESERVED (0x7C)
+
+/*
+ * Frames larger than this are not decompressed in parallel, since every
+ * thread needs two buffers of the size of the largest frame.
+ */
+#define MAX_PARALLEL_FRAME_SIZE (64 * 1024 * 1024)
+#define SCRATCH_SIZE (64 * 1024)
+
+/* The zlib and lzma APIs use unsigned int and size_t for the lengths */
+#define MAX_INFLATE_CHUNK (1024 * 1024 * 1024)
+
+/*
+ * An Inflater decompresses a range of the mapping. The range may consist of
+ * several frames, except for the xz frame mode, where it is exactly one xz
+ * block.
+ */
+class Inflater
+{
+public:
+	virtual ~Inflater() {}
+	virtual bool begin(const char *src, int64_t size) = 0;
+	/* Returns the number of bytes, 0 at the end of the data, -1 on error */
+	virtual int64_t inflate(char *buf, int64_t len) = 0;
+};
+
+#ifdef TRACESHARK_HAVE_ZLIB
+class GzipInflater : public Inflater
+{
+public:
+	GzipInflater();
+	~GzipInflater();
+	bool begin(const char *src, int64_t size);
+	int64_t inflate(char *buf, int64_t len);
+private:
+	z_stream strm;
+	const char *next;
+	int64_t remaining;
+	bool active;
+	bool finished;
+	bool failed;
+};
+
+GzipInflater::GzipInflater():
+	next(nullptr), remaining(0), active(false), finished(true),
+	failed(false)
+{
+	memset(&strm, 0, sizeof(strm));
+}
+
+GzipInflater::~GzipInflater()
+{
+	if (active)
+		inflateEnd(&strm);
+}
+
+bool GzipInflater::begin(const char *src, int64_t size)
+{
+	if (active) {
+		inflateEnd(&strm);
+		active = false;
+	}
+	memset(&strm, 0, sizeof(strm));
+	/* 16 means that we only accept the gzip format */
+	if (inflateInit2(&strm, 16 + MAX_WBITS) != Z_OK)
+		return false;
+	active = true;
+	next = src;
+	remaining = size;
+	finished = false;
+	failed = false;
+	return true;
+}
+
+int64_t GzipInflater::inflate(char *buf, int64_t len)
+{
+	int64_t produced = 0;
+	unsigned int out;
+	unsigned int chunk;
+	int r;
+
+	while (produced < len && !finished && !failed) {
+		if (strm.avail_in == 0) {
+			chunk = TSMIN(remaining, MAX_INFLATE_CHUNK);
+			strm.next_in = (Bytef*) next;
+			strm.avail_in = chunk;
+			next += chunk;
+			remaining -= chunk;
+		}
+		out = TSMIN(len - produced, MAX_INFLATE_CHUNK);
+		strm.next_out = (Bytef*) buf + produced;
+		strm.avail_out = out;
+		r = ::inflate(&strm, Z_NO_FLUSH);
+		produced += out - strm.avail_out;
+		if (r == Z_STREAM_END) {
+			/* A gzip file may consist of several members */
+			if (strm.avail_in == 0 && remaining == 0)
+				finished = true;
+			else if (inflateReset(&strm) != Z_OK)
+				failed = true;
+		} else if (r != Z_OK) {
+			failed = true;
+		}
+	}
+	if (failed && produced == 0)
+		return -1;
+	return produced;
+}
+#endif /* TRACESHARK_HAVE_ZLIB */
+
+#ifdef TRACESHARK_HAVE_LZMA
+class XzInflater : public Inflater
+{
+public:
+	XzInflater(bool blockMode, uint32_t check);
+	~XzInflater();
+	bool begin(const char *src, int64_t size);
+	int64_t inflate(char *buf, int64_t len);
+private:
+	bool beginBlock(const char *src, int64_t size);
+	lzma_stream strm;
+	bool blockMode;
+	lzma_check check;
+	const char *next;
+	int64_t remaining;
+	bool finished;
+	bool failed;
+};
+
+XzInflater::XzInflater(bool bmode, uint32_t chk):
+	blockMode(bmode), check((lzma_check) chk), next(nullptr),
+	remaining(0), finished(true), failed(false)
+{
+	strm = LZMA_STREAM_INIT;
+}
+
+XzInflater::~XzInflater()
+{
+	lzma_end(&strm);
+}
+
+bool XzInflater::begin(const char *src, int64_t size)
+{
+	lzma_end(&strm);
+	strm = LZMA_STREAM_INIT;
+	finished = false;
+	failed = false;
+	if (blockMode)
+		return beginBlock(src, size);
+	if (lzma_stream_decoder(&strm, UINT64_MAX, LZMA_CONCATENATED) !=
+	    LZMA_OK)
+		return false;
+	next = src;
+	remaining = size;
+	return true;
+}
+
+/* The blocks of an xz file are decoded without the stream around them */
+bool XzInflater::beginBlock(const char *src, int64_t size)
+{
+	lzma_filter filters[LZMA_FILTERS_MAX + 1];
+	lzma_block block;
+	lzma_ret r;
+	int i;
+
+	if (size < 1)
+		return false;
+	memset(&block, 0, sizeof(block));
+	block.version = 0;
+	block.check = check;
+	block.filters = filters;
+	block.header_size = lzma_block_header_size_decode((uint8_t) *src);
+	if (block.header_size > size)
+		return false;
+	if (lzma_block_header_decode(&block, nullptr, (const uint8_t*) src)
+	    != LZMA_OK)
+		return false;
+	r = lzma_block_decoder(&strm, &block);
+	/* The decoder has copied the filter options */
+	for (i = 0; filters[i].id != LZMA_VLI_UNKNOWN; i++)
+		free(filters[i].options);
+	if (r != LZMA_OK)
+		return false;
+	next = src + block.header_size;
+	remaining = size - block.header_size;
+	return true;
+}
+
+int64_t XzInflater::inflate(char *buf, int64_t len)
+{
+	int64_t produced = 0;
+	size_t out;
+	size_t chunk;
+	lzma_action action;
+	lzma_ret r;
+
+	while (produced < len && !finished && !failed) {
+		if (strm.avail_in == 0) {
+			chunk = TSMIN(remaining, MAX_INFLATE_CHUNK);
+			strm.next_in = (const uint8_t*) next;
+			strm.avail_in = chunk;
+			next += chunk;
+			remaining -= chunk;
+		}
+		out = TSMIN(len - produced, MAX_INFLATE_CHUNK);
+		strm.next_out = (uint8_t*) buf + produced;
+		strm.avail_out = out;
+		action = strm.avail_in == 0 ? LZMA_FINISH : LZMA_RUN;
+		r = lzma_code(&strm, action);
+		produced += out - strm.avail_out;
+		if (r == LZMA_STREAM_END)
+			finished = true;
+		else if (r != LZMA_OK)
+			failed = true;
+	}
+	if (failed && produced == 0)
+		return -1;
+	return produced;
+}
+#endif /* TRACESHARK_HAVE_LZMA */
+
+#ifdef TRACESHARK_HAVE_ZSTD
+class ZstdInflater : public Inflater
+{
+public:
+	ZstdInflater();
+	~ZstdInflater();
+	bool begin(const char *src, int64_t size);
+	int64_t inflate(char *buf, int64_t len);
+private:
+	ZSTD_DStream *dstream;
+	ZSTD_inBuffer in;
+	/* True if we are in the middle of a frame */
+	bool inFrame;
+	bool failed;
+};
+
+ZstdInflater::ZstdInflater():
+	inFrame(false), failed(false)
+{
+	dstream = ZSTD_createDStream();
+	in.src = nullptr;
+	in.size = 0;
+	in.pos = 0;
+}
+
+ZstdInflater::~ZstdInflater()
+{
+	ZSTD_freeDStream(dstream);
+}
+
+bool ZstdInflater::begin(const char *src, int64_t size)
+{
+	if (dstream == nullptr)
+		return false;
+	if (ZSTD_isError(ZSTD_initDStream(dstream)))
+		return false;
+	in.src = src;
+	in.size = size;
+	in.pos = 0;
+	inFrame = false;
+	failed = false;
+	return true;
+}
+
+int64_t ZstdInflater::inflate(char *buf, int64_t len)
+{
+	int64_t produced = 0;
+	ZSTD_outBuffer out;
+	size_t r;
+
+	while (produced < len && !failed) {
+		if (in.pos == in.size && !inFrame)
+			break;
+		out.dst = buf + produced;
+		out.size = len - produced;
+		out.pos = 0;
+		r = ZSTD_decompressStream(dstream, &out, &in);
+		if (ZSTD_isError(r)) {
+			failed = true;
+			break;
+		}
+		produced += out.pos;
+		inFrame = r != 0;
+		/* The last frame is truncated */
+		if (out.pos == 0 && in.pos == in.size && inFrame)
+			failed = true;
+	}
+	if (failed && produced == 0)
+		return -1;
+	return produced;
+}
+#endif /* TRACESHARK_HAVE_ZSTD */
+
+CompressedFile::CompressedFile(const char *m, int64_t size):
+	map(m), mapSize(size), compression(COMPRESSION_NONE), xzCheck(0),
+	maxFrameSize(0), dataSize(-1), seqInflater(nullptr), seqPos(0),
+	randInflater(nullptr), randPos(INT64_MAX), frameCache(nullptr),
+	frameCacheSize(0), frameCacheIdx(-1), parallel(false),
+	nrInflaters(0), nrSlots(0), slotMemory(nullptr), nextFrame(0),
+	readFrame(0), readFramePos(0), inflatersStarted(false),
+	abortInflate(false)
+{
+	int i;
+
+	for (i = 0; i < MAX_NR_INFLATERS; i++)
+		inflaterThreads[i] = nullptr;
+}
+
+CompressedFile::~CompressedFile()
+{
+	stopInflaters();
+	delete seqInflater;
+	delete randInflater;
+	delete[] frameCache;
+}
+
+compression_t CompressedFile::getCompression(const char *header,
+					     int64_t len)
+{
+	if (len >= 2 && !memcmp(header, GZIP_MAGIC, 2))
+		return COMPRESSION_GZIP;
+	if (len >= 6 && !memcmp(header, XZ_MAGIC, 6))
+		return COMPRESSION_XZ;
+	if (len >= 4 && !memcmp(header, ZSTD_MAGIC, 4))
+		return COMPRESSION_ZSTD;
+	return COMPRESSION_NONE;
+}
+
+/*
+ * Returns a new Inflater, or nullptr if support for the compression has not
+ * been compiled in. In frame mode, the Inflater will be used to decompress
+ * single frames.
+ */
+Inflater *CompressedFile::newInflater(bool frameMode)
+{
+	switch (compression) {
+#ifdef TRACESHARK_HAVE_ZLIB
+	case COMPRESSION_GZIP:
+		return new GzipInflater();
+#endif
+#ifdef TRACESHARK_HAVE_LZMA
+	case COMPRESSION_XZ:
+		return new XzInflater(frameMode, xzCheck);
+#endif
+#ifdef TRACESHARK_HAVE_ZSTD
+	case COMPRESSION_ZSTD:
+		return new ZstdInflater();
+#endif
+	default:
+		break;
+	}
+	(void) frameMode;
+	return nullptr;
+}
+
+int CompressedFile::open()
+{
+	int i;
+
+	compression = getCompression(map, mapSize);
+	if (compression == COMPRESSION_NONE)
+		return -TS_ERROR_FILEFORMAT;
+
+	if (findFrames()) {
+		dataSize = 0;
+		for (i = 0; i < frames.size(); i++) {
+			maxFrameSize = TSMAX(maxFrameSize, frames[i].dataSize);
+			dataSize += frames[i].dataSize;
+		}
+		parallel = frames.size() > 1 &&
+			maxFrameSize <= MAX_PARALLEL_FRAME_SIZE;
+	} else {
+		frames.clear();
+	}
+
+	seqInflater = newInflater(false);
+	randInflater = newInflater(frames.size() > 0);
+	if (seqInflater == nullptr || randInflater == nullptr)
+		return -TS_ERROR_COMPRESSION;
+	if (!seqInflater->begin(map, mapSize))
+		return -TS_ERROR_FILE_RESOURCE;
+	return 0;
+}
+
+/*
+ * Finds the independent frames of the file. Returns false if the file cannot
+ * be split into frames with known sizes, then it will be decompressed as one
+ * stream.
+ */
+bool CompressedFile::findFrames()
+{
+	int64_t offset = 0;
+	int64_t dataOffset = 0;
+	bool ok;
+	int i;
+
+	switch (compression) {
+	case COMPRESSION_GZIP:
+		ok = findGzipFrames();
+		break;
+	case COMPRESSION_XZ:
+		ok = findXzFrames();
+		break;
+	case COMPRESSION_ZSTD:
+		ok = findZstdFrames();
+		break;
+	default:
+		ok = false;
+		break;
+	}
+	if (!ok || frames.size() < 1)
+		return false;
+
+	/* The frames must follow each other */
+	for (i = 0; i < frames.size(); i++) {
+		const CompressedFrame &frame = frames[i];
+		if (frame.dataSize < 0 || frame.dataOffset != dataOffset ||
+		    frame.offset < offset || frame.size <= 0 ||
+		    frame.size > mapSize - frame.offset)
+			return false;
+		offset = frame.offset + frame.size;
+		dataOffset += frame.dataSize;
+	}
+	return true;
+}
+
+/*
+ * The BGZF format, which is produced by bgzip, consists of gzip members that
+ * store their compressed size in an extra field. The decompressed size is in
+ * the trailer of each member.
+ */
+bool CompressedFile::findGzipFrames()
+{
+	CompressedFrame frame;
+	DataCursor cursor(map, mapSize);
+	const char *header;
+	uint16_t xlen, slen, bsize;
+	uint32_t isize;
+	const char *sub;
+	int64_t end;
+
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	cursor.swap = true;
+#endif
+	frame.dataOffset = 0;
+	while (cursor.pos < mapSize) {
+		frame.offset = cursor.pos;
+		if (!cursor.getBytes(10, &header) ||
+		    memcmp(header, GZIP_MAGIC, 2) != 0 ||
+		    !(header[3] & GZIP_FLAG_EXTRA) || !cursor.get16(&xlen))
+			return false;
+		end = cursor.pos + xlen;
+		bsize = 0;
+		while (cursor.pos + 4 <= end) {
+			if (!cursor.getBytes(2, &sub) || !cursor.get16(&slen))
+				return false;
+			if (sub[0] == 'B' && sub[1] == 'C' && slen == 2) {
+				if (!cursor.get16(&bsize))
+					return false;
+			} else if (!cursor.getBytes(slen, &sub)) {
+				return false;
+			}
+		}
+		if (bsize == 0)
+			return false;
+		frame.size = (int64_t) bsize + 1;
+		if (frame.size < GZIP_HEADER_SIZE + GZIP_TRAILER_SIZE ||
+		    frame.size > mapSize - frame.offset)
+			return false;
+		cursor.pos = frame.offset + frame.size - 4;
+		if (!cursor.get32(&isize))
+			return false;
+		frame.dataSize = isize;
+		frames.append(frame);
+		frame.dataOffset += frame.dataSize;
+	}
+	return true;
+}
+
+/*
+ * An xz file that has been compressed with several threads consists of
+ * blocks that can be decompressed independently. Their sizes are in the index
+ * at the end of the file. We only handle files with a single stream.
+ */
+bool CompressedFile::findXzFrames()
+{
+#ifdef TRACESHARK_HAVE_LZMA
+	lzma_stream_flags hflags, fflags;
+	lzma_index *index = nullptr;
+	lzma_index_iter iter;
+	uint64_t memlimit = UINT64_MAX;
+	size_t pos = 0;
+	int64_t end = mapSize;
+	int64_t indexPos;
+	CompressedFrame frame;
+	bool ok = false;
+
+	if (mapSize < 2 * XZ_HEADER_SIZE)
+		return false;
+	if (lzma_stream_header_decode(&hflags, (const uint8_t*) map)
+	    != LZMA_OK)
+		return false;
+	xzCheck = hflags.check;
+
+	/* Skip the stream padding */
+	while (end >= 2 * XZ_HEADER_SIZE + 4 &&
+	       !memcmp(map + end - 4, "\0\0\0\0", 4))
+		end -= 4;
+	if (lzma_stream_footer_decode(&fflags, (const uint8_t*)
+				      map + end - XZ_HEADER_SIZE) != LZMA_OK)
+		return false;
+	if (lzma_stream_flags_compare(&hflags, &fflags) != LZMA_OK)
+		return false;
+	indexPos = end - XZ_HEADER_SIZE - (int64_t) fflags.backward_size;
+	if (indexPos < XZ_HEADER_SIZE)
+		return false;
+	if (lzma_index_buffer_decode(&index, &memlimit, nullptr,
+				     (const uint8_t*) map + indexPos, &pos,
+				     fflags.backward_size) != LZMA_OK)
+		return false;
+
+	/* There is another stream before this one */
+	if ((int64_t) lzma_index_stream_size(index) != end)
+		goto out;
+
+	lzma_index_iter_init(&iter, index);
+	while (!lzma_index_iter_next(&iter, LZMA_INDEX_ITER_BLOCK)) {
+		frame.offset = iter.block.compressed_file_offset;
+		frame.size = iter.block.total_size;
+		frame.dataOffset = iter.block.uncompressed_file_offset;
+		frame.dataSize = iter.block.uncompressed_size;
+		frames.append(frame);
+	}
+	ok = true;
+out:
+	lzma_index_end(index, nullptr);
+	return ok;
+#else
+	return false;
+#endif
+}
+
+bool CompressedFile::findZstdFrames()
+{
+#ifdef TRACESHARK_HAVE_ZSTD
+	CompressedFrame frame;
+	unsigned long long dsize;
+	uint32_t magic;
+	int64_t pos = 0;
+	size_t csize;
+
+	if (findZstdSeekTable())
+		return true;
+	frames.clear();
+
+	frame.dataOffset = 0;
+	while (pos < mapSize) {
+		csize = ZSTD_findFrameCompressedSize(map + pos, mapSize - pos);
+		if (ZSTD_isError(csize) || csize == 0)
+			return false;
+		/* There is no point in walking through a single frame */
+		if (pos == 0 && (int64_t) csize == mapSize)
+			return false;
+		memcpy(&magic, map + pos, sizeof(magic));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+		magic = __builtin_bswap32(magic);
+#endif
+		if ((magic & ZSTD_SKIPPABLE_MASK) != ZSTD_SKIPPABLE_MAGIC) {
+			dsize = ZSTD_getFrameContentSize(map + pos,
+							 mapSize - pos);
+			if (dsize == ZSTD_CONTENTSIZE_UNKNOWN ||
+			    dsize == ZSTD_CONTENTSIZE_ERROR)
+				return false;
+			frame.offset = pos;
+			frame.size = csize;
+			frame.dataSize = dsize;
+			frames.append(frame);
+			frame.dataOffset += frame.dataSize;
+		}
+		pos += csize;
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+
+/*
+ * The seekable zstd format has a table of the frame sizes in a skippable frame
+ * at the end of the file, so we do not need to walk through all the frames.
+ */
+bool CompressedFile::findZstdSeekTable()
+{
+	CompressedFrame frame;
+	DataCursor cursor(map, mapSize);
+	uint32_t nrFrames, magic, tableMagic, tableSize;
+	uint32_t csize, dsize, checksum;
+	const char *descriptor;
+	int64_t entrySize;
+	int64_t tablePos;
+	uint32_t i;
+
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	cursor.swap = true;
+#endif
+	if (mapSize < ZSTD_SEEKTABLE_FOOTER_SIZE + 8)
+		return false;
+	cursor.pos = mapSize - ZSTD_SEEKTABLE_FOOTER_SIZE;
+	if (!cursor.get32(&nrFrames) || !cursor.getBytes(1, &descriptor) ||
+	    !cursor.get32(&magic))
+		return false;
+	if (magic != ZSTD_SEEKABLE_MAGIC ||
+	    (*descriptor & ZSTD_SEEKTABLE_RESERVED) != 0)
+		return false;
+	entrySize = (*descriptor & ZSTD_SEEKTABLE_CHECKSUM) ? 12 : 8;
+	if ((int64_t) nrFrames * entrySize >
+	    mapSize - ZSTD_SEEKTABLE_FOOTER_SIZE - 8)
+		return false;
+
+	tablePos = mapSize - ZSTD_SEEKTABLE_FOOTER_SIZE - nrFrames * entrySize;
+	cursor.pos = tablePos - 8;
+	if (!cursor.get32(&tableMagic) || !cursor.get32(&tableSize))
+		return false;
+	if (tableMagic != ZSTD_SEEKTABLE_MAGIC ||
+	    tableSize != nrFrames * entrySize + ZSTD_SEEKTABLE_FOOTER_SIZE)
+		return false;
+
+	frame.offset = 0;
+	frame.dataOffset = 0;
+	for (i = 0; i < nrFrames; i++) {
+		if (!cursor.get32(&csize) || !cursor.get32(&dsize))
+			return false;
+		if (entrySize == 12 && !cursor.get32(&checksum))
+			return false;
+		frame.size = csize;
+		frame.dataSize = dsize;
+		frames.append(frame);
+		frame.offset += frame.size;
+		frame.dataOffset += frame.dataSize;
+	}
+	return frame.offset == tablePos - 8;
+}
+
+bool CompressedFile::inflateFrame(Inflater *inflater,
+				  const CompressedFrame &frame, char *buf)
+{
+	int64_t done = 0;
+	int64_t n;
+
+	if (!inflater->begin(map + frame.offset, frame.size))
+		return false;
+	while (done < frame.dataSize) {
+		n = inflater->inflate(buf + done, frame.dataSize - done);
+		if (n <= 0)
+			return false;
+		done += n;
+	}
+	return true;
+}
+
+/* Returns the index of the frame that contains dataOffset, or -1 */
+int CompressedFile::findFrame(int64_t offset) const
+{
+	int low = 0;
+	int high = frames.size() - 1;
+	int mid;
+
+	if (offset < 0 || offset >= dataSize)
+		return -1;
+	while (low < high) {
+		mid = low + (high - low + 1) / 2;
+		if (frames[mid].dataOffset <= offset)
+			low = mid;
+		else
+			high = mid - 1;
+	}
+	return low;
+}
+
+/*
+ * This is used by the loadThread. It works like read(2), i.e. it returns the
+ * number of bytes, 0 at the end and -1 on errors.
+ */
+ssize_t CompressedFile::read(char *buf, size_t len)
+{
+	int64_t copied = 0;
+	int64_t n;
+	int slot;
+
+	if (!parallel) {
+		n = seqInflater->inflate(buf, len);
+		if (n < 0) {
+			errno = EIO;
+			return -1;
+		}
+		/* Now we know the size without having to decompress again */
+		if (n == 0 && len > 0)
+			dataSize = seqPos;
+		seqPos += n;
+		return n;
+	}
+
+	if (!inflatersStarted)
+		startInflaters();
+
+	mutex.lock();
+	while (copied < (int64_t) len && readFrame < frames.size()) {
+		const CompressedFrame &frame = frames[readFrame];
+		slot = readFrame % nrSlots;
+		while (slotFrame[slot] != readFrame || !slotDone[slot])
+			frameDone.wait(&mutex);
+		if (slotError[slot]) {
+			mutex.unlock();
+			if (copied > 0)
+				return copied;
+			errno = EIO;
+			return -1;
+		}
+		/* The slot is ours until we free it */
+		mutex.unlock();
+		n = TSMIN((int64_t) len - copied, frame.dataSize - readFramePos);
+		memcpy(buf + copied, slotMemory + slot * maxFrameSize +
+		       readFramePos, n);
+		copied += n;
+		readFramePos += n;
+		mutex.lock();
+		if (readFramePos == frame.dataSize) {
+			slotFrame[slot] = -1;
+			slotDone[slot] = false;
+			readFrame++;
+			readFramePos = 0;
+			slotFreed.wakeAll();
+		}
+	}
+	mutex.unlock();
+	return copied;
+}
+
+void CompressedFile::startInflaters()
+{
+	int i;
+	size_t size;
+
+	nrInflaters = TSMAX(1, QThread::idealThreadCount() - 2);
+	nrInflaters = TSMIN(nrInflaters, MAX_NR_INFLATERS);
+	nrInflaters = TSMIN(nrInflaters, frames.size());
+	/* Two slots per thread, so that the threads can work ahead */
+	nrSlots = 2 * nrInflaters;
+
+	size = nrSlots * maxFrameSize;
+	slotMemory = (char*) mmap(nullptr, size, PROT_READ | PROT_WRITE,
+				  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (slotMemory == MAP_FAILED)
+		mmap_err();
+	slotFrame.fill(-1, nrSlots);
+	slotDone.fill(false, nrSlots);
+	slotError.fill(false, nrSlots);
+	nextFrame = 0;
+	readFrame = 0;
+	readFramePos = 0;
+	abortInflate = false;
+
+	for (i = 0; i < nrInflaters; i++) {
+		inflaterThreads[i] = new WorkThread<CompressedFile>
+			(QString("inflaterThread") + QString::number(i), this,
+			 &CompressedFile::threadInflate);
+		inflaterThreads[i]->start();
+	}
+	inflatersStarted = true;
+}
+
+void CompressedFile::stopInflaters()
+{
+	int i;
+
+	if (!inflatersStarted)
+		return;
+	mutex.lock();
+	abortInflate = true;
+	slotFreed.wakeAll();
+	mutex.unlock();
+	for (i = 0; i < nrInflaters; i++) {
+		inflaterThreads[i]->wait();
+		delete inflaterThreads[i];
+		inflaterThreads[i] = nullptr;
+	}
+	if (munmap(slotMemory, nrSlots * maxFrameSize) != 0)
+		munmap_err();
+	slotMemory = nullptr;
+	inflatersStarted = false;
+}
+
+/*
+ * The inflater threads take the frames in order and each frame has a fixed
+ * slot, so a thread may need to wait until read() has consumed the frame that
+ * previously occupied the slot.
+ */
+void CompressedFile::threadInflate()
+{
+	Inflater *inflater = newInflater(true);
+	int frame, slot;
+	bool ok;
+
+	mutex.lock();
+	while (!abortInflate && nextFrame < frames.size()) {
+		frame = nextFrame;
+		nextFrame++;
+		slot = frame % nrSlots;
+		/*
+		 * The slot is free when read() has consumed all frames before
+		 * this one that used it. We cannot just wait for the slot to
+		 * be free, because another thread could be waiting for the
+		 * same slot with a later frame.
+		 */
+		while (!abortInflate && frame >= readFrame + nrSlots)
+			slotFreed.wait(&mutex);
+		if (abortInflate)
+			break;
+		slotFrame[slot] = frame;
+		slotDone[slot] = false;
+		mutex.unlock();
+
+		ok = inflater != nullptr &&
+			inflateFrame(inflater, frames[frame],
+				     slotMemory + slot * maxFrameSize);
+
+		mutex.lock();
+		slotDone[slot] = true;
+		slotError[slot] = !ok;
+		frameDone.wakeAll();
+	}
+	mutex.unlock();
+	delete inflater;
+}
+
+/*
+ * This is used to read the chunks of the events, e.g. backtraces. It is not
+ * thread safe and should only be used from the main thread.
+ */
+int64_t CompressedFile::readAt(int64_t offset, char *buf, int64_t len,
+			       int *ts_errno)
+{
+	int64_t done = 0;
+	int64_t n, pos;
+	int idx;
+
+	*ts_errno = 0;
+	if (frameCache == nullptr) {
+		frameCacheSize = frames.size() > 0 ? maxFrameSize :
+			SCRATCH_SIZE;
+		frameCache = new char[TSMAX(frameCacheSize, 1)];
+	}
+
+	if (frames.size() > 0) {
+		while (done < len) {
+			idx = findFrame(offset + done);
+			if (idx < 0)
+				break;
+			const CompressedFrame &frame = frames[idx];
+			if (idx != frameCacheIdx) {
+				frameCacheIdx = -1;
+				if (!inflateFrame(randInflater, frame,
+						  frameCache)) {
+					*ts_errno = -TS_ERROR_DECOMPRESS;
+					return done;
+				}
+				frameCacheIdx = idx;
+			}
+			pos = offset + done - frame.dataOffset;
+			n = TSMIN(len - done, frame.dataSize - pos);
+			memcpy(buf + done, frameCache + pos, n);
+			done += n;
+		}
+		if (done < len)
+			*ts_errno = -TS_ERROR_EOF;
+		return done;
+	}
+
+	/*
+	 * Without frames, we need to decompress from the beginning of the file,
+	 * unless the offset is after the previous read.
+	 */
+	if (offset < randPos) {
+		if (!randInflater->begin(map, mapSize)) {
+			*ts_errno = -TS_ERROR_FILE_RESOURCE;
+			return 0;
+		}
+		randPos = 0;
+	}
+	while (randPos < offset) {
+		n = randInflater->inflate(frameCache,
+					  TSMIN(offset - randPos,
+						frameCacheSize));
+		if (n <= 0)
+			goto err;
+		randPos += n;
+	}
+	while (done < len) {
+		n = randInflater->inflate(buf + done, len - done);
+		if (n <= 0)
+			goto err;
+		done += n;
+		randPos += n;
+	}
+	return done;
+err:
+	*ts_errno = n < 0 ? -TS_ERROR_DECOMPRESS : -TS_ERROR_EOF;
+	/* Make the next call start from the beginning */
+	randPos = INT64_MAX;
+	return done;
+}
+
+/*
+ * Returns the size of the decompressed data, or -1 on errors. If the file does
+ * not have frames with known sizes, this needs to decompress the whole file.
+ */
+int64_t CompressedFile::getSize()
+{
+	Inflater *inflater;
+	int64_t size = 0;
+	int64_t n;
+	char *scratch;
+
+	if (dataSize >= 0)
+		return dataSize;
+	inflater = newInflater(false);
+	if (inflater == nullptr || !inflater->begin(map, mapSize)) {
+		delete inflater;
+		return -1;
+	}
+	scratch = new char[SCRATCH_SIZE];
+	while ((n = inflater->inflate(scratch, SCRATCH_SIZE)) > 0)
+		size += n;
+	delete[] scratch;
+	delete inflater;
+	if (n < 0)
+		return -1;
+	dataSize = size;
+	return dataSize;
+}
+
+/*
+ * Decompresses the whole file to buf, which must have room for getSize()
+ * bytes. This uses the same parallel decompression as read(), so it cannot be
+ * used if the file is also being read with read().
+ */
+int CompressedFile::decompressAll(char *buf, int64_t len)
+{
+	int64_t done = 0;
+	ssize_t n;
+
+	while (done < len) {
+		n = read(buf + done, TSMIN(len - done, MAX_INFLATE_CHUNK));
+		if (n < 0)
+			return -TS_ERROR_DECOMPRESS;
+		if (n == 0)
+			return -TS_ERROR_EOF;
+		done += n;
+	}
+	return 0;
+}
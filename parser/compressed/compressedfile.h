@@ -0,0 +1,178 @@
+// SPDX-License-Identifier: (GPL-2.0-or-later OR BSD-2-Clause)
+/*
+ * Traceshark - a visualizer for visualizing ftrace and perf traces
+ * Copyright (C) 2019  Viktor Rosendahl <viktor.rosendahl@gmail.com>
+ *
+ * This file is dual licensed: you can use it either under the terms of
+ * the GPL, or the BSD license, at your option.
+ *
+ *  a) This program is free software; you can redistribute it and/or
+ *     modify it under the terms of the GNU General Public License as
+ *     published by the Free Software Foundation; either version 2 of the
+ *     License, or (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public
+ *     License along with this library; if not, write to the Free
+ *     Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ *     MA 02110-1301 USA
+ *
+ * Alternatively,
+ *
+ *  b) Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *     1. Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *     2. Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *     CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *     INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *     MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *     DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *     CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *     NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *     LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *     HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *     CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ *     OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *     EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef COMPRESSEDFILE_H
+#define COMPRESSEDFILE_H
+
+#include <cstdint>
+
+#include <QMutex>
+#include <QVector>
+#include <QWaitCondition>
+
+#include "vtl/compiler.h"
+
+extern "C" {
+#include <sys/types.h>
+}
+
+class Inflater;
+template<class T> class WorkThread;
+
+#define COMPRESSED_MAGIC_SIZE (6)
+
+/* The largest number of threads that decompress frames in parallel */
+#define MAX_NR_INFLATERS (8)
+
+typedef enum : int {
+	COMPRESSION_NONE = 0,
+	COMPRESSION_GZIP,
+	COMPRESSION_XZ,
+	COMPRESSION_ZSTD
+} compression_t;
+
+/*
+ * A frame is a piece of the compressed file that can be decompressed without
+ * knowing anything about the rest of the file. These are the members of a
+ * BGZF file, the blocks of an xz file and the frames of a zstd file.
+ */
+class CompressedFrame
+{
+public:
+	int64_t offset;
+	int64_t size;
+	int64_t dataOffset;
+	/* This is -1 if the decompressed size is not known */
+	int64_t dataSize;
+};
+
+/*
+ * This class decompresses a gzip, xz or zstd file from a read only mapping of
+ * the file. If the file consists of several independent frames with known
+ * sizes, the frames are decompressed in parallel by a number of threads, ahead
+ * of the sequential read() calls. The frames also allow readAt() to jump
+ * directly to the frame that has the data, otherwise it needs to decompress
+ * everything from the beginning of the file.
+ */
+class CompressedFile
+{
+public:
+	CompressedFile(const char *map, int64_t size);
+	~CompressedFile();
+	static compression_t getCompression(const char *header, int64_t len);
+	int open();
+	ssize_t read(char *buf, size_t len);
+	int64_t readAt(int64_t offset, char *buf, int64_t len, int *ts_errno);
+	int64_t getSize();
+	int decompressAll(char *buf, int64_t len);
+	__always_inline compression_t getCompression() const;
+	__always_inline int getNrFrames() const;
+private:
+	Inflater *newInflater(bool frameMode);
+	bool findFrames();
+	bool findGzipFrames();
+	bool findXzFrames();
+	bool findZstdFrames();
+	bool findZstdSeekTable();
+	bool inflateFrame(Inflater *inflater, const CompressedFrame &frame,
+			  char *buf);
+	int findFrame(int64_t dataOffset) const;
+	void startInflaters();
+	void stopInflaters();
+	void threadInflate();
+	const char *map;
+	int64_t mapSize;
+	compression_t compression;
+	/* Only used by xz, this is the check type from the stream header */
+	uint32_t xzCheck;
+	QVector<CompressedFrame> frames;
+	int64_t maxFrameSize;
+	int64_t dataSize;
+	/* Used by read() if the frames are not decompressed in parallel */
+	Inflater *seqInflater;
+	int64_t seqPos;
+	/* Used by readAt() */
+	Inflater *randInflater;
+	int64_t randPos;
+	char *frameCache;
+	int64_t frameCacheSize;
+	int frameCacheIdx;
+	/* These are used by the parallel decompression */
+	bool parallel;
+	int nrInflaters;
+	int nrSlots;
+	char *slotMemory;
+	QVector<int> slotFrame;
+	QVector<bool> slotDone;
+	QVector<bool> slotError;
+	int nextFrame;
+	int readFrame;
+	int64_t readFramePos;
+	bool inflatersStarted;
+	bool abortInflate;
+	QMutex mutex;
+	QWaitCondition slotFreed;
+	QWaitCondition frameDone;
+	WorkThread<CompressedFile> *inflaterThreads[MAX_NR_INFLATERS];
+};
+
+__always_inline compression_t CompressedFile::getCompression() const
+{
+	return compression;
+}
+
+__always_inline int CompressedFile::getNrFrames() const
+{
+	return frames.size();
+}
+
+#endif /* COMPRESSEDFILE_H */
@@ -0,0 +1,149 @@
+// SPDX-License-Identifier: (GPL-2.0-or-later OR BSD-2-Clause)
+/*
+ * Traceshark - a visualizer for visualizing ftrace and perf traces
+ * Copyright (C) 2019  Viktor Rosendahl <viktor.rosendahl@gmail.com>
+ *
+ * This file is dual licensed: you can use it either under the terms of
+ * the GPL, or the BSD license, at your option.
+ *
+ *  a) This program is free software; you can redistribute it and/or
+ *     modify it under the terms of the GNU General Public License as
+ *     published by the Free Software Foundation; either version 2 of the
+ *     License, or (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public
+ *     License along with this library; if not, write to the Free
+ *     Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ *     MA 02110-1301 USA
+ *
+ * Alternatively,
+ *
+ *  b) Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *     1. Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *     2. Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *     CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *     INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *     MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *     DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *     CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *     NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *     LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *     HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *     CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ *     OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *     EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef DATACURSOR_H
+#define DATACURSOR_H
+
+#include <cstdint>
+#include <cstring>
+
+#include "parser/eventformat.h"
+#include "vtl/compiler.h"
+
+/*
+ * A bounds checked reader of the headers of binary trace files. All the get
+ * functions return false if the data would extend beyond the end.
+ */
+class DataCursor {
+public:
+	DataCursor(const char *d, int64_t s, bool sw = false);
+	__always_inline bool getBytes(int64_t n, const char **ptr);
+	__always_inline bool get16(uint16_t *value);
+	__always_inline bool get32(uint32_t *value);
+	__always_inline bool get64(uint64_t *value);
+	__always_inline bool getString(const char **str, int64_t *len);
+	__always_inline bool expectString(const char *str);
+	const char *data;
+	int64_t size;
+	int64_t pos;
+	bool swap;
+};
+
+inline DataCursor::DataCursor(const char *d, int64_t s, bool sw)
+	: data(d), size(s), pos(0), swap(sw)
+{}
+
+__always_inline bool DataCursor::getBytes(int64_t n, const char **ptr)
+{
+	if (n < 0 || n > size - pos)
+		return false;
+	*ptr = data + pos;
+	pos += n;
+	return true;
+}
+
+__always_inline bool DataCursor::get16(uint16_t *value)
+{
+	const char *ptr;
+
+	if (!getBytes(2, &ptr))
+		return false;
+	*value = EventField::readUnsigned(ptr, 2, swap);
+	return true;
+}
+
+__always_inline bool DataCursor::get32(uint32_t *value)
+{
+	const char *ptr;
+
+	if (!getBytes(4, &ptr))
+		return false;
+	*value = EventField::readUnsigned(ptr, 4, swap);
+	return true;
+}
+
+__always_inline bool DataCursor::get64(uint64_t *value)
+{
+	const char *ptr;
+
+	if (!getBytes(8, &ptr))
+		return false;
+	*value = EventField::readUnsigned(ptr, 8, swap);
+	return true;
+}
+
+/* This returns a null terminated string from the data */
+__always_inline bool DataCursor::getString(const char **str, int64_t *len)
+{
+	const char *end;
+
+	if (pos >= size)
+		return false;
+	end = (const char*) memchr(data + pos, '\0', size - pos);
+	if (end == nullptr)
+		return false;
+	*str = data + pos;
+	*len = end - *str;
+	pos += *len + 1;
+	return true;
+}
+
+__always_inline bool DataCursor::expectString(const char *str)
+{
+	const char *s;
+	int64_t len;
+
+	return getString(&s, &len) && len == (int64_t) strlen(str) &&
+		memcmp(s, str, len) == 0;
+}
+
+#endif /* DATACURSOR_H */
@@ -0,0 +1,138 @@
+// SPDX-License-Identifier: (GPL-2.0-or-later OR BSD-2-Clause)
+/*
+ * Traceshark - a visualizer for visualizing ftrace and perf traces
+ * Copyright (C) 2019  Viktor Rosendahl <viktor.rosendahl@gmail.com>
+ *
+ * This file is dual licensed: you can use it either under the terms of
+ * the GPL, or the BSD license, at your option.
+ *
+ *  a) This program is free software; you can redistribute it and/or
+ *     modify it under the terms of the GNU General Public License as
+ *     published by the Free Software Foundation; either version 2 of the
+ *     License, or (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public
+ *     License along with this library; if not, write to the Free
+ *     Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ *     MA 02110-1301 USA
+ *
+ * Alternatively,
+ *
+ *  b) Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *     1. Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *     2. Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *     CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *     INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *     MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *     DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *     CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *     NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *     LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *     HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *     CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ *     OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *     EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "misc/chunk.h"
+#include "parser/eventargs.h"
+#include "parser/tracefile.h"
+#include "parser/tracedat/tracedat.h"
+
+/* The raw arguments of an event are formatted into a buffer of this size */
+#define EVENTARGS_RAW_SIZE (1024)
+
+TraceFile *EventArgs::traceFile = nullptr;
+const TraceDat *EventArgs::traceDat = nullptr;
+
+void EventArgs::setTraceFile(TraceFile *file)
+{
+	traceFile = file;
+}
+
+void EventArgs::setTraceDat(const TraceDat *dat)
+{
+	traceDat = dat;
+}
+
+EventArgs::~EventArgs()
+{
+	delete[] chars;
+}
+
+void EventArgs::decode(const TraceEvent &event)
+{
+	Chunk chunk;
+	int ts_errno;
+	int len;
+
+	argv = ptrs;
+	argc = 0;
+
+	if (event.hasRawArgs()) {
+		if (traceDat == nullptr)
+			return;
+		chars = new char[EVENTARGS_RAW_SIZE];
+		len = traceDat->formatArgsAt(event.argOffset, chars,
+					     EVENTARGS_RAW_SIZE);
+		tokenize(len);
+		return;
+	}
+
+	if (traceFile == nullptr || event.argLen <= 0)
+		return;
+
+	chunk.offset = event.argOffset;
+	chunk.len = event.argLen;
+	chars = new char[chunk.len + 1];
+	len = traceFile->readChunkAt(&chunk, chars, chunk.len, &ts_errno);
+	if (ts_errno != 0 || len != chunk.len)
+		return;
+	tokenize(len);
+}
+
+/*
+ * The arguments are split at the spaces, in the same way as the lines are
+ * tokenized when the file is parsed.
+ */
+void EventArgs::tokenize(int len)
+{
+	char *c;
+	char *end;
+	char *word;
+
+	chars[len] = '\0';
+	end = chars + len;
+	c = chars;
+	while (c < end && argc < EVENT_MAX_NR_ARGS) {
+		while (c < end && *c == ' ')
+			c++;
+		if (c == end)
+			break;
+		word = c;
+		while (c < end && *c != ' ')
+			c++;
+		*c = '\0';
+		strings[argc].ptr = word;
+		strings[argc].len = c - word;
+		ptrs[argc] = &strings[argc];
+		argc++;
+		c++;
+	}
+}
@@ -0,0 +1,101 @@
+// SPDX-License-Identifier: (GPL-2.0-or-later OR BSD-2-Clause)
+/*
+ * Traceshark - a visualizer for visualizing ftrace and perf traces
+ * Copyright (C) 2019  Viktor Rosendahl <viktor.rosendahl@gmail.com>
+ *
+ * This file is dual licensed: you can use it either under the terms of
+ * the GPL, or the BSD license, at your option.
+ *
+ *  a) This program is free software; you can redistribute it and/or
+ *     modify it under the terms of the GNU General Public License as
+ *     published by the Free Software Foundation; either version 2 of the
+ *     License, or (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public
+ *     License along with this library; if not, write to the Free
+ *     Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ *     MA 02110-1301 USA
+ *
+ * Alternatively,
+ *
+ *  b) Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *     1. Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *     2. Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *     CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *     INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *     MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *     DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *     CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *     NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *     LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *     HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *     CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ *     OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *     EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef EVENTARGS_H
+#define EVENTARGS_H
+
+#include "misc/traceshark.h"
+#include "misc/tstring.h"
+#include "parser/traceevent.h"
+#include "vtl/compiler.h"
+
+class TraceDat;
+class TraceFile;
+
+/*
+ * This gives access to the arguments of an event. If the arguments of the
+ * event are lazy, then they are read from the trace file and tokenized into
+ * this object, so the argv pointers are only valid as long as this object
+ * exists. Raw arguments are formatted from the binary record of the event and
+ * then tokenized in the same way. Otherwise, argv points to the interned
+ * arguments of the event.
+ */
+class EventArgs {
+public:
+	__always_inline EventArgs(const TraceEvent &event);
+	~EventArgs();
+	const TString * const *argv;
+	int argc;
+	static void setTraceFile(TraceFile *file);
+	static void setTraceDat(const TraceDat *dat);
+private:
+	void decode(const TraceEvent &event);
+	void tokenize(int len);
+	char *chars;
+	TString strings[EVENT_MAX_NR_ARGS];
+	const TString *ptrs[EVENT_MAX_NR_ARGS];
+	static TraceFile *traceFile;
+	static const TraceDat *traceDat;
+};
+
+__always_inline EventArgs::EventArgs(const TraceEvent &event):
+	chars(nullptr)
+{
+	if (likely(event.hasArgv())) {
+		argv = event.argv;
+		argc = event.argc;
+		return;
+	}
+	decode(event);
+}
+
+#endif /* EVENTARGS_H */
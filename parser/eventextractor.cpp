@@ -0,0 +1,338 @@
+// SPDX-License-Identifier: (GPL-2.0-or-later OR BSD-2-Clause)
+/*
+ * Traceshark - a visualizer for visualizing ftrace and perf traces
+ * Copyright (C) 2019  Viktor Rosendahl <viktor.rosendahl@gmail.com>
+ *
+ * This file is dual licensed: you can use it either under the terms of
+ * the GPL, or the BSD license, at your option.
+ *
+ *  a) This program is free software; you can redistribute it and/or
+ *     modify it under the terms of the GNU General Public License as
+ *     published by the Free Software Foundation; either version 2 of the
+ *     License, or (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public
+ *     License along with this library; if not, write to the Free
+ *     Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ *     MA 02110-1301 USA
+ *
+ * Alternatively,
+ *
+ *  b) Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *     1. Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *     2. Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *     CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *     INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *     MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *     DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *     CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *     NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *     LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *     HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *     CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ *     OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *     EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstring>
+
+#include "parser/eventextractor.h"
+#include "parser/eventformat.h"
+#include "parser/eventhash.h"
+
+extern "C" {
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+}
+
+static __always_inline bool is_length_modifier(char c)
+{
+	return c == 'h' || c == 'l' || c == 'L' || c == 'q' || c == 'j' ||
+		c == 'z' || c == 't';
+}
+
+/*
+ * This skips a conversion specification, c points to the character after the
+ * '%'. The conversion character is stored in conv.
+ */
+static const char *skip_conversion(const char *c, const char *end, char *conv)
+{
+	while (c < end && strchr("-+ #0", *c) != nullptr)
+		c++;
+	while (c < end && ((*c >= '0' && *c <= '9') || *c == '*' || *c == '.'))
+		c++;
+	while (c < end && is_length_modifier(*c))
+		c++;
+	if (c == end) {
+		*conv = '\0';
+		return c;
+	}
+	*conv = *c;
+	c++;
+	/* The kernel's pointer extensions, e.g. %pS or %pI4 */
+	if (*conv == 'p') {
+		while (c < end && ((*c >= 'a' && *c <= 'z') ||
+				   (*c >= 'A' && *c <= 'Z') ||
+				   (*c >= '0' && *c <= '9')))
+			c++;
+	}
+	return c;
+}
+
+/*
+ * This walks the format string of the print fmt and creates a field for every
+ * conversion that begins a word and is preceded by a key, such as "pid=". We
+ * don't care about the arguments after the format string, since they can be
+ * arbitrary C expressions, e.g. in the case of prev_state in sched_switch.
+ */
+bool EventExtractor::build(const EventFormat &format)
+{
+	const char *c = format.printFmt.constData();
+	const char *end = c + format.printFmt.size();
+	const char *word = nullptr;
+	const char *keyEnd;
+	bool converted = false;
+	int index = -1;
+	char conv;
+	Field field;
+
+	name = format.name;
+	fields.clear();
+	if (c == end || *c != '"')
+		return false;
+
+	for (c++; c < end && *c != '"'; ) {
+		if (*c == ' ') {
+			word = nullptr;
+			c++;
+			continue;
+		}
+		if (word == nullptr) {
+			word = c;
+			converted = false;
+			index++;
+		}
+		if (*c == '\\' && c + 1 < end) {
+			c += 2;
+			continue;
+		}
+		if (*c != '%') {
+			c++;
+			continue;
+		}
+		if (c + 1 < end && c[1] == '%') {
+			c += 2;
+			continue;
+		}
+		keyEnd = c;
+		c = skip_conversion(c + 1, end, &conv);
+		/* Only the first conversion of a word can have a key */
+		if (converted)
+			continue;
+		converted = true;
+		if (keyEnd - word < 2 ||
+		    (keyEnd[-1] != '=' && keyEnd[-1] != ':'))
+			continue;
+		field.key = QByteArray(word, keyEnd - word);
+		field.name = QByteArray(word, keyEnd - word - 1);
+		field.index = index;
+		field.base = conv == 'x' || conv == 'X' || conv == 'p' ?
+			16 : 10;
+		field.isString = conv == 's';
+		fields.append(field);
+	}
+	return !fields.isEmpty();
+}
+
+int EventExtractor::findField(const char *fname) const
+{
+	int i;
+
+	for (i = 0; i < fields.size(); i++) {
+		if (fields[i].name == fname)
+			return i;
+	}
+	return -1;
+}
+
+/*
+ * Hexadecimal values are printed both with and without 0x by the kernel, so we
+ * accept the prefix regardless of the base.
+ */
+bool EventExtractor::parseInt(const TString *str, int base, int64_t *value)
+{
+	const char *c = str->ptr;
+	const char *end = str->ptr + str->len;
+	const char *digits;
+	uint64_t v = 0;
+	bool neg = false;
+	int d;
+
+	if (c < end && *c == '-') {
+		neg = true;
+		c++;
+	}
+	if (end - c > 2 && c[0] == '0' && (c[1] == 'x' || c[1] == 'X')) {
+		base = 16;
+		c += 2;
+	}
+	for (digits = c; c < end; c++) {
+		if (*c >= '0' && *c <= '9')
+			d = *c - '0';
+		else if (base == 16 && *c >= 'a' && *c <= 'f')
+			d = *c - 'a' + 10;
+		else if (base == 16 && *c >= 'A' && *c <= 'F')
+			d = *c - 'A' + 10;
+		else
+			break;
+		v = v * base + d;
+	}
+	if (c == digits)
+		return false;
+	*value = neg ? -(int64_t) v : (int64_t) v;
+	return true;
+}
+
+EventExtractors::EventExtractors()
+{
+	int i;
+
+	for (i = 0; i < NR_EVENTS; i++)
+		known[i] = nullptr;
+}
+
+EventExtractors::~EventExtractors()
+{
+	clear();
+}
+
+void EventExtractors::clear()
+{
+	int i;
+
+	for (i = 0; i < list.size(); i++)
+		delete list[i];
+	list.clear();
+	byName.clear();
+	for (i = 0; i < NR_EVENTS; i++)
+		known[i] = nullptr;
+}
+
+/*
+ * This adds the extractor of the event that is described by a format
+ * descriptor. If the same event is described twice, the first one is used.
+ */
+bool EventExtractors::add(const char *text, int64_t len)
+{
+	EventFormat format;
+	EventExtractor *extractor;
+	TString ename;
+	event_t type;
+
+	if (!format.parse(text, len) || byName.contains(format.name))
+		return false;
+
+	extractor = new EventExtractor();
+	if (!extractor->build(format)) {
+		delete extractor;
+		return false;
+	}
+	list.append(extractor);
+	byName[extractor->name] = extractor;
+
+	ename.ptr = (char*) extractor->name.constData();
+	ename.len = extractor->name.size();
+	type = EventHash::lookup(&ename);
+	if (type >= 0 && type < NR_EVENTS)
+		known[type] = extractor;
+	return true;
+}
+
+const EventExtractor *EventExtractors::find(const TString *ename) const
+{
+	return byName.value(QByteArray(ename->ptr, ename->len), nullptr);
+}
+
+static bool read_file(const char *fileName, QByteArray *text)
+{
+	char buf[4096];
+	ssize_t r;
+	int fd;
+
+	fd = open(fileName, O_RDONLY);
+	if (fd < 0)
+		return false;
+	text->clear();
+	do {
+		r = read(fd, buf, sizeof(buf));
+		if (r > 0)
+			text->append(buf, r);
+	} while (r > 0 && text->size() < EVENTEXTRACTOR_MAX_FORMAT_SIZE);
+	::close(fd);
+	return r >= 0;
+}
+
+/* The formats of a system are in <system>/<event>/format */
+int EventExtractors::loadSystem(const char *dirName)
+{
+	QByteArray path;
+	QByteArray text;
+	struct dirent *entry;
+	DIR *dir;
+	int nr = 0;
+
+	dir = opendir(dirName);
+	if (dir == nullptr)
+		return 0;
+	while ((entry = readdir(dir)) != nullptr) {
+		if (entry->d_name[0] == '.')
+			continue;
+		path = QByteArray(dirName) + "/" + entry->d_name + "/format";
+		if (read_file(path.constData(), &text) &&
+		    add(text.constData(), text.size()))
+			nr++;
+	}
+	closedir(dir);
+	return nr;
+}
+
+/*
+ * This loads all the format descriptors from a directory with the same layout
+ * as the events directory of tracefs. Returns the number of events loaded.
+ */
+int EventExtractors::loadDir(const char *dirName)
+{
+	QByteArray path;
+	struct dirent *entry;
+	DIR *dir;
+	int nr = 0;
+
+	dir = opendir(dirName);
+	if (dir == nullptr)
+		return 0;
+	while ((entry = readdir(dir)) != nullptr) {
+		if (entry->d_name[0] == '.')
+			continue;
+		path = QByteArray(dirName) + "/" + entry->d_name;
+		nr += loadSystem(path.constData());
+	}
+	closedir(dir);
+	return nr;
+}
@@ -0,0 +1,198 @@
+// SPDX-License-Identifier: (GPL-2.0-or-later OR BSD-2-Clause)
+/*
+ * Traceshark - a visualizer for visualizing ftrace and perf traces
+ * Copyright (C) 2019  Viktor Rosendahl <viktor.rosendahl@gmail.com>
+ *
+ * This file is dual licensed: you can use it either under the terms of
+ * the GPL, or the BSD license, at your option.
+ *
+ *  a) This program is free software; you can redistribute it and/or
+ *     modify it under the terms of the GNU General Public License as
+ *     published by the Free Software Foundation; either version 2 of the
+ *     License, or (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public
+ *     License along with this library; if not, write to the Free
+ *     Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ *     MA 02110-1301 USA
+ *
+ * Alternatively,
+ *
+ *  b) Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *     1. Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *     2. Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *     CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *     INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *     MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *     DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *     CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *     NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *     LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *     HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *     CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ *     OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *     EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef EVENTEXTRACTOR_H
+#define EVENTEXTRACTOR_H
+
+#include <cstdint>
+#include <cstring>
+
+#include <QByteArray>
+#include <QMap>
+#include <QVector>
+
+#include "parser/traceevent.h"
+#include "misc/tstring.h"
+#include "vtl/compiler.h"
+
+class EventFormat;
+
+/*
+ * The name of the directory, next to the trace file, from which the event
+ * format descriptors are read. It is supposed to be a copy of the events
+ * directory of tracefs, i.e. of /sys/kernel/tracing/events.
+ */
+#define EVENTEXTRACTOR_DIR "events"
+#define EVENTEXTRACTOR_MAX_FORMAT_SIZE (256 * 1024)
+
+/*
+ * This extracts the fields of an event from the arguments as they are printed
+ * by the kernel. The extractor is built once per event, from the print fmt of
+ * the event's format descriptor. For example, from
+ *
+ *	print fmt: "comm=%s pid=%d prio=%d target_cpu=%03d", REC->comm, ...
+ *
+ * it learns that the pid field is the argument that begins with "pid=" and
+ * that it is normally the second argument. The expected position is tried
+ * first, the other arguments are only searched if a string field before the
+ * wanted one contained spaces, or if the trace doesn't match the format.
+ */
+class EventExtractor {
+public:
+	class Field {
+	public:
+		/* The text that precedes the value, e.g. "pid=" */
+		QByteArray key;
+		/* The name of the field, i.e. the key without '=' or ':' */
+		QByteArray name;
+		/* The expected index of the argument */
+		int index;
+		/* The base of the value, 10 or 16 */
+		int base;
+		bool isString;
+	};
+	bool build(const EventFormat &format);
+	int findField(const char *fname) const;
+	__always_inline bool getArg(const TString * const *argv, int argc,
+				    int field, TString *value) const;
+	__always_inline bool getInt(const TString * const *argv, int argc,
+				    int field, int64_t *value) const;
+	QByteArray name;
+	QVector<Field> fields;
+private:
+	static __always_inline bool argMatches(const TString *arg,
+					       const Field &field);
+	static bool parseInt(const TString *str, int base, int64_t *value);
+};
+
+/*
+ * The extractors of all the events whose format descriptors have been loaded.
+ * The extractors of the events that are known to the analyzer can be looked
+ * up by event_t, the others by name, since their event_t depends on the
+ * grammar.
+ */
+class EventExtractors {
+public:
+	EventExtractors();
+	~EventExtractors();
+	int loadDir(const char *dirName);
+	bool add(const char *text, int64_t len);
+	void clear();
+	__always_inline int size() const;
+	__always_inline const EventExtractor *getKnown(event_t type) const;
+	const EventExtractor *find(const TString *ename) const;
+private:
+	int loadSystem(const char *dirName);
+	QVector<EventExtractor*> list;
+	QMap<QByteArray, EventExtractor*> byName;
+	const EventExtractor *known[NR_EVENTS];
+};
+
+__always_inline bool EventExtractor::argMatches(const TString *arg,
+						const Field &field)
+{
+	return arg->len >= field.key.size() &&
+		memcmp(arg->ptr, field.key.constData(), field.key.size()) == 0;
+}
+
+/*
+ * This sets value to point to the value of the field inside the argument, it
+ * is not null terminated. A string value that contains spaces will only be
+ * given up to the first space.
+ */
+__always_inline bool EventExtractor::getArg(const TString * const *argv,
+					    int argc, int field,
+					    TString *value) const
+{
+	const Field &f = fields[field];
+	const TString *arg;
+	int i = f.index;
+
+	if (likely(i < argc && argMatches(argv[i], f))) {
+		arg = argv[i];
+	} else {
+		for (i = 0; i < argc; i++) {
+			if (argMatches(argv[i], f))
+				break;
+		}
+		if (i == argc)
+			return false;
+		arg = argv[i];
+	}
+	value->ptr = arg->ptr + f.key.size();
+	value->len = arg->len - f.key.size();
+	return true;
+}
+
+__always_inline bool EventExtractor::getInt(const TString * const *argv,
+					    int argc, int field,
+					    int64_t *value) const
+{
+	TString str;
+
+	if (!getArg(argv, argc, field, &str))
+		return false;
+	return parseInt(&str, fields[field].base, value);
+}
+
+__always_inline int EventExtractors::size() const
+{
+	return list.size();
+}
+
+__always_inline const EventExtractor *EventExtractors::getKnown(event_t type)
+	const
+{
+	return type >= 0 && type < NR_EVENTS ? known[type] : nullptr;
+}
+
+#endif /* EVENTEXTRACTOR_H */
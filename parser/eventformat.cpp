@@ -0,0 +1,240 @@
+// SPDX-License-Identifier: (GPL-2.0-or-later OR BSD-2-Clause)
+/*
+ * Traceshark - a visualizer for visualizing ftrace and perf traces
+ * Copyright (C) 2019  Viktor Rosendahl <viktor.rosendahl@gmail.com>
+ *
+ * This file is dual licensed: you can use it either under the terms of
+ * the GPL, or the BSD license, at your option.
+ *
+ *  a) This program is free software; you can redistribute it and/or
+ *     modify it under the terms of the GNU General Public License as
+ *     published by the Free Software Foundation; either version 2 of the
+ *     License, or (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public
+ *     License along with this library; if not, write to the Free
+ *     Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ *     MA 02110-1301 USA
+ *
+ * Alternatively,
+ *
+ *  b) Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *     1. Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *     2. Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *     CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *     INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *     MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *     DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *     CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *     NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *     LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *     HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *     CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ *     OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *     EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstdlib>
+#include <cstring>
+
+#include "parser/eventformat.h"
+
+EventField::EventField():
+	offset(0), size(0), isSigned(false), isArray(false), isDataLoc(false),
+	isString(false)
+{}
+
+EventFormat::EventFormat():
+	id(-1), nrCommonFields(0)
+{}
+
+static __always_inline const char *skip_spaces(const char *c, const char *end)
+{
+	while (c < end && (*c == ' ' || *c == '\t'))
+		c++;
+	return c;
+}
+
+static __always_inline const char *find_eol(const char *c, const char *end)
+{
+	const char *nl = (const char *) memchr(c, '\n', end - c);
+	return nl != nullptr ? nl : end;
+}
+
+static __always_inline bool has_prefix(const char *c, const char *end,
+				       const char *prefix, const char **rest)
+{
+	size_t len = strlen(prefix);
+
+	if ((size_t) (end - c) < len || memcmp(c, prefix, len) != 0)
+		return false;
+	*rest = c + len;
+	return true;
+}
+
+/*
+ * Parses the number that follows the given key, e.g. "offset:", within the
+ * line.
+ */
+static bool number_after(const char *line, const char *end, const char *key,
+			 unsigned int *value)
+{
+	size_t len = strlen(key);
+	const char *c;
+	unsigned int v = 0;
+	bool found = false;
+
+	for (c = line; c + len <= end; c++) {
+		if (memcmp(c, key, len) == 0)
+			break;
+	}
+	if (c + len > end)
+		return false;
+	for (c += len; c < end && *c >= '0' && *c <= '9'; c++) {
+		v = v * 10 + (*c - '0');
+		found = true;
+	}
+	*value = v;
+	return found;
+}
+
+bool EventFormat::parseField(const char *line, const char *end,
+			     EventField &field)
+{
+	const char *decl;
+	const char *declEnd;
+	const char *nameEnd;
+	const char *nameBegin;
+	const char *c;
+	unsigned int isSigned = 0;
+
+	if (!has_prefix(line, end, "field:", &decl))
+		return false;
+	decl = skip_spaces(decl, end);
+	declEnd = (const char *) memchr(decl, ';', end - decl);
+	if (declEnd == nullptr)
+		return false;
+
+	/*
+	 * The name is the last word of the declaration, before any trailing
+	 * [], note that __data_loc char[] name has the [] before the name.
+	 */
+	nameEnd = declEnd;
+	while (nameEnd > decl && nameEnd[-1] == ' ')
+		nameEnd--;
+	if (nameEnd > decl && nameEnd[-1] == ']') {
+		for (c = nameEnd - 1; c > decl && *c != '['; c--)
+			;
+		if (*c != '[')
+			return false;
+		field.isArray = true;
+		nameEnd = c;
+	}
+	while (nameEnd > decl && nameEnd[-1] == ' ')
+		nameEnd--;
+	nameBegin = nameEnd;
+	while (nameBegin > decl && nameBegin[-1] != ' ' &&
+	       nameBegin[-1] != '*')
+		nameBegin--;
+	if (nameBegin == nameEnd)
+		return false;
+	field.name = QByteArray(nameBegin, nameEnd - nameBegin);
+
+	field.isDataLoc = has_prefix(decl, declEnd, "__data_loc", &c);
+	/*
+	 * The kernel declares strings as char arrays, or as
+	 * __data_loc char[] for dynamic strings.
+	 */
+	c = field.isDataLoc ? skip_spaces(c, declEnd) : decl;
+	if (has_prefix(c, declEnd, "char", &c) ||
+	    has_prefix(c, declEnd, "const char", &c))
+		field.isString = field.isArray || field.isDataLoc;
+
+	if (!number_after(declEnd, end, "offset:", &field.offset) ||
+	    !number_after(declEnd, end, "size:", &field.size))
+		return false;
+	if (number_after(declEnd, end, "signed:", &isSigned))
+		field.isSigned = isSigned != 0;
+	return true;
+}
+
+bool EventFormat::parseFields(const char *text, int64_t len,
+			      QVector<EventField> &fields)
+{
+	const char *c = text;
+	const char *end = text + len;
+	const char *eol;
+
+	while (c < end) {
+		eol = find_eol(c, end);
+		c = skip_spaces(c, eol);
+		EventField field;
+		if (parseField(c, eol, field))
+			fields.append(field);
+		c = eol + 1;
+	}
+	return !fields.isEmpty();
+}
+
+bool EventFormat::parse(const char *text, int64_t len)
+{
+	const char *c = text;
+	const char *end = text + len;
+	const char *eol;
+	const char *rest;
+	int i;
+
+	while (c < end) {
+		eol = find_eol(c, end);
+		c = skip_spaces(c, eol);
+		if (has_prefix(c, eol, "name:", &rest)) {
+			rest = skip_spaces(rest, eol);
+			name = QByteArray(rest, eol - rest);
+		} else if (has_prefix(c, eol, "ID:", &rest)) {
+			id = atoi(QByteArray(rest, eol - rest).constData());
+		} else if (has_prefix(c, eol, "print fmt:", &rest)) {
+			rest = skip_spaces(rest, eol);
+			printFmt = QByteArray(rest, eol - rest);
+		} else {
+			EventField field;
+			if (parseField(c, eol, field))
+				fields.append(field);
+		}
+		c = eol + 1;
+	}
+
+	nrCommonFields = 0;
+	for (i = 0; i < fields.size(); i++) {
+		if (!fields[i].name.startsWith("common_"))
+			break;
+		nrCommonFields++;
+	}
+	return !name.isEmpty() && id >= 0;
+}
+
+const EventField *EventFormat::findField(const char *fname) const
+{
+	int i;
+
+	for (i = 0; i < fields.size(); i++) {
+		if (fields[i].name == fname)
+			return &fields[i];
+	}
+	return nullptr;
+}
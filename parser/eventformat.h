@@ -0,0 +1,195 @@
+// SPDX-License-Identifier: (GPL-2.0-or-later OR BSD-2-Clause)
+/*
+ * Traceshark - a visualizer for visualizing ftrace and perf traces
+ * Copyright (C) 2019  Viktor Rosendahl <viktor.rosendahl@gmail.com>
+ *
+ * This file is dual licensed: you can use it either under the terms of
+ * the GPL, or the BSD license, at your option.
+ *
+ *  a) This program is free software; you can redistribute it and/or
+ *     modify it under the terms of the GNU General Public License as
+ *     published by the Free Software Foundation; either version 2 of the
+ *     License, or (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public
+ *     License along with this library; if not, write to the Free
+ *     Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ *     MA 02110-1301 USA
+ *
+ * Alternatively,
+ *
+ *  b) Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *     1. Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *     2. Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *     CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *     INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *     MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *     DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *     CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *     NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *     LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *     HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *     CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ *     OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *     EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef EVENTFORMAT_H
+#define EVENTFORMAT_H
+
+#include <cstdint>
+#include <cstring>
+
+#include <QByteArray>
+#include <QVector>
+
+#include "misc/tstring.h"
+#include "vtl/compiler.h"
+
+/*
+ * This describes one field of an event, as given by a line like this one in
+ * the kernel's event format descriptors:
+ *
+ *	field:char prev_comm[16];	offset:8;	size:16;	signed:1;
+ */
+class EventField {
+public:
+	EventField();
+	QByteArray name;
+	unsigned int offset;
+	unsigned int size;
+	bool isSigned;
+	bool isArray;
+	/* A __data_loc field is a 32-bit (len << 16 | offset) reference */
+	bool isDataLoc;
+	/* True for char arrays and __data_loc char[] */
+	bool isString;
+	__always_inline uint64_t getUnsigned(const char *data, bool swap)
+		const;
+	__always_inline int64_t getSigned(const char *data, bool swap) const;
+	__always_inline bool getString(const char *data, unsigned int dataLen,
+				       bool swap, TString *str) const;
+	static __always_inline uint64_t readUnsigned(const char *ptr,
+						     unsigned int size,
+						     bool swap);
+};
+
+/*
+ * The format of an event, e.g. from /sys/kernel/tracing/events/sched/
+ * sched_switch/format or the copies of these that are embedded in trace-cmd
+ * and perf files.
+ */
+class EventFormat {
+public:
+	EventFormat();
+	bool parse(const char *text, int64_t len);
+	static bool parseFields(const char *text, int64_t len,
+				QVector<EventField> &fields);
+	const EventField *findField(const char *fname) const;
+	QByteArray system;
+	QByteArray name;
+	int id;
+	QVector<EventField> fields;
+	QByteArray printFmt;
+	/* The common_* fields are first in fields, this many of them */
+	int nrCommonFields;
+private:
+	static bool parseField(const char *line, const char *end,
+			       EventField &field);
+};
+
+__always_inline uint64_t EventField::readUnsigned(const char *ptr,
+						  unsigned int size, bool swap)
+{
+	uint8_t v8;
+	uint16_t v16;
+	uint32_t v32;
+	uint64_t v64;
+
+	switch (size) {
+	case 1:
+		memcpy(&v8, ptr, sizeof(v8));
+		return v8;
+	case 2:
+		memcpy(&v16, ptr, sizeof(v16));
+		return swap ? __builtin_bswap16(v16) : v16;
+	case 4:
+		memcpy(&v32, ptr, sizeof(v32));
+		return swap ? __builtin_bswap32(v32) : v32;
+	case 8:
+		memcpy(&v64, ptr, sizeof(v64));
+		return swap ? __builtin_bswap64(v64) : v64;
+	default:
+		return 0;
+	}
+}
+
+__always_inline uint64_t EventField::getUnsigned(const char *data, bool swap)
+	const
+{
+	return readUnsigned(data + offset, size, swap);
+}
+
+__always_inline int64_t EventField::getSigned(const char *data, bool swap)
+	const
+{
+	uint64_t v = readUnsigned(data + offset, size, swap);
+
+	switch (size) {
+	case 1:
+		return (int8_t) v;
+	case 2:
+		return (int16_t) v;
+	case 4:
+		return (int32_t) v;
+	default:
+		return (int64_t) v;
+	}
+}
+
+/*
+ * This sets str to point to the string inside data. The string is not copied
+ * and it will not be null terminated.
+ */
+__always_inline bool EventField::getString(const char *data,
+					   unsigned int dataLen, bool swap,
+					   TString *str) const
+{
+	uint32_t loc;
+	unsigned int soff;
+	unsigned int slen;
+
+	if (isDataLoc) {
+		if (offset + 4 > dataLen)
+			return false;
+		loc = readUnsigned(data + offset, 4, swap);
+		soff = loc & 0xffff;
+		slen = loc >> 16;
+	} else {
+		soff = offset;
+		slen = size;
+	}
+	if (soff + slen > dataLen)
+		return false;
+	str->ptr = (char*) data + soff;
+	str->len = strnlen(str->ptr, slen);
+	return true;
+}
+
+#endif /* EVENTFORMAT_H */
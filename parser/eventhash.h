@@ -0,0 +1,174 @@
+// SPDX-License-Identifier: (GPL-2.0-or-later OR BSD-2-Clause)
+/*
+ * Traceshark - a visualizer for visualizing ftrace and perf traces
+ * Copyright (C) 2019  Viktor Rosendahl <viktor.rosendahl@gmail.com>
+ *
+ * This file is dual licensed: you can use it either under the terms of
+ * the GPL, or the BSD license, at your option.
+ *
+ *  a) This program is free software; you can redistribute it and/or
+ *     modify it under the terms of the GNU General Public License as
+ *     published by the Free Software Foundation; either version 2 of the
+ *     License, or (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public
+ *     License along with this library; if not, write to the Free
+ *     Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ *     MA 02110-1301 USA
+ *
+ * Alternatively,
+ *
+ *  b) Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *     1. Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *     2. Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *     CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *     INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *     MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *     DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *     CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *     NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *     LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *     HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *     CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ *     OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *     EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef EVENTHASH_H
+#define EVENTHASH_H
+
+#include <cstdint>
+#include <cstring>
+
+#include "misc/traceshark.h"
+#include "misc/tstring.h"
+#include "parser/traceevent.h"
+
+/*
+ * This is a perfect hash for the names in eventstrings[], which is generated
+ * at compile time. It is used in front of the StringTree, so that the events
+ * that we know about can be identified with a single probe and a memcmp().
+ * Only unknown events need to go to the StringTree.
+ */
+
+#define EVENTHASH_BITS (5)
+#define EVENTHASH_SIZE (1 << EVENTHASH_BITS)
+#define EVENTHASH_MAX_SEED (4096)
+
+class EventHashSlot {
+public:
+	int8_t event;
+	uint8_t len;
+};
+
+static constexpr uint32_t eventhash_mix(uint32_t h, uint32_t c)
+{
+	return (h ^ c) * 0x9e3779b1U;
+}
+
+/*
+ * Only the length and four characters are used. This is enough to tell the
+ * known names apart and it keeps the lookup cheap for unknown names, since
+ * it does not need to read the whole string.
+ */
+static constexpr uint32_t eventhash_hash(const char *s, int len,
+					 uint32_t seed)
+{
+	return len < 2 ? eventhash_mix(seed, len) :
+		eventhash_mix(eventhash_mix(eventhash_mix(eventhash_mix(
+			eventhash_mix(seed, len), (uint8_t) s[0]),
+			(uint8_t) s[len / 2]), (uint8_t) s[len - 2]),
+			      (uint8_t) s[len - 1]);
+}
+
+static constexpr unsigned int eventhash_slot(const char *s, int len,
+					     uint32_t seed)
+{
+	return eventhash_hash(s, len, seed) >> (32 - EVENTHASH_BITS);
+}
+
+static constexpr int eventhash_strlen(const char *s)
+{
+	return *s == '\0' ? 0 : 1 + eventhash_strlen(s + 1);
+}
+
+static constexpr unsigned int eventhash_event_slot(int event, uint32_t seed)
+{
+	return eventhash_slot(eventstrings[event],
+			      eventhash_strlen(eventstrings[event]), seed);
+}
+
+/* Check that no pair (i, j), with j > i, share the same slot */
+static constexpr bool eventhash_unique(uint32_t seed, int i, int j)
+{
+	return i >= NR_EVENTS - 1 ? true :
+		j >= NR_EVENTS ? eventhash_unique(seed, i + 1, i + 2) :
+		eventhash_event_slot(i, seed) != eventhash_event_slot(j, seed)
+		&& eventhash_unique(seed, i, j + 1);
+}
+
+static constexpr uint32_t eventhash_find_seed(uint32_t seed)
+{
+	return seed >= EVENTHASH_MAX_SEED || eventhash_unique(seed, 0, 1) ?
+		seed : eventhash_find_seed(seed + 1);
+}
+
+class EventHash {
+public:
+	static __always_inline event_t lookup(const TString *name);
+	static constexpr uint32_t SEED = eventhash_find_seed(0);
+	static constexpr int slotEvent(unsigned int s, int event);
+	static constexpr EventHashSlot makeSlot(unsigned int s);
+private:
+	static const EventHashSlot table[EVENTHASH_SIZE];
+};
+
+static_assert(EventHash::SEED < EVENTHASH_MAX_SEED,
+	      "No perfect hash found, please increase EVENTHASH_BITS");
+
+constexpr int EventHash::slotEvent(unsigned int s, int event)
+{
+	return event >= NR_EVENTS ? EVENT_ERROR :
+		eventhash_event_slot(event, SEED) == s ? event :
+		slotEvent(s, event + 1);
+}
+
+constexpr EventHashSlot EventHash::makeSlot(unsigned int s)
+{
+	return slotEvent(s, 0) == EVENT_ERROR ?
+		EventHashSlot { EVENT_ERROR, 0 } :
+		EventHashSlot {
+			(int8_t) slotEvent(s, 0),
+			(uint8_t) eventhash_strlen(eventstrings[slotEvent(s, 0)])
+		};
+}
+
+__always_inline event_t EventHash::lookup(const TString *name)
+{
+	const EventHashSlot &s = table[eventhash_slot(name->ptr, name->len,
+						      SEED)];
+
+	if (s.len != name->len || s.event == EVENT_ERROR)
+		return EVENT_ERROR;
+	if (memcmp(name->ptr, eventstrings[s.event], s.len) != 0)
+		return EVENT_ERROR;
+	return (event_t) s.event;
+}
+
+#endif /* EVENTHASH_H */
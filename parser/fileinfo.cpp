@@ -98,3 +98,24 @@ int64_t FileInfo::getFileSize()
 {
 	return st.st_size;
 }
+
+void FileInfo::getStamp(FileStamp *stamp) const
+{
+	stamp->size = st.st_size;
+	stamp->mtimeSec = st.st_mtim.tv_sec;
+	stamp->mtimeNsec = st.st_mtim.tv_nsec;
+	stamp->ctimeSec = st.st_ctim.tv_sec;
+	stamp->ctimeNsec = st.st_ctim.tv_nsec;
+}
+
+bool FileInfo::cmpStamp(const FileStamp *stamp) const
+{
+	FileStamp s;
+
+	getStamp(&s);
+	return  s.ctimeSec == stamp->ctimeSec &&
+		s.ctimeNsec == stamp->ctimeNsec &&
+		s.mtimeSec == stamp->mtimeSec &&
+		s.mtimeNsec == stamp->mtimeNsec &&
+		s.size == stamp->size;
+}
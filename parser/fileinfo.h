@@ -61,11 +61,26 @@ extern "C" {
 #include <unistd.h>
 }
 
+/*
+ * The parts of struct stat that cmpStat() compares, in a form that can be
+ * stored in a file.
+ */
+class FileStamp {
+public:
+	int64_t size;
+	int64_t mtimeSec;
+	int64_t mtimeNsec;
+	int64_t ctimeSec;
+	int64_t ctimeNsec;
+};
+
 class FileInfo {
 public:
 	void saveStat(int fd, int *ts_errno);
 	bool cmpStat(int fd, int *ts_errno);
 	int64_t getFileSize();
+	void getStamp(FileStamp *stamp) const;
+	bool cmpStamp(const FileStamp *stamp) const;
 private:
 	struct stat st;
 };
@@ -58,7 +58,8 @@ extern "C" {
 #include "parser/traceevent.h"
 
 FtraceGrammar::FtraceGrammar() :
-	unknownTypeCounter(EVENT_UNKNOWN), tmp_argc(0)
+	sharedGrammar(nullptr), unknownTypeCounter(EVENT_UNKNOWN),
+	tmp_argc(0)
 {
 	argPool = new StringPool(2048, 1024 * 1024);
 	namePool =  new StringPool(1024, 65536);
@@ -67,6 +68,21 @@ FtraceGrammar::FtraceGrammar() :
 	setupEventTree();
 }
 
+/*
+ * The pools of a reader grammar only hold the strings of the events that one
+ * reader parses, so they start smaller than those of the parser's grammar.
+ */
+FtraceGrammar::FtraceGrammar(FtraceGrammar *shared) :
+	sharedGrammar(shared), unknownTypeCounter(EVENT_UNKNOWN),
+	tmp_argc(0)
+{
+	argPool = new StringPool(2048, 65536);
+	namePool =  new StringPool(1024, 4096);
+	eventTree = new StringTree(8, 256, 4096);
+	bzero(tmp_argv, sizeof(tmp_argv));
+	setupEventTree();
+}
+
 FtraceGrammar::~FtraceGrammar()
 {
 	delete argPool;
@@ -89,9 +105,23 @@ void FtraceGrammar::setupEventTree()
 	TString str;
 
 	for (t = 0; t < NR_EVENTS; t++) {
-		str.ptr = eventstrings[t];
+		str.ptr = (char *) eventstrings[t];
 		str.len = strlen(eventstrings[t]);
 		eventTree->searchAllocString(&str, TShark::StrHash32(&str),
 					     (event_t) t);
 	}
 }
+
+event_t FtraceGrammar::internSharedEventType(const TString *name,
+					     uint32_t hval)
+{
+	event_t type;
+
+	typeMutex.lock();
+	type = eventTree->searchAllocString(name, hval,
+					    (event_t) unknownTypeCounter);
+	if (type == unknownTypeCounter)
+		unknownTypeCounter++;
+	typeMutex.unlock();
+	return type;
+}
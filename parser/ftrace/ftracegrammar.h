@@ -53,9 +53,12 @@
 #ifndef FTRACEGRAMMAR_H
 #define FTRACEGRAMMAR_H
 
+#include <QMutex>
+
 #include "misc/traceshark.h"
 #include "mm/stringpool.h"
 #include "mm/stringtree.h"
+#include "parser/eventhash.h"
 #include "parser/paramhelpers.h"
 #include "parser/traceevent.h"
 #include "vtl/time.h"
@@ -72,13 +75,22 @@ class FtraceGrammar
 {
 public:
 	FtraceGrammar();
+	FtraceGrammar(FtraceGrammar *shared);
 	~FtraceGrammar();
 	void clear();
 	__always_inline bool parseLine(const TraceLine &line,
 				       TraceEvent &event);
+	/*
+	 * These are used by the parser itself but also by the readers that
+	 * produce events directly from binary trace formats.
+	 */
+	__always_inline event_t internEventType(const TString *name);
+	__always_inline const TString *internTaskName(const TString *name);
+	__always_inline const TString *internArg(const TString *arg);
 	StringTree *eventTree;
 private:
 	void setupEventTree();
+	event_t internSharedEventType(const TString *name, uint32_t hval);
 	__always_inline bool NamePidMatch(const TString *str,
 					  TraceEvent &event);
 	__always_inline bool CPUMatch(const TString *str,
@@ -87,8 +99,19 @@ private:
 	__always_inline bool TimeMatch(const TString *str, TraceEvent &event);
 	__always_inline bool EventMatch(const TString *str, TraceEvent &event);
 	__always_inline bool ArgMatch(const TString *str, TraceEvent &event);
+	__always_inline bool LazyArgsMatch(const TraceLine &line,
+					   const TString *str, int n,
+					   TraceEvent &event);
 	StringPool *argPool;
 	StringPool *namePool;
+	/*
+	 * The grammar of a reader thread gets the types of the unknown events
+	 * from the grammar of the parser, so that an event name gets the same
+	 * type regardless of which reader that sees it first. Its own eventTree
+	 * is only a cache of the types that it has already looked up.
+	 */
+	FtraceGrammar *sharedGrammar;
+	QMutex typeMutex;
 	int unknownTypeCounter;
 	typedef enum {
 		STATE_NAMEPID = 0,
@@ -101,6 +124,48 @@ private:
 	const TString *tmp_argv[EVENT_MAX_NR_ARGS];
 };
 
+__always_inline event_t FtraceGrammar::internEventType(const TString *name)
+{
+	event_t type;
+	uint32_t hval;
+
+	type = EventHash::lookup(name);
+	if (type != EVENT_ERROR)
+		return type;
+
+	hval = TShark::StrHash32(name);
+	if (sharedGrammar != nullptr) {
+		type = eventTree->searchString(name, hval);
+		if (type != EVENT_ERROR)
+			return type;
+		type = sharedGrammar->internSharedEventType(name, hval);
+		return eventTree->searchAllocString(name, hval, type);
+	}
+
+	type = eventTree->searchAllocString(name, hval,
+					    (event_t) unknownTypeCounter);
+	if (type == unknownTypeCounter) {
+		/*
+		 * This event is a new event, so for the next one we need to
+		 * bump the counter in order to use a unique eventType value
+		 * for every event name
+		 */
+		unknownTypeCounter++;
+	}
+	return type;
+}
+
+__always_inline const TString *
+FtraceGrammar::internTaskName(const TString *name)
+{
+	return namePool->allocString(name, TShark::StrHash32(name), 0);
+}
+
+__always_inline const TString *FtraceGrammar::internArg(const TString *arg)
+{
+	return argPool->allocString(arg, TShark::StrHash32(arg), 16);
+}
+
 __always_inline bool FtraceGrammar::NamePidMatch(const TString *str,
 						 TraceEvent &/*event*/)
 {
@@ -123,6 +188,7 @@ __always_inline bool FtraceGrammar::CPUMatch(const TString *str,
 					     TraceEvent &event)
 {
 	char *c;
+	char *end = str->ptr + str->len;
 	unsigned int cpu = 0;
 	int digit;
 
@@ -130,7 +196,7 @@ __always_inline bool FtraceGrammar::CPUMatch(const TString *str,
 		return false;
 
 	cpu = 0;
-	for (c = str->ptr + 1; *c != '\0' && *c != ']'; c++) {
+	for (c = str->ptr + 1; c < end && *c != ']'; c++) {
 		digit = *c - '0';
 		if (digit > 9 || digit < 0)
 			goto error;
@@ -198,7 +264,6 @@ __always_inline bool FtraceGrammar::TimeMatch(const TString *str,
 	const int maxlen = sizeof(nbuf) / sizeof(char) - 1;
 	int i;
 	int fini;
-	uint32_t hash;
 
 	namestr.ptr = nbuf;
 	namestr.len = 0;
@@ -209,7 +274,7 @@ __always_inline bool FtraceGrammar::TimeMatch(const TString *str,
 	 * atof() and sscanf() are not up to the task because they are
 	 * too slow and get confused by locality issues.
 	 */
-	event.time = vtl::Time::fromString(str->ptr, rval);;
+	event.setTime(vtl::Time::fromString(str->ptr, rval));
 
 	/*
 	 * This is the time field, if it is successful we need to assemble
@@ -242,12 +307,10 @@ __always_inline bool FtraceGrammar::TimeMatch(const TString *str,
 			}
 			if (!namestr.merge(&finistr, maxlen))
 				return false;
-			hash = TShark::StrHash32(&namestr);
-			newname = namePool->allocString(&namestr, hash, 0);
+			newname = internTaskName(&namestr);
 		} else {
 			/* This is the common case, no spaces in the name. */
-			hash = TShark::StrHash32(&finistr);
-			newname = namePool->allocString(&finistr, hash, 0);
+			newname = internTaskName(&finistr);
 		}
 
 		if (newname == nullptr)
@@ -278,18 +341,9 @@ __always_inline bool FtraceGrammar::EventMatch(const TString *str,
 	} else
 		return false;
 
-	type = eventTree->searchAllocString(&estr, TShark::StrHash32(&estr),
-					    (event_t) unknownTypeCounter);
+	type = internEventType(&estr);
 	if (type == EVENT_ERROR)
 		return false;
-	else if (type == unknownTypeCounter) {
-		/*
-		 * This event is a new event, so for the next one we need to
-		 * bump the counter in order to use a unique eventType value 
-		 * for every event name
-		 */
-		unknownTypeCounter++;
-	}
 	event.type = type;
 	return true;
 }
@@ -299,7 +353,7 @@ __always_inline bool FtraceGrammar::ArgMatch(const TString *str,
 {
 	const TString *newstr;
 	if (event.argc < EVENT_MAX_NR_ARGS) {
-		newstr = argPool->allocString(str, TShark::StrHash32(str), 16);
+		newstr = internArg(str);
 		if (newstr == nullptr)
 			return false;
 		event.argv[event.argc] = newstr;
@@ -309,6 +363,21 @@ __always_inline bool FtraceGrammar::ArgMatch(const TString *str,
 	return false;
 }
 
+/*
+ * The arguments of unknown events are only needed if the user wants to look
+ * at them, so we only store where they are in the file and leave the
+ * tokenization and interning to EventArgs.
+ */
+__always_inline bool FtraceGrammar::LazyArgsMatch(const TraceLine &line,
+						  const TString *str, int n,
+						  TraceEvent &event)
+{
+	const TString *last = str + n - 1;
+
+	event.setLazyArgs(line.begin + (str->ptr - line.ptr),
+			  last->ptr + last->len - str->ptr);
+	return true;
+}
 
 __always_inline bool FtraceGrammar::parseLine(const TraceLine &line,
 					      TraceEvent &event)
@@ -348,6 +417,8 @@ __always_inline bool FtraceGrammar::parseLine(const TraceLine &line,
 			NEXTTOKEN(true);
 			ts_fallthrough;
 		case STATE_ARG:
+			if (event.type >= EVENT_UNKNOWN)
+				return LazyArgsMatch(line, str, n, event);
 			while (ArgMatch(str, event))
 				NEXTTOKEN(true);
 			return false;
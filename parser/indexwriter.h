@@ -0,0 +1,102 @@
+// SPDX-License-Identifier: (GPL-2.0-or-later OR BSD-2-Clause)
+/*
+ * Traceshark - a visualizer for visualizing ftrace and perf traces
+ * Copyright (C) 2019  Viktor Rosendahl <viktor.rosendahl@gmail.com>
+ *
+ * This file is dual licensed: you can use it either under the terms of
+ * the GPL, or the BSD license, at your option.
+ *
+ *  a) This program is free software; you can redistribute it and/or
+ *     modify it under the terms of the GNU General Public License as
+ *     published by the Free Software Foundation; either version 2 of the
+ *     License, or (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public
+ *     License along with this library; if not, write to the Free
+ *     Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ *     MA 02110-1301 USA
+ *
+ * Alternatively,
+ *
+ *  b) Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *     1. Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *     2. Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *     CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *     INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *     MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *     DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *     CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *     NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *     LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *     HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *     CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ *     OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *     EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef INDEXWRITER_H
+#define INDEXWRITER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "misc/traceshark.h"
+#include "vtl/compiler.h"
+
+#define INDEXWRITER_ALIGN (8)
+#define INDEXWRITER_BUFFER_SIZE (1024 * 1024)
+
+/*
+ * A simple buffered writer for the sidecar files. The header is written last,
+ * with pwrite(), when the positions of all sections are known.
+ */
+class IndexWriter {
+public:
+	IndexWriter(int f);
+	~IndexWriter();
+	__always_inline bool put(const void *data, size_t len);
+	bool align();
+	bool flush();
+	uint64_t pos;
+private:
+	int fd;
+	char *buf;
+	size_t used;
+};
+
+__always_inline bool IndexWriter::put(const void *data, size_t len)
+{
+	const char *d = (const char*) data;
+	size_t n;
+
+	while (len > 0) {
+		if (used == INDEXWRITER_BUFFER_SIZE && !flush())
+			return false;
+		n = TSMIN(len, INDEXWRITER_BUFFER_SIZE - used);
+		memcpy(buf + used, d, n);
+		used += n;
+		pos += n;
+		d += n;
+		len -= n;
+	}
+	return true;
+}
+
+#endif /* INDEXWRITER_H */
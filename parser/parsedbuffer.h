@@ -0,0 +1,135 @@
+// SPDX-License-Identifier: (GPL-2.0-or-later OR BSD-2-Clause)
+/*
+ * Traceshark - a visualizer for visualizing ftrace and perf traces
+ * Copyright (C) 2019  Viktor Rosendahl <viktor.rosendahl@gmail.com>
+ *
+ * This file is dual licensed: you can use it either under the terms of
+ * the GPL, or the BSD license, at your option.
+ *
+ *  a) This program is free software; you can redistribute it and/or
+ *     modify it under the terms of the GNU General Public License as
+ *     published by the Free Software Foundation; either version 2 of the
+ *     License, or (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public
+ *     License along with this library; if not, write to the Free
+ *     Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ *     MA 02110-1301 USA
+ *
+ * Alternatively,
+ *
+ *  b) Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *     1. Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *     2. Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *     CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *     INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *     MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *     DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *     CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *     NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *     LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *     HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *     CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ *     OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *     EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef PARSEDBUFFER_H
+#define PARSEDBUFFER_H
+
+#include <cstdint>
+
+#include "mm/mempool.h"
+#include "parser/schedpayload.h"
+#include "parser/traceevent.h"
+#include "vtl/compiler.h"
+#include "vtl/tlist.h"
+
+/*
+ * The events that a reader thread has parsed from one ThreadBuffer with the
+ * grammar of one trace type. The parserThread moves them to the list of events
+ * in the order of the buffers, because the timestamp rollover fixup and the
+ * info lines after perf events depend on what came before the buffer.
+ */
+class ParsedBuffer {
+public:
+	class Line {
+	public:
+		/* The offset of the line of the event in the file */
+		int64_t begin;
+		/*
+		 * The offset of the first of the lines before the event that
+		 * were not events, or -1 if the previous line in the buffer
+		 * is an event or if the event is first in the buffer.
+		 */
+		int64_t infoBegin;
+	};
+	ParsedBuffer(bool ownArgv = false);
+	~ParsedBuffer();
+	__always_inline void clear();
+	/* The payload field of the events is an index into payloads */
+	vtl::TList<TraceEvent> events;
+	vtl::TList<Line> lines;
+	vtl::TList<SchedPayload> payloads;
+	/*
+	 * The offset of the first of the lines at the end of the buffer that
+	 * are not events, or -1 if the last line is an event.
+	 */
+	int64_t trailingInfo;
+	/* False if the buffer was not parsed with this grammar */
+	bool valid;
+	/*
+	 * The pool of the argv arrays of the events, or nullptr if they are
+	 * allocated from the pool of the reader thread. The pool is reset when
+	 * the buffer is reused, so the parserThread must copy the arrays when
+	 * it stitches the events.
+	 */
+	MemPool *argvPool;
+};
+
+/*
+ * If ownArgv is true, the buffer has its own argv pool. This is used when a
+ * trace is followed, so that the oldest events can be evicted together with
+ * their argv arrays.
+ */
+inline ParsedBuffer::ParsedBuffer(bool ownArgv):
+	trailingInfo(-1), valid(false), argvPool(nullptr)
+{
+	if (ownArgv)
+		argvPool = new MemPool(4096, sizeof(TString*));
+}
+
+inline ParsedBuffer::~ParsedBuffer()
+{
+	delete argvPool;
+}
+
+__always_inline void ParsedBuffer::clear()
+{
+	events.softclear();
+	lines.softclear();
+	payloads.softclear();
+	trailingInfo = -1;
+	valid = false;
+	if (argvPool != nullptr)
+		argvPool->reset();
+}
+
+#endif /* PARSEDBUFFER_H */
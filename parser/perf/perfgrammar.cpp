@@ -54,7 +54,7 @@
 #include "parser/traceevent.h"
 
 PerfGrammar::PerfGrammar() :
-	unknownTypeCounter(EVENT_UNKNOWN)
+	sharedGrammar(nullptr), unknownTypeCounter(EVENT_UNKNOWN)
 {
 	argPool = new StringPool(2048, 1024 * 1024);
 	namePool =  new StringPool(1024, 65536);
@@ -62,6 +62,19 @@ PerfGrammar::PerfGrammar() :
 	setupEventTree();
 }
 
+/*
+ * The pools of a reader grammar only hold the strings of the events that one
+ * reader parses, so they start smaller than those of the parser's grammar.
+ */
+PerfGrammar::PerfGrammar(PerfGrammar *shared) :
+	sharedGrammar(shared), unknownTypeCounter(EVENT_UNKNOWN)
+{
+	argPool = new StringPool(2048, 65536);
+	namePool =  new StringPool(1024, 4096);
+	eventTree = new StringTree(8, 256, 4096);
+	setupEventTree();
+}
+
 PerfGrammar::~PerfGrammar()
 {
 	delete argPool;
@@ -84,9 +97,23 @@ void PerfGrammar::setupEventTree()
 	TString str;
 
 	for (t = 0; t < NR_EVENTS; t++) {
-		str.ptr = eventstrings[t];
+		str.ptr = (char *) eventstrings[t];
 		str.len = strlen(eventstrings[t]);
 		eventTree->searchAllocString(&str, TShark::StrHash32(&str),
 					     (event_t) t);
 	}
 }
+
+event_t PerfGrammar::internSharedEventType(const TString *name,
+					   uint32_t hval)
+{
+	event_t type;
+
+	typeMutex.lock();
+	type = eventTree->searchAllocString(name, hval,
+					    (event_t) unknownTypeCounter);
+	if (type == unknownTypeCounter)
+		unknownTypeCounter++;
+	typeMutex.unlock();
+	return type;
+}
@@ -53,9 +53,12 @@
 #ifndef PERFGRAMMAR_H
 #define PERFGRAMMAR_H
 
+#include <QMutex>
+
 #include "misc/traceshark.h"
 #include "mm/stringpool.h"
 #include "mm/stringtree.h"
+#include "parser/eventhash.h"
 #include "parser/traceevent.h"
 #include "vtl/time.h"
 
@@ -71,12 +74,21 @@ class PerfGrammar
 {
 public:
 	PerfGrammar();
+	PerfGrammar(PerfGrammar *shared);
 	~PerfGrammar();
 	void clear();
 	__always_inline bool parseLine(TraceLine &line, TraceEvent &event);
+	/*
+	 * These are used by the parser itself but also by the readers that
+	 * produce events directly from binary trace formats.
+	 */
+	__always_inline event_t internEventType(const TString *name);
+	__always_inline const TString *internTaskName(const TString *name);
+	__always_inline const TString *internArg(const TString *arg);
 	StringTree *eventTree;
 private:
 	void setupEventTree();
+	event_t internSharedEventType(const TString *name, uint32_t hval);
 	__always_inline bool StoreMatch(TString *str, TraceEvent &event);
 	__always_inline bool NameMatch(TString *str, TraceEvent &event);
 	__always_inline bool IntArgMatch(TString *str, TraceEvent &event);
@@ -86,8 +98,19 @@ private:
 	__always_inline bool TimeMatch(TString *str, TraceEvent &event);
 	__always_inline bool EventMatch(TString *str, TraceEvent &event);
 	__always_inline bool ArgMatch(TString *str, TraceEvent &event);
+	__always_inline bool LazyArgsMatch(const TraceLine &line,
+					   const TString *str, int n,
+					   TraceEvent &event);
 	StringPool *argPool;
 	StringPool *namePool;
+	/*
+	 * The grammar of a reader thread gets the types of the unknown events
+	 * from the grammar of the parser, so that an event name gets the same
+	 * type regardless of which reader that sees it first. Its own eventTree
+	 * is only a cache of the types that it has already looked up.
+	 */
+	PerfGrammar *sharedGrammar;
+	QMutex typeMutex;
 
 	/*
 	 * This is a counter that will count up every time a new event name
@@ -107,6 +130,48 @@ private:
 	} grammarstate_t;
 };
 
+__always_inline event_t PerfGrammar::internEventType(const TString *name)
+{
+	event_t type;
+	uint32_t hval;
+
+	type = EventHash::lookup(name);
+	if (type != EVENT_ERROR)
+		return type;
+
+	hval = TShark::StrHash32(name);
+	if (sharedGrammar != nullptr) {
+		type = eventTree->searchString(name, hval);
+		if (type != EVENT_ERROR)
+			return type;
+		type = sharedGrammar->internSharedEventType(name, hval);
+		return eventTree->searchAllocString(name, hval, type);
+	}
+
+	type = eventTree->searchAllocString(name, hval,
+					    (event_t) unknownTypeCounter);
+	if (type == unknownTypeCounter) {
+		/*
+		 * This event is a new event, so for the next one we need to
+		 * bump the counter in order to use a unique eventType value
+		 * for every event name.
+		 */
+		unknownTypeCounter++;
+	}
+	return type;
+}
+
+__always_inline const TString *
+PerfGrammar::internTaskName(const TString *name)
+{
+	return namePool->allocString(name, TShark::StrHash32(name), 0);
+}
+
+__always_inline const TString *PerfGrammar::internArg(const TString *arg)
+{
+	return argPool->allocString(arg, TShark::StrHash32(arg), 16);
+}
+
 __always_inline bool PerfGrammar::StoreMatch(TString *str, TraceEvent &event)
 {
 	/*
@@ -166,6 +231,7 @@ __always_inline bool PerfGrammar::PidMatch(TString *str, TraceEvent &event)
 __always_inline bool PerfGrammar::CPUMatch(TString *str, TraceEvent &event)
 {
 	char *c;
+	char *end = str->ptr + str->len;
 	unsigned int cpu = 0;
 	int digit;
 
@@ -173,7 +239,7 @@ __always_inline bool PerfGrammar::CPUMatch(TString *str, TraceEvent &event)
 		return false;
 
 	cpu = 0;
-	for (c = str->ptr + 1; *c != '\0' && *c != ']'; c++) {
+	for (c = str->ptr + 1; c < end && *c != ']'; c++) {
 		digit = *c - '0';
 		if (digit > 9 || digit < 0)
 			goto error;
@@ -229,14 +295,13 @@ __always_inline bool PerfGrammar::TimeMatch(TString *str, TraceEvent &event)
 	const unsigned int maxlen = sizeof(cstr) / sizeof(char) - 1;
 	int i;
 	int pid;
-	uint32_t hash;
 	bool ok;
 
 	namestr.ptr = cstr;
 	namestr.len = 0;
 
 	/* atof() and sscanf() are buggy. */
-	event.time = vtl::Time::fromString(str->ptr, rval);
+	event.setTime(vtl::Time::fromString(str->ptr, rval));
 
 	/*
 	 * This is the time field, if it is successful we need to assemble
@@ -259,12 +324,9 @@ __always_inline bool PerfGrammar::TimeMatch(TString *str, TraceEvent &event)
 					return false;
 			}
 
-			hash = TShark::StrHash32(&namestr);
-			newname = namePool->allocString(&namestr, hash, 0);
+			newname = internTaskName(&namestr);
 		} else {
-			hash = TShark::StrHash32(event.argv[0]);
-			newname = namePool->allocString(event.argv[0], hash,
-							0);
+			newname = internTaskName(event.argv[0]);
 		}
 		if (newname == nullptr)
 			return false;
@@ -284,8 +346,11 @@ __always_inline bool PerfGrammar::EventMatch(TString *str, TraceEvent &event)
 	if (str->len < 1)
 		return false;
 
+	/*
+	 * The token may point into a read only mapping of the trace file, so
+	 * we only adjust the length and leave the ':' in place.
+	 */
 	if (*lastChr == ':') {
-		*lastChr = '\0';
 		str->len--;
 	} else
 		return false;
@@ -302,19 +367,9 @@ __always_inline bool PerfGrammar::EventMatch(TString *str, TraceEvent &event)
 		tmpstr.len = str->len;
 	}
 
-	type = eventTree->searchAllocString(&tmpstr,
-					    TShark::StrHash32(&tmpstr),
-					    (event_t) unknownTypeCounter);
+	type = internEventType(&tmpstr);
 	if (type == EVENT_ERROR)
 		return false;
-	else if (type == unknownTypeCounter) {
-		/*
-		 * This event is a new event, so for the next one we need to
-		 * bump the counter in order to use a unique eventType value 
-		 * for every event name.
-		 */
-		unknownTypeCounter++;
-	}
 	event.type = type;
 	return true;
 }
@@ -323,7 +378,7 @@ __always_inline bool PerfGrammar::ArgMatch(TString *str, TraceEvent &event)
 {
 	const TString *newstr;
 	if (event.argc < EVENT_MAX_NR_ARGS) {
-		newstr = argPool->allocString(str, TShark::StrHash32(str), 16);
+		newstr = internArg(str);
 		if (newstr == nullptr)
 			return false;
 		event.argv[event.argc] = newstr;
@@ -333,6 +388,21 @@ __always_inline bool PerfGrammar::ArgMatch(TString *str, TraceEvent &event)
 	return false;
 }
 
+/*
+ * The arguments of unknown events, such as cpu-cycles, are only needed if the
+ * user wants to look at them, so we only store where they are in the file and
+ * leave the tokenization and interning to EventArgs.
+ */
+__always_inline bool PerfGrammar::LazyArgsMatch(const TraceLine &line,
+						const TString *str, int n,
+						TraceEvent &event)
+{
+	const TString *last = str + n - 1;
+
+	event.setLazyArgs(line.begin + (str->ptr - line.ptr),
+			  last->ptr + last->len - str->ptr);
+	return true;
+}
 
 __always_inline bool PerfGrammar::parseLine(TraceLine &line, TraceEvent &event)
 {
@@ -384,6 +454,8 @@ __always_inline bool PerfGrammar::parseLine(TraceLine &line, TraceEvent &event)
 			NEXTTOKEN(true);
 			ts_fallthrough;
 		case STATE_ARG:
+			if (event.type >= EVENT_UNKNOWN)
+				return LazyArgsMatch(line, str, n, event);
 			while (ArgMatch(str, event))
 				NEXTTOKEN(true);
 			return false;
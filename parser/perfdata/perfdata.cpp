@@ -0,0 +1,704 @@
+// SPDX-License-Identifier: (GPL-2.0-or-later OR BSD-2-Clause)
+/*
+ * Traceshark - a visualizer for visualizing ftrace and perf traces
+ * Copyright (C) 2019  Viktor Rosendahl <viktor.rosendahl@gmail.com>
+ *
+ * This file is dual licensed: you can use it either under the terms of
+ * the GPL, or the BSD license, at your option.
+ *
+ *  a) This program is free software; you can redistribute it and/or
+ *     modify it under the terms of the GNU General Public License as
+ *     published by the Free Software Foundation; either version 2 of the
+ *     License, or (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public
+ *     License along with this library; if not, write to the Free
+ *     Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ *     MA 02110-1301 USA
+ *
+ * Alternatively,
+ *
+ *  b) Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *     1. Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *     2. Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *     CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *     INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *     MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *     DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *     CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *     NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *     LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *     HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *     CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ *     OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *     EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <climits>
+#include <cstdio>
+#include <cstring>
+
+#include "parser/datacursor.h"
+#include "parser/perf/perfgrammar.h"
+#include "parser/perfdata/perfdata.h"
+#include "parser/schedpayload.h"
+#include "mm/mempool.h"
+#include "misc/chunk.h"
+#include "misc/errors.h"
+#include "misc/traceshark.h"
+#include "threads/indexwatcher.h"
+#include "vtl/heapsort.h"
+#include "vtl/tlist.h"
+
+#define PERFDATA_MAGIC "PERFILE2"
+#define PERFDATA_HEADER_SIZE (104)
+#define PERFDATA_LINE_SIZE (1024)
+
+/* These values are from include/uapi/linux/perf_event.h */
+#define PERFDATA_TYPE_HARDWARE (0)
+#define PERFDATA_TYPE_SOFTWARE (1)
+#define PERFDATA_TYPE_TRACEPOINT (2)
+
+#define PERFDATA_SAMPLE_IP		(1ULL << 0)
+#define PERFDATA_SAMPLE_TID		(1ULL << 1)
+#define PERFDATA_SAMPLE_TIME		(1ULL << 2)
+#define PERFDATA_SAMPLE_ADDR		(1ULL << 3)
+#define PERFDATA_SAMPLE_READ		(1ULL << 4)
+#define PERFDATA_SAMPLE_CALLCHAIN	(1ULL << 5)
+#define PERFDATA_SAMPLE_ID		(1ULL << 6)
+#define PERFDATA_SAMPLE_CPU		(1ULL << 7)
+#define PERFDATA_SAMPLE_PERIOD		(1ULL << 8)
+#define PERFDATA_SAMPLE_STREAM_ID	(1ULL << 9)
+#define PERFDATA_SAMPLE_RAW		(1ULL << 10)
+#define PERFDATA_SAMPLE_IDENTIFIER	(1ULL << 16)
+
+#define PERFDATA_FORMAT_TOTAL_TIME_ENABLED	(1ULL << 0)
+#define PERFDATA_FORMAT_TOTAL_TIME_RUNNING	(1ULL << 1)
+#define PERFDATA_FORMAT_ID			(1ULL << 2)
+#define PERFDATA_FORMAT_GROUP			(1ULL << 3)
+#define PERFDATA_FORMAT_LOST			(1ULL << 4)
+
+#define PERFDATA_ATTR_SAMPLE_ID_ALL (1ULL << 18)
+
+#define PERFDATA_RECORD_COMM (3)
+#define PERFDATA_RECORD_SAMPLE (9)
+#define PERFDATA_RECORD_FINISHED_ROUND (12)
+
+/* These are the feature bits from tools/perf/util/header.h */
+#define PERFDATA_FEAT_TRACING_DATA (1)
+#define PERFDATA_FEAT_EVENT_DESC (12)
+
+#define arraylen(A) (sizeof(A) / sizeof(A[0]))
+
+static const char *const hardwareNames[] = {
+	"cycles", "instructions", "cache-references", "cache-misses",
+	"branches", "branch-misses", "bus-cycles", "stalled-cycles-frontend",
+	"stalled-cycles-backend", "ref-cycles",
+};
+
+static const char *const softwareNames[] = {
+	"cpu-clock", "task-clock", "page-faults", "context-switches",
+	"cpu-migrations", "minor-faults", "major-faults", "alignment-faults",
+	"emulation-faults", "dummy",
+};
+
+static __always_inline uint64_t read64(const char *ptr)
+{
+	return EventField::readUnsigned(ptr, 8, false);
+}
+
+static __always_inline uint32_t read32(const char *ptr)
+{
+	return EventField::readUnsigned(ptr, 4, false);
+}
+
+PerfData::PerfData(const char *m, int64_t s)
+	: map(m), size(s), dataOffset(0), dataSize(0), idPos(-1),
+	  hasTracingData(false), pending(nullptr), spare(nullptr)
+{
+	memset(features, 0, sizeof(features));
+}
+
+PerfData::~PerfData()
+{
+	delete pending;
+	delete spare;
+}
+
+/*
+ * Only files that have been written with the same byte order as ours are
+ * recognized, perf writes the magic as a 64-bit integer.
+ */
+bool PerfData::isPerfData(const char *header, int64_t len)
+{
+	uint64_t magic;
+
+	memcpy(&magic, PERFDATA_MAGIC, sizeof(magic));
+	return len >= PERFDATA_MAGIC_SIZE &&
+		memcmp(header, &magic, PERFDATA_MAGIC_SIZE) == 0;
+}
+
+int PerfData::readHeaders()
+{
+	DataCursor cursor(map, size);
+	uint64_t headerSize, attrSize, attrsOffset, attrsSize;
+	uint64_t dummy;
+	int i;
+	int rval;
+
+	if (!isPerfData(map, size))
+		return -TS_ERROR_FILEFORMAT;
+	cursor.pos = PERFDATA_MAGIC_SIZE;
+	if (!cursor.get64(&headerSize) || !cursor.get64(&attrSize) ||
+	    !cursor.get64(&attrsOffset) || !cursor.get64(&attrsSize) ||
+	    !cursor.get64(&dataOffset) || !cursor.get64(&dataSize) ||
+	    !cursor.get64(&dummy) || !cursor.get64(&dummy))
+		return -TS_ERROR_FILEFORMAT;
+	for (i = 0; i < 4; i++) {
+		if (!cursor.get64(&features[i]))
+			return -TS_ERROR_FILEFORMAT;
+	}
+	/* The pipe mode files have a shorter header and no sections */
+	if (headerSize < PERFDATA_HEADER_SIZE)
+		return -TS_ERROR_FILEFORMAT;
+	if (dataOffset > (uint64_t) size ||
+	    dataSize > (uint64_t) size - dataOffset)
+		return -TS_ERROR_FILEFORMAT;
+
+	rval = readAttrs(attrSize, attrsOffset, attrsSize);
+	if (rval != 0)
+		return rval;
+	rval = readFeatures();
+	if (rval != 0)
+		return rval;
+	setupAttrs();
+	return 0;
+}
+
+/*
+ * Every entry of the attrs section consists of a perf_event_attr, followed by
+ * a section that points to the ids of the events.
+ */
+int PerfData::readAttrs(uint64_t attrSize, uint64_t offset, uint64_t len)
+{
+	const char *p;
+	uint64_t nr, i, j;
+	uint64_t idOffset, idSize;
+	Attr attr;
+
+	/* We need the fields up to the flags and the ids section */
+	if (attrSize < 48 + 16 || offset > (uint64_t) size ||
+	    len > (uint64_t) size - offset)
+		return -TS_ERROR_FILEFORMAT;
+	nr = len / attrSize;
+	if (nr == 0)
+		return -TS_ERROR_FILEFORMAT;
+
+	for (i = 0; i < nr; i++) {
+		p = map + offset + i * attrSize;
+		attr.type = read32(p);
+		attr.config = read64(p + 8);
+		attr.sampleType = read64(p + 24);
+		attr.readFormat = read64(p + 32);
+		attr.sampleIdAll = (read64(p + 40) &
+				    PERFDATA_ATTR_SAMPLE_ID_ALL) != 0;
+		attr.format = nullptr;
+		attr.eventType = EVENT_ERROR;
+		attr.typeValid = false;
+		attrs.append(attr);
+
+		idOffset = read64(p + attrSize - 16);
+		idSize = read64(p + attrSize - 8);
+		if (idOffset > (uint64_t) size ||
+		    idSize > (uint64_t) size - idOffset)
+			return -TS_ERROR_FILEFORMAT;
+		for (j = 0; j + 8 <= idSize; j += 8)
+			attrById[read64(map + idOffset + j)] = i;
+	}
+	return 0;
+}
+
+/*
+ * The feature sections are located after the data, there is one
+ * perf_file_section for every bit that is set in the features bitmap.
+ */
+int PerfData::readFeatures()
+{
+	DataCursor cursor(map, size);
+	uint64_t offset, len;
+	int bit;
+
+	cursor.pos = dataOffset + dataSize;
+	for (bit = 0; bit < 256; bit++) {
+		if ((features[bit / 64] & (1ULL << (bit % 64))) == 0)
+			continue;
+		if (!cursor.get64(&offset) || !cursor.get64(&len))
+			return -TS_ERROR_FILEFORMAT;
+		if (offset > (uint64_t) size || len > (uint64_t) size - offset)
+			return -TS_ERROR_FILEFORMAT;
+		if (bit == PERFDATA_FEAT_TRACING_DATA) {
+			DataCursor tcursor(map + offset, len);
+			/*
+			 * Without the tracing data, the tracepoints will
+			 * not have any arguments but we can still continue
+			 */
+			hasTracingData = tdata.parse(&tcursor) == 0;
+		} else if (bit == PERFDATA_FEAT_EVENT_DESC) {
+			if (!readEventDesc(map + offset, len))
+				return -TS_ERROR_FILEFORMAT;
+		}
+	}
+	return 0;
+}
+
+/* The event descriptions give us the names of the events */
+bool PerfData::readEventDesc(const char *data, uint64_t len)
+{
+	DataCursor cursor(data, len);
+	const char *ptr;
+	const char *name;
+	uint32_t nr, attrSize, nrIds, nameLen;
+	uint32_t i, j;
+	uint64_t id;
+	int idx;
+
+	if (!cursor.get32(&nr) || !cursor.get32(&attrSize))
+		return false;
+	for (i = 0; i < nr; i++) {
+		if (!cursor.getBytes(attrSize, &ptr) || !cursor.get32(&nrIds) ||
+		    !cursor.get32(&nameLen) || !cursor.getBytes(nameLen, &name))
+			return false;
+		idx = i < (uint32_t) attrs.size() ? (int) i : -1;
+		for (j = 0; j < nrIds; j++) {
+			if (!cursor.get64(&id))
+				return false;
+			if (j == 0 && attrById.contains(id))
+				idx = attrById.value(id);
+		}
+		if (idx >= 0 && attrs[idx].name.isEmpty())
+			attrs[idx].name = QByteArray(name,
+						     strnlen(name, nameLen));
+	}
+	return true;
+}
+
+void PerfData::setupAttrs()
+{
+	uint64_t st;
+	int i;
+	int colon;
+
+	for (i = 0; i < attrs.size(); i++) {
+		Attr &attr = attrs[i];
+		if (attr.type == PERFDATA_TYPE_TRACEPOINT && hasTracingData)
+			attr.format = tdata.getFormat(attr.config);
+		if (attr.format != nullptr)
+			continue;
+		/* Names such as cycles:ppp are printed without the modifiers */
+		colon = attr.name.indexOf(':');
+		if (colon >= 0)
+			attr.name = attr.name.left(colon);
+		if (!attr.name.isEmpty())
+			continue;
+		if (attr.type == PERFDATA_TYPE_HARDWARE &&
+		    attr.config < arraylen(hardwareNames))
+			attr.name = hardwareNames[attr.config];
+		else if (attr.type == PERFDATA_TYPE_SOFTWARE &&
+			 attr.config < arraylen(softwareNames))
+			attr.name = softwareNames[attr.config];
+		else
+			attr.name = "unknown";
+	}
+
+	/*
+	 * perf requires that the id is at the same position in all samples
+	 * when there are several events, so we look at the first one.
+	 */
+	idPos = -1;
+	if (attrs.size() < 2)
+		return;
+	st = attrs[0].sampleType;
+	if (st & PERFDATA_SAMPLE_IDENTIFIER) {
+		idPos = 0;
+	} else if (st & PERFDATA_SAMPLE_ID) {
+		idPos = 0;
+		if (st & PERFDATA_SAMPLE_IP)
+			idPos += 8;
+		if (st & PERFDATA_SAMPLE_TID)
+			idPos += 8;
+		if (st & PERFDATA_SAMPLE_TIME)
+			idPos += 8;
+		if (st & PERFDATA_SAMPLE_ADDR)
+			idPos += 8;
+	}
+}
+
+__always_inline PerfData::Attr *PerfData::findAttr(const char *rec,
+						   unsigned int len)
+{
+	uint64_t id;
+
+	if (idPos < 0)
+		return &attrs[0];
+	if ((unsigned int) idPos + 16 > len)
+		return nullptr;
+	id = read64(rec + 8 + idPos);
+	if (!attrById.contains(id))
+		return nullptr;
+	return &attrs[attrById.value(id)];
+}
+
+/* This decodes the fields of a PERF_RECORD_SAMPLE that we are interested in */
+bool PerfData::parseSample(const Attr *attr, const char *rec,
+			   unsigned int len, Sample *sample) const
+{
+	const uint64_t st = attr->sampleType;
+	const uint64_t rf = attr->readFormat;
+	const char *p = rec + 8;
+	const char *end = rec + len;
+	uint64_t nr;
+	uint64_t n;
+
+#define NEED(BYTES) do { if ((uint64_t) (end - p) < (BYTES)) return false; } \
+	while (0)
+
+	memset(sample, 0, sizeof(*sample));
+	if (st & PERFDATA_SAMPLE_IDENTIFIER) {
+		NEED(8);
+		p += 8;
+	}
+	if (st & PERFDATA_SAMPLE_IP) {
+		NEED(8);
+		p += 8;
+	}
+	if (st & PERFDATA_SAMPLE_TID) {
+		NEED(8);
+		sample->tid = read32(p + 4);
+		p += 8;
+	}
+	if (st & PERFDATA_SAMPLE_TIME) {
+		NEED(8);
+		sample->time = read64(p);
+		p += 8;
+	}
+	if (st & PERFDATA_SAMPLE_ADDR) {
+		NEED(8);
+		p += 8;
+	}
+	if (st & PERFDATA_SAMPLE_ID) {
+		NEED(8);
+		p += 8;
+	}
+	if (st & PERFDATA_SAMPLE_STREAM_ID) {
+		NEED(8);
+		p += 8;
+	}
+	if (st & PERFDATA_SAMPLE_CPU) {
+		NEED(8);
+		sample->cpu = read32(p);
+		p += 8;
+	}
+	if (st & PERFDATA_SAMPLE_PERIOD) {
+		NEED(8);
+		sample->period = read64(p);
+		p += 8;
+	}
+	if (st & PERFDATA_SAMPLE_READ) {
+		n = 8;
+		if (rf & PERFDATA_FORMAT_ID)
+			n += 8;
+		if (rf & PERFDATA_FORMAT_LOST)
+			n += 8;
+		if (rf & PERFDATA_FORMAT_GROUP) {
+			NEED(8);
+			nr = read64(p);
+			p += 8;
+			if (nr > (uint64_t) (end - p) / n)
+				return false;
+			n *= nr;
+		}
+		if (rf & PERFDATA_FORMAT_TOTAL_TIME_ENABLED)
+			n += 8;
+		if (rf & PERFDATA_FORMAT_TOTAL_TIME_RUNNING)
+			n += 8;
+		NEED(n);
+		p += n;
+	}
+	if (st & PERFDATA_SAMPLE_CALLCHAIN) {
+		NEED(8);
+		nr = read64(p);
+		p += 8;
+		if (nr > (uint64_t) (end - p) / 8)
+			return false;
+		sample->callchain = p;
+		sample->nrIps = nr;
+		p += nr * 8;
+	}
+	if (st & PERFDATA_SAMPLE_RAW) {
+		NEED(4);
+		n = read32(p);
+		p += 4;
+		NEED(n);
+		sample->raw = p;
+		sample->rawSize = n;
+	}
+#undef NEED
+	return true;
+}
+
+/*
+ * The time of a sample is in the sample itself, the time of other records is
+ * in the sample_id that is appended to them if sample_id_all is set. The
+ * sample_id consists of the TID, TIME, ID, STREAM_ID, CPU and IDENTIFIER
+ * fields, if they are present in sample_type.
+ */
+uint64_t PerfData::recordTime(const char *rec, unsigned int len) const
+{
+	const Attr &attr = attrs[0];
+	const uint64_t st = attr.sampleType;
+	unsigned int pos = 8;
+
+	if (!attr.sampleIdAll || (st & PERFDATA_SAMPLE_TIME) == 0)
+		return 0;
+	if (st & PERFDATA_SAMPLE_ID)
+		pos += 8;
+	if (st & PERFDATA_SAMPLE_STREAM_ID)
+		pos += 8;
+	if (st & PERFDATA_SAMPLE_CPU)
+		pos += 8;
+	if (st & PERFDATA_SAMPLE_IDENTIFIER)
+		pos += 8;
+	if (pos + 8 > len)
+		return 0;
+	return read64(rec + len - pos);
+}
+
+const TString *PerfData::lookupName(uint32_t tid, PerfGrammar *grammar)
+{
+	char buf[16];
+	TString name;
+	const TString *interned;
+
+	interned = comms.value(tid, nullptr);
+	if (interned != nullptr)
+		return interned;
+
+	/* This is what perf script prints if the comm is unknown */
+	if (tid == 0)
+		name.ptr = (char*) "swapper";
+	else {
+		snprintf(buf, sizeof(buf), ":%u", tid);
+		name.ptr = buf;
+	}
+	name.len = strlen(name.ptr);
+	interned = grammar->internTaskName(&name);
+	comms[tid] = interned;
+	return interned;
+}
+
+/* A PERF_RECORD_COMM is pid, tid and the null terminated comm */
+void PerfData::emitComm(const char *rec, unsigned int len,
+			PerfGrammar *grammar)
+{
+	TString name;
+	const TString *interned;
+	uint32_t tid;
+
+	if (len < 16)
+		return;
+	tid = read32(rec + 12);
+	name.ptr = (char*) rec + 16;
+	name.len = strnlen(name.ptr, len - 16);
+	interned = grammar->internTaskName(&name);
+	if (interned != nullptr)
+		comms[tid] = interned;
+}
+
+void PerfData::emitSample(const char *rec, unsigned int len,
+			  PerfGrammar *grammar, vtl::TList<TraceEvent> *events,
+			  SchedPayloads *payloads, MemPool *ptrPool,
+			  MemPool *postEventPool)
+{
+	char line[PERFDATA_LINE_SIZE];
+	const unsigned long long nsecs = 1000000000ULL;
+	Attr *attr;
+	Sample s;
+	TString ename;
+	Chunk *chunk;
+	int n;
+
+	attr = findAttr(rec, len);
+	if (attr == nullptr || !parseSample(attr, rec, len, &s))
+		return;
+
+	TraceEvent &event = events->preAlloc();
+	if (attr->format != nullptr) {
+		event.type = tracingdata_event_type(attr->format, grammar);
+	} else {
+		if (!attr->typeValid) {
+			ename.ptr = attr->name.data();
+			ename.len = attr->name.size();
+			attr->eventType = grammar->internEventType(&ename);
+			attr->typeValid = true;
+		}
+		event.type = attr->eventType;
+	}
+	event.pid = s.tid;
+	event.cpu = s.cpu;
+	event.setTime(vtl::Time(false, s.time / nsecs, s.time % nsecs, 9));
+	event.taskName = lookupName(s.tid, grammar);
+	/* perf script prints the period of samples but not of tracepoints */
+	event.intArg = attr->format == nullptr ? (int) s.period : 0;
+	event.argc = 0;
+	event.argv = (const TString**) ptrPool->preallocN(EVENT_MAX_NR_ARGS);
+
+	if (attr->format != nullptr && s.raw != nullptr) {
+		n = tdata.formatArgs(attr->format, s.raw, s.rawSize, line,
+				     sizeof(line), TracingData::STYLE_PERF);
+		tracingdata_split_args(grammar, line, n, event);
+	}
+
+	if (s.nrIps > 0) {
+		chunk = (Chunk*) postEventPool->allocObj();
+		chunk->offset = s.callchain - map;
+		chunk->len = TSMIN(s.nrIps * 8, (uint64_t) INT32_MAX & ~7ULL);
+		event.postEventInfo = chunk;
+	} else {
+		event.postEventInfo = nullptr;
+	}
+
+	ptrPool->commitN(event.argc);
+	if (attr->format != nullptr && s.raw != nullptr)
+		tdata.decodePayload(attr->format, s.raw, s.rawSize,
+				    TRACE_TYPE_PERF, payloads, event);
+	else
+		payloads->decode(TRACE_TYPE_PERF, event);
+	events->commit();
+}
+
+/*
+ * This sorts the pending records by time and emits the ones that are not
+ * later than limit. The offset in the file is used as a tie breaker, so that
+ * records with the same time are emitted in the order of the file.
+ */
+void PerfData::flush(uint64_t limit, PerfGrammar *grammar,
+		     vtl::TList<TraceEvent> *events, SchedPayloads *payloads,
+		     MemPool *ptrPool, MemPool *postEventPool)
+{
+	vtl::TList<Pending> *tmp;
+	const char *rec;
+	unsigned int len;
+	int i, n;
+
+	n = pending->size();
+	vtl::heapsort<vtl::TList, Pending>(
+		*pending, [] (const Pending &a, const Pending &b) -> int {
+			if (a.time != b.time)
+				return a.time < b.time ? -1 : 1;
+			if (a.offset != b.offset)
+				return a.offset < b.offset ? -1 : 1;
+			return 0;
+		});
+
+	for (i = 0; i < n; i++) {
+		const Pending &p = (*pending)[i];
+		if (p.time > limit)
+			break;
+		rec = map + p.offset;
+		len = EventField::readUnsigned(rec + 6, 2, false);
+		if (read32(rec) == PERFDATA_RECORD_SAMPLE)
+			emitSample(rec, len, grammar, events, payloads, ptrPool,
+				   postEventPool);
+		else
+			emitComm(rec, len, grammar);
+	}
+
+	spare->softclear();
+	for (; i < n; i++)
+		spare->append((*pending)[i]);
+	tmp = pending;
+	pending = spare;
+	spare = tmp;
+}
+
+/*
+ * The records in the file are only partially ordered by time. perf writes a
+ * PERF_RECORD_FINISHED_ROUND every time it has emptied the ring buffers, all
+ * records that are older than the newest record before the previous
+ * FINISHED_ROUND can then be sorted and emitted. This is what perf itself
+ * does.
+ */
+void PerfData::readEvents(PerfGrammar *grammar,
+			  vtl::TList<TraceEvent> *events,
+			  SchedPayloads *payloads, MemPool *ptrPool,
+			  MemPool *postEventPool, IndexWatcher *watcher)
+{
+	uint64_t off = dataOffset;
+	const uint64_t end = dataOffset + dataSize;
+	uint64_t roundLimit = 0;
+	uint64_t maxTime = 0;
+	const char *rec;
+	unsigned int type;
+	unsigned int len;
+	Attr *attr;
+	Sample s;
+	Pending p;
+
+	pending = new vtl::TList<Pending>;
+	spare = new vtl::TList<Pending>;
+
+	while (off + 8 <= end) {
+		rec = map + off;
+		type = read32(rec);
+		len = EventField::readUnsigned(rec + 6, 2, false);
+		if (len < 8 || off + len > end)
+			break;
+		switch (type) {
+		case PERFDATA_RECORD_SAMPLE:
+			attr = findAttr(rec, len);
+			if (attr == nullptr || !parseSample(attr, rec, len, &s))
+				break;
+			p.time = s.time;
+			p.offset = off;
+			pending->append(p);
+			maxTime = TSMAX(maxTime, p.time);
+			break;
+		case PERFDATA_RECORD_COMM:
+			p.time = recordTime(rec, len);
+			p.offset = off;
+			pending->append(p);
+			break;
+		case PERFDATA_RECORD_FINISHED_ROUND:
+			flush(roundLimit, grammar, events, payloads, ptrPool,
+			      postEventPool);
+			roundLimit = maxTime;
+			watcher->sendNextIndex(events->size());
+			break;
+		default:
+			break;
+		}
+		off += len;
+	}
+	flush(UINT64_MAX, grammar, events, payloads, ptrPool, postEventPool);
+
+	delete pending;
+	delete spare;
+	pending = nullptr;
+	spare = nullptr;
+}
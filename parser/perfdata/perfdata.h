@@ -0,0 +1,164 @@
+// SPDX-License-Identifier: (GPL-2.0-or-later OR BSD-2-Clause)
+/*
+ * Traceshark - a visualizer for visualizing ftrace and perf traces
+ * Copyright (C) 2019  Viktor Rosendahl <viktor.rosendahl@gmail.com>
+ *
+ * This file is dual licensed: you can use it either under the terms of
+ * the GPL, or the BSD license, at your option.
+ *
+ *  a) This program is free software; you can redistribute it and/or
+ *     modify it under the terms of the GNU General Public License as
+ *     published by the Free Software Foundation; either version 2 of the
+ *     License, or (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public
+ *     License along with this library; if not, write to the Free
+ *     Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ *     MA 02110-1301 USA
+ *
+ * Alternatively,
+ *
+ *  b) Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *     1. Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *     2. Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *     CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *     INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *     MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *     DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *     CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *     NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *     LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *     HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *     CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ *     OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *     EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PERFDATA_H
+#define PERFDATA_H
+
+#include <cstdint>
+
+#include <QByteArray>
+#include <QMap>
+#include <QVector>
+
+#include "parser/tracedat/tracingdata.h"
+#include "parser/traceevent.h"
+#include "misc/tstring.h"
+#include "vtl/compiler.h"
+
+class IndexWatcher;
+class MemPool;
+class PerfGrammar;
+class SchedPayloads;
+namespace vtl {
+	template<class T> class TList;
+}
+
+#define PERFDATA_MAGIC_SIZE (8)
+
+/*
+ * A reader for the perf.data files that are produced by perf record. The
+ * records are decoded directly from the mapping of the file. The arguments of
+ * tracepoint events are formatted from the raw data in the same way as perf
+ * script would print them, so that the perf_* accessors can be used. The
+ * callchains are not copied, the postEventInfo of an event is a Chunk that
+ * refers to the array of instruction pointers in the file.
+ */
+class PerfData
+{
+public:
+	PerfData(const char *map, int64_t size);
+	~PerfData();
+	static bool isPerfData(const char *header, int64_t len);
+	int readHeaders();
+	void readEvents(PerfGrammar *grammar, vtl::TList<TraceEvent> *events,
+			SchedPayloads *payloads, MemPool *ptrPool,
+			MemPool *postEventPool, IndexWatcher *watcher);
+private:
+	class Attr {
+	public:
+		uint32_t type;
+		uint64_t config;
+		uint64_t sampleType;
+		uint64_t readFormat;
+		bool sampleIdAll;
+		QByteArray name;
+		/* This is only set for tracepoints */
+		TracingData::Format *format;
+		event_t eventType;
+		bool typeValid;
+	};
+
+	/* A record that is waiting to be sorted by time */
+	class Pending {
+	public:
+		uint64_t time;
+		int64_t offset;
+	};
+
+	class Sample {
+	public:
+		uint32_t tid;
+		uint32_t cpu;
+		uint64_t time;
+		uint64_t period;
+		const char *callchain;
+		uint64_t nrIps;
+		const char *raw;
+		uint32_t rawSize;
+	};
+
+	int readAttrs(uint64_t attrSize, uint64_t offset, uint64_t len);
+	int readFeatures();
+	bool readEventDesc(const char *data, uint64_t len);
+	void setupAttrs();
+	Attr *findAttr(const char *rec, unsigned int len);
+	bool parseSample(const Attr *attr, const char *rec, unsigned int len,
+			 Sample *sample) const;
+	uint64_t recordTime(const char *rec, unsigned int len) const;
+	void flush(uint64_t limit, PerfGrammar *grammar,
+		   vtl::TList<TraceEvent> *events, SchedPayloads *payloads,
+		   MemPool *ptrPool, MemPool *postEventPool);
+	void emitSample(const char *rec, unsigned int len,
+			PerfGrammar *grammar, vtl::TList<TraceEvent> *events,
+			SchedPayloads *payloads, MemPool *ptrPool,
+			MemPool *postEventPool);
+	void emitComm(const char *rec, unsigned int len,
+		      PerfGrammar *grammar);
+	const TString *lookupName(uint32_t tid, PerfGrammar *grammar);
+
+	const char *map;
+	int64_t size;
+	uint64_t dataOffset;
+	uint64_t dataSize;
+	uint64_t features[4];
+	QVector<Attr> attrs;
+	QMap<uint64_t, int> attrById;
+	/* The position of the sample id in a sample, -1 if there is none */
+	int idPos;
+	bool hasTracingData;
+	TracingData tdata;
+	QMap<uint32_t, const TString*> comms;
+	vtl::TList<Pending> *pending;
+	vtl::TList<Pending> *spare;
+};
+
+#endif /* PERFDATA_H */
@@ -0,0 +1,121 @@
+// SPDX-License-Identifier: (GPL-2.0-or-later OR BSD-2-Clause)
+/*
+ * Traceshark - a visualizer for visualizing ftrace and perf traces
+ * Copyright (C) 2019  Viktor Rosendahl <viktor.rosendahl@gmail.com>
+ *
+ * This file is dual licensed: you can use it either under the terms of
+ * the GPL, or the BSD license, at your option.
+ *
+ *  a) This program is free software; you can redistribute it and/or
+ *     modify it under the terms of the GNU General Public License as
+ *     published by the Free Software Foundation; either version 2 of the
+ *     License, or (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public
+ *     License along with this library; if not, write to the Free
+ *     Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ *     MA 02110-1301 USA
+ *
+ * Alternatively,
+ *
+ *  b) Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *     1. Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *     2. Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *     CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *     INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *     MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *     DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *     CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *     NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *     LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *     HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *     CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ *     OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *     EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "parser/schedpayload.h"
+
+#define arraylen(A) (sizeof(A) / sizeof(A[0]))
+
+/*
+ * The fields that the payloads are decoded from when the format of the event
+ * is known, the fields after nrRequired are optional.
+ */
+static const struct {
+	event_t type;
+	int nrRequired;
+	const char *fields[SCHEDPAYLOAD_MAX_FIELDS];
+} payloadFields[] = {
+	{ SCHED_SWITCH, 3, { "prev_pid", "next_pid", "prev_state" } },
+	{ SCHED_WAKEUP, 3, { "pid", "target_cpu", "prio", "success" } },
+	{ SCHED_WAKEUP_NEW, 3, { "pid", "target_cpu", "prio", "success" } },
+	{ SCHED_WAKING, 3, { "pid", "target_cpu", "prio" } },
+	{ SCHED_MIGRATE_TASK, 3, { "pid", "orig_cpu", "dest_cpu", "prio" } },
+	{ CPU_FREQUENCY, 2, { "cpu_id", "state" } },
+	{ CPU_IDLE, 2, { "cpu_id", "state" } },
+};
+
+SchedPayloads::SchedPayloads()
+{
+	setExtractors(nullptr);
+}
+
+/*
+ * This looks up the fields of the known events once, so that decode() only
+ * needs to index into the arguments. Events whose format doesn't have all the
+ * required fields are decoded with the ftrace_* and perf_* accessors.
+ */
+void SchedPayloads::setExtractors(const EventExtractors *extractors)
+{
+	const EventExtractor *x;
+	FieldMap *map;
+	unsigned int i;
+	int j;
+
+	for (i = 0; i < NR_EVENTS; i++)
+		fieldMaps[i].extractor = nullptr;
+	if (extractors == nullptr)
+		return;
+
+	for (i = 0; i < arraylen(payloadFields); i++) {
+		x = extractors->getKnown(payloadFields[i].type);
+		if (x == nullptr)
+			continue;
+		map = &fieldMaps[payloadFields[i].type];
+		for (j = 0; j < SCHEDPAYLOAD_MAX_FIELDS; j++) {
+			map->fields[j] = payloadFields[i].fields[j] != nullptr ?
+				x->findField(payloadFields[i].fields[j]) : -1;
+			if (map->fields[j] < 0 &&
+			    j < payloadFields[i].nrRequired)
+				break;
+		}
+		if (j == SCHEDPAYLOAD_MAX_FIELDS)
+			map->extractor = x;
+	}
+}
+
+/*
+ * Removes the first n payloads, the caller must subtract n from the payload
+ * field of the events that remain.
+ */
+void SchedPayloads::removeFirst(int n)
+{
+	list.removeFirst(n);
+}
@@ -0,0 +1,425 @@
+// SPDX-License-Identifier: (GPL-2.0-or-later OR BSD-2-Clause)
+/*
+ * Traceshark - a visualizer for visualizing ftrace and perf traces
+ * Copyright (C) 2019  Viktor Rosendahl <viktor.rosendahl@gmail.com>
+ *
+ * This file is dual licensed: you can use it either under the terms of
+ * the GPL, or the BSD license, at your option.
+ *
+ *  a) This program is free software; you can redistribute it and/or
+ *     modify it under the terms of the GNU General Public License as
+ *     published by the Free Software Foundation; either version 2 of the
+ *     License, or (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public
+ *     License along with this library; if not, write to the Free
+ *     Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ *     MA 02110-1301 USA
+ *
+ * Alternatively,
+ *
+ *  b) Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *     1. Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *     2. Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *     CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *     INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *     MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *     DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *     CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *     NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *     LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *     HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *     CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ *     OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *     EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SCHEDPAYLOAD_H
+#define SCHEDPAYLOAD_H
+
+#include <QVector>
+
+#include "misc/traceshark.h"
+#include "parser/eventextractor.h"
+#include "parser/genericparams.h"
+#include "parser/traceevent.h"
+#include "vtl/compiler.h"
+#include "vtl/tlist.h"
+
+/*
+ * The numeric fields of the scheduler events that the analyzer uses are
+ * decoded once, when the events are parsed, so that the processing of the
+ * events and the searches don't need to scan the argument strings again.
+ * TraceEvent::payload is the index of the payload of an event in the
+ * SchedPayloads, or SCHED_PAYLOAD_NONE if the arguments of the event could not
+ * be decoded. The payload field is only valid for the event types that are
+ * handled by SchedPayloads::decode().
+ */
+#define SCHED_PAYLOAD_NONE (-1)
+#define SCHEDPAYLOAD_MAX_FIELDS (4)
+
+/*
+ * The names of the tasks are only in the payload if the reader could decode
+ * them without the argument strings, i.e. from a binary trace. Otherwise they
+ * are SCHED_NAME_NONE and the name is taken from the arguments.
+ */
+#define SCHED_NAME_NONE (-1)
+
+class SchedPayload {
+public:
+	union {
+		struct {
+			int oldpid;
+			int newpid;
+			taskstate_t state;
+			int oldname;
+			int newname;
+		} sw;
+		/* Used by sched_wakeup, sched_wakeup_new and sched_waking */
+		struct {
+			int pid;
+			unsigned int cpu;
+			unsigned int prio;
+			bool success;
+			int name;
+		} wakeup;
+		struct {
+			int pid;
+			unsigned int origCPU;
+			unsigned int destCPU;
+			unsigned int prio;
+		} migrate;
+		struct {
+			unsigned int cpu;
+			unsigned int freq;
+		} cpufreq;
+		struct {
+			unsigned int cpu;
+			int32_t state;
+		} cpuidle;
+	};
+};
+
+class SchedPayloads {
+public:
+	SchedPayloads();
+	__always_inline void decode(tracetype_t ttype, TraceEvent &event);
+	__always_inline bool decodeInto(tracetype_t ttype,
+					const TraceEvent &event,
+					SchedPayload *p) const;
+	__always_inline void add(TraceEvent &event, const SchedPayload *p);
+	static __always_inline bool isDecoded(event_t type);
+	__always_inline int addName(const TString *name);
+	__always_inline const TString *getName(int id) const;
+	__always_inline SchedPayload &preAlloc();
+	__always_inline void commit(TraceEvent &event);
+	__always_inline const SchedPayload *get(const TraceEvent &event) const;
+	void setExtractors(const EventExtractors *extractors);
+	__always_inline int size() const;
+	void removeFirst(int n);
+	__always_inline void clear();
+private:
+	/*
+	 * The extractor of a known event and the fields that the payload is
+	 * decoded from, in the order given by the payloadFields table.
+	 */
+	class FieldMap {
+	public:
+		const EventExtractor *extractor;
+		int fields[SCHEDPAYLOAD_MAX_FIELDS];
+	};
+	__always_inline bool decodeFields(const FieldMap *map,
+					  const TraceEvent &event,
+					  SchedPayload *p) const;
+	__always_inline bool decodeParams(tracetype_t ttype,
+					  const TraceEvent &event,
+					  SchedPayload *p) const;
+	vtl::TList<SchedPayload> list;
+	QVector<const TString*> names;
+	FieldMap fieldMaps[NR_EVENTS];
+};
+
+/*
+ * This must be called before the event is made visible to the analyzer. The
+ * events whose type is not one of the types below are left untouched, their
+ * payload field may be in use as argLen. If the format of the event has been
+ * loaded, the fields are extracted as described by the format, otherwise, or
+ * if the trace doesn't match the format, the ftrace_* and perf_* accessors
+ * are used.
+ */
+__always_inline void SchedPayloads::decode(tracetype_t ttype,
+					   TraceEvent &event)
+{
+	FieldMap *map;
+	SchedPayload *p;
+
+	if (!isDecoded(event.type))
+		return;
+
+	p = &list.preAlloc();
+	map = &fieldMaps[event.type];
+	if (map->extractor != nullptr) {
+		if (likely(decodeFields(map, event, p))) {
+			commit(event);
+			return;
+		}
+		/* The trace doesn't match the format, so stop trying */
+		map->extractor = nullptr;
+	}
+	if (decodeParams(ttype, event, p))
+		commit(event);
+	else
+		event.payload = SCHED_PAYLOAD_NONE;
+}
+
+/*
+ * This is like decode() but it doesn't touch the SchedPayloads, so it can be
+ * called by several reader threads at the same time. The payload is decoded
+ * into p, which is later handed to add() by the thread that owns the
+ * SchedPayloads. Since nothing is remembered, the format is tried for every
+ * event, also if the trace doesn't match it.
+ */
+__always_inline bool SchedPayloads::decodeInto(tracetype_t ttype,
+					       const TraceEvent &event,
+					       SchedPayload *p) const
+{
+	const FieldMap *map;
+
+	if (!isDecoded(event.type))
+		return false;
+
+	map = &fieldMaps[event.type];
+	if (map->extractor != nullptr && likely(decodeFields(map, event, p)))
+		return true;
+	return decodeParams(ttype, event, p);
+}
+
+/* The payload is copied, a null p means that the event couldn't be decoded */
+__always_inline void SchedPayloads::add(TraceEvent &event,
+					const SchedPayload *p)
+{
+	if (p == nullptr) {
+		event.payload = SCHED_PAYLOAD_NONE;
+		return;
+	}
+	list.preAlloc() = *p;
+	commit(event);
+}
+
+/* Returns true for the event types that have a payload */
+__always_inline bool SchedPayloads::isDecoded(event_t type)
+{
+	switch (type) {
+	case CPU_FREQUENCY:
+	case CPU_IDLE:
+	case SCHED_MIGRATE_TASK:
+	case SCHED_SWITCH:
+	case SCHED_WAKEUP:
+	case SCHED_WAKEUP_NEW:
+	case SCHED_WAKING:
+		return true;
+	default:
+		return false;
+	}
+}
+
+__always_inline bool SchedPayloads::decodeFields(const FieldMap *map,
+						 const TraceEvent &event,
+						 SchedPayload *p) const
+{
+	const EventExtractor *x = map->extractor;
+	const int *f = map->fields;
+	const TString * const *argv = event.argv;
+	int argc = event.argc;
+	int64_t v[3];
+	TString str;
+
+	switch (event.type) {
+	case SCHED_SWITCH:
+		if (!x->getInt(argv, argc, f[0], &v[0]) ||
+		    !x->getInt(argv, argc, f[1], &v[1]) ||
+		    !x->getArg(argv, argc, f[2], &str))
+			return false;
+		p->sw.oldpid = v[0];
+		p->sw.newpid = v[1];
+		p->sw.state = __sched_state_from_tstring(&str);
+		p->sw.oldname = SCHED_NAME_NONE;
+		p->sw.newname = SCHED_NAME_NONE;
+		return true;
+	case SCHED_WAKEUP:
+	case SCHED_WAKEUP_NEW:
+	case SCHED_WAKING:
+		if (!x->getInt(argv, argc, f[0], &v[0]) ||
+		    !x->getInt(argv, argc, f[1], &v[1]) ||
+		    !x->getInt(argv, argc, f[2], &v[2]))
+			return false;
+		p->wakeup.pid = v[0];
+		p->wakeup.cpu = v[1];
+		p->wakeup.prio = v[2];
+		/* Newer kernels don't print success, it's always true */
+		p->wakeup.success = f[3] < 0 ||
+			!x->getInt(argv, argc, f[3], &v[0]) || v[0] != 0;
+		p->wakeup.name = SCHED_NAME_NONE;
+		return true;
+	case SCHED_MIGRATE_TASK:
+		if (!x->getInt(argv, argc, f[0], &v[0]) ||
+		    !x->getInt(argv, argc, f[1], &v[1]) ||
+		    !x->getInt(argv, argc, f[2], &v[2]))
+			return false;
+		p->migrate.pid = v[0];
+		p->migrate.origCPU = v[1];
+		p->migrate.destCPU = v[2];
+		p->migrate.prio = f[3] >= 0 &&
+			x->getInt(argv, argc, f[3], &v[0]) ? v[0] : 0;
+		return true;
+	case CPU_FREQUENCY:
+		if (!x->getInt(argv, argc, f[0], &v[0]) ||
+		    !x->getInt(argv, argc, f[1], &v[1]))
+			return false;
+		p->cpufreq.cpu = v[0];
+		p->cpufreq.freq = v[1];
+		return true;
+	case CPU_IDLE:
+		if (!x->getInt(argv, argc, f[0], &v[0]) ||
+		    !x->getInt(argv, argc, f[1], &v[1]))
+			return false;
+		p->cpuidle.cpu = v[0];
+		/* The state is printed as an unsigned, -1 means exit */
+		p->cpuidle.state = (int32_t) v[1];
+		return true;
+	default:
+		return false;
+	}
+}
+
+__always_inline bool SchedPayloads::decodeParams(tracetype_t ttype,
+						 const TraceEvent &event,
+						 SchedPayload *p) const
+{
+	sched_switch_handle handle;
+
+	switch (event.type) {
+	case SCHED_SWITCH:
+		if (!sched_switch_parse(ttype, event, handle))
+			return false;
+		p->sw.oldpid = sched_switch_handle_oldpid(ttype, event, handle);
+		p->sw.newpid = sched_switch_handle_newpid(ttype, event, handle);
+		p->sw.state = sched_switch_handle_state(ttype, event, handle);
+		p->sw.oldname = SCHED_NAME_NONE;
+		p->sw.newname = SCHED_NAME_NONE;
+		return true;
+	case SCHED_WAKEUP:
+	case SCHED_WAKEUP_NEW:
+		if (!sched_wakeup_args_ok(ttype, event))
+			return false;
+		p->wakeup.pid = sched_wakeup_pid(ttype, event);
+		p->wakeup.cpu = sched_wakeup_cpu(ttype, event);
+		p->wakeup.prio = sched_wakeup_prio(ttype, event);
+		p->wakeup.success = sched_wakeup_success(ttype, event);
+		p->wakeup.name = SCHED_NAME_NONE;
+		return true;
+	case SCHED_WAKING:
+		if (!sched_waking_args_ok(ttype, event))
+			return false;
+		p->wakeup.pid = sched_waking_pid(ttype, event);
+		p->wakeup.cpu = sched_waking_cpu(ttype, event);
+		p->wakeup.prio = sched_waking_prio(ttype, event);
+		p->wakeup.success = true;
+		p->wakeup.name = SCHED_NAME_NONE;
+		return true;
+	case SCHED_MIGRATE_TASK:
+		if (!sched_migrate_args_ok(ttype, event))
+			return false;
+		p->migrate.pid = sched_migrate_pid(ttype, event);
+		p->migrate.origCPU = sched_migrate_origCPU(ttype, event);
+		p->migrate.destCPU = sched_migrate_destCPU(ttype, event);
+		p->migrate.prio = sched_migrate_prio(ttype, event);
+		return true;
+	case CPU_FREQUENCY:
+		if (!cpufreq_args_ok(ttype, event))
+			return false;
+		p->cpufreq.cpu = cpufreq_cpu(ttype, event);
+		p->cpufreq.freq = cpufreq_freq(ttype, event);
+		return true;
+	case CPU_IDLE:
+		if (!cpuidle_args_ok(ttype, event))
+			return false;
+		p->cpuidle.cpu = cpuidle_cpu(ttype, event);
+		p->cpuidle.state = cpuidle_state(ttype, event);
+		return true;
+	default:
+		return false;
+	}
+}
+
+/*
+ * These can be used instead of decode() by readers that decode the payload
+ * themselves, e.g. from the binary fields of the event.
+ */
+__always_inline SchedPayload &SchedPayloads::preAlloc()
+{
+	return list.preAlloc();
+}
+
+__always_inline void SchedPayloads::commit(TraceEvent &event)
+{
+	event.payload = list.size();
+	list.commit();
+}
+
+/*
+ * Returns nullptr if the arguments of the event could not be decoded. The
+ * caller must have checked that the event is of one of the types that are
+ * handled by decode().
+ */
+__always_inline
+const SchedPayload *SchedPayloads::get(const TraceEvent &event) const
+{
+	if (event.payload == SCHED_PAYLOAD_NONE)
+		return nullptr;
+	return &list.at(event.payload);
+}
+
+__always_inline int SchedPayloads::size() const
+{
+	return list.size();
+}
+
+/* The name must stay valid as long as the payloads, e.g. an interned name */
+__always_inline int SchedPayloads::addName(const TString *name)
+{
+	names.append(name);
+	return names.size() - 1;
+}
+
+/* Returns nullptr for SCHED_NAME_NONE */
+__always_inline const TString *SchedPayloads::getName(int id) const
+{
+	if (id < 0 || id >= names.size())
+		return nullptr;
+	return names[id];
+}
+
+__always_inline void SchedPayloads::clear()
+{
+	list.clear();
+	names.clear();
+}
+
+#endif /* SCHEDPAYLOAD_H */
@@ -0,0 +1,541 @@
+// SPDX-License-Identifier: (GPL-2.0-or-later OR BSD-2-Clause)
+/*
+ * Traceshark - a visualizer for visualizing ftrace and perf traces
+ * Copyright (C) 2019  Viktor Rosendahl <viktor.rosendahl@gmail.com>
+ *
+ * This file is dual licensed: you can use it either under the terms of
+ * the GPL, or the BSD license, at your option.
+ *
+ *  a) This program is free software; you can redistribute it and/or
+ *     modify it under the terms of the GNU General Public License as
+ *     published by the Free Software Foundation; either version 2 of the
+ *     License, or (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public
+ *     License along with this library; if not, write to the Free
+ *     Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ *     MA 02110-1301 USA
+ *
+ * Alternatively,
+ *
+ *  b) Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *     1. Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *     2. Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *     CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *     INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *     MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *     DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *     CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *     NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *     LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *     HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *     CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ *     OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *     EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstdio>
+#include <cstring>
+
+#include "parser/datacursor.h"
+#include "parser/ftrace/ftracegrammar.h"
+#include "parser/tracedat/tracedat.h"
+#include "parser/schedpayload.h"
+#include "mm/mempool.h"
+#include "misc/errors.h"
+#include "misc/traceshark.h"
+#include "threads/indexwatcher.h"
+#include "vtl/tlist.h"
+
+#define TRACEDAT_VERSION (6)
+
+/* The ring buffer event header consists of type_len:5 and time_delta:27 */
+#define RB_TYPE_PADDING (29)
+#define RB_TYPE_TIME_EXTEND (30)
+#define RB_TYPE_TIME_STAMP (31)
+#define RB_TS_SHIFT (27)
+#define RB_DELTA_MASK ((1U << RB_TS_SHIFT) - 1)
+/* The upper bits of the commit field of a page are used for flags */
+#define RB_COMMIT_MASK ((1ULL << 27) - 1)
+
+#define TRACEDAT_LINE_SIZE (1024)
+#define TRACEDAT_BATCH (16384)
+
+TraceDat::TraceDat(const char *m, int64_t s)
+	: map(m), size(s), nrCPUs(0)
+{}
+
+bool TraceDat::isTraceDat(const char *header, int64_t len)
+{
+	return TracingData::isTracingData(header, len);
+}
+
+__always_inline uint32_t TraceDat::read32(const char *ptr) const
+{
+	return EventField::readUnsigned(ptr, 4, tdata.swap);
+}
+
+/*
+ * This reads the headers of the file and makes the streams point to the
+ * beginning of the data of every CPU. Only version 6 of the format, the
+ * classic flyrecord format, is supported.
+ */
+int TraceDat::readHeaders()
+{
+	DataCursor cursor(map, size);
+	const char *ptr;
+	uint64_t size64, offset64;
+	unsigned int i;
+	int rval;
+
+	rval = tdata.parse(&cursor);
+	if (rval != 0)
+		return rval;
+	if (tdata.version != TRACEDAT_VERSION)
+		return -TS_ERROR_FILEFORMAT;
+
+	if (!cursor.get32(&nrCPUs))
+		return -TS_ERROR_FILEFORMAT;
+
+	while (true) {
+		if (!cursor.getBytes(TRACEDAT_MAGIC_SIZE, &ptr))
+			return -TS_ERROR_FILEFORMAT;
+		if (memcmp(ptr, "options  ", TRACEDAT_MAGIC_SIZE) == 0) {
+			if (!readOptions(&cursor))
+				return -TS_ERROR_FILEFORMAT;
+			continue;
+		}
+		if (memcmp(ptr, "flyrecord", TRACEDAT_MAGIC_SIZE) == 0)
+			break;
+		/* This includes "latency  ", which is text only */
+		return -TS_ERROR_FILEFORMAT;
+	}
+
+	streams.resize(nrCPUs);
+	for (i = 0; i < nrCPUs; i++) {
+		CPUStream &s = streams[i];
+		if (!cursor.get64(&offset64) || !cursor.get64(&size64))
+			return -TS_ERROR_FILEFORMAT;
+		if (offset64 > (uint64_t) size ||
+		    size64 > (uint64_t) size - offset64)
+			return -TS_ERROR_FILEFORMAT;
+		s.cpu = i;
+		s.offset = offset64;
+		s.end = offset64 + size64;
+		s.next = nullptr;
+		s.dataEnd = nullptr;
+		s.ts = 0;
+		s.record = nullptr;
+		s.data = nullptr;
+		s.len = 0;
+	}
+	return 0;
+}
+
+/* The options are a list of (u16 id, u32 size, data), ended by id 0 */
+bool TraceDat::readOptions(DataCursor *cursor)
+{
+	const char *ptr;
+	uint32_t len;
+	uint16_t id;
+
+	while (true) {
+		if (!cursor->get16(&id))
+			return false;
+		if (id == 0)
+			return true;
+		if (!cursor->get32(&len) || !cursor->getBytes(len, &ptr))
+			return false;
+	}
+}
+
+bool TraceDat::loadPage(CPUStream *s)
+{
+	const char *page;
+	const char *pageEnd;
+	uint64_t commit;
+
+	while (s->offset + tdata.pageData.offset < s->end) {
+		page = map + s->offset;
+		pageEnd = map + TSMIN(s->offset + tdata.pageSize, s->end);
+		s->offset += tdata.pageSize;
+
+		s->ts = tdata.pageTs.getUnsigned(page, tdata.swap);
+		commit = tdata.pageCommit.getUnsigned(page, tdata.swap) & RB_COMMIT_MASK;
+		s->next = page + tdata.pageData.offset;
+		if (commit > (uint64_t) (pageEnd - s->next))
+			commit = pageEnd - s->next;
+		s->dataEnd = s->next + commit;
+		if (commit > 0)
+			return true;
+	}
+	return false;
+}
+
+/* This advances the stream to its next event, false is returned at the end */
+bool TraceDat::nextEvent(CPUStream *s)
+{
+	uint32_t header;
+	uint32_t typeLen;
+	uint32_t delta;
+	uint32_t len;
+	const char *p;
+
+	while (true) {
+		if (s->next == nullptr || s->next + 4 > s->dataEnd) {
+			if (!loadPage(s))
+				return false;
+			continue;
+		}
+		s->record = s->next;
+		header = read32(s->next);
+		if (tdata.bigEndian) {
+			typeLen = header >> RB_TS_SHIFT;
+			delta = header & RB_DELTA_MASK;
+		} else {
+			typeLen = header & 0x1f;
+			delta = header >> 5;
+		}
+		p = s->next + 4;
+
+		switch (typeLen) {
+		case RB_TYPE_PADDING:
+			/* A zero delta means that the rest of page is empty */
+			if (delta == 0 || p + 4 > s->dataEnd) {
+				s->next = s->dataEnd;
+				continue;
+			}
+			len = read32(p);
+			if (len > (uint64_t) (s->dataEnd - p))
+				s->next = s->dataEnd;
+			else
+				s->next = p + len;
+			continue;
+		case RB_TYPE_TIME_EXTEND:
+			if (p + 4 > s->dataEnd) {
+				s->next = s->dataEnd;
+				continue;
+			}
+			s->ts += ((uint64_t) read32(p) << RB_TS_SHIFT) + delta;
+			s->next = p + 4;
+			continue;
+		case RB_TYPE_TIME_STAMP:
+			if (p + 4 > s->dataEnd) {
+				s->next = s->dataEnd;
+				continue;
+			}
+			s->ts = ((uint64_t) read32(p) << RB_TS_SHIFT) | delta;
+			s->next = p + 4;
+			continue;
+		case 0:
+			if (p + 4 > s->dataEnd) {
+				s->next = s->dataEnd;
+				continue;
+			}
+			len = read32(p);
+			len = len >= 4 ? (len - 4 + 3) & ~3U : 0;
+			p += 4;
+			break;
+		default:
+			len = typeLen * 4;
+			break;
+		}
+
+		if (len > (uint64_t) (s->dataEnd - p)) {
+			s->next = s->dataEnd;
+			continue;
+		}
+		s->ts += delta;
+		s->data = p;
+		s->len = len;
+		s->next = p + len;
+		return true;
+	}
+}
+
+/* Restore the min-heap property of the streams, starting at index i */
+void TraceDat::heapDown(int i)
+{
+	const int n = heap.size();
+	CPUStream *tmp;
+	int child;
+
+	while (true) {
+		child = 2 * i + 1;
+		if (child >= n)
+			break;
+		if (child + 1 < n && heap[child + 1]->ts < heap[child]->ts)
+			child++;
+		if (heap[i]->ts <= heap[child]->ts)
+			break;
+		tmp = heap[i];
+		heap[i] = heap[child];
+		heap[child] = tmp;
+		i = child;
+	}
+}
+
+/*
+ * This finds the data of the event whose header is at offset. Only data
+ * events are accepted, the time is not needed, so the page doesn't need to be
+ * decoded.
+ */
+bool TraceDat::readRecord(int64_t offset, const char **data,
+			  unsigned int *len) const
+{
+	const char *p;
+	uint32_t header;
+	uint32_t typeLen;
+	uint32_t l;
+
+	if (offset < 0 || offset > size - 4)
+		return false;
+	header = read32(map + offset);
+	typeLen = tdata.bigEndian ? header >> RB_TS_SHIFT : header & 0x1f;
+	p = map + offset + 4;
+
+	if (typeLen == 0) {
+		if (p + 4 > map + size)
+			return false;
+		l = read32(p);
+		l = l >= 4 ? (l - 4 + 3) & ~3U : 0;
+		p += 4;
+	} else if (typeLen < RB_TYPE_PADDING) {
+		l = typeLen * 4;
+	} else {
+		return false;
+	}
+	if (l > (uint64_t) (map + size - p))
+		return false;
+	*data = p;
+	*len = l;
+	return true;
+}
+
+const TString *TraceDat::lookupName(int pid, FtraceGrammar *grammar)
+{
+	TString name;
+	const TString *interned;
+
+	interned = names.value(pid, nullptr);
+	if (interned != nullptr)
+		return interned;
+
+	if (pid == 0) {
+		name.ptr = (char*) "<idle>";
+		name.len = strlen(name.ptr);
+	} else if (!tdata.getCmdline(pid, &name)) {
+		name.ptr = (char*) "<...>";
+		name.len = strlen(name.ptr);
+	}
+	interned = grammar->internTaskName(&name);
+	names[pid] = interned;
+	return interned;
+}
+
+/*
+ * The payloads refer to the names by id, the id is reused as long as the
+ * name of the pid doesn't change, so that every name is only interned once.
+ */
+int TraceDat::nameId(int pid, const TString *comm, FtraceGrammar *grammar,
+		     SchedPayloads *payloads)
+{
+	const TString *name;
+	int id;
+
+	id = nameIds.value(pid, SCHED_NAME_NONE);
+	name = payloads->getName(id);
+	if (name != nullptr && name->len == comm->len &&
+	    memcmp(name->ptr, comm->ptr, comm->len) == 0)
+		return id;
+
+	name = grammar->internTaskName(comm);
+	if (name == nullptr)
+		return SCHED_NAME_NONE;
+	id = payloads->addName(name);
+	nameIds[pid] = id;
+	return id;
+}
+
+/*
+ * This decodes the payload of a scheduler event, together with the names of
+ * its tasks, from the binary fields. False is returned if the fields of the
+ * event are not known, then the arguments need to be formatted instead.
+ */
+bool TraceDat::decodeSched(const TracingData::Format *fmt, const char *data,
+			   unsigned int len, FtraceGrammar *grammar,
+			   SchedPayloads *payloads, TraceEvent &event)
+{
+	SchedPayload &p = payloads->preAlloc();
+	TString names[2];
+
+	if (!tdata.decodeSched(fmt, data, len, event.type, &p, names))
+		return false;
+
+	switch (fmt->kind) {
+	case TracingData::DAT_SCHED_SWITCH:
+		p.sw.oldname = nameId(p.sw.oldpid, &names[0], grammar,
+				      payloads);
+		p.sw.newname = nameId(p.sw.newpid, &names[1], grammar,
+				      payloads);
+		break;
+	case TracingData::DAT_SCHED_WAKEUP:
+	case TracingData::DAT_SCHED_WAKING:
+		p.wakeup.name = nameId(p.wakeup.pid, &names[0], grammar,
+				       payloads);
+		break;
+	default:
+		break;
+	}
+	payloads->commit(event);
+	return true;
+}
+
+/*
+ * This is used when the events are restored from a trace index, which doesn't
+ * contain the payloads of the events with raw arguments. Events without a
+ * payload get SCHED_PAYLOAD_NONE.
+ */
+void TraceDat::decodeRecordAt(int64_t offset, FtraceGrammar *grammar,
+			      SchedPayloads *payloads, TraceEvent &event)
+{
+	const TracingData::Format *fmt;
+	const char *data;
+	unsigned int len;
+
+	if (readRecord(offset, &data, &len) && len >= 2) {
+		fmt = tdata.getFormat(EventField::readUnsigned(data, 2,
+							       tdata.swap));
+		if (fmt != nullptr &&
+		    decodeSched(fmt, data, len, grammar, payloads, event))
+			return;
+	}
+	payloads->add(event, nullptr);
+}
+
+/*
+ * This formats the raw arguments of an event for EventArgs. It only reads the
+ * mapping, so it can be called from any thread. The return value is the
+ * length of the formatted arguments, which are null terminated.
+ */
+int TraceDat::formatArgsAt(int64_t offset, char *buf, int bufSize) const
+{
+	const TracingData::Format *fmt;
+	const char *data;
+	unsigned int len;
+	int n;
+
+	if (bufSize < 1)
+		return 0;
+	buf[0] = '\0';
+	if (!readRecord(offset, &data, &len) || len < 2)
+		return 0;
+	fmt = tdata.getFormat(EventField::readUnsigned(data, 2, tdata.swap));
+	if (fmt == nullptr)
+		return 0;
+	n = tdata.formatArgs(fmt, data, len, buf, bufSize,
+			     TracingData::STYLE_TRACE_CMD);
+	n = TSMAX(0, TSMIN(n, bufSize - 1));
+	buf[n] = '\0';
+	return n;
+}
+
+/*
+ * This merges the events of all CPUs into the events list, in timestamp
+ * order. The watcher is notified every now and then, so that the analyzer can
+ * start to process the events while we are still decoding.
+ */
+void TraceDat::readEvents(FtraceGrammar *grammar,
+			  vtl::TList<TraceEvent> *events,
+			  SchedPayloads *payloads, MemPool *ptrPool,
+			  IndexWatcher *watcher)
+{
+	char line[TRACEDAT_LINE_SIZE];
+	const unsigned long long nsecs = 1000000000ULL;
+	TracingData::Format *fmt;
+	CPUStream *s;
+	unsigned int i;
+	unsigned int id;
+	int len;
+	int nr = 0;
+
+	heap.clear();
+	for (i = 0; i < nrCPUs; i++) {
+		s = &streams[i];
+		if (nextEvent(s))
+			heap.append(s);
+	}
+	for (i = heap.size() / 2; i-- > 0;)
+		heapDown(i);
+
+	while (!heap.isEmpty()) {
+		s = heap[0];
+
+		id = s->len >= 2 ?
+			EventField::readUnsigned(s->data, 2, tdata.swap) : 0;
+		fmt = tdata.getFormat(id);
+		if (fmt != nullptr) {
+			TraceEvent &event = events->preAlloc();
+			event.type = tracingdata_event_type(fmt, grammar);
+			event.cpu = s->cpu;
+			event.setTime(vtl::Time(false, s->ts / nsecs,
+						s->ts % nsecs, 9));
+			event.pid = fmt->pidField != nullptr &&
+				fmt->pidField->offset + 4 <= s->len ?
+				fmt->pidField->getSigned(s->data, tdata.swap) :
+				0;
+			event.taskName = lookupName(event.pid, grammar);
+			event.intArg = 0;
+			event.postEventInfo = nullptr;
+
+			if (decodeSched(fmt, s->data, s->len, grammar,
+					payloads, event)) {
+				event.setRawArgs(s->record - map);
+			} else if (event.type >= EVENT_UNKNOWN) {
+				event.setRawArgs(s->record - map);
+				payloads->add(event, nullptr);
+			} else {
+				event.argc = 0;
+				event.argv = (const TString**)
+					ptrPool->preallocN(EVENT_MAX_NR_ARGS);
+				len = tdata.formatArgs(
+					fmt, s->data, s->len, line,
+					sizeof(line),
+					TracingData::STYLE_TRACE_CMD);
+				tracingdata_split_args(grammar, line, len,
+						       event);
+				ptrPool->commitN(event.argc);
+				payloads->decode(TRACE_TYPE_FTRACE, event);
+			}
+			events->commit();
+			nr++;
+			if ((nr % TRACEDAT_BATCH) == 0)
+				watcher->sendNextIndex(events->size());
+		}
+
+		if (nextEvent(s)) {
+			heapDown(0);
+		} else {
+			heap[0] = heap.last();
+			heap.removeLast();
+			if (!heap.isEmpty())
+				heapDown(0);
+		}
+	}
+}
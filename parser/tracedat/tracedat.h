@@ -0,0 +1,142 @@
+// SPDX-License-Identifier: (GPL-2.0-or-later OR BSD-2-Clause)
+/*
+ * Traceshark - a visualizer for visualizing ftrace and perf traces
+ * Copyright (C) 2019  Viktor Rosendahl <viktor.rosendahl@gmail.com>
+ *
+ * This file is dual licensed: you can use it either under the terms of
+ * the GPL, or the BSD license, at your option.
+ *
+ *  a) This program is free software; you can redistribute it and/or
+ *     modify it under the terms of the GNU General Public License as
+ *     published by the Free Software Foundation; either version 2 of the
+ *     License, or (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public
+ *     License along with this library; if not, write to the Free
+ *     Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ *     MA 02110-1301 USA
+ *
+ * Alternatively,
+ *
+ *  b) Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *     1. Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *     2. Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *     CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *     INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *     MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *     DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *     CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *     NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *     LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *     HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *     CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ *     OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *     EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TRACEDAT_H
+#define TRACEDAT_H
+
+#include <cstdint>
+
+#include <QMap>
+#include <QVector>
+
+#include "parser/tracedat/tracingdata.h"
+#include "parser/traceevent.h"
+#include "misc/tstring.h"
+#include "vtl/compiler.h"
+
+class DataCursor;
+class FtraceGrammar;
+class IndexWatcher;
+class MemPool;
+class SchedPayloads;
+namespace vtl {
+	template<class T> class TList;
+}
+
+#define TRACEDAT_MAGIC_SIZE TRACINGDATA_MAGIC_SIZE
+
+/*
+ * A reader for the binary trace.dat files that are produced by trace-cmd
+ * record. The file is expected to be mapped into memory as a whole, the
+ * per-CPU ring buffer pages are decoded in place and merged by timestamp into
+ * TraceEvent objects. The payloads of the scheduler events and the names of
+ * their tasks are decoded directly from the binary fields. These events, and
+ * the events that traceshark doesn't know, get raw arguments, which are only
+ * formatted by EventArgs when they are displayed. The arguments of the other
+ * events are formatted in the same way as trace-cmd report would print them,
+ * so that the rest of traceshark can treat them as parsed ftrace text.
+ */
+class TraceDat
+{
+public:
+	TraceDat(const char *map, int64_t size);
+	static bool isTraceDat(const char *header, int64_t len);
+	int readHeaders();
+	void readEvents(FtraceGrammar *grammar,
+			vtl::TList<TraceEvent> *events,
+			SchedPayloads *payloads, MemPool *ptrPool,
+			IndexWatcher *watcher);
+	void decodeRecordAt(int64_t offset, FtraceGrammar *grammar,
+			    SchedPayloads *payloads, TraceEvent &event);
+	int formatArgsAt(int64_t offset, char *buf, int bufSize) const;
+private:
+	/* The state of the decoding of the data of one CPU */
+	class CPUStream {
+	public:
+		unsigned int cpu;
+		int64_t offset;
+		int64_t end;
+		const char *next;
+		const char *dataEnd;
+		uint64_t ts;
+		/* The current event, record is its header */
+		const char *record;
+		const char *data;
+		unsigned int len;
+	};
+
+	__always_inline uint32_t read32(const char *ptr) const;
+	bool readOptions(DataCursor *cursor);
+	bool loadPage(CPUStream *s);
+	bool nextEvent(CPUStream *s);
+	void heapDown(int i);
+	bool readRecord(int64_t offset, const char **data,
+			unsigned int *len) const;
+	const TString *lookupName(int pid, FtraceGrammar *grammar);
+	int nameId(int pid, const TString *comm, FtraceGrammar *grammar,
+		   SchedPayloads *payloads);
+	bool decodeSched(const TracingData::Format *fmt, const char *data,
+			 unsigned int len, FtraceGrammar *grammar,
+			 SchedPayloads *payloads, TraceEvent &event);
+
+	const char *map;
+	int64_t size;
+	unsigned int nrCPUs;
+	TracingData tdata;
+	QMap<int, const TString*> names;
+	/* The name id of the latest name of every pid in the payloads */
+	QMap<int, int> nameIds;
+	QVector<CPUStream> streams;
+	QVector<CPUStream*> heap;
+};
+
+#endif /* TRACEDAT_H */
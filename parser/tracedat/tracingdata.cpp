@@ -0,0 +1,678 @@
+// SPDX-License-Identifier: (GPL-2.0-or-later OR BSD-2-Clause)
+/*
+ * Traceshark - a visualizer for visualizing ftrace and perf traces
+ * Copyright (C) 2019  Viktor Rosendahl <viktor.rosendahl@gmail.com>
+ *
+ * This file is dual licensed: you can use it either under the terms of
+ * the GPL, or the BSD license, at your option.
+ *
+ *  a) This program is free software; you can redistribute it and/or
+ *     modify it under the terms of the GNU General Public License as
+ *     published by the Free Software Foundation; either version 2 of the
+ *     License, or (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public
+ *     License along with this library; if not, write to the Free
+ *     Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ *     MA 02110-1301 USA
+ *
+ * Alternatively,
+ *
+ *  b) Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *     1. Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *     2. Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *     CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *     INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *     MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *     DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *     CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *     NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *     LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *     HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *     CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ *     OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *     EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "parser/datacursor.h"
+#include "parser/paramhelpers.h"
+#include "parser/schedpayload.h"
+#include "parser/tracedat/tracingdata.h"
+#include "misc/errors.h"
+#include "misc/traceshark.h"
+
+#define TRACINGDATA_MAGIC "\x17\x08\x44tracing"
+#define TRACEDAT_VERSION (6)
+#define TRACINGDATA_MAX_ID (65535)
+
+#define arraylen(A) (sizeof(A) / sizeof(A[0]))
+
+static const struct {
+	const char *name;
+	TracingData::datkind_t kind;
+	int nrRequired;
+	const char *fields[TRACINGDATA_MAX_FIELDS];
+} knownEvents[] = {
+	{ "sched_switch", TracingData::DAT_SCHED_SWITCH, 7,
+	  { "prev_comm", "prev_pid", "prev_prio", "prev_state", "next_comm",
+	    "next_pid", "next_prio" } },
+	{ "sched_wakeup", TracingData::DAT_SCHED_WAKEUP, 4,
+	  { "comm", "pid", "prio", "target_cpu", "success" } },
+	{ "sched_wakeup_new", TracingData::DAT_SCHED_WAKEUP, 4,
+	  { "comm", "pid", "prio", "target_cpu", "success" } },
+	{ "sched_waking", TracingData::DAT_SCHED_WAKING, 4,
+	  { "comm", "pid", "prio", "target_cpu" } },
+	{ "sched_migrate_task", TracingData::DAT_SCHED_MIGRATE, 5,
+	  { "comm", "pid", "prio", "orig_cpu", "dest_cpu" } },
+	{ "sched_process_fork", TracingData::DAT_SCHED_FORK, 4,
+	  { "parent_comm", "parent_pid", "child_comm", "child_pid" } },
+	{ "sched_process_exit", TracingData::DAT_SCHED_EXIT, 3,
+	  { "comm", "pid", "prio" } },
+	{ "cpu_frequency", TracingData::DAT_CPU_STATE, 2,
+	  { "state", "cpu_id" } },
+	{ "cpu_idle", TracingData::DAT_CPU_STATE, 2,
+	  { "state", "cpu_id" } },
+	{ "irq_handler_entry", TracingData::DAT_IRQ_ENTRY, 2,
+	  { "irq", "name" } },
+	{ "irq_handler_exit", TracingData::DAT_IRQ_EXIT, 2,
+	  { "irq", "ret" } },
+};
+
+/*
+ * This is used if the print fmt of sched_switch doesn't contain a table of
+ * the states, these are the values of Linux 4.7.2.
+ */
+static const struct {
+	uint64_t value;
+	char name;
+} defaultStates[] = {
+	{ TASK_FLAG_INTERRUPTIBLE, TASK_CHAR_INTERRUPTIBLE },
+	{ TASK_FLAG_UNINTERRUPTIBLE, TASK_CHAR_UNINTERRUPTIBLE },
+	{ TASK_FLAG_STOPPED, TASK_CHAR_STOPPED },
+	{ TASK_FLAG_TRACED, TASK_CHAR_TRACED },
+	{ TASK_FLAG_EXIT_DEAD, TASK_CHAR_EXIT_DEAD },
+	{ TASK_FLAG_EXIT_ZOMBIE, TASK_CHAR_EXIT_ZOMBIE },
+	{ TASK_FLAG_DEAD, TASK_CHAR_DEAD },
+	{ TASK_FLAG_WAKEKILL, TASK_CHAR_WAKEKILL },
+	{ TASK_FLAG_WAKING, TASK_CHAR_WAKING },
+	{ TASK_FLAG_PARKED, TASK_CHAR_PARKED },
+	{ TASK_FLAG_NOLOAD, TASK_CHAR_NOLOAD },
+};
+
+#define DEFAULT_PREEMPT_FLAG (2048)
+
+TracingData::TracingData()
+	: version(0), swap(false), bigEndian(false), pageSize(0),
+	  preemptFlag(DEFAULT_PREEMPT_FLAG)
+{}
+
+TracingData::~TracingData()
+{
+	int i;
+
+	for (i = 0; i < formats.size(); i++)
+		delete formats[i];
+}
+
+bool TracingData::isTracingData(const char *header, int64_t len)
+{
+	return len >= TRACINGDATA_MAGIC_SIZE &&
+		memcmp(header, TRACINGDATA_MAGIC, TRACINGDATA_MAGIC_SIZE) == 0;
+}
+
+/*
+ * trace-cmd writes the version as "6", while perf uses "0.5" or "0.6". The
+ * saved cmdlines are present in trace.dat files and since 0.6 in perf.data
+ * files.
+ */
+int TracingData::parse(DataCursor *c)
+{
+	const char *ptr;
+	const char *ver;
+	const char *system;
+	int64_t len;
+	uint32_t count, nrSystems;
+	uint32_t n, i, j;
+	uint64_t size64;
+	bool hasCmdlines;
+
+	if (!c->getBytes(TRACINGDATA_MAGIC_SIZE, &ptr) ||
+	    !isTracingData(ptr, TRACINGDATA_MAGIC_SIZE))
+		return -TS_ERROR_FILEFORMAT;
+	if (!c->getString(&ver, &len))
+		return -TS_ERROR_FILEFORMAT;
+	if (memchr(ver, '.', len) != nullptr) {
+		version = 0;
+		hasCmdlines = strtod(ver, nullptr) >= 0.6;
+	} else {
+		version = atoi(ver);
+		if (version > TRACEDAT_VERSION)
+			return -TS_ERROR_NEWFORMAT;
+		if (version < TRACEDAT_VERSION)
+			return -TS_ERROR_FILEFORMAT;
+		hasCmdlines = true;
+	}
+
+	/* The endianess byte and the size of long */
+	if (!c->getBytes(2, &ptr))
+		return -TS_ERROR_FILEFORMAT;
+	bigEndian = ptr[0] != 0;
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	swap = !bigEndian;
+#else
+	swap = bigEndian;
+#endif
+	c->swap = swap;
+	if (!c->get32(&pageSize) || pageSize == 0)
+		return -TS_ERROR_FILEFORMAT;
+
+	if (!readHeaderPage(c))
+		return -TS_ERROR_FILEFORMAT;
+	if (!c->expectString("header_event") || !c->get64(&size64) ||
+	    !c->getBytes(size64, &ptr))
+		return -TS_ERROR_FILEFORMAT;
+
+	/* The formats of ftrace's own events, such as function and print */
+	if (!c->get32(&count))
+		return -TS_ERROR_FILEFORMAT;
+	for (i = 0; i < count; i++) {
+		if (!readFormat(c, "ftrace"))
+			return -TS_ERROR_FILEFORMAT;
+	}
+
+	/* The formats of the events, grouped by system */
+	if (!c->get32(&nrSystems))
+		return -TS_ERROR_FILEFORMAT;
+	for (i = 0; i < nrSystems; i++) {
+		if (!c->getString(&system, &len) || !c->get32(&count))
+			return -TS_ERROR_FILEFORMAT;
+		for (j = 0; j < count; j++) {
+			if (!readFormat(c, system))
+				return -TS_ERROR_FILEFORMAT;
+		}
+	}
+
+	/* kallsyms and printk formats, which we don't need */
+	if (!c->get32(&n) || !c->getBytes(n, &ptr))
+		return -TS_ERROR_FILEFORMAT;
+	if (!c->get32(&n) || !c->getBytes(n, &ptr))
+		return -TS_ERROR_FILEFORMAT;
+
+	if (hasCmdlines) {
+		if (!c->get64(&size64) || !readCmdlines(c, size64))
+			return -TS_ERROR_FILEFORMAT;
+	}
+	return 0;
+}
+
+bool TracingData::readHeaderPage(DataCursor *c)
+{
+	QVector<EventField> fields;
+	const char *ptr;
+	uint64_t len;
+	int i;
+	bool ts = false, commit = false, data = false;
+
+	if (!c->expectString("header_page") || !c->get64(&len) ||
+	    !c->getBytes(len, &ptr))
+		return false;
+	if (!EventFormat::parseFields(ptr, len, fields))
+		return false;
+	for (i = 0; i < fields.size(); i++) {
+		const EventField &f = fields[i];
+		if (f.name == "timestamp") {
+			pageTs = f;
+			ts = true;
+		} else if (f.name == "commit") {
+			pageCommit = f;
+			commit = true;
+		} else if (f.name == "data") {
+			pageData = f;
+			data = true;
+		}
+	}
+	return ts && commit && data && pageData.offset < pageSize;
+}
+
+bool TracingData::readFormat(DataCursor *c, const char *system)
+{
+	const char *ptr;
+	uint64_t len;
+	Format *fmt;
+
+	if (!c->get64(&len) || !c->getBytes(len, &ptr))
+		return false;
+	fmt = new Format;
+	/* We simply ignore the formats that we don't understand */
+	if (!fmt->format.parse(ptr, len) || fmt->format.id < 0 ||
+	    fmt->format.id > TRACINGDATA_MAX_ID) {
+		delete fmt;
+		return true;
+	}
+	fmt->format.system = system;
+	classifyFormat(fmt);
+	formats.append(fmt);
+	if (formatById.size() <= fmt->format.id)
+		formatById.resize(fmt->format.id + 1);
+	formatById[fmt->format.id] = fmt;
+	return true;
+}
+
+/* The saved cmdlines consists of lines like "1234 bash" */
+bool TracingData::readCmdlines(DataCursor *cursor, int64_t len)
+{
+	const char *ptr;
+	const char *end;
+	const char *c;
+	const char *eol;
+	TString name;
+	int pid;
+
+	if (!cursor->getBytes(len, &ptr))
+		return false;
+	end = ptr + len;
+	for (c = ptr; c < end; c = eol + 1) {
+		eol = (const char*) memchr(c, '\n', end - c);
+		if (eol == nullptr)
+			eol = end;
+		pid = 0;
+		while (c < eol && *c >= '0' && *c <= '9') {
+			pid = pid * 10 + (*c - '0');
+			c++;
+		}
+		if (c >= eol || *c != ' ')
+			continue;
+		c++;
+		name.ptr = (char*) c;
+		name.len = eol - c;
+		cmdlines[pid] = name;
+	}
+	return true;
+}
+
+void TracingData::classifyFormat(Format *fmt)
+{
+	unsigned int i;
+	int j;
+
+	fmt->kind = DAT_GENERIC;
+	fmt->typeValid = false;
+	fmt->type = EVENT_ERROR;
+	fmt->pidField = fmt->format.findField("common_pid");
+	for (j = 0; j < TRACINGDATA_MAX_FIELDS; j++)
+		fmt->fields[j] = nullptr;
+
+	for (i = 0; i < arraylen(knownEvents); i++) {
+		if (fmt->format.name != knownEvents[i].name)
+			continue;
+		for (j = 0; j < TRACINGDATA_MAX_FIELDS &&
+			     knownEvents[i].fields[j] != nullptr; j++) {
+			fmt->fields[j] = fmt->format.findField(
+				knownEvents[i].fields[j]);
+			if (fmt->fields[j] == nullptr &&
+			    j < knownEvents[i].nrRequired)
+				return;
+		}
+		fmt->kind = knownEvents[i].kind;
+		if (fmt->kind == DAT_SCHED_SWITCH)
+			parseStateFlags(fmt->format.printFmt);
+		return;
+	}
+}
+
+/*
+ * The print fmt of sched_switch contains a table of the task states, which
+ * looks like this:
+ *	__print_flags(REC->prev_state & ((((0x0000 | 0x0001 | ...) + 1) << 1)
+ *	- 1), "|", { 0x0001, "S" }, { 0x0002, "D" }, ...)
+ * The bit after the highest state is the preemption flag.
+ */
+void TracingData::parseStateFlags(const QByteArray &printFmt)
+{
+	const char *c = printFmt.constData();
+	const char *end = c + printFmt.size();
+	const char *q;
+	char *e;
+	StateFlag flag;
+	TString str;
+	uint64_t maxFlag = 0;
+
+	stateFlags.clear();
+	c = strstr(c, "__print_flags(");
+	if (c == nullptr)
+		return;
+	while (c < end) {
+		c = (const char*) memchr(c, '{', end - c);
+		if (c == nullptr)
+			break;
+		c++;
+		flag.value = strtoull(c, &e, 0);
+		q = (const char*) memchr(e, '"', end - e);
+		if (q == nullptr || q + 2 >= end || e == c)
+			break;
+		flag.name = q[1];
+		c = q + 2;
+		if (flag.value == 0)
+			continue;
+		str.ptr = &flag.name;
+		str.len = 1;
+		flag.state = __sched_state_from_tstring(&str);
+		stateFlags.append(flag);
+		maxFlag = TSMAX(maxFlag, flag.value);
+	}
+	if (maxFlag != 0)
+		preemptFlag = maxFlag << 1;
+}
+
+int TracingData::formatState(uint64_t state, char *buf, int bufSize)
+	const
+{
+	int n = 0;
+	int i;
+	bool any = false;
+
+	if (bufSize < 4)
+		return 0;
+	if (stateFlags.isEmpty()) {
+		for (i = 0; i < (int) arraylen(defaultStates); i++) {
+			if ((state & defaultStates[i].value) == 0)
+				continue;
+			if (n + 3 >= bufSize)
+				break;
+			if (any)
+				buf[n++] = TASK_CHAR_SEPARATOR;
+			buf[n++] = defaultStates[i].name;
+			any = true;
+		}
+	} else {
+		for (i = 0; i < stateFlags.size(); i++) {
+			if ((state & stateFlags[i].value) == 0)
+				continue;
+			if (n + 3 >= bufSize)
+				break;
+			if (any)
+				buf[n++] = TASK_CHAR_SEPARATOR;
+			buf[n++] = stateFlags[i].name;
+			any = true;
+		}
+	}
+	if (!any)
+		buf[n++] = TASK_SCHAR_RUNNABLE;
+	if (state & preemptFlag)
+		buf[n++] = TASK_CHAR_PREEMPT;
+	buf[n] = '\0';
+	return n;
+}
+
+/*
+ * This gives the same state as formatState() followed by
+ * __sched_state_from_tstring() would, without going through the string.
+ */
+taskstate_t TracingData::decodeState(uint64_t state) const
+{
+	taskstate_t tstate = TASK_STATE_RUNNABLE;
+	int i;
+
+	if (stateFlags.isEmpty()) {
+		for (i = 0; i < (int) arraylen(defaultStates); i++) {
+			if ((state & defaultStates[i].value) != 0)
+				tstate |= defaultStates[i].value;
+		}
+	} else {
+		for (i = 0; i < stateFlags.size(); i++) {
+			if ((state & stateFlags[i].value) == 0)
+				continue;
+			if (stateFlags[i].state == TASK_STATE_PARSER_ERROR)
+				return TASK_STATE_PARSER_ERROR;
+			tstate |= stateFlags[i].state;
+		}
+	}
+	if (state & preemptFlag)
+		tstate |= TASK_FLAG_PREEMPT;
+	return tstate;
+}
+
+/*
+ * This formats the arguments of an event in the same way as trace-cmd report
+ * or perf script prints them, because that is what the ftrace_* and perf_*
+ * accessors expect. The two only differ for sched_switch and sched_wakeup,
+ * for which trace-cmd has formats of its own.
+ */
+int TracingData::formatArgs(const Format *fmt, const char *data,
+			    unsigned int len, char *buf, int bufSize,
+			    argstyle_t style) const
+{
+	const EventField *const *f = fmt->fields;
+	TString s1, s2;
+	char state[64];
+	int n = 0;
+	int r;
+	int i;
+
+	switch (fmt->kind) {
+	case DAT_SCHED_SWITCH:
+		if (!f[0]->getString(data, len, swap, &s1) ||
+		    !f[4]->getString(data, len, swap, &s2))
+			return 0;
+		formatState(f[3]->getUnsigned(data, swap), state,
+			    sizeof(state));
+		return snprintf(buf, bufSize, style == STYLE_PERF ?
+				"prev_comm=%.*s prev_pid=%lld prev_prio=%lld "
+				"prev_state=%s ==> next_comm=%.*s "
+				"next_pid=%lld next_prio=%lld" :
+				"%.*s:%lld [%lld] %s ==> %.*s:%lld [%lld]",
+				(int) s1.len, s1.ptr,
+				(long long) f[1]->getSigned(data, swap),
+				(long long) f[2]->getSigned(data, swap), state,
+				(int) s2.len, s2.ptr,
+				(long long) f[5]->getSigned(data, swap),
+				(long long) f[6]->getSigned(data, swap));
+	case DAT_SCHED_WAKEUP:
+		if (!f[0]->getString(data, len, swap, &s1))
+			return 0;
+		if (style == STYLE_TRACE_CMD)
+			return snprintf(buf, bufSize, "%.*s:%lld [%lld] "
+					"success=%d CPU:%03lld", (int) s1.len,
+					s1.ptr,
+					(long long) f[1]->getSigned(data, swap),
+					(long long) f[2]->getSigned(data, swap),
+					f[4] != nullptr ?
+					(int) f[4]->getSigned(data, swap) : 1,
+					(long long) f[3]->getSigned(data, swap));
+		if (f[4] != nullptr)
+			return snprintf(buf, bufSize, "comm=%.*s pid=%lld "
+					"prio=%lld success=%d "
+					"target_cpu=%03lld", (int) s1.len,
+					s1.ptr,
+					(long long) f[1]->getSigned(data, swap),
+					(long long) f[2]->getSigned(data, swap),
+					(int) f[4]->getSigned(data, swap),
+					(long long) f[3]->getSigned(data, swap));
+		ts_fallthrough;
+	case DAT_SCHED_WAKING:
+		if (!f[0]->getString(data, len, swap, &s1))
+			return 0;
+		return snprintf(buf, bufSize, "comm=%.*s pid=%lld prio=%lld "
+				"target_cpu=%03lld", (int) s1.len, s1.ptr,
+				(long long) f[1]->getSigned(data, swap),
+				(long long) f[2]->getSigned(data, swap),
+				(long long) f[3]->getSigned(data, swap));
+	case DAT_SCHED_MIGRATE:
+		if (!f[0]->getString(data, len, swap, &s1))
+			return 0;
+		return snprintf(buf, bufSize, "comm=%.*s pid=%lld prio=%lld "
+				"orig_cpu=%lld dest_cpu=%lld", (int) s1.len,
+				s1.ptr, (long long) f[1]->getSigned(data, swap),
+				(long long) f[2]->getSigned(data, swap),
+				(long long) f[3]->getSigned(data, swap),
+				(long long) f[4]->getSigned(data, swap));
+	case DAT_SCHED_FORK:
+		if (!f[0]->getString(data, len, swap, &s1) ||
+		    !f[2]->getString(data, len, swap, &s2))
+			return 0;
+		return snprintf(buf, bufSize, "comm=%.*s pid=%lld "
+				"child_comm=%.*s child_pid=%lld", (int) s1.len,
+				s1.ptr, (long long) f[1]->getSigned(data, swap),
+				(int) s2.len, s2.ptr,
+				(long long) f[3]->getSigned(data, swap));
+	case DAT_SCHED_EXIT:
+		if (!f[0]->getString(data, len, swap, &s1))
+			return 0;
+		return snprintf(buf, bufSize, "comm=%.*s pid=%lld prio=%lld",
+				(int) s1.len, s1.ptr,
+				(long long) f[1]->getSigned(data, swap),
+				(long long) f[2]->getSigned(data, swap));
+	case DAT_CPU_STATE:
+		/* cpu_idle prints the signed state as an unsigned */
+		return snprintf(buf, bufSize, "state=%u cpu_id=%u",
+				(unsigned int) f[0]->getUnsigned(data, swap),
+				(unsigned int) f[1]->getUnsigned(data, swap));
+	case DAT_IRQ_ENTRY:
+		if (!f[1]->getString(data, len, swap, &s1))
+			return 0;
+		return snprintf(buf, bufSize, "irq=%lld name=%.*s",
+				(long long) f[0]->getSigned(data, swap),
+				(int) s1.len, s1.ptr);
+	case DAT_IRQ_EXIT:
+		return snprintf(buf, bufSize, "irq=%lld ret=%s",
+				(long long) f[0]->getSigned(data, swap),
+				f[1]->getSigned(data, swap) ?
+				"handled" : "unhandled");
+	default:
+		break;
+	}
+
+	/* The generic case, print all fields that are not common as a=b */
+	for (i = fmt->format.nrCommonFields; i < fmt->format.fields.size();
+	     i++) {
+		const EventField &field = fmt->format.fields[i];
+		if (field.offset + (field.isDataLoc ? 4 : field.size) > len)
+			continue;
+		if (n >= bufSize - 1)
+			break;
+		if (field.isString) {
+			if (!field.getString(data, len, swap, &s1))
+				continue;
+			r = snprintf(buf + n, bufSize - n, "%s%s=%.*s",
+				     n > 0 ? " " : "", field.name.constData(),
+				     (int) s1.len, s1.ptr);
+		} else if (field.isArray || field.isDataLoc) {
+			r = snprintf(buf + n, bufSize - n, "%s%s=ARRAY",
+				     n > 0 ? " " : "", field.name.constData());
+		} else if (field.isSigned) {
+			r = snprintf(buf + n, bufSize - n, "%s%s=%lld",
+				     n > 0 ? " " : "", field.name.constData(),
+				     (long long) field.getSigned(data, swap));
+		} else {
+			r = snprintf(buf + n, bufSize - n, "%s%s=%llu",
+				     n > 0 ? " " : "", field.name.constData(),
+				     (unsigned long long)
+				     field.getUnsigned(data, swap));
+		}
+		if (r < 0)
+			break;
+		n += r;
+	}
+	return TSMIN(n, bufSize - 1);
+}
+
+/*
+ * This decodes the payload of a scheduler event directly from the binary
+ * fields that are described by the embedded format, rather than from the
+ * formatted arguments. The names of the tasks are returned in names, which
+ * point into data, so that the caller can intern them and store them in the
+ * payload, the name fields of the payload are left as SCHED_NAME_NONE. False
+ * is returned if the event doesn't have a payload that we know the fields of,
+ * or if it's too short for its format.
+ */
+bool TracingData::decodeSched(const Format *fmt, const char *data,
+			      unsigned int len, event_t type, SchedPayload *p,
+			      TString *names) const
+{
+	const EventField *const *f = fmt->fields;
+	int i;
+
+	for (i = 0; i < TRACINGDATA_MAX_FIELDS; i++) {
+		if (f[i] != nullptr && f[i]->offset + f[i]->size > len)
+			return false;
+	}
+
+	switch (fmt->kind) {
+	case DAT_SCHED_SWITCH:
+		if (!f[0]->getString(data, len, swap, &names[0]) ||
+		    !f[4]->getString(data, len, swap, &names[1]))
+			return false;
+		p->sw.oldpid = f[1]->getSigned(data, swap);
+		p->sw.newpid = f[5]->getSigned(data, swap);
+		p->sw.state = decodeState(f[3]->getUnsigned(data, swap));
+		p->sw.oldname = SCHED_NAME_NONE;
+		p->sw.newname = SCHED_NAME_NONE;
+		return true;
+	case DAT_SCHED_WAKEUP:
+	case DAT_SCHED_WAKING:
+		if (!f[0]->getString(data, len, swap, &names[0]))
+			return false;
+		p->wakeup.pid = f[1]->getSigned(data, swap);
+		p->wakeup.prio = f[2]->getSigned(data, swap);
+		p->wakeup.cpu = f[3]->getSigned(data, swap);
+		p->wakeup.success = fmt->kind == DAT_SCHED_WAKING ||
+			f[4] == nullptr || f[4]->getSigned(data, swap) != 0;
+		p->wakeup.name = SCHED_NAME_NONE;
+		return true;
+	case DAT_SCHED_MIGRATE:
+		p->migrate.pid = f[1]->getSigned(data, swap);
+		p->migrate.prio = f[2]->getSigned(data, swap);
+		p->migrate.origCPU = f[3]->getSigned(data, swap);
+		p->migrate.destCPU = f[4]->getSigned(data, swap);
+		return true;
+	case DAT_CPU_STATE:
+		if (type == CPU_FREQUENCY) {
+			p->cpufreq.freq = f[0]->getUnsigned(data, swap);
+			p->cpufreq.cpu = f[1]->getUnsigned(data, swap);
+		} else {
+			p->cpuidle.state = f[0]->getUnsigned(data, swap);
+			p->cpuidle.cpu = f[1]->getUnsigned(data, swap);
+		}
+		return true;
+	default:
+		return false;
+	}
+}
+
+/*
+ * This is for the readers that also format the arguments. The events that we
+ * don't know the fields of are handed over to SchedPayloads::decode().
+ */
+void TracingData::decodePayload(const Format *fmt, const char *data,
+				unsigned int len, tracetype_t ttype,
+				SchedPayloads *payloads,
+				TraceEvent &event) const
+{
+	SchedPayload &p = payloads->preAlloc();
+	TString names[2];
+
+	if (decodeSched(fmt, data, len, event.type, &p, names))
+		payloads->commit(event);
+	else
+		payloads->decode(ttype, event);
+}
@@ -0,0 +1,217 @@
+// SPDX-License-Identifier: (GPL-2.0-or-later OR BSD-2-Clause)
+/*
+ * Traceshark - a visualizer for visualizing ftrace and perf traces
+ * Copyright (C) 2019  Viktor Rosendahl <viktor.rosendahl@gmail.com>
+ *
+ * This file is dual licensed: you can use it either under the terms of
+ * the GPL, or the BSD license, at your option.
+ *
+ *  a) This program is free software; you can redistribute it and/or
+ *     modify it under the terms of the GNU General Public License as
+ *     published by the Free Software Foundation; either version 2 of the
+ *     License, or (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public
+ *     License along with this library; if not, write to the Free
+ *     Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ *     MA 02110-1301 USA
+ *
+ * Alternatively,
+ *
+ *  b) Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *     1. Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *     2. Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *     CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *     INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *     MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *     DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *     CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *     NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *     LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *     HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *     CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ *     OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *     EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TRACINGDATA_H
+#define TRACINGDATA_H
+
+#include <cstdint>
+
+#include <QByteArray>
+#include <QMap>
+#include <QVector>
+
+#include "parser/eventformat.h"
+#include "parser/traceevent.h"
+#include "misc/traceshark.h"
+#include "misc/tstring.h"
+#include "vtl/compiler.h"
+
+class DataCursor;
+class SchedPayload;
+class SchedPayloads;
+
+#define TRACINGDATA_MAGIC_SIZE (10)
+#define TRACINGDATA_MAX_FIELDS (7)
+
+/*
+ * The tracing data is the description of the kernel's ring buffer and of the
+ * events that is found in the beginning of trace.dat files. perf.data files
+ * embed the same data in the HEADER_TRACING_DATA feature section. This class
+ * parses it and formats the raw data of the events into arguments, either the
+ * way that trace-cmd report or the way that perf script prints them.
+ */
+class TracingData
+{
+public:
+	typedef enum {
+		DAT_GENERIC = 0,
+		DAT_SCHED_SWITCH,
+		DAT_SCHED_WAKEUP,
+		DAT_SCHED_WAKING,
+		DAT_SCHED_MIGRATE,
+		DAT_SCHED_FORK,
+		DAT_SCHED_EXIT,
+		DAT_CPU_STATE,
+		DAT_IRQ_ENTRY,
+		DAT_IRQ_EXIT,
+	} datkind_t;
+
+	typedef enum {
+		STYLE_TRACE_CMD = 0,
+		STYLE_PERF,
+	} argstyle_t;
+
+	class Format {
+	public:
+		EventFormat format;
+		datkind_t kind;
+		/* Known fields, in the order given by the knownEvents table */
+		const EventField *fields[TRACINGDATA_MAX_FIELDS];
+		const EventField *pidField;
+		event_t type;
+		bool typeValid;
+	};
+
+	TracingData();
+	~TracingData();
+	static bool isTracingData(const char *header, int64_t len);
+	int parse(DataCursor *cursor);
+	__always_inline Format *getFormat(unsigned int id) const;
+	int formatArgs(const Format *fmt, const char *data, unsigned int len,
+		       char *buf, int size, argstyle_t style) const;
+	bool decodeSched(const Format *fmt, const char *data,
+			 unsigned int len, event_t type, SchedPayload *p,
+			 TString *names) const;
+	void decodePayload(const Format *fmt, const char *data,
+			   unsigned int len, tracetype_t ttype,
+			   SchedPayloads *payloads, TraceEvent &event) const;
+	__always_inline bool getCmdline(int pid, TString *name) const;
+	int version;
+	bool swap;
+	bool bigEndian;
+	unsigned int pageSize;
+	EventField pageTs;
+	EventField pageCommit;
+	EventField pageData;
+private:
+	class StateFlag {
+	public:
+		uint64_t value;
+		char name;
+		/* The TASK_FLAG_* of name */
+		taskstate_t state;
+	};
+	bool readHeaderPage(DataCursor *cursor);
+	bool readFormat(DataCursor *cursor, const char *system);
+	bool readCmdlines(DataCursor *cursor, int64_t size);
+	void classifyFormat(Format *fmt);
+	void parseStateFlags(const QByteArray &printFmt);
+	int formatState(uint64_t state, char *buf, int size) const;
+	taskstate_t decodeState(uint64_t state) const;
+	QVector<Format*> formats;
+	QVector<Format*> formatById;
+	QVector<StateFlag> stateFlags;
+	uint64_t preemptFlag;
+	QMap<int, TString> cmdlines;
+};
+
+__always_inline TracingData::Format *TracingData::getFormat(unsigned int id)
+	const
+{
+	return id < (unsigned int) formatById.size() ? formatById[id] :
+		nullptr;
+}
+
+__always_inline bool TracingData::getCmdline(int pid, TString *name) const
+{
+	if (!cmdlines.contains(pid))
+		return false;
+	*name = cmdlines.value(pid);
+	return true;
+}
+
+/* The event type is looked up once per format and then cached */
+template<class Grammar>
+__always_inline event_t tracingdata_event_type(TracingData::Format *fmt,
+					       Grammar *grammar)
+{
+	TString ename;
+
+	if (!fmt->typeValid) {
+		ename.ptr = (char*) fmt->format.name.constData();
+		ename.len = fmt->format.name.size();
+		fmt->type = grammar->internEventType(&ename);
+		fmt->typeValid = true;
+	}
+	return fmt->type;
+}
+
+/*
+ * This splits the formatted arguments of an event into words, in the same way
+ * as the tokenizer would have done it, and interns them into argv.
+ */
+template<class Grammar>
+__always_inline void tracingdata_split_args(Grammar *grammar, char *line,
+					    int len, TraceEvent &event)
+{
+	TString word;
+	const TString *str;
+	int b, e;
+
+	for (b = 0; b < len && event.argc < EVENT_MAX_NR_ARGS; b = e) {
+		while (b < len && line[b] == ' ')
+			b++;
+		for (e = b; e < len && line[e] != ' '; e++)
+			;
+		if (e == b)
+			break;
+		word.ptr = line + b;
+		word.len = e - b;
+		str = grammar->internArg(&word);
+		if (str == nullptr)
+			break;
+		event.argv[event.argc] = str;
+		event.argc++;
+	}
+}
+
+#endif /* TRACINGDATA_H */
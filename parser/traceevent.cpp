@@ -53,35 +53,6 @@
 #include "parser/traceevent.h"
 #include "mm/stringtree.h"
 
-/* Do not change the order of these without updating the enum in
- * traceevent.h */
-
-static char cpufreqstr[] = "cpu_frequency";
-static char cpuidlestr[] = "cpu_idle";
-static char migratestr[] = "sched_migrate_task";
-static char sswitchstr[] = "sched_switch";
-static char swakeupstr[] = "sched_wakeup";
-static char swaknewstr[] = "sched_wakeup_new";
-static char swakingstr[] = "sched_waking";
-static char sprforkstr[] = "sched_process_fork";
-static char sprexitstr[] = "sched_process_exit";
-static char irqhdlrent[] = "irq_handler_entry";
-static char irqhdlrext[] = "irq_handler_exit";
-
-char *eventstrings[NR_EVENTS] = {
-	cpufreqstr,
-	cpuidlestr,
-	migratestr,
-	sswitchstr,
-	swakeupstr,
-	swaknewstr,
-	swakingstr,
-	sprforkstr,
-	sprexitstr,
-	irqhdlrent,
-	irqhdlrext
-};
-
 StringTree *TraceEvent::stringTree = nullptr;
 
 void TraceEvent::setStringTree(StringTree *sTree)
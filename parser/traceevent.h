@@ -149,6 +149,23 @@ typedef enum {
 
 #define EVENT_UNKNOWN (NR_EVENTS)
 
+/*
+ * The arguments of the events that are not known to the analyzer are not
+ * tokenized during the parsing. For these events, argc is EVENT_ARGS_LAZY and
+ * argOffset and argLen give the position of the arguments in the trace file.
+ * Use EventArgs to access the arguments of an event that may be lazy.
+ *
+ * The events that are known to the analyzer never have lazy arguments, for
+ * them argLen is reused as the payload index, see schedpayload.h.
+ *
+ * The events of binary traces may have raw arguments instead. For them, argc
+ * is EVENT_ARGS_RAW and argOffset is the offset of the binary record of the
+ * event in the trace file, from which EventArgs formats the arguments. Since
+ * argLen is not needed, these events can have a payload.
+ */
+#define EVENT_ARGS_LAZY (-1)
+#define EVENT_ARGS_RAW (-2)
+
 class StringTree;
 class Chunk;
 
@@ -157,11 +174,25 @@ public:
 	const TString *taskName;
 	int pid;
 	unsigned int cpu;
-	vtl::Time time;
+	/*
+	 * The time is stored as nanoseconds and a precision, instead of as a
+	 * vtl::Time, which would take 16 bytes because of the padding after
+	 * its precision field. The precision is packed together with argc.
+	 * Use getTime() and setTime() to access them as a vtl::Time.
+	 */
+	vtl::Time::timeint_t timeNs;
 	int intArg;
 	event_t type;
-	const TString **argv;
-	int argc;
+	union {
+		const TString **argv;
+		int64_t argOffset;
+	};
+	int argc : 28;
+	unsigned int timePrecision : 4;
+	union {
+		int argLen;
+		int payload;
+	};
 
 	/*
 	 * postEventInfo most likely will contain a backtrace that will occur
@@ -172,6 +203,13 @@ public:
 	 */
 	Chunk *postEventInfo;
 
+	__always_inline vtl::Time getTime() const;
+	__always_inline void setTime(const vtl::Time &time);
+	__always_inline bool hasLazyArgs() const;
+	__always_inline void setLazyArgs(int64_t offset, int len);
+	__always_inline bool hasRawArgs() const;
+	__always_inline void setRawArgs(int64_t offset);
+	__always_inline bool hasArgv() const;
 	const TString *getEventName() const;
 	static const TString *getEventName(event_t event);
 	static void setStringTree(StringTree *sTree);
@@ -184,6 +222,63 @@ private:
 	static StringTree *stringTree;
 };
 
-extern char *eventstrings[];
+__always_inline vtl::Time TraceEvent::getTime() const
+{
+	return vtl::Time(false, 0, timeNs, timePrecision);
+}
+
+__always_inline void TraceEvent::setTime(const vtl::Time &time)
+{
+	timeNs = time.toNanoseconds();
+	timePrecision = time.getPrecision();
+}
+
+__always_inline bool TraceEvent::hasLazyArgs() const
+{
+	return argc == EVENT_ARGS_LAZY;
+}
+
+__always_inline void TraceEvent::setLazyArgs(int64_t offset, int len)
+{
+	argOffset = offset;
+	argLen = len;
+	argc = EVENT_ARGS_LAZY;
+}
+
+__always_inline bool TraceEvent::hasRawArgs() const
+{
+	return argc == EVENT_ARGS_RAW;
+}
+
+__always_inline void TraceEvent::setRawArgs(int64_t offset)
+{
+	argOffset = offset;
+	argc = EVENT_ARGS_RAW;
+}
+
+/* Returns false if the arguments are lazy or raw */
+__always_inline bool TraceEvent::hasArgv() const
+{
+	return argc >= 0;
+}
+
+/*
+ * Do not change the order of these without updating the enum above. These are
+ * constexpr, so that the perfect hash in eventhash.h can be generated at
+ * compile time.
+ */
+constexpr const char *const eventstrings[NR_EVENTS] = {
+	"cpu_frequency",
+	"cpu_idle",
+	"sched_migrate_task",
+	"sched_switch",
+	"sched_wakeup",
+	"sched_wakeup_new",
+	"sched_waking",
+	"sched_process_fork",
+	"sched_process_exit",
+	"irq_handler_entry",
+	"irq_handler_exit"
+};
 
 #endif
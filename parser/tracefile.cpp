@@ -74,17 +74,46 @@ __always_inline static int clib_close(int fd)
 	return close(fd);
 }
 
-TraceFile::TraceFile(char *name, int &ts_errno, unsigned int bsize)
-	: fd_is_open(false), bufferSwitch(false), nRead(0), lastBuf(0),
-	  lastPos(0), endOfLine(false), mappedFile(nullptr), fileSize(0)
+/*
+ * If follow is true, then the file is not mapped and the load thread keeps
+ * reading after the end of the file, until stopLoad() is called. The file
+ * may then also be a FIFO or a character device, such as trace_pipe. Loading
+ * starts at startPos in regular files.
+ */
+TraceFile::TraceFile(char *name, int &ts_errno, unsigned int bsize,
+		     unsigned int nrBuf, unsigned int nrReaders, bool follow,
+		     int64_t startPos)
+	: fd_is_open(false), nRead(0), mappedFile(nullptr), loadMapped(false),
+	  mappedLen(0), fileSize(0), compressedFile(nullptr), rawMap(nullptr),
+	  rawMapLen(0), nrBuffers(nrBuf),
+	  classify(CharClass::getClassifier()), callchainChunks(false),
+	  callchainSwap(false)
 {
 	unsigned int i;
+	bool mapped = false;
 
-	fd = open(name, O_RDONLY);
+	/*
+	 * Opening a FIFO for reading would block until there is a writer, so
+	 * in follow mode we open it non blocking and then let the load thread
+	 * wait for data.
+	 */
+	fd = open(name, follow ? O_RDONLY | O_NONBLOCK : O_RDONLY);
 	if (fd >= 0) {
 		fd_is_open = true;
 		fileInfo.saveStat(fd, &ts_errno);
 		fileSize = fileInfo.getFileSize();
+		if (follow) {
+			if (fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) &
+				  ~O_NONBLOCK) != 0 && ts_errno == 0)
+				ts_errno = errno;
+			if (startPos > 0 && ts_errno == 0 &&
+			    lseek(fd, startPos, SEEK_SET) < 0)
+				ts_errno = errno;
+		} else if (ts_errno == 0) {
+			mapped = mapFile();
+		}
+		if (ts_errno == 0)
+			ts_errno = openCompressed(&mapped);
 	} else {
 		if (errno != 0)
 			ts_errno = errno;
@@ -92,38 +121,210 @@ TraceFile::TraceFile(char *name, int &ts_errno, unsigned int bsize)
 			ts_errno = - TS_ERROR_ERROR;
 	}
 
-	for (i = 0; i < NR_BUFFERS; i++) {
-		loadBuffers[i] = new LoadBuffer(bsize);
+	/* The load buffers only need memory of their own if we use read() */
+	loadBuffers = new LoadBuffer*[nrBuffers];
+	for (i = 0; i < nrBuffers; i++) {
+		loadBuffers[i] = new LoadBuffer(bsize, !mapped);
 	}
-	loadThread = new LoadThread(loadBuffers, NR_BUFFERS, fd);
-	/*
-	 * Don't start thread if something failed earlier, we go this far in
-	 * order to avoid problems in the destructor
-	 */
+	loadThread = new LoadThread(loadBuffers, nrBuffers, nrReaders, fd);
+	if (mapped)
+		loadThread->setMapping(mappedFile, fileSize);
+	if (compressedFile != nullptr)
+		loadThread->setCompressedFile(compressedFile);
+	if (follow)
+		loadThread->setFollow(startPos);
 	buffer = (char *) mmap(nullptr, BUFFER_SIZE, PROT_READ | PROT_WRITE,
 			      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
 	if (buffer == MAP_FAILED)
 		mmap_err();
-	if (ts_errno != 0)
-		return;
+}
+
+/*
+ * The loading is started separately, so that the caller has a chance to look
+ * at the beginning of the file first. Binary files are not loaded by the
+ * loadThread at all but decoded directly from the mapping.
+ */
+void TraceFile::startLoad()
+{
 	loadThread->start();
 }
 
+/* The stages of the loading record their waiting time in stats */
+void TraceFile::setStallStats(StallStats *stats)
+{
+	unsigned int i;
+
+	for (i = 0; i < nrBuffers; i++)
+		loadBuffers[i]->setStallStats(stats);
+}
+
+/*
+ * Makes a following load thread stop at the current end of the file.
+ */
+void TraceFile::stopLoad()
+{
+	loadThread->stop();
+}
+
 TraceFile::~TraceFile()
 {
 	unsigned int i;
 	loadThread->wait();
 	delete loadThread;
-	for (i = 0; i < NR_BUFFERS; i++)
+	for (i = 0; i < nrBuffers; i++)
 		delete loadBuffers[i];
+	delete[] loadBuffers;
+	unmapFile();
 	if (munmap(buffer, BUFFER_SIZE) != 0)
 		munmap_err();
 }
 
+/*
+ * Map the whole trace file read only, so that the load buffers can point
+ * directly into the page cache instead of having the data copied with read().
+ * We first reserve an anonymous area that is one page larger than the file
+ * and then map the file on top of it. This way, there is always a zeroed page
+ * after the end of the file, which the tokenizer and the grammars can safely
+ * peek into.
+ */
+bool TraceFile::mapFile()
+{
+	long pagesize = sysconf(_SC_PAGESIZE);
+	char *area;
+	char *m;
+	size_t len;
+
+	if (pagesize <= 0 || fileSize <= 0)
+		return false;
+	/* The file will not fit in our address space */
+	if ((uint64_t) fileSize > (uint64_t) SIZE_MAX - 2 * pagesize)
+		return false;
+	len = ((size_t) fileSize + pagesize - 1) / pagesize * pagesize +
+		pagesize;
+
+	area = (char*) mmap(nullptr, len, PROT_READ,
+			    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (area == MAP_FAILED)
+		return false;
+	m = (char*) mmap(area, fileSize, PROT_READ, MAP_PRIVATE | MAP_FIXED,
+			 fd, 0);
+	if (m == MAP_FAILED) {
+		if (munmap(area, len) != 0)
+			munmap_err();
+		return false;
+	}
+	/* These are only hints, so we don't care if they fail */
+	madvise(m, fileSize, MADV_SEQUENTIAL);
+	madvise(m, fileSize, MADV_WILLNEED);
+
+	mappedFile = m;
+	mappedLen = len;
+	loadMapped = true;
+	return true;
+}
+
+/*
+ * If the file is compressed, then the mapping from mapFile() is handed over to
+ * a CompressedFile and the loading will use the load buffers with memory of
+ * their own, since the decompressed data needs to go somewhere. A compressed
+ * file can only be decompressed from a mapping, so we check the magic with
+ * pread() if the file could not be mapped, in order to be able to give a
+ * proper error.
+ */
+int TraceFile::openCompressed(bool *mapped)
+{
+	char header[COMPRESSED_MAGIC_SIZE];
+	ssize_t n;
+
+	if (!*mapped) {
+		n = pread(fd, header, sizeof(header), 0);
+		if (n > 0 && CompressedFile::getCompression(header, n) !=
+		    COMPRESSION_NONE)
+			return -TS_ERROR_COMPRESSION;
+		return 0;
+	}
+	if (CompressedFile::getCompression(mappedFile, fileSize) ==
+	    COMPRESSION_NONE)
+		return 0;
+
+	compressedFile = new CompressedFile(mappedFile, fileSize);
+	rawMap = mappedFile;
+	rawMapLen = mappedLen;
+	mappedFile = nullptr;
+	mappedLen = 0;
+	loadMapped = false;
+	*mapped = false;
+	return compressedFile->open();
+}
+
+/*
+ * The binary formats are decoded from a mapping of the whole file, so if the
+ * file is compressed, we decompress all of it to an anonymous mapping, which
+ * then replaces the mapping of the file. Like with mapFile(), there is a zeroed
+ * page after the end of the data.
+ */
+int TraceFile::mapDecompressed()
+{
+	long pagesize = sysconf(_SC_PAGESIZE);
+	int64_t size;
+	size_t len;
+	char *m;
+	int r;
+
+	if (compressedFile == nullptr)
+		return -TS_ERROR_INTERNAL;
+	if (loadMapped)
+		return 0;
+	size = compressedFile->getSize();
+	if (size < 0)
+		return -TS_ERROR_DECOMPRESS;
+	if (pagesize <= 0 ||
+	    (uint64_t) size > (uint64_t) SIZE_MAX - 2 * pagesize)
+		return -TS_ERROR_FILE_RESOURCE;
+	len = ((size_t) size + pagesize - 1) / pagesize * pagesize + pagesize;
+
+	m = (char*) mmap(nullptr, len, PROT_READ | PROT_WRITE,
+			 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (m == MAP_FAILED)
+		return -TS_ERROR_FILE_RESOURCE;
+	r = compressedFile->decompressAll(m, size);
+	if (r != 0) {
+		if (munmap(m, len) != 0)
+			munmap_err();
+		return r;
+	}
+
+	mappedFile = m;
+	mappedLen = len;
+	fileSize = size;
+	loadMapped = true;
+	return 0;
+}
+
+void TraceFile::unmapFile()
+{
+	delete compressedFile;
+	compressedFile = nullptr;
+	if (rawMap != nullptr) {
+		if (munmap(rawMap, rawMapLen) != 0)
+			munmap_err();
+		rawMap = nullptr;
+		rawMapLen = 0;
+	}
+	if (!loadMapped)
+		return;
+	if (munmap(mappedFile, mappedLen) != 0)
+		munmap_err();
+	mappedFile = nullptr;
+	mappedLen = 0;
+	loadMapped = false;
+}
+
 void TraceFile::close(int *ts_errno)
 {
 	*ts_errno = 0;
 	freeMmap();
+	unmapFile();
 	if (!fd_is_open)
 		return;
 	fd_is_open = false;
@@ -148,6 +349,12 @@ bool TraceFile::isIntact(int *ts_errno)
 
 bool TraceFile::allocMmap()
 {
+	/* We may already have the file mapped from the loading */
+	if (mappedFile != nullptr)
+		return true;
+	/* The chunks of a compressed file are read from the CompressedFile */
+	if (compressedFile != nullptr)
+		return false;
 	mappedFile = (char*) mmap(nullptr, fileSize, PROT_READ,
 				  MAP_PRIVATE, fd, 0);
 	if (mappedFile == MAP_FAILED) {
@@ -166,37 +373,140 @@ bool TraceFile::allocMmap()
 
 void TraceFile::freeMmap()
 {
-	if (mappedFile == nullptr)
+	/* A mapping from mapFile() is kept until the file is closed */
+	if (mappedFile == nullptr || loadMapped)
 		return;
 	if (munmap(mappedFile, fileSize) != 0)
 		munmap_err();
+	mappedFile = nullptr;
 }
 
-void TraceFile::readChunk(const Chunk *chunk, char *buf, int size,
-			  int *ts_errno)
+/*
+ * This copies the chunk to buf and returns the number of bytes that were
+ * written, which is not more than size.
+ */
+int TraceFile::readChunk(const Chunk *chunk, char *buf, int size,
+			 int *ts_errno)
 {
 	int64_t s;
-	if (mappedFile == nullptr) {
-		readChunk_(chunk, buf, size, ts_errno);
-		return;
-	}
+	if (mappedFile == nullptr)
+		return readChunk_(chunk, buf, size, ts_errno);
+	if (callchainChunks)
+		return formatCallchain(chunk, buf, size);
 	s = TSMIN(size, chunk->len);
 	if (chunk->offset + s > fileSize) {
 		*ts_errno = - TS_ERROR_EOF;
-		return;
+		return 0;
 	}
-	strncpy(buf, mappedFile + chunk->offset, chunk->len);
+	memcpy(buf, mappedFile + chunk->offset, s);
+	return s;
+}
+
+/*
+ * This is like readChunk() but it uses pread(), so that it doesn't disturb
+ * the file position, which is used by the LoadThread while the file is being
+ * loaded. It always copies the text from the file.
+ */
+int TraceFile::readChunkAt(const Chunk *chunk, char *buf, int size,
+			   int *ts_errno)
+{
+	int64_t s = TSMIN(size, chunk->len);
+	char *b = buf;
+	ssize_t r;
+
+	*ts_errno = 0;
+	if (compressedFile != nullptr)
+		return compressedFile->readAt(chunk->offset, buf, s, ts_errno);
+
+	if (mappedFile != nullptr) {
+		if (chunk->offset + s > fileSize) {
+			*ts_errno = - TS_ERROR_EOF;
+			return 0;
+		}
+		memcpy(buf, mappedFile + chunk->offset, s);
+		return s;
+	}
+
+	while (s > 0) {
+		r = pread(fd, b, s, chunk->offset + (b - buf));
+		if (r < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno != 0)
+				*ts_errno = errno;
+			else
+				*ts_errno = - TS_ERROR_ERROR;
+			break;
+		}
+		if (r == 0) {
+			*ts_errno = - TS_ERROR_EOF;
+			break;
+		}
+		b += r;
+		s -= r;
+	}
+	return b - buf;
+}
+
+void TraceFile::setCallchainChunks(bool swap)
+{
+	callchainChunks = true;
+	callchainSwap = swap;
+}
+
+/*
+ * The callchains of the binary perf files are printed like perf script prints
+ * addresses for which it has no symbols.
+ */
+int TraceFile::formatCallchain(const Chunk *chunk, char *buf, int size)
+{
+	/* These are used for context markers, such as PERF_CONTEXT_KERNEL */
+	const uint64_t contextMax = (uint64_t) -4095;
+	const char *ip;
+	const char *end;
+	uint64_t addr;
+	int n = 0;
+	int r;
+
+	if (chunk->offset < 0 || chunk->offset + chunk->len > fileSize)
+		return 0;
+	ip = mappedFile + chunk->offset;
+	end = ip + chunk->len;
+	for (; ip + sizeof(addr) <= end; ip += sizeof(addr)) {
+		memcpy(&addr, ip, sizeof(addr));
+		if (callchainSwap)
+			addr = __builtin_bswap64(addr);
+		if (addr >= contextMax)
+			continue;
+		r = snprintf(buf + n, size - n, "\t%16llx [unknown] "
+			     "([unknown])\n", (unsigned long long) addr);
+		if (r < 0 || r >= size - n)
+			break;
+		n += r;
+	}
+	return n;
 }
 
 QByteArray TraceFile::getChunkArray(const Chunk *chunk, int *ts_errno)
 {
 	char *buf;
 	QByteArray rval;
+	int64_t len;
 
 	if (mappedFile == nullptr) {
 		return getChunkArray_(chunk, ts_errno);
 	}
 
+	if (callchainChunks) {
+		/* Every address takes 8 bytes and a line of 40 characters */
+		len = chunk->len / 8 * 40 + 1;
+		buf = len <= BUFFER_SIZE ? buffer : new char[len];
+		rval = QByteArray(buf, formatCallchain(chunk, buf, len));
+		if (buf != buffer)
+			delete[] buf;
+		return rval;
+	}
+
 	if (chunk->offset + chunk->len > fileSize) {
 		*ts_errno = - TS_ERROR_EOF;
 		return rval;
@@ -64,6 +64,8 @@
 #include "threads/loadbuffer.h"
 #include "threads/threadbuffer.h"
 #include "mm/mempool.h"
+#include "parser/charclass.h"
+#include "parser/compressed/compressedfile.h"
 #include "parser/fileinfo.h"
 #include "parser/traceline.h"
 #include "misc/chunk.h"
@@ -74,154 +76,189 @@ class LoadThread;
 class TraceFile
 {
 public:
-	TraceFile(char *name, int &ts_errno, unsigned int bsize = 1024 * 1024);
+	TraceFile(char *name, int &ts_errno, unsigned int bsize = 1024 * 1024,
+		  unsigned int nrBuf = 4, unsigned int nrReaders = 1,
+		  bool follow = false, int64_t startPos = 0);
 	~TraceFile();
+	void startLoad();
+	void stopLoad();
 	void close(int *ts_errno);
 	__always_inline unsigned int
 		ReadLine(TraceLine *line, ThreadBuffer<TraceLine> *tbuffer);
 	__always_inline bool atEnd() const;
-	__always_inline bool getBufferSwitch() const;
-	__always_inline void clearBufferSwitch();
 	FileInfo fileInfo;
 	__always_inline LoadBuffer *getLoadBuffer(int index) const;
+	__always_inline unsigned int getNrBuffers() const;
 	QByteArray getChunkArray(const Chunk *chunk,
 						 int *ts_errno);
 	bool isIntact(int *ts_errno);
-	void readChunk(const Chunk *chunk, char *buf, int size,
-				       int *ts_errno);
+	int readChunk(const Chunk *chunk, char *buf, int size,
+		      int *ts_errno);
+	int readChunkAt(const Chunk *chunk, char *buf, int size,
+			int *ts_errno);
 	__always_inline int64_t getFileSize();
+	__always_inline const char *getMappedFile() const;
+	void setCallchainChunks(bool swap);
+	__always_inline bool getCallchainChunks(bool *swap) const;
 	bool allocMmap();
 	void freeMmap();
+	__always_inline bool isCompressed() const;
+	void setStallStats(StallStats *stats);
+	int mapDecompressed();
 private:
 	__always_inline QByteArray getChunkArray_(const Chunk *chunk,
 						  int *ts_errno);
-	__always_inline void readChunk_(const Chunk *chunk, char *buf,
-					int size, int *ts_errno);
+	__always_inline int readChunk_(const Chunk *chunk, char *buf,
+				       int size, int *ts_errno);
+	int formatCallchain(const Chunk *chunk, char *buf, int size);
 	__always_inline unsigned int nextBufferIdx(unsigned int n);
-	__always_inline unsigned int
-		ReadNextWord(char **word, ThreadBuffer<TraceLine> *tbuffer);
-	__always_inline bool
-		CheckBufferSwitch(unsigned int pos,
-				  ThreadBuffer<TraceLine> *tbuffer);
+	bool mapFile();
+	void unmapFile();
+	int openCompressed(bool *mapped);
 	int fd;
 	bool fd_is_open;
-	bool bufferSwitch;
 	unsigned int nRead;
-	unsigned lastBuf;
-	unsigned lastPos;
-	bool endOfLine;
 	char *mappedFile;
+	/* This is true if mappedFile was created by mapFile() */
+	bool loadMapped;
+	size_t mappedLen;
 	int64_t fileSize;
-	static const unsigned int NR_BUFFERS = 4;
-	LoadBuffer *loadBuffers[NR_BUFFERS];
+	/*
+	 * If the file is compressed, then rawMap is the mapping of the
+	 * compressed file and the offsets of the loadBuffers and the chunks are
+	 * offsets in the decompressed data.
+	 */
+	CompressedFile *compressedFile;
+	char *rawMap;
+	size_t rawMapLen;
+	unsigned int nrBuffers;
+	LoadBuffer **loadBuffers;
 	LoadThread *loadThread;
+	charclass_fn_t classify;
+	/*
+	 * If this is true, then the chunks are arrays of instruction pointers
+	 * from a binary perf file, rather than text from the file.
+	 */
+	bool callchainChunks;
+	bool callchainSwap;
 	char *buffer;
 	static const int BUFFER_SIZE = 131072;
 };
 
 
-__always_inline bool TraceFile::CheckBufferSwitch(unsigned int pos,
-						  ThreadBuffer<TraceLine>
-						  *tbuffer)
-{
-	LoadBuffer *loadBuffer = tbuffer->loadBuffer;
-	if (unlikely(pos >= loadBuffer->nRead)) {
-		lastPos = 0;
-		bufferSwitch = true;
-		endOfLine = true;
-		return true;
-	}
-	return false;
-}
-
+/*
+ * This function tokenizes the line that begins at tbuffer->tokenPos. Instead
+ * of looking at one character at a time, the buffer is classified in blocks
+ * of CHARCLASS_BLOCK_SIZE bytes, which gives us bitmasks of the spaces and
+ * newlines. From these masks we compute the beginnings and ends of all the
+ * words in the block, so that all words of the line can be emitted in one
+ * pass.
+ */
 __always_inline unsigned int
-TraceFile::ReadNextWord(char **word, ThreadBuffer<TraceLine> *tbuffer)
+TraceFile::ReadLine(TraceLine *line, ThreadBuffer<TraceLine> *tbuffer)
 {
-	unsigned int pos = lastPos;
-	unsigned int nchar = 0;
-	char c;
-	char *buffer = tbuffer->loadBuffer->buffer;
+	const LoadBuffer *loadBuffer = tbuffer->loadBuffer;
+	char *buffer = loadBuffer->buffer;
+	const unsigned int end = loadBuffer->nRead;
+	unsigned int block = tbuffer->tokenPos;
+	unsigned int wordBegin = 0;
+	unsigned int col = 0;
+	unsigned int n;
+	uint64_t spaces, newlines;
+	uint64_t valid, word, begins, ends;
+	uint64_t carry = 0;
+	bool inWord = false;
+	TString *strings;
+
+	strings = (TString*) tbuffer->strPool->preallocN(EVENT_MAX_NR_ARGS);
+	line->strings = strings;
+	line->begin = loadBuffer->filePos + block;
+	line->ptr = buffer + block;
+
+	while (block < end) {
+		classify(buffer + block, &spaces, &newlines);
+		n = end - block;
+		if (n < CHARCLASS_BLOCK_SIZE) {
+			valid = (1ULL << n) - 1;
+			spaces &= valid;
+			newlines &= valid;
+		} else {
+			valid = ~0ULL;
+		}
 
-	if (endOfLine)
-		return 0;
+		word = ~(spaces | newlines) & valid;
+		/* carry is set if a word continues from the previous block */
+		begins = word & ~((word << 1) | carry);
+		/*
+		 * A word ends at the first non word character, this may be the
+		 * first invalid bit, if the word extends to the end of the
+		 * buffer.
+		 */
+		ends = ~word & ((word << 1) | carry);
+
+		/* Nothing after the first newline belongs to this line */
+		if (newlines != 0) {
+			newlines &= -newlines;
+			begins &= newlines - 1;
+			ends &= newlines | (newlines - 1);
+		}
 
-	for (c = buffer[pos]; c == ' '; c = buffer[pos]) {
-		pos++;
-		if (unlikely(CheckBufferSwitch(pos, tbuffer)))
-			return 0;
-	}
+		while (true) {
+			if (!inWord) {
+				if (begins == 0)
+					break;
+				wordBegin = block + __builtin_ctzll(begins);
+				begins &= begins - 1;
+				inWord = true;
+			}
+			if (ends == 0)
+				break;
+			if (likely(col < EVENT_MAX_NR_ARGS)) {
+				strings[col].ptr = buffer + wordBegin;
+				strings[col].len = block + __builtin_ctzll(ends)
+					- wordBegin;
+				col++;
+			}
+			ends &= ends - 1;
+			inWord = false;
+		}
 
-	if (c == '\n') {
-		pos++;
-		if (likely(!CheckBufferSwitch(pos, tbuffer)))
-			lastPos = pos;
-		return 0;
-	}
+		if (newlines != 0) {
+			tbuffer->tokenPos = block + __builtin_ctzll(newlines)
+				+ 1;
+			if (unlikely(tbuffer->tokenPos >= end)) {
+				tbuffer->tokenPos = 0;
+				tbuffer->bufferSwitch = true;
+			}
+			goto out;
+		}
 
-	*word = buffer + pos;
-	pos++;
-
-	while (true) {
-		nchar++;
-		if (unlikely(CheckBufferSwitch(pos, tbuffer)))
-			break;
-		c = buffer[pos];
-		if (c == ' ' || c == '\n')
-			break;
-		pos++;
+		carry = word >> (CHARCLASS_BLOCK_SIZE - 1);
+		block += CHARCLASS_BLOCK_SIZE;
 	}
-	if (c == '\n')
-		endOfLine = true;
+
 	/*
-	 * This can be out otside of the buffer, in case hit the break
-	 * above but we have that spare page
+	 * We ran out of buffer without finding a newline, so the last word
+	 * ends at the end of the buffer.
 	 */
-	buffer[pos] = '\0';
-	pos++;
-	if (unlikely(CheckBufferSwitch(pos, tbuffer)))
-		return nchar;
-	lastPos = pos;
-	return nchar;
-}
-
-__always_inline unsigned int
-TraceFile::ReadLine(TraceLine *line, ThreadBuffer<TraceLine> *tbuffer)
-{
-	unsigned int col;
-	unsigned int n;
-	/* This is a setup needed by ReadNextWord() */
-	endOfLine = false;
-
-	line->strings = (TString*)
-		tbuffer->strPool->preallocN(EVENT_MAX_NR_ARGS);
-	line->begin = tbuffer->loadBuffer->filePos + lastPos;
-
-	for(col = 0; col < EVENT_MAX_NR_ARGS; col++) {
-		n = ReadNextWord(&line->strings[col].ptr, tbuffer);
-		if (n == 0)
-			break;
-		line->strings[col].len = n;
+	if (inWord && col < EVENT_MAX_NR_ARGS) {
+		strings[col].ptr = buffer + wordBegin;
+		strings[col].len = end - wordBegin;
+		col++;
 	}
+	tbuffer->tokenPos = 0;
+	tbuffer->bufferSwitch = true;
+out:
 	if (col > 0)
 		tbuffer->strPool->commitN(col);
 	line->nStrings = col;
 	return col;
 }
 
-__always_inline bool TraceFile::getBufferSwitch() const
-{
-	return bufferSwitch;
-}
-
-__always_inline void TraceFile::clearBufferSwitch()
-{
-	bufferSwitch = false;
-}
-
 __always_inline unsigned int TraceFile::nextBufferIdx(unsigned int n)
 {
 	n++;
-	if (n == NR_BUFFERS)
+	if (n == nrBuffers)
 		n = 0;
 	return n;
 }
@@ -231,6 +268,11 @@ __always_inline LoadBuffer *TraceFile::getLoadBuffer(int index) const
 	return loadBuffers[index];
 }
 
+__always_inline unsigned int TraceFile::getNrBuffers() const
+{
+	return nrBuffers;
+}
+
 __always_inline QByteArray TraceFile::getChunkArray_(const Chunk *chunk,
 						     int *ts_errno)
 {
@@ -246,6 +288,13 @@ __always_inline QByteArray TraceFile::getChunkArray_(const Chunk *chunk,
 		buf = new char[chunk->len];
 	}
 
+	if (compressedFile != nullptr) {
+		if (compressedFile->readAt(chunk->offset, buf, chunk->len,
+					   ts_errno) == chunk->len)
+			rval = QByteArray(buf, chunk->len);
+		goto out;
+	}
+
 	if (lseek64(fd, chunk->offset, SEEK_SET) != chunk->offset) {
 		if (errno != 0)
 			*ts_errno = errno;
@@ -286,19 +335,24 @@ out:
 	return rval;
 }
 
-__always_inline void TraceFile::readChunk_(const Chunk *chunk, char *buf,
-					   int size, int *ts_errno)
+__always_inline int TraceFile::readChunk_(const Chunk *chunk, char *buf,
+					  int size, int *ts_errno)
 {
 	size_t count;
 	char *b;
 	ssize_t r;
 
+	if (compressedFile != nullptr)
+		return compressedFile->readAt(chunk->offset, buf,
+					      TSMIN(chunk->len, size),
+					      ts_errno);
+
 	if (lseek64(fd, chunk->offset, SEEK_SET) != chunk->offset) {
 		if (errno != 0)
 			*ts_errno = errno;
 		else
 			*ts_errno = - TS_ERROR_ERROR;
-		return;
+		return 0;
 	}
 
 	count = TSMIN(chunk->len, size);
@@ -313,21 +367,46 @@ __always_inline void TraceFile::readChunk_(const Chunk *chunk, char *buf,
 				*ts_errno = errno;
 			else
 				*ts_errno = - TS_ERROR_ERROR;
-			return;
+			return b - buf;
 		}
 		if (r == 0) {
 			*ts_errno = - TS_ERROR_EOF;
-			return;
+			return b - buf;
 		}
 		b += r;
 		count -= r;
 	}
 	*ts_errno = 0;
+	return b - buf;
 }
 
+/*
+ * For a compressed file, this is the size of the decompressed data, which may
+ * need to be decompressed in order to find out the size, unless it has already
+ * been loaded.
+ */
 int64_t TraceFile::getFileSize()
 {
+	if (compressedFile != nullptr && !loadMapped)
+		return compressedFile->getSize();
 	return fileSize;
 }
 
+/* This returns nullptr if the whole file could not be mapped */
+__always_inline const char *TraceFile::getMappedFile() const
+{
+	return loadMapped ? mappedFile : nullptr;
+}
+
+__always_inline bool TraceFile::isCompressed() const
+{
+	return compressedFile != nullptr;
+}
+
+__always_inline bool TraceFile::getCallchainChunks(bool *swap) const
+{
+	*swap = callchainSwap;
+	return callchainChunks;
+}
+
 #endif
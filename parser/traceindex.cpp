@@ -0,0 +1,629 @@
+// SPDX-License-Identifier: (GPL-2.0-or-later OR BSD-2-Clause)
+/*
+ * Traceshark - a visualizer for visualizing ftrace and perf traces
+ * Copyright (C) 2019  Viktor Rosendahl <viktor.rosendahl@gmail.com>
+ *
+ * This file is dual licensed: you can use it either under the terms of
+ * the GPL, or the BSD license, at your option.
+ *
+ *  a) This program is free software; you can redistribute it and/or
+ *     modify it under the terms of the GNU General Public License as
+ *     published by the Free Software Foundation; either version 2 of the
+ *     License, or (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public
+ *     License along with this library; if not, write to the Free
+ *     Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ *     MA 02110-1301 USA
+ *
+ * Alternatively,
+ *
+ *  b) Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *     1. Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *     2. Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *     CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *     INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *     MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *     DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *     CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *     NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *     LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *     HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *     CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ *     OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *     EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstring>
+#include <new>
+
+#include <QByteArray>
+#include <QMap>
+
+#include "parser/genericparams.h"
+#include "parser/indexwriter.h"
+#include "parser/schedpayload.h"
+#include "parser/traceindex.h"
+#include "parser/tracedat/tracedat.h"
+#include "mm/mempool.h"
+#include "mm/stringtree.h"
+#include "misc/chunk.h"
+#include "misc/errors.h"
+#include "threads/indexwatcher.h"
+#include "vtl/error.h"
+#include "vtl/tlist.h"
+
+extern "C" {
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+}
+
+#define TRACEINDEX_MAGIC "TSIDX\0\0\0"
+#define TRACEINDEX_MAGIC_SIZE (8)
+/* This needs to be bumped if the grammars start to produce other events */
+#define TRACEINDEX_VERSION (3)
+#define TRACEINDEX_BYTE_ORDER (0x01020304)
+#define TRACEINDEX_ALIGN INDEXWRITER_ALIGN
+#define TRACEINDEX_NO_STRING UINT32_MAX
+/* The argLen of an event with raw arguments, argOffset is then the record */
+#define TRACEINDEX_RAW_ARGS (-2)
+
+enum {
+	SECTION_EVENTNAMES = 0,
+	SECTION_TASKNAMES,
+	SECTION_ARGS,
+	SECTION_TIME,
+	SECTION_PRECISION,
+	SECTION_CPU,
+	SECTION_PID,
+	SECTION_TYPE,
+	SECTION_INTARG,
+	SECTION_TASKNAME,
+	SECTION_ARGC,
+	SECTION_ARGV,
+	SECTION_POSTOFFSET,
+	SECTION_POSTLEN,
+	SECTION_ARGOFFSET,
+	SECTION_ARGLEN,
+	NR_SECTIONS
+};
+
+class IndexSection {
+public:
+	uint64_t offset;
+	uint64_t size;
+};
+
+/* All fields are stored in the byte order of the machine */
+class IndexHeader {
+public:
+	char magic[TRACEINDEX_MAGIC_SIZE];
+	uint32_t version;
+	uint32_t byteOrder;
+	uint32_t traceType;
+	uint32_t flags;
+	FileStamp stamp;
+	uint64_t nrEvents;
+	uint64_t nrArgs;
+	IndexSection sections[NR_SECTIONS];
+};
+
+__always_inline static int clib_open(const char *pathname, int flags)
+{
+	return open(pathname, flags);
+}
+
+__always_inline static int clib_close(int fd)
+{
+	return close(fd);
+}
+
+__always_inline static int errno_or(int error)
+{
+	return errno != 0 ? errno : error;
+}
+
+TraceIndex::TraceIndex()
+	: map(nullptr), mapSize(0), traceType(TRACE_TYPE_UNKNOWN), flags(0),
+	  nrEvents(0), nrArgs(0)
+{
+	memset(&eventNames, 0, sizeof(eventNames));
+	memset(&taskNames, 0, sizeof(taskNames));
+	memset(&args, 0, sizeof(args));
+}
+
+TraceIndex::~TraceIndex()
+{
+	close();
+}
+
+/*
+ * This maps the index and checks that it belongs to the trace file that info
+ * describes. Everything that readEvents() depends on is validated here, so
+ * that a broken index can be rejected before any events are produced.
+ */
+int TraceIndex::open(const char *name, const FileInfo *info)
+{
+	const IndexHeader *header;
+	struct stat st;
+	void *m;
+	int fd;
+	int i;
+	int ts_errno;
+
+	if (map != nullptr)
+		return -TS_ERROR_INTERNAL;
+
+	fd = clib_open(name, O_RDONLY);
+	if (fd < 0)
+		return errno_or(-TS_ERROR_OPEN);
+	if (fstat(fd, &st) != 0) {
+		ts_errno = errno_or(-TS_ERROR_FILE_READ);
+		clib_close(fd);
+		return ts_errno;
+	}
+	if (st.st_size < (off_t) sizeof(IndexHeader)) {
+		clib_close(fd);
+		return -TS_ERROR_FILEFORMAT;
+	}
+	m = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	clib_close(fd);
+	if (m == MAP_FAILED)
+		return -TS_ERROR_FILE_RESOURCE;
+	map = (const char*) m;
+	mapSize = st.st_size;
+
+	header = (const IndexHeader*) map;
+	if (memcmp(header->magic, TRACEINDEX_MAGIC,
+		   TRACEINDEX_MAGIC_SIZE) != 0 ||
+	    header->byteOrder != TRACEINDEX_BYTE_ORDER) {
+		ts_errno = -TS_ERROR_FILEFORMAT;
+		goto err;
+	}
+	if (header->version != TRACEINDEX_VERSION) {
+		ts_errno = -TS_ERROR_NEWFORMAT;
+		goto err;
+	}
+	if (!info->cmpStamp(&header->stamp)) {
+		ts_errno = -TS_ERROR_FILECHANGED;
+		goto err;
+	}
+
+	traceType = (tracetype_t) header->traceType;
+	flags = header->flags;
+	nrEvents = header->nrEvents;
+	nrArgs = header->nrArgs;
+	/* The events are indexed with int everywhere */
+	if (!tracetype_is_valid(traceType) || nrEvents > INT32_MAX) {
+		ts_errno = -TS_ERROR_FILEFORMAT;
+		goto err;
+	}
+	for (i = 0; i < NR_SECTIONS; i++) {
+		const IndexSection &s = header->sections[i];
+		if (s.offset % TRACEINDEX_ALIGN != 0 ||
+		    s.offset > (uint64_t) mapSize ||
+		    s.size > (uint64_t) mapSize - s.offset) {
+			ts_errno = -TS_ERROR_FILEFORMAT;
+			goto err;
+		}
+	}
+	if (!setupStringTable(SECTION_EVENTNAMES, &eventNames) ||
+	    !setupStringTable(SECTION_TASKNAMES, &taskNames) ||
+	    !setupStringTable(SECTION_ARGS, &args) ||
+	    getSection(SECTION_TIME, nrEvents, sizeof(int64_t)) == nullptr ||
+	    getSection(SECTION_PRECISION, nrEvents, sizeof(uint8_t)) == nullptr ||
+	    getSection(SECTION_CPU, nrEvents, sizeof(uint32_t)) == nullptr ||
+	    getSection(SECTION_PID, nrEvents, sizeof(int32_t)) == nullptr ||
+	    getSection(SECTION_TYPE, nrEvents, sizeof(int32_t)) == nullptr ||
+	    getSection(SECTION_INTARG, nrEvents, sizeof(int32_t)) == nullptr ||
+	    getSection(SECTION_TASKNAME, nrEvents, sizeof(uint32_t)) == nullptr ||
+	    getSection(SECTION_ARGC, nrEvents, sizeof(uint8_t)) == nullptr ||
+	    getSection(SECTION_ARGV, nrArgs, sizeof(uint32_t)) == nullptr ||
+	    getSection(SECTION_POSTOFFSET, nrEvents, sizeof(int64_t)) == nullptr ||
+	    getSection(SECTION_POSTLEN, nrEvents, sizeof(int32_t)) == nullptr ||
+	    getSection(SECTION_ARGOFFSET, nrEvents, sizeof(int64_t)) == nullptr ||
+	    getSection(SECTION_ARGLEN, nrEvents, sizeof(int32_t)) == nullptr) {
+		ts_errno = -TS_ERROR_FILEFORMAT;
+		goto err;
+	}
+
+	madvise((void*) map, mapSize, MADV_SEQUENTIAL);
+	return 0;
+err:
+	close();
+	return ts_errno;
+}
+
+void TraceIndex::close()
+{
+	if (map != nullptr && munmap((void*) map, mapSize) != 0)
+		munmap_err();
+	map = nullptr;
+	mapSize = 0;
+	traceType = TRACE_TYPE_UNKNOWN;
+	flags = 0;
+	nrEvents = 0;
+	nrArgs = 0;
+	memset(&eventNames, 0, sizeof(eventNames));
+	memset(&taskNames, 0, sizeof(taskNames));
+	memset(&args, 0, sizeof(args));
+	taskNameTable.clear();
+	argTable.clear();
+}
+
+const void *TraceIndex::getSection(int section, uint64_t count,
+				   uint64_t elemSize) const
+{
+	const IndexHeader *header = (const IndexHeader*) map;
+	const IndexSection &s = header->sections[section];
+
+	if (s.size != count * elemSize || count > s.size)
+		return nullptr;
+	return map + s.offset;
+}
+
+/*
+ * A string table consists of the number of strings, followed by an array of
+ * offsets and the null terminated strings. The array has one extra element,
+ * so that the length of every string can be computed from two offsets.
+ */
+bool TraceIndex::setupStringTable(int section, StringTable *table)
+{
+	const IndexHeader *header = (const IndexHeader*) map;
+	const IndexSection &s = header->sections[section];
+	const char *data = map + s.offset;
+	uint64_t i;
+
+	if (s.size < sizeof(uint64_t))
+		return false;
+	memcpy(&table->count, data, sizeof(uint64_t));
+	if (table->count >= (s.size - sizeof(uint64_t)) / sizeof(uint64_t))
+		return false;
+	table->offsets = (const uint64_t*) (data + sizeof(uint64_t));
+	table->chars = (const char*) (table->offsets + table->count + 1);
+	table->charsSize = s.size - (table->chars - data);
+
+	if (table->offsets[0] != 0 ||
+	    table->offsets[table->count] > table->charsSize)
+		return false;
+	for (i = 0; i < table->count; i++) {
+		if (table->offsets[i + 1] <= table->offsets[i] ||
+		    table->chars[table->offsets[i + 1] - 1] != '\0')
+			return false;
+	}
+	return true;
+}
+
+void TraceIndex::readEvents(tracetype_t ttype,
+			    vtl::TList<TraceEvent> *events,
+			    SchedPayloads *payloads, MemPool *ptrPool,
+			    MemPool *postEventPool, TraceDat *traceDat,
+			    FtraceGrammar *grammar, IndexWatcher *watcher)
+{
+	const int64_t *time = (const int64_t*)
+		getSection(SECTION_TIME, nrEvents, sizeof(int64_t));
+	const uint8_t *precision = (const uint8_t*)
+		getSection(SECTION_PRECISION, nrEvents, sizeof(uint8_t));
+	const uint32_t *cpu = (const uint32_t*)
+		getSection(SECTION_CPU, nrEvents, sizeof(uint32_t));
+	const int32_t *pid = (const int32_t*)
+		getSection(SECTION_PID, nrEvents, sizeof(int32_t));
+	const int32_t *type = (const int32_t*)
+		getSection(SECTION_TYPE, nrEvents, sizeof(int32_t));
+	const int32_t *intArg = (const int32_t*)
+		getSection(SECTION_INTARG, nrEvents, sizeof(int32_t));
+	const uint32_t *taskName = (const uint32_t*)
+		getSection(SECTION_TASKNAME, nrEvents, sizeof(uint32_t));
+	const uint8_t *argc = (const uint8_t*)
+		getSection(SECTION_ARGC, nrEvents, sizeof(uint8_t));
+	const uint32_t *argv = (const uint32_t*)
+		getSection(SECTION_ARGV, nrArgs, sizeof(uint32_t));
+	const int64_t *postOffset = (const int64_t*)
+		getSection(SECTION_POSTOFFSET, nrEvents, sizeof(int64_t));
+	const int32_t *postLen = (const int32_t*)
+		getSection(SECTION_POSTLEN, nrEvents, sizeof(int32_t));
+	const int64_t *argOffset = (const int64_t*)
+		getSection(SECTION_ARGOFFSET, nrEvents, sizeof(int64_t));
+	const int32_t *argLen = (const int32_t*)
+		getSection(SECTION_ARGLEN, nrEvents, sizeof(int32_t));
+	const int32_t maxType = EVENT_UNKNOWN + eventNames.count;
+	const uint64_t nrNames = taskNameTable.size();
+	const uint64_t nrArgStrings = argTable.size();
+	uint64_t argPos = 0;
+	uint64_t i;
+	unsigned int n, j;
+	uint32_t idx;
+	Chunk *chunk;
+
+	for (i = 0; i < nrEvents; i++) {
+		TraceEvent &event = events->preAlloc();
+		event.setTime(vtl::Time(false, 0, time[i], precision[i]));
+		event.cpu = cpu[i];
+		event.pid = pid[i];
+		event.type = type[i] >= EVENT_ERROR && type[i] < maxType ?
+			(event_t) type[i] : EVENT_ERROR;
+		event.intArg = intArg[i];
+		event.taskName = taskName[i] < nrNames ?
+			taskNameTable[taskName[i]] : nullptr;
+
+		event.argv = (const TString**)
+			ptrPool->preallocN(EVENT_MAX_NR_ARGS);
+		n = TSMIN(argc[i], EVENT_MAX_NR_ARGS);
+		if (argPos + argc[i] > nrArgs)
+			n = 0;
+		for (j = 0; j < n; j++) {
+			idx = argv[argPos + j];
+			if (idx >= nrArgStrings)
+				break;
+			event.argv[j] = argTable[idx];
+		}
+		event.argc = j;
+		argPos += argc[i];
+		ptrPool->commitN(event.argc);
+		if (argLen[i] >= 0) {
+			event.setLazyArgs(argOffset[i], argLen[i]);
+		} else if (argLen[i] == TRACEINDEX_RAW_ARGS) {
+			event.setRawArgs(argOffset[i]);
+			if (traceDat != nullptr)
+				traceDat->decodeRecordAt(argOffset[i], grammar,
+							 payloads, event);
+			else
+				payloads->add(event, nullptr);
+		} else {
+			payloads->decode(ttype, event);
+		}
+
+		if (postLen[i] >= 0) {
+			chunk = (Chunk*) postEventPool->allocObj();
+			chunk->offset = postOffset[i];
+			chunk->len = postLen[i];
+			event.postEventInfo = chunk;
+		} else {
+			event.postEventInfo = nullptr;
+		}
+		events->commit();
+
+		if ((i & 0xffff) == 0xffff)
+			watcher->sendNextIndex(events->size());
+	}
+}
+
+/* This assigns an index to every unique string, in order of appearance */
+class StringCollector {
+public:
+	__always_inline uint32_t add(const TString *str);
+	QVector<const TString*> strings;
+private:
+	QMap<const TString*, uint32_t> indexes;
+};
+
+__always_inline uint32_t StringCollector::add(const TString *str)
+{
+	uint32_t idx;
+
+	if (str == nullptr)
+		return TRACEINDEX_NO_STRING;
+	if (indexes.contains(str))
+		return indexes.value(str);
+	idx = strings.size();
+	indexes[str] = idx;
+	strings.append(str);
+	return idx;
+}
+
+static bool writeStringTable(IndexWriter *w, IndexSection *section,
+			     const QVector<const TString*> &strings)
+{
+	uint64_t count = strings.size();
+	uint64_t offset = 0;
+	uint64_t i;
+	const char nul = '\0';
+
+	section->offset = w->pos;
+	if (!w->put(&count, sizeof(count)) ||
+	    !w->put(&offset, sizeof(offset)))
+		return false;
+	for (i = 0; i < count; i++) {
+		offset += strings[i]->len + 1;
+		if (!w->put(&offset, sizeof(offset)))
+			return false;
+	}
+	for (i = 0; i < count; i++) {
+		if (!w->put(strings[i]->ptr, strings[i]->len) ||
+		    !w->put(&nul, sizeof(nul)))
+			return false;
+	}
+	section->size = w->pos - section->offset;
+	return w->align();
+}
+
+template<typename T, typename F>
+static bool writeColumn(IndexWriter *w, IndexSection *section,
+			const vtl::TList<TraceEvent> *events, F value)
+{
+	int i;
+	int n = events->size();
+	T v;
+
+	section->offset = w->pos;
+	for (i = 0; i < n; i++) {
+		v = value((*events)[i]);
+		if (!w->put(&v, sizeof(v)))
+			return false;
+	}
+	section->size = w->pos - section->offset;
+	return w->align();
+}
+
+static bool writeIndex(int fd, IndexHeader *header,
+		       const vtl::TList<TraceEvent> *events,
+		       const StringTree *eventTree)
+{
+	IndexWriter w(fd);
+	IndexSection *sections = header->sections;
+	StringCollector taskNames;
+	StringCollector args;
+	QVector<const TString*> eventNames;
+	QVector<uint32_t> taskNameIdx;
+	QVector<uint32_t> argvIdx;
+	const TString *name;
+	int i, j, n;
+	event_t t;
+
+	/* The space for the header is reserved here and filled in last */
+	memset(sections, 0, sizeof(header->sections));
+	if (!w.put(header, sizeof(*header)) || !w.align())
+		return false;
+
+	for (t = EVENT_UNKNOWN; t <= eventTree->getMaxEvent();
+	     t = (event_t) (t + 1)) {
+		name = eventTree->stringLookup(t);
+		if (name == nullptr)
+			return false;
+		eventNames.append(name);
+	}
+
+	n = events->size();
+	taskNameIdx.reserve(n);
+	for (i = 0; i < n; i++) {
+		const TraceEvent &event = (*events)[i];
+		taskNameIdx.append(taskNames.add(event.taskName));
+		for (j = 0; j < event.argc; j++)
+			argvIdx.append(args.add(event.argv[j]));
+	}
+	header->nrEvents = n;
+	header->nrArgs = argvIdx.size();
+
+	if (!writeStringTable(&w, &sections[SECTION_EVENTNAMES], eventNames) ||
+	    !writeStringTable(&w, &sections[SECTION_TASKNAMES],
+			      taskNames.strings) ||
+	    !writeStringTable(&w, &sections[SECTION_ARGS], args.strings))
+		return false;
+
+	if (!writeColumn<int64_t>(&w, &sections[SECTION_TIME], events,
+		[] (const TraceEvent &e) -> int64_t {
+			return e.timeNs;
+		}) ||
+	    !writeColumn<uint8_t>(&w, &sections[SECTION_PRECISION], events,
+		[] (const TraceEvent &e) -> uint8_t {
+			return e.timePrecision;
+		}) ||
+	    !writeColumn<uint32_t>(&w, &sections[SECTION_CPU], events,
+		[] (const TraceEvent &e) -> uint32_t { return e.cpu; }) ||
+	    !writeColumn<int32_t>(&w, &sections[SECTION_PID], events,
+		[] (const TraceEvent &e) -> int32_t { return e.pid; }) ||
+	    !writeColumn<int32_t>(&w, &sections[SECTION_TYPE], events,
+		[] (const TraceEvent &e) -> int32_t { return e.type; }) ||
+	    !writeColumn<int32_t>(&w, &sections[SECTION_INTARG], events,
+		[] (const TraceEvent &e) -> int32_t { return e.intArg; }) ||
+	    !writeColumn<uint8_t>(&w, &sections[SECTION_ARGC], events,
+		[] (const TraceEvent &e) -> uint8_t {
+			return e.hasArgv() ? e.argc : 0;
+		}) ||
+	    !writeColumn<int64_t>(&w, &sections[SECTION_POSTOFFSET], events,
+		[] (const TraceEvent &e) -> int64_t {
+			return e.postEventInfo != nullptr ?
+				e.postEventInfo->offset : 0;
+		}) ||
+	    !writeColumn<int32_t>(&w, &sections[SECTION_POSTLEN], events,
+		[] (const TraceEvent &e) -> int32_t {
+			return e.postEventInfo != nullptr ?
+				e.postEventInfo->len : -1;
+		}) ||
+	    !writeColumn<int64_t>(&w, &sections[SECTION_ARGOFFSET], events,
+		[] (const TraceEvent &e) -> int64_t {
+			return e.hasArgv() ? 0 : e.argOffset;
+		}) ||
+	    !writeColumn<int32_t>(&w, &sections[SECTION_ARGLEN], events,
+		[] (const TraceEvent &e) -> int32_t {
+			if (e.hasLazyArgs())
+				return e.argLen;
+			return e.hasRawArgs() ? TRACEINDEX_RAW_ARGS : -1;
+		}))
+		return false;
+
+	sections[SECTION_TASKNAME].offset = w.pos;
+	if (!w.put(taskNameIdx.constData(), n * sizeof(uint32_t)))
+		return false;
+	sections[SECTION_TASKNAME].size = w.pos -
+		sections[SECTION_TASKNAME].offset;
+	if (!w.align())
+		return false;
+
+	sections[SECTION_ARGV].offset = w.pos;
+	if (!w.put(argvIdx.constData(), argvIdx.size() * sizeof(uint32_t)))
+		return false;
+	sections[SECTION_ARGV].size = w.pos - sections[SECTION_ARGV].offset;
+	if (!w.align() || !w.flush())
+		return false;
+
+	return pwrite(fd, header, sizeof(*header), 0) ==
+		(ssize_t) sizeof(*header);
+}
+
+/*
+ * The index is written to a temporary file that is renamed when it is
+ * complete, so that another instance never sees a partially written index.
+ */
+int TraceIndex::write(const char *name, const FileInfo *info,
+		      tracetype_t traceType, bool callchainChunks,
+		      bool callchainSwap, bool rawArgs,
+		      const vtl::TList<TraceEvent> *events,
+		      const StringTree *eventTree)
+{
+	IndexHeader header;
+	QByteArray tmpName(name);
+	int fd;
+	int ts_errno = 0;
+	bool ok;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, TRACEINDEX_MAGIC, TRACEINDEX_MAGIC_SIZE);
+	header.version = TRACEINDEX_VERSION;
+	header.byteOrder = TRACEINDEX_BYTE_ORDER;
+	header.traceType = traceType;
+	header.flags = (callchainChunks ? TRACEINDEX_FLAG_CALLCHAIN : 0) |
+		(callchainSwap ? TRACEINDEX_FLAG_SWAP : 0) |
+		(rawArgs ? TRACEINDEX_FLAG_RAWARGS : 0);
+	info->getStamp(&header.stamp);
+
+	tmpName.append(".XXXXXX");
+	fd = mkstemp(tmpName.data());
+	if (fd < 0)
+		return errno_or(-TS_ERROR_FILE_WRITE);
+
+	ok = writeIndex(fd, &header, events, eventTree);
+	if (!ok)
+		ts_errno = errno_or(-TS_ERROR_FILE_WRITE);
+	if (clib_close(fd) != 0 && ok) {
+		ok = false;
+		ts_errno = errno_or(-TS_ERROR_FILE_WRITE);
+	}
+	if (ok && rename(tmpName.data(), name) != 0) {
+		ok = false;
+		ts_errno = errno_or(-TS_ERROR_FILE_RENAME);
+	}
+	if (!ok)
+		unlink(tmpName.data());
+	return ts_errno;
+}
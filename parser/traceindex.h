@@ -0,0 +1,217 @@
+// SPDX-License-Identifier: (GPL-2.0-or-later OR BSD-2-Clause)
+/*
+ * Traceshark - a visualizer for visualizing ftrace and perf traces
+ * Copyright (C) 2019  Viktor Rosendahl <viktor.rosendahl@gmail.com>
+ *
+ * This file is dual licensed: you can use it either under the terms of
+ * the GPL, or the BSD license, at your option.
+ *
+ *  a) This program is free software; you can redistribute it and/or
+ *     modify it under the terms of the GNU General Public License as
+ *     published by the Free Software Foundation; either version 2 of the
+ *     License, or (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public
+ *     License along with this library; if not, write to the Free
+ *     Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ *     MA 02110-1301 USA
+ *
+ * Alternatively,
+ *
+ *  b) Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *     1. Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *     2. Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *     CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *     INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *     MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *     DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *     CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *     NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *     LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *     HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *     CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ *     OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *     EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TRACEINDEX_H
+#define TRACEINDEX_H
+
+#include <cstdint>
+
+#include <QVector>
+
+#include "parser/fileinfo.h"
+#include "parser/traceevent.h"
+#include "misc/traceshark.h"
+#include "misc/tstring.h"
+#include "vtl/compiler.h"
+
+class FtraceGrammar;
+class IndexWatcher;
+class MemPool;
+class SchedPayloads;
+class StringTree;
+class TraceDat;
+namespace vtl {
+	template<class T> class TList;
+}
+
+#define TRACEINDEX_SUFFIX ".tsidx"
+
+#define TRACEINDEX_FLAG_CALLCHAIN (1 << 0)
+#define TRACEINDEX_FLAG_SWAP (1 << 1)
+/* The events with raw arguments need the mapping of the trace.dat file */
+#define TRACEINDEX_FLAG_RAWARGS (1 << 2)
+
+/*
+ * A trace index is a sidecar file that contains the result of the parsing of
+ * a trace file. It is written after a trace file has been parsed and the next
+ * time that the same file is opened, the events are restored from the index
+ * instead of being parsed. The index is only used if the size and the
+ * timestamps of the trace file are the same as when it was written.
+ *
+ * The events are stored column by column and the strings are stored once, in
+ * string tables, that the events refer to by index. The strings are interned
+ * into the grammar when the index is opened, so the restored events look
+ * exactly like the ones that the grammar would have produced. The payloads
+ * are decoded again when the events are restored, those of the events with
+ * raw arguments from the binary records in the trace.dat file.
+ */
+class TraceIndex
+{
+public:
+	TraceIndex();
+	~TraceIndex();
+	int open(const char *name, const FileInfo *info);
+	void close();
+	__always_inline bool isOpen() const;
+	__always_inline tracetype_t getTraceType() const;
+	__always_inline int64_t getNrEvents() const;
+	__always_inline bool getCallchainChunks(bool *swap) const;
+	__always_inline bool hasRawArgs() const;
+	template<class Grammar> bool internStrings(Grammar *grammar);
+	void readEvents(tracetype_t ttype, vtl::TList<TraceEvent> *events,
+			SchedPayloads *payloads, MemPool *ptrPool,
+			MemPool *postEventPool, TraceDat *traceDat,
+			FtraceGrammar *grammar, IndexWatcher *watcher);
+	static int write(const char *name, const FileInfo *info,
+			 tracetype_t traceType, bool callchainChunks,
+			 bool callchainSwap, bool rawArgs,
+			 const vtl::TList<TraceEvent> *events,
+			 const StringTree *eventTree);
+private:
+	class StringTable {
+	public:
+		uint64_t count;
+		const uint64_t *offsets;
+		const char *chars;
+		uint64_t charsSize;
+	};
+	bool setupStringTable(int section, StringTable *table);
+	__always_inline void getString(const StringTable *table, uint64_t i,
+				       TString *str) const;
+	const void *getSection(int section, uint64_t count,
+			       uint64_t elemSize) const;
+	const char *map;
+	int64_t mapSize;
+	tracetype_t traceType;
+	uint32_t flags;
+	uint64_t nrEvents;
+	uint64_t nrArgs;
+	StringTable eventNames;
+	StringTable taskNames;
+	StringTable args;
+	QVector<const TString*> taskNameTable;
+	QVector<const TString*> argTable;
+};
+
+__always_inline bool TraceIndex::isOpen() const
+{
+	return map != nullptr;
+}
+
+__always_inline tracetype_t TraceIndex::getTraceType() const
+{
+	return traceType;
+}
+
+__always_inline int64_t TraceIndex::getNrEvents() const
+{
+	return nrEvents;
+}
+
+__always_inline void TraceIndex::getString(const StringTable *table,
+					   uint64_t i, TString *str) const
+{
+	str->ptr = (char*) table->chars + table->offsets[i];
+	str->len = table->offsets[i + 1] - table->offsets[i] - 1;
+}
+
+__always_inline bool TraceIndex::getCallchainChunks(bool *swap) const
+{
+	*swap = (flags & TRACEINDEX_FLAG_SWAP) != 0;
+	return (flags & TRACEINDEX_FLAG_CALLCHAIN) != 0;
+}
+
+__always_inline bool TraceIndex::hasRawArgs() const
+{
+	return (flags & TRACEINDEX_FLAG_RAWARGS) != 0;
+}
+
+/*
+ * The event types are allocated in the order that the event names are
+ * interned, so the names must be interned in the order that they had when
+ * the index was written, which is also the order in which they are stored.
+ * The grammar must not have seen any unknown events before this is called.
+ */
+template<class Grammar> bool TraceIndex::internStrings(Grammar *grammar)
+{
+	TString str;
+	const TString *interned;
+	uint64_t i;
+
+	for (i = 0; i < eventNames.count; i++) {
+		getString(&eventNames, i, &str);
+		if (grammar->internEventType(&str) != (event_t) (EVENT_UNKNOWN
+								 + i))
+			return false;
+	}
+
+	taskNameTable.resize(taskNames.count);
+	for (i = 0; i < taskNames.count; i++) {
+		getString(&taskNames, i, &str);
+		interned = grammar->internTaskName(&str);
+		if (interned == nullptr)
+			return false;
+		taskNameTable[i] = interned;
+	}
+
+	argTable.resize(args.count);
+	for (i = 0; i < args.count; i++) {
+		getString(&args, i, &str);
+		interned = grammar->internArg(&str);
+		if (interned == nullptr)
+			return false;
+		argTable[i] = interned;
+	}
+	return true;
+}
+
+#endif /* TRACEINDEX_H */
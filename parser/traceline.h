@@ -61,7 +61,10 @@ class TraceLine {
 public:
 	TString *strings;
 	unsigned int nStrings;
+	/* The offset of the line in the file */
 	int64_t begin;
+	/* The beginning of the line in the load buffer */
+	const char *ptr;
 };
 
 #endif
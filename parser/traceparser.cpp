@@ -56,37 +56,64 @@
 #include <limits>
 
 #include "misc/tstring.h"
+#include "parser/eventargs.h"
+#include "parser/eventextractor.h"
 #include "parser/genericparams.h"
 #include "mm/mempool.h"
 #include "parser/ftrace/ftracegrammar.h"
 #include "parser/perf/perfgrammar.h"
 #include "parser/tracefile.h"
+#include "parser/traceindex.h"
 #include "parser/traceparser.h"
+#include "parser/tracedat/tracedat.h"
+#include "parser/perfdata/perfdata.h"
 #include "misc/errors.h"
 #include "misc/chunk.h"
 #include "misc/traceshark.h"
 #include "threads/indexwatcher.h"
 #include "threads/threadbuffer.h"
 
+extern "C" {
+#include <sys/stat.h>
+}
+
 #define CLEAR_VARIABLE(VAR) memset(&VAR, 0, sizeof(VAR))
 #define TRACE_TYPE_CONFIDENCE_FACTOR (100)
+/* Large L3 caches are shared by many cores, so we don't use more than this */
+#define MAX_LOAD_RING_SIZE (64 * 1024 * 1024)
 
 TraceParser::TraceParser()
-	: traceType(TRACE_TYPE_UNKNOWN), events(nullptr)
+	: traceType(TRACE_TYPE_UNKNOWN), traceDat(nullptr), perfData(nullptr),
+	  indexedEvents(-1), following(false), tbuffers(nullptr),
+	  ftraceParsed(nullptr), perfParsed(nullptr), nrTBuffers(0),
+	  minTBuffers(0), loadBufferSize(0),
+	  eventBatchSize(DEFAULT_EVENT_BATCH_SIZE), nrReaders(0),
+	  events(nullptr)
 {
+	unsigned int i;
+
 	traceFile = nullptr;
 	ptrPool = new MemPool(16384, sizeof(TString*));
 	postEventPool = new MemPool(16384, sizeof(Chunk));
+	traceIndex = new TraceIndex();
+	extractors = new EventExtractors();
 
 	ftraceGrammar = new FtraceGrammar();
 	perfGrammar = new PerfGrammar();
 
-	tbuffers = new ThreadBuffer<TraceLine>*[NR_TBUFFERS];
 	parserThread = new WorkThread<TraceParser>
 		(QString("parserThread"), this, &TraceParser::threadParser);
-	readerThread = new WorkThread<TraceParser>
-		(QString("readerThread"), this, &TraceParser::threadReader);
-	eventsWatcher = new IndexWatcher(10000);
+	for (i = 0; i < MAX_NR_READERS; i++) {
+		readerThreads[i] = new WorkThread<TraceParser>
+			(QString("readerThread") + QString::number(i), this,
+			 &TraceParser::threadReader);
+		/* These are allocated by open(), when they are needed */
+		readerFtraceGrammars[i] = nullptr;
+		readerPerfGrammars[i] = nullptr;
+		readerPtrPools[i] = nullptr;
+	}
+	eventsWatcher = new IndexWatcher(DEFAULT_EVENT_BATCH_SIZE);
+	eventsWatcher->setStallCounter(stallStats.getCounter(STALL_ANALYZE));
 	traceTypeWatcher = new IndexWatcher;
 	ftraceEvents = new vtl::TList<TraceEvent>();
 	perfEvents = new vtl::TList<TraceEvent>();
@@ -99,29 +126,61 @@ TraceParser::TraceParser()
 
 TraceParser::~TraceParser()
 {
+	unsigned int i;
+
 	delete ftraceGrammar;
 	delete perfGrammar;
 	delete ptrPool;
 	delete postEventPool;
-	delete[] tbuffers;
+	delete traceIndex;
+	delete extractors;
 	delete parserThread;
-	delete readerThread;
+	for (i = 0; i < MAX_NR_READERS; i++) {
+		delete readerThreads[i];
+		delete readerFtraceGrammars[i];
+		delete readerPerfGrammars[i];
+		delete readerPtrPools[i];
+	}
 	delete eventsWatcher;
 	delete traceTypeWatcher;
 	delete ftraceEvents;
 	delete perfEvents;
 }
 
-int TraceParser::open(const QString &fileName)
+/*
+ * If follow is true, the file is read as text from startPos and the parsing
+ * continues as the file grows, until stopFollow() is called. Neither the
+ * index nor the binary formats are used in that case.
+ */
+int TraceParser::open(const QString &fileName, bool follow, int64_t startPos)
 {
 	int ts_errno;
 	unsigned int i;
+	unsigned int bufSize;
+	unsigned int nrBuf;
+	char magic[TRACEDAT_MAGIC_SIZE];
+	Chunk chunk;
 
 	if (traceFile != nullptr)
 		return -TS_ERROR_INTERNAL;
 
+	/*
+	 * The loadThread and the parserThread are expected to keep one core
+	 * each busy, the tokenization and the parsing of the lines is split
+	 * among the remaining cores.
+	 * Every reader thread handles every nrReaders:th buffer, so the number
+	 * of buffers must be a multiple of nrReaders and we want each reader
+	 * to have at least two buffers, so that it never needs to wait for the
+	 * parser, unless the parser is the bottleneck.
+	 */
+	nrReaders = TSMAX(1, QThread::idealThreadCount() - 2);
+	nrReaders = TSMIN(nrReaders, MAX_NR_READERS);
+	computeBufferConfig(fileName, &bufSize, &nrBuf);
+	nrTBuffers = nrReaders * TSMAX(2, (nrBuf + nrReaders - 1) / nrReaders);
+
 	traceFile = new TraceFile(fileName.toLocal8Bit().data(), ts_errno,
-				  1024 * 1024 * 2);
+				  bufSize, nrTBuffers, nrReaders, follow,
+				  startPos);
 
 	if (ts_errno != 0) {
 		delete traceFile;
@@ -129,24 +188,461 @@ int TraceParser::open(const QString &fileName)
 		return ts_errno;
 	}
 
+	following = follow;
+	stallStats.reset();
+	traceFile->setStallStats(&stallStats);
+	EventArgs::setTraceFile(traceFile);
+	eventsWatcher->setBatchSize(eventBatchSize);
+	indexName = fileName.toLocal8Bit();
+	indexName.append(TRACEINDEX_SUFFIX);
+	indexedEvents = -1;
+	loadExtractors(fileName);
+	if (!following && openTraceIndex() == 0)
+		return 0;
+
+	/*
+	 * The size of a compressed file may not be known without decompressing
+	 * it, so we let readChunk() tell us if the file is too small.
+	 */
+	if (!following) {
+		chunk.offset = 0;
+		chunk.len = TRACEDAT_MAGIC_SIZE;
+		traceFile->readChunk(&chunk, magic, TRACEDAT_MAGIC_SIZE,
+				     &ts_errno);
+		if (ts_errno == 0 &&
+		    TraceDat::isTraceDat(magic, TRACEDAT_MAGIC_SIZE))
+			return openTraceDat();
+		if (ts_errno == 0 &&
+		    PerfData::isPerfData(magic, TRACEDAT_MAGIC_SIZE))
+			return openPerfData();
+	}
+
 	/* These buffers will be deleted by the parserThread */
-	for (i = 0; i < NR_TBUFFERS; i++)
+	tbuffers = new ThreadBuffer<TraceLine>*[nrTBuffers];
+	ftraceParsed = new ParsedBuffer*[nrTBuffers];
+	perfParsed = new ParsedBuffer*[nrTBuffers];
+	for (i = 0; i < nrTBuffers; i++) {
 		tbuffers[i] = new ThreadBuffer<TraceLine>(TBUFSIZE);
+		tbuffers[i]->loadBuffer = traceFile->getLoadBuffer(i);
+		tbuffers[i]->stallStats = &stallStats;
+		ftraceParsed[i] = new ParsedBuffer(following);
+		perfParsed[i] = new ParsedBuffer(following);
+	}
+	for (i = 0; i < nrReaders; i++) {
+		if (readerFtraceGrammars[i] != nullptr)
+			continue;
+		readerFtraceGrammars[i] = new FtraceGrammar(ftraceGrammar);
+		readerPerfGrammars[i] = new PerfGrammar(perfGrammar);
+		readerPtrPools[i] = new MemPool(16384, sizeof(TString*));
+	}
 	eventsWatcher->reset();
 	traceTypeWatcher->reset();
-	readerThread->start();
+	parseType.storeRelease(TRACE_TYPE_UNKNOWN);
+	readerCounter.storeRelease(0);
+	traceFile->startLoad();
+	for (i = 0; i < nrReaders; i++)
+		readerThreads[i]->start();
+	parserThread->setObjFn(this, &TraceParser::threadParser);
 	parserThread->start();
 
 	return 0;
 }
 
+/*
+ * A trace.dat file is decoded directly from the mapping of the file by the
+ * parserThread, so neither the loadThread nor the readers are used.
+ */
+int TraceParser::openTraceDat()
+{
+	int ts_errno;
+	int dummy;
+	const char *map;
+
+	if (traceFile->isCompressed()) {
+		ts_errno = traceFile->mapDecompressed();
+		if (ts_errno != 0)
+			goto err;
+	}
+	map = traceFile->getMappedFile();
+	if (map == nullptr) {
+		ts_errno = -TS_ERROR_FILE_RESOURCE;
+		goto err;
+	}
+
+	traceDat = new TraceDat(map, traceFile->getFileSize());
+	ts_errno = traceDat->readHeaders();
+	if (ts_errno != 0) {
+		delete traceDat;
+		traceDat = nullptr;
+		goto err;
+	}
+	EventArgs::setTraceDat(traceDat);
+
+	eventsWatcher->reset();
+	traceTypeWatcher->reset();
+	parserThread->setObjFn(this, &TraceParser::threadTraceDat);
+	parserThread->start();
+	return 0;
+err:
+	EventArgs::setTraceFile(nullptr);
+	traceFile->close(&dummy);
+	delete traceFile;
+	traceFile = nullptr;
+	return ts_errno;
+}
+
+/*
+ * A perf.data file is also decoded directly from the mapping. The callchains
+ * are left in the file, so the TraceFile needs to know how to print them.
+ */
+int TraceParser::openPerfData()
+{
+	int ts_errno;
+	int dummy;
+	const char *map;
+
+	if (traceFile->isCompressed()) {
+		ts_errno = traceFile->mapDecompressed();
+		if (ts_errno != 0)
+			goto err;
+	}
+	map = traceFile->getMappedFile();
+	if (map == nullptr) {
+		ts_errno = -TS_ERROR_FILE_RESOURCE;
+		goto err;
+	}
+
+	perfData = new PerfData(map, traceFile->getFileSize());
+	ts_errno = perfData->readHeaders();
+	if (ts_errno != 0) {
+		delete perfData;
+		perfData = nullptr;
+		goto err;
+	}
+
+	traceFile->setCallchainChunks(false);
+	eventsWatcher->reset();
+	traceTypeWatcher->reset();
+	parserThread->setObjFn(this, &TraceParser::threadPerfData);
+	parserThread->start();
+	return 0;
+err:
+	EventArgs::setTraceFile(nullptr);
+	traceFile->close(&dummy);
+	delete traceFile;
+	traceFile = nullptr;
+	return ts_errno;
+}
+
+/*
+ * If the file has been opened before, the events can be restored from the
+ * index that was written then, which is much faster than parsing the file.
+ */
+int TraceParser::openTraceIndex()
+{
+	int ts_errno;
+	bool swap;
+	bool ok;
+
+	ts_errno = traceIndex->open(indexName.data(), &traceFile->fileInfo);
+	if (ts_errno != 0)
+		return ts_errno;
+
+	switch (traceIndex->getTraceType()) {
+	case TRACE_TYPE_FTRACE:
+		ok = traceIndex->internStrings(ftraceGrammar);
+		break;
+	case TRACE_TYPE_PERF:
+		ok = traceIndex->internStrings(perfGrammar);
+		break;
+	default:
+		ok = false;
+		break;
+	}
+	/* The callchains can only be printed from the mapping */
+	if (ok && traceIndex->getCallchainChunks(&swap)) {
+		if (traceFile->isCompressed() &&
+		    traceFile->mapDecompressed() != 0)
+			ok = false;
+		else if (traceFile->getMappedFile() != nullptr)
+			traceFile->setCallchainChunks(swap);
+		else
+			ok = false;
+	}
+	/* The raw arguments are formatted and decoded from the mapping */
+	if (ok && traceIndex->hasRawArgs())
+		ok = openRawArgs();
+	if (!ok) {
+		traceIndex->close();
+		ftraceGrammar->clear();
+		perfGrammar->clear();
+		return -TS_ERROR_FILEFORMAT;
+	}
+
+	indexedEvents = traceIndex->getNrEvents();
+	eventsWatcher->reset();
+	traceTypeWatcher->reset();
+	parserThread->setObjFn(this, &TraceParser::threadTraceIndex);
+	parserThread->start();
+	return 0;
+}
+
+/*
+ * The events with raw arguments refer to the records of the trace.dat file,
+ * so restoring them from the index requires the headers of the file.
+ */
+bool TraceParser::openRawArgs()
+{
+	const char *map;
+
+	if (traceFile->isCompressed() && traceFile->mapDecompressed() != 0)
+		return false;
+	map = traceFile->getMappedFile();
+	if (map == nullptr)
+		return false;
+	traceDat = new TraceDat(map, traceFile->getFileSize());
+	if (traceDat->readHeaders() != 0) {
+		delete traceDat;
+		traceDat = nullptr;
+		return false;
+	}
+	EventArgs::setTraceDat(traceDat);
+	return true;
+}
+
 bool TraceParser::isOpen() const
 {
 	return (traceFile != nullptr);
 }
 
+/*
+ * Makes the loading stop at the current end of a followed file. The parsing
+ * then finishes as if the end of the file had been reached.
+ */
+void TraceParser::stopFollow()
+{
+	if (following && traceFile != nullptr)
+		traceFile->stopLoad();
+}
+
+/*
+ * Removes the first n events of a followed trace, so that the memory use
+ * stays bounded. The argv arrays and the info chunks of the remaining events
+ * are moved to new pools and the old pools are freed. This is called by the
+ * thread of the analyzer, which must not access the events until it has
+ * processed them again from the first index.
+ */
+void TraceParser::evictEvents(int n)
+{
+	vtl::TList<TraceEvent> *list;
+	SchedPayloads *payloads;
+	TraceLineData *lineData;
+	MemPool *newPtrPool;
+	MemPool *newPostEventPool;
+	const TString **argv;
+	Chunk *chunk;
+	int first;
+	int i, s;
+
+	windowMutex.lock();
+	if (!following || !tracetype_is_valid(traceType))
+		goto out;
+	if (traceType == TRACE_TYPE_FTRACE) {
+		list = ftraceEvents;
+		payloads = &ftracePayloads;
+		lineData = &ftraceLineData;
+	} else {
+		list = perfEvents;
+		payloads = &perfPayloads;
+		lineData = &perfLineData;
+	}
+	n = TSMIN(n, list->size());
+	if (n <= 0)
+		goto out;
+	list->removeFirst(n);
+	s = list->size();
+
+	/* The payloads are in the same order as the events */
+	first = payloads->size();
+	for (i = 0; i < s; i++) {
+		const TraceEvent &event = list->at(i);
+		if (SchedPayloads::isDecoded(event.type) &&
+		    event.payload != SCHED_PAYLOAD_NONE) {
+			first = event.payload;
+			break;
+		}
+	}
+	payloads->removeFirst(first);
+
+	newPtrPool = new MemPool(16384, sizeof(TString*));
+	newPostEventPool = new MemPool(16384, sizeof(Chunk));
+	for (i = 0; i < s; i++) {
+		TraceEvent &event = (*list)[i];
+		if (SchedPayloads::isDecoded(event.type) &&
+		    event.payload != SCHED_PAYLOAD_NONE)
+			event.payload -= first;
+		if (event.argc > 0) {
+			argv = (const TString**) newPtrPool->allocN(event.argc);
+			memcpy(argv, event.argv,
+			       event.argc * sizeof(const TString*));
+			event.argv = argv;
+		}
+		if (event.postEventInfo != nullptr &&
+		    event.postEventInfo != &fakePostEventInfo) {
+			chunk = (Chunk*) newPostEventPool->allocObj();
+			*chunk = *event.postEventInfo;
+			event.postEventInfo = chunk;
+		}
+	}
+	delete ptrPool;
+	delete postEventPool;
+	ptrPool = newPtrPool;
+	postEventPool = newPostEventPool;
+
+	/* The list has moved, prevEvent always points to the last event */
+	lineData->prevEvent = s > 0 ? &list->last() : &fakeEvent;
+	eventsWatcher->removeFirst(n);
+out:
+	windowMutex.unlock();
+}
+
+/*
+ * Sets the minimum number of buffers that are passed between the load thread,
+ * the reader threads and the parser thread, when the next file is opened.
+ * More buffers allow the stages to get further ahead of each other, fewer
+ * buffers keep the data that is handed over in the caches. Zero means that
+ * the number is computed from the cache size.
+ */
+void TraceParser::setNrBuffers(unsigned int nr)
+{
+	minTBuffers = TSMIN(nr, MAX_NR_TBUFFERS);
+}
+
+/* Sets the size of the load buffers, zero means automatic */
+void TraceParser::setBufferSize(unsigned int size)
+{
+	if (size == 0)
+		loadBufferSize = 0;
+	else
+		loadBufferSize = TSMIN(TSMAX(size, MIN_LOAD_BUFFER_SIZE),
+				       MAX_LOAD_BUFFER_SIZE);
+}
+
+/*
+ * Sets how many events the parser posts before the analyzer is woken up. A
+ * smaller batch makes the analyzer follow the parser more closely, at the
+ * cost of more wakeups.
+ */
+void TraceParser::setBatchSize(int size)
+{
+	eventBatchSize = size > 0 ? size : DEFAULT_EVENT_BATCH_SIZE;
+}
+
+/*
+ * Returns the size of a cache level in bytes, or 0 if it is not known. Not all
+ * C libraries provide the cache sizes with sysconf(), so we also look in sysfs.
+ */
+static int64_t cacheSize(int level)
+{
+	char path[128];
+	char buf[32];
+	char unit = 'B';
+	long value = 0;
+	int64_t size;
+	FILE *file;
+	int i;
+
+#if defined(_SC_LEVEL2_CACHE_SIZE) && defined(_SC_LEVEL3_CACHE_SIZE)
+	value = sysconf(level == 2 ? _SC_LEVEL2_CACHE_SIZE :
+			_SC_LEVEL3_CACHE_SIZE);
+	if (value > 0)
+		return value;
+#endif
+	for (i = 0; i < 8; i++) {
+		snprintf(path, sizeof(path),
+			 "/sys/devices/system/cpu/cpu0/cache/index%d/level", i);
+		file = fopen(path, "r");
+		if (file == nullptr)
+			break;
+		if (fscanf(file, "%ld", &value) != 1)
+			value = 0;
+		fclose(file);
+		if (value != level)
+			continue;
+		snprintf(path, sizeof(path),
+			 "/sys/devices/system/cpu/cpu0/cache/index%d/size", i);
+		file = fopen(path, "r");
+		if (file == nullptr)
+			break;
+		size = 0;
+		if (fgets(buf, sizeof(buf), file) != nullptr &&
+		    sscanf(buf, "%ld%c", &value, &unit) >= 1) {
+			size = value;
+			if (unit == 'K')
+				size *= 1024;
+			else if (unit == 'M')
+				size *= 1024 * 1024;
+		}
+		fclose(file);
+		return size;
+	}
+	return 0;
+}
+
+/*
+ * A load buffer should fit in the L2 cache, so that a reader thread tokenizes
+ * it from the cache and the parser thread finds the tokens in the L3 cache. The
+ * buffers that are in flight at the same time should fit in the L3 cache.
+ * Small files are split so that all reader threads get something to do.
+ */
+void TraceParser::computeBufferConfig(const QString &fileName,
+				      unsigned int *bufSize,
+				      unsigned int *nrBuf) const
+{
+	const int64_t alignment = 64 * 1024;
+	int64_t l2 = cacheSize(2);
+	int64_t l3 = cacheSize(3);
+	int64_t size;
+	int64_t split;
+	struct stat sbuf;
+
+	if (l2 <= 0)
+		l2 = 1024 * 1024;
+	if (l3 <= 0)
+		l3 = 8 * l2;
+	l3 = TSMIN(l3, 2 * MAX_LOAD_RING_SIZE);
+
+	if (loadBufferSize != 0) {
+		size = loadBufferSize;
+	} else {
+		size = TSMIN(TSMAX(l2, MIN_LOAD_BUFFER_SIZE),
+			     MAX_LOAD_BUFFER_SIZE);
+		if (stat(fileName.toLocal8Bit().data(), &sbuf) == 0 &&
+		    S_ISREG(sbuf.st_mode) && sbuf.st_size > 0) {
+			split = sbuf.st_size / (2 * nrReaders);
+			split = (split + alignment - 1) / alignment * alignment;
+			size = TSMIN(size, TSMAX(split, MIN_LOAD_BUFFER_SIZE));
+		}
+	}
+	*bufSize = size;
+
+	if (minTBuffers != 0)
+		*nrBuf = minTBuffers;
+	else
+		*nrBuf = TSMIN(TSMAX(l3 / 2 / size, NR_TBUFFERS),
+			       MAX_NR_TBUFFERS);
+}
+
 void TraceParser::close(int *ts_errno)
 {
+	unsigned int i;
+
+	stopFollow();
+	/* The parserThread may still be writing the index */
+	parserThread->wait();
+	traceIndex->close();
+	EventArgs::setTraceFile(nullptr);
+	EventArgs::setTraceDat(nullptr);
 	if (traceFile != nullptr) {
 		traceFile->close(ts_errno);
 		delete traceFile;
@@ -154,55 +650,107 @@ void TraceParser::close(int *ts_errno)
 	} else {
 		*ts_errno = 0;
 	}
+	if (traceDat != nullptr) {
+		delete traceDat;
+		traceDat = nullptr;
+	}
+	if (perfData != nullptr) {
+		delete perfData;
+		perfData = nullptr;
+	}
 	ptrPool->reset();
+	for (i = 0; i < MAX_NR_READERS; i++) {
+		if (readerFtraceGrammars[i] == nullptr)
+			continue;
+		readerFtraceGrammars[i]->clear();
+		readerPerfGrammars[i]->clear();
+		readerPtrPools[i]->reset();
+	}
 	perfGrammar->clear();
 	perfEvents->clear();
+	perfPayloads.clear();
 	ftraceGrammar->clear();
 	ftraceEvents->clear();
+	ftracePayloads.clear();
+	ftracePayloads.setExtractors(nullptr);
+	perfPayloads.setExtractors(nullptr);
+	extractors->clear();
 	events = nullptr;
 	traceType = TRACE_TYPE_UNKNOWN;
 }
 
+/*
+ * If there is a copy of the events directory of tracefs next to the trace
+ * file, then the format descriptors in it are used to decode the scheduler
+ * events, instead of the hand written ftrace_* and perf_* accessors.
+ */
+void TraceParser::loadExtractors(const QString &fileName)
+{
+	QByteArray dirName = fileName.toLocal8Bit();
+	int slash = dirName.lastIndexOf('/');
+
+	dirName = slash >= 0 ? dirName.left(slash + 1) : QByteArray();
+	dirName.append(EVENTEXTRACTOR_DIR);
+
+	extractors->clear();
+	extractors->loadDir(dirName.constData());
+	ftracePayloads.setExtractors(extractors);
+	perfPayloads.setExtractors(extractors);
+}
+
 
 void TraceParser::threadReader()
 {
-	unsigned long long nr = 0;
-	unsigned int i = 0;
-	unsigned int curbuf = 0;
+	unsigned int reader;
+	unsigned int curbuf;
 	bool eof;
+	tracetype_t ttype;
+	ThreadBuffer<TraceLine> *tbuf;
 
-	for (i = 0; i < NR_TBUFFERS; i++)
-		tbuffers[i]->loadBuffer = traceFile->getLoadBuffer(i);
-
-	tbuffers[curbuf]->beginProduceBuffer();
+	/*
+	 * The reader threads take turns, so that the buffers are tokenized and
+	 * parsed in parallel. This thread handles buffer number curbuf, curbuf
+	 * + nrReaders, curbuf + 2 * nrReaders and so on.
+	 */
+	curbuf = readerCounter.fetchAndAddOrdered(1);
+	reader = curbuf;
 
 	while(true) {
-		TraceLine *line = &tbuffers[curbuf]->list.increase();
-		quint32 n = traceFile->ReadLine(line, tbuffers[curbuf]);
-		nr += n;
-		if (traceFile->getBufferSwitch()) {
-			eof = tbuffers[curbuf]->loadBuffer->isEOF();
-			tbuffers[curbuf]->endProduceBuffer();
-			if (eof)
-				break;
-			curbuf++;
-			if (curbuf == NR_TBUFFERS)
-				curbuf = 0;
-			traceFile->clearBufferSwitch();
-			tbuffers[curbuf]->beginProduceBuffer();
-			eof = tbuffers[curbuf]->loadBuffer->isEOF();
-			/*
-			 * This is were EOF will be detected in practice, with
-			 * the current implementation of LoadBuffer
-			 */
-			if (eof && tbuffers[curbuf]->loadBuffer->nRead == 0) {
-				tbuffers[curbuf]->endProduceBuffer();
-				break;
-			}
+		tbuf = tbuffers[curbuf];
+		tbuf->beginProduceBuffer();
+		ftraceParsed[curbuf]->clear();
+		perfParsed[curbuf]->clear();
+		eof = tbuf->loadBuffer->isEOF();
+		/*
+		 * This is were EOF will be detected in practice, with
+		 * the current implementation of LoadBuffer
+		 */
+		if (eof && tbuf->loadBuffer->nRead == 0) {
+			tbuf->endProduceBuffer();
+			break;
 		}
+		do {
+			TraceLine *line = &tbuf->list.increase();
+			traceFile->ReadLine(line, tbuf);
+		} while (!tbuf->bufferSwitch);
+		/*
+		 * Until the parserThread knows what kind of trace this is, the
+		 * buffer is parsed with both grammars.
+		 */
+		ttype = (tracetype_t) parseType.loadAcquire();
+		if (ttype != TRACE_TYPE_PERF)
+			parseLines(TRACE_TYPE_FTRACE, reader, tbuf,
+				   ftraceParsed[curbuf]);
+		if (ttype != TRACE_TYPE_FTRACE)
+			parseLines(TRACE_TYPE_PERF, reader, tbuf,
+				   perfParsed[curbuf]);
+		tbuf->endProduceBuffer();
+		if (eof)
+			break;
+		curbuf += nrReaders;
+		if (curbuf >= nrTBuffers)
+			curbuf -= nrTBuffers;
 	}
-
-	printf("%llu\n", nr);
 }
 
 
@@ -217,7 +765,12 @@ void TraceParser::threadParser()
 
 	prepareParse();
 	while(true) {
-		eof = parseBuffer(i);
+		/*
+		 * The stitch functions return with windowMutex locked, it's
+		 * held until the new size of the list has been posted and
+		 * after the last buffer until the EOF has been sent.
+		 */
+		eof = stitchBuffer(i);
 		determineTraceType();
 		if (eof)
 			break;
@@ -228,13 +781,17 @@ void TraceParser::threadParser()
 		 */
 		if (traceType != TRACE_TYPE_UNKNOWN)
 			eventsWatcher->sendNextIndex(events->size());
+		windowMutex.unlock();
 		i++;
-		if (i == NR_TBUFFERS)
+		if (i == nrTBuffers)
 			i = 0;
-		if (traceType == TRACE_TYPE_FTRACE)
-			goto ftrace;
-		if (traceType == TRACE_TYPE_PERF)
+		if (traceType != TRACE_TYPE_UNKNOWN) {
+			/* From now on, the readers only use one grammar */
+			parseType.storeRelease(traceType);
+			if (traceType == TRACE_TYPE_FTRACE)
+				goto ftrace;
 			goto perf;
+		}
 	}
 	/*
 	 * Must have been a short trace or a lot of unknown garbage in the
@@ -247,26 +804,28 @@ void TraceParser::threadParser()
 
 	/*
 	 * The purpose of jumping to these loops is to  be able to use the
-	 * (hopefully faster) specialized parse functions
+	 * (hopefully faster) specialized stitch functions
 	 */
 ftrace:
 	while(true) {
-		if (parseFtraceBuffer(i))
+		if (stitchFtraceBuffer(i))
 			break;
 		eventsWatcher->sendNextIndex(ftraceEvents->size());
+		windowMutex.unlock();
 		i++;
-		if (i == NR_TBUFFERS)
+		if (i == nrTBuffers)
 			i = 0;
 	}
 	goto out;
 
 perf:
 	while(true) {
-		if (parsePerfBuffer(i))
+		if (stitchPerfBuffer(i))
 			break;
 		eventsWatcher->sendNextIndex(perfEvents->size());
+		windowMutex.unlock();
 		i++;
-		if (i == NR_TBUFFERS)
+		if (i == nrTBuffers)
 			i = 0;
 	}
 out:
@@ -282,9 +841,108 @@ out:
 
 	eventsWatcher->sendNextIndex(events->size());
 	eventsWatcher->sendEOF();
+	windowMutex.unlock();
 
-	for (i = 0; i < NR_TBUFFERS; i++)
+	/*
+	 * The reader threads may still be processing the empty EOF buffers
+	 * that the LoadThread produces after the last real buffer.
+	 */
+	for (i = 0; i < nrReaders; i++)
+		readerThreads[i]->wait();
+
+	for (i = 0; i < nrTBuffers; i++) {
 		delete tbuffers[i];
+		delete ftraceParsed[i];
+		delete perfParsed[i];
+	}
+	delete[] tbuffers;
+	delete[] ftraceParsed;
+	delete[] perfParsed;
+	tbuffers = nullptr;
+	ftraceParsed = nullptr;
+	perfParsed = nullptr;
+
+	writeTraceIndex();
+}
+
+void TraceParser::threadTraceDat()
+{
+	prepareParse();
+	traceType = TRACE_TYPE_FTRACE;
+	TraceEvent::setStringTree(ftraceGrammar->eventTree);
+	events = ftraceEvents;
+	sendTraceType();
+
+	traceDat->readEvents(ftraceGrammar, ftraceEvents, &ftracePayloads,
+			     ptrPool, eventsWatcher);
+
+	eventsWatcher->sendNextIndex(events->size());
+	eventsWatcher->sendEOF();
+	writeTraceIndex();
+}
+
+void TraceParser::threadPerfData()
+{
+	prepareParse();
+	traceType = TRACE_TYPE_PERF;
+	TraceEvent::setStringTree(perfGrammar->eventTree);
+	events = perfEvents;
+	sendTraceType();
+
+	perfData->readEvents(perfGrammar, perfEvents, &perfPayloads, ptrPool,
+			     postEventPool, eventsWatcher);
+
+	eventsWatcher->sendNextIndex(events->size());
+	eventsWatcher->sendEOF();
+	writeTraceIndex();
+}
+
+void TraceParser::threadTraceIndex()
+{
+	SchedPayloads *payloads;
+
+	prepareParse();
+	traceType = traceIndex->getTraceType();
+	if (traceType == TRACE_TYPE_FTRACE) {
+		TraceEvent::setStringTree(ftraceGrammar->eventTree);
+		events = ftraceEvents;
+		payloads = &ftracePayloads;
+	} else {
+		TraceEvent::setStringTree(perfGrammar->eventTree);
+		events = perfEvents;
+		payloads = &perfPayloads;
+	}
+	sendTraceType();
+
+	traceIndex->readEvents(traceType, events, payloads, ptrPool,
+			       postEventPool, traceDat, ftraceGrammar,
+			       eventsWatcher);
+	traceIndex->close();
+
+	eventsWatcher->sendNextIndex(events->size());
+	eventsWatcher->sendEOF();
+}
+
+/*
+ * This is called by the parserThread after the EOF has been sent, so the
+ * analyzer can process the events while the index is being written. Both
+ * only read the events. Failing to write the index is not an error, it only
+ * means that the file will be parsed again the next time.
+ */
+void TraceParser::writeTraceIndex()
+{
+	int ts_errno;
+	bool chunks, swap;
+
+	if (following || !tracetype_is_valid(traceType) ||
+	    events == nullptr || events->size() == 0)
+		return;
+	if (!traceFile->isIntact(&ts_errno))
+		return;
+	chunks = traceFile->getCallchainChunks(&swap);
+	TraceIndex::write(indexName.data(), &traceFile->fileInfo, traceType,
+			  chunks, swap, traceDat != nullptr, events,
+			  TraceEvent::getStringTree());
 }
 
 void TraceParser::waitForTraceType()
@@ -295,6 +953,19 @@ void TraceParser::waitForTraceType()
 		traceTypeWatcher->waitForNextBatch(eof, index);
 }
 
+/*
+ * This is the non blocking variant of waitForTraceType(), it returns true if
+ * the trace type has been determined.
+ */
+bool TraceParser::pollTraceType()
+{
+	int index;
+	bool eof;
+
+	traceTypeWatcher->pollNextBatch(eof, index);
+	return eof;
+}
+
 void TraceParser::sendTraceType()
 {
 	traceTypeWatcher->sendEOF();
@@ -320,6 +991,8 @@ void TraceParser::prepareParse()
 
 	ftraceEvents->clear();
 	perfEvents->clear();
+	ftracePayloads.clear();
+	perfPayloads.clear();
 	events = nullptr;
 }
 
@@ -372,12 +1045,12 @@ void TraceParser::fixLastEvent()
 bool TraceParser::parseLineBugFixup(TraceEvent* event,
 				    const vtl::Time &prevTime)
 {
-	vtl::Time corrtime = event->time + CORR_DELTA;
+	vtl::Time corrtime = event->getTime() + CORR_DELTA;
 	vtl::Time delta = corrtime - prevTime;
 	bool retval = false;
 
 	if (delta >= VTL_TIME_ZERO && delta < TIME_10MS) {
-		event->time = corrtime;
+		event->setTime(corrtime);
 		retval = true;
 	}
 	return retval;
@@ -421,38 +1094,8 @@ void TraceParser::guessTraceType()
 	sendTraceType();
 }
 
-/* This parses a buffer regardless if it's perf or ftrace */
-bool TraceParser::parseBuffer(unsigned int index)
+/* This stitches a buffer regardless if it's perf or ftrace */
+bool TraceParser::stitchBuffer(unsigned int index)
 {
-	unsigned int i, s;
-	bool eof;
-	const TString **argv;
-
-	ThreadBuffer<TraceLine> *tbuf = tbuffers[index];
-	tbuf->beginConsumeBuffer();
-
-	s = tbuf->list.size();
-	argv = (const TString**)
-		ptrPool->preallocN(EVENT_MAX_NR_ARGS);;
-
-	for(i = 0; i < s; i++) {
-		TraceLine &line = tbuf->list[i];
-		TraceEvent &ft_event = ftraceEvents->preAlloc();
-		ft_event.argc = 0;
-		ft_event.argv = argv;
-		if (parseLineFtrace(line, ft_event)) {
-			argv = (const TString**)
-				ptrPool->preallocN(EVENT_MAX_NR_ARGS);;
-		}
-		TraceEvent &p_event = perfEvents->preAlloc();
-		p_event.argc = 0;
-		p_event.argv = argv;
-		if (parseLinePerf(line, p_event)) {
-			argv = (const TString**)
-				ptrPool->preallocN(EVENT_MAX_NR_ARGS);;
-		}
-	}
-	eof = tbuf->loadBuffer->isEOF();
-	tbuf->endConsumeBuffer();
-	return eof;
+	return __stitchBuffer(TRACE_TYPE_UNKNOWN, index);
 }
@@ -53,11 +53,18 @@
 #ifndef TRACEPARSER_H
 #define TRACEPARSER_H
 
+#include <QByteArray>
+#include <QAtomicInt>
+#include <QMutex>
 #include <QVector>
 
+#include <cstring>
+
 #include "parser/genericparams.h"
+#include "parser/parsedbuffer.h"
 #include "parser/ftrace/ftracegrammar.h"
 #include "parser/perf/perfgrammar.h"
+#include "parser/schedpayload.h"
 #include "mm/mempool.h"
 #include "parser/tracelinedata.h"
 #include "parser/traceline.h"
@@ -65,16 +72,34 @@
 #include "misc/chunk.h"
 #include "misc/traceshark.h"
 #include "threads/indexwatcher.h"
+#include "threads/stallstats.h"
 #include "threads/threadbuffer.h"
 #include "threads/workitem.h"
 #include "threads/workthread.h"
 #include "threads/workqueue.h"
 #include "misc/tstring.h"
 
+/*
+ * Default minimum number of buffers, the actual number depends on nrReaders.
+ * This can be changed with TraceParser::setNrBuffers().
+ */
 #define NR_TBUFFERS (4)
+#define MAX_NR_TBUFFERS (256)
+
+/*
+ * The limits of the size of the load buffers. A buffer must be larger than the
+ * longest line in the trace.
+ */
+#define MIN_LOAD_BUFFER_SIZE (256 * 1024)
+#define MAX_LOAD_BUFFER_SIZE (64 * 1024 * 1024)
 #define TBUFSIZE (256)
+#define MAX_NR_READERS (8)
 
+class EventExtractors;
+class PerfData;
+class TraceDat;
 class TraceFile;
+class TraceIndex;
 class TraceAnalyzer;
 namespace vtl {
 	template<class T> class TList;
@@ -86,33 +111,59 @@ class TraceParser
 public:
 	TraceParser();
 	~TraceParser();
-	int open(const QString &fileName);
+	int open(const QString &fileName, bool follow = false,
+		 int64_t startPos = 0);
 	bool isOpen() const;
+	__always_inline bool isFollowing() const;
+	__always_inline int64_t getIndexedEvents() const;
+	void stopFollow();
+	void evictEvents(int n);
+	void setNrBuffers(unsigned int nr);
+	void setBufferSize(unsigned int size);
+	void setBatchSize(int size);
+	__always_inline const StallStats &getStallStats() const;
 	void close(int *ts_errno);
 	void threadParser();
 	void threadReader();
+	void threadTraceDat();
+	void threadPerfData();
+	void threadTraceIndex();
 	__always_inline vtl::TList<TraceEvent> *getEventsTList() const;
+	__always_inline const SchedPayloads *getSchedPayloads() const;
 	const StringTree *getPerfEventTree();
 	const StringTree *getFtraceEventTree();
 protected:
 	__always_inline void waitForNextBatch(bool &eof, int &index);
+	__always_inline void pollNextBatch(bool &eof, int &index);
 	void waitForTraceType();
+	bool pollTraceType();
 	tracetype_t traceType;
 	TraceFile *traceFile;
 private:
+	int openTraceDat();
+	int openPerfData();
+	int openTraceIndex();
+	bool openRawArgs();
+	void writeTraceIndex();
+	void loadExtractors(const QString &fileName);
 	void determineTraceType();
 	void guessTraceType();
 	void sendTraceType();
 	void prepareParse();
-	__always_inline bool __parseBuffer(tracetype_t ttppe,
-					   unsigned int index);
-	__always_inline bool parseFtraceBuffer(unsigned int index);
-	__always_inline bool parsePerfBuffer(unsigned int index);
-	__always_inline bool parseLineFtrace(TraceLine &line,
-					     TraceEvent &event);
-	__always_inline bool parseLinePerf(TraceLine &line, TraceEvent &event);
+	void computeBufferConfig(const QString &fileName,
+				 unsigned int *bufSize,
+				 unsigned int *nrBuf) const;
+	__always_inline void parseLines(tracetype_t ttype, unsigned int reader,
+					ThreadBuffer<TraceLine> *tbuf,
+					ParsedBuffer *pbuf);
+	__always_inline bool __stitchBuffer(tracetype_t ttype,
+					    unsigned int index);
+	__always_inline bool stitchFtraceBuffer(unsigned int index);
+	__always_inline bool stitchPerfBuffer(unsigned int index);
+	__always_inline void stitchEvents(tracetype_t ttype,
+					  ParsedBuffer *pbuf);
 	void fixLastEvent();
-	bool parseBuffer(unsigned int index);
+	bool stitchBuffer(unsigned int index);
 	bool parseLineBugFixup(TraceEvent* event, const vtl::Time &prevTime);
 	MemPool *ptrPool;
 	MemPool *postEventPool;
@@ -120,14 +171,68 @@ private:
 	Chunk fakePostEventInfo;
 	FtraceGrammar *ftraceGrammar;
 	PerfGrammar *perfGrammar;
+	/* This is only used if the file is a binary trace.dat file */
+	TraceDat *traceDat;
+	/* This is only used if the file is a binary perf.data file */
+	PerfData *perfData;
+	TraceIndex *traceIndex;
+	/* The event format descriptors that were found next to the trace */
+	EventExtractors *extractors;
+	/* The name of the sidecar index of the currently open file */
+	QByteArray indexName;
+	/*
+	 * The number of events in the index that the events are restored from,
+	 * or -1 if the file is parsed.
+	 */
+	int64_t indexedEvents;
+	/* True if the file is read in follow mode */
+	bool following;
+	/*
+	 * The parserThread holds this while it stitches a buffer and posts the
+	 * new size of the list, so that evictEvents() can modify the events
+	 * of a followed trace.
+	 */
+	QMutex windowMutex;
 	ThreadBuffer<TraceLine> **tbuffers;
+	/* The events that the readers have parsed from each of the tbuffers */
+	ParsedBuffer **ftraceParsed;
+	ParsedBuffer **perfParsed;
+	unsigned int nrTBuffers;
+	/*
+	 * The number of buffers, their size and the batch size for the next
+	 * open(). Zero means that they are computed from the size of the file
+	 * and the caches.
+	 */
+	unsigned int minTBuffers;
+	unsigned int loadBufferSize;
+	int eventBatchSize;
+	/* How long each stage of the pipeline has been waiting for the others */
+	StallStats stallStats;
 	WorkThread<TraceParser> *parserThread;
-	WorkThread<TraceParser> *readerThread;
+	WorkThread<TraceParser> *readerThreads[MAX_NR_READERS];
+	unsigned int nrReaders;
+	/* Used by the reader threads to claim their first buffer index */
+	QAtomicInt readerCounter;
+	/*
+	 * The grammars and the argv pool of each reader thread. The strings
+	 * and the argv arrays of the events stay in them until close().
+	 */
+	FtraceGrammar *readerFtraceGrammars[MAX_NR_READERS];
+	PerfGrammar *readerPerfGrammars[MAX_NR_READERS];
+	MemPool *readerPtrPools[MAX_NR_READERS];
+	/*
+	 * The trace type once the parserThread has determined it, until then
+	 * the readers parse every buffer with both grammars.
+	 */
+	QAtomicInt parseType;
 	TraceLineData ftraceLineData;
 	TraceLineData perfLineData;
 	vtl::TList<TraceEvent> *ftraceEvents;
 	vtl::TList<TraceEvent> *perfEvents;
 	vtl::TList<TraceEvent> *events;
+	/* The decoded scheduler events of ftraceEvents and perfEvents */
+	SchedPayloads ftracePayloads;
+	SchedPayloads perfPayloads;
 	IndexWatcher *eventsWatcher;
 	/* This IndexWatcher isn't really watching an index, it's to synchronize
 	 * when traceType has been determined in the parser thread */
@@ -139,118 +244,203 @@ __always_inline void TraceParser::waitForNextBatch(bool &eof, int &index)
 	eventsWatcher->waitForNextBatch(eof, index);
 }
 
-/* This parses a buffer */
-__always_inline bool TraceParser::parseFtraceBuffer(unsigned int index)
+__always_inline void TraceParser::pollNextBatch(bool &eof, int &index)
+{
+	eventsWatcher->pollNextBatch(eof, index);
+}
+
+__always_inline const StallStats &TraceParser::getStallStats() const
 {
-	return __parseBuffer(TRACE_TYPE_FTRACE, index);
+	return stallStats;
 }
 
-/* This parses a buffer */
-__always_inline bool TraceParser::parsePerfBuffer(unsigned int index)
+__always_inline bool TraceParser::isFollowing() const
 {
-	return __parseBuffer(TRACE_TYPE_PERF, index);
+	return following;
 }
 
-/* This parses a buffer */
-__always_inline bool TraceParser::__parseBuffer(tracetype_t ttype,
-						unsigned int index)
+__always_inline int64_t TraceParser::getIndexedEvents() const
 {
+	return indexedEvents;
+}
+
+/* This stitches a buffer */
+__always_inline bool TraceParser::stitchFtraceBuffer(unsigned int index)
+{
+	return __stitchBuffer(TRACE_TYPE_FTRACE, index);
+}
+
+/* This stitches a buffer */
+__always_inline bool TraceParser::stitchPerfBuffer(unsigned int index)
+{
+	return __stitchBuffer(TRACE_TYPE_PERF, index);
+}
+
+/*
+ * This is called by a reader thread after it has tokenized a buffer. Only the
+ * grammar is applied here, whatever depends on the previous buffers is left to
+ * stitchEvents(), which the parserThread calls in the order of the buffers.
+ */
+__always_inline void TraceParser::parseLines(tracetype_t ttype,
+					     unsigned int reader,
+					     ThreadBuffer<TraceLine> *tbuf,
+					     ParsedBuffer *pbuf)
+{
+	FtraceGrammar *fgrammar = readerFtraceGrammars[reader];
+	PerfGrammar *pgrammar = readerPerfGrammars[reader];
+	MemPool *pool = pbuf->argvPool != nullptr ? pbuf->argvPool :
+		readerPtrPools[reader];
+	const SchedPayloads *payloads = ttype == TRACE_TYPE_FTRACE ?
+		&ftracePayloads : &perfPayloads;
+	int64_t infoBegin = -1;
 	unsigned int i, s;
-	bool eof;
 	const TString **argv;
-
-	ThreadBuffer<TraceLine> *tbuf = tbuffers[index];
-	tbuf->beginConsumeBuffer();
+	bool ok;
 
 	s = tbuf->list.size();
-	argv = (const TString**) ptrPool->preallocN(EVENT_MAX_NR_ARGS);
+	argv = (const TString**) pool->preallocN(EVENT_MAX_NR_ARGS);
 
 	for(i = 0; i < s; i++) {
 		TraceLine &line = tbuf->list[i];
-		if (ttype == TRACE_TYPE_FTRACE) {
-			TraceEvent &event = ftraceEvents->preAlloc();
-			event.argc = 0;
-			event.argv = argv;
-			if (parseLineFtrace(line, event)) {
-				argv = (const TString**)
-					ptrPool->preallocN(EVENT_MAX_NR_ARGS);
-			}
-		} else if (ttype == TRACE_TYPE_PERF) {
-			TraceEvent &event = perfEvents->preAlloc();
-			event.argc = 0;
-			event.argv = argv;
-			if (parseLinePerf(line, event)) {
-				argv = (const TString**)
-					ptrPool->preallocN(EVENT_MAX_NR_ARGS);
-			}
+		TraceEvent &event = pbuf->events.preAlloc();
+		event.argc = 0;
+		event.argv = argv;
+		if (ttype == TRACE_TYPE_FTRACE)
+			ok = fgrammar->parseLine(line, event);
+		else
+			ok = pgrammar->parseLine(line, event);
+		if (!ok) {
+			if (infoBegin < 0)
+				infoBegin = line.begin;
+			continue;
+		}
+
+		if (!event.hasLazyArgs())
+			pool->commitN(event.argc);
+		argv = (const TString**) pool->preallocN(EVENT_MAX_NR_ARGS);
+
+		SchedPayload &p = pbuf->payloads.preAlloc();
+		if (payloads->decodeInto(ttype, event, &p)) {
+			event.payload = pbuf->payloads.size();
+			pbuf->payloads.commit();
+		} else if (SchedPayloads::isDecoded(event.type)) {
+			event.payload = SCHED_PAYLOAD_NONE;
 		}
+		event.postEventInfo = nullptr;
+		pbuf->events.commit();
+
+		ParsedBuffer::Line &pline = pbuf->lines.increase();
+		pline.begin = line.begin;
+		pline.infoBegin = infoBegin;
+		infoBegin = -1;
 	}
+	pbuf->trailingInfo = infoBegin;
+	pbuf->valid = true;
+}
+
+/*
+ * This stitches a buffer, ttype is TRACE_TYPE_UNKNOWN to stitch both types.
+ * It returns with windowMutex locked, so that the caller can post the new
+ * size of the list before the events are evicted.
+ */
+__always_inline bool TraceParser::__stitchBuffer(tracetype_t ttype,
+						 unsigned int index)
+{
+	bool eof;
+
+	ThreadBuffer<TraceLine> *tbuf = tbuffers[index];
+	tbuf->beginConsumeBuffer();
+	windowMutex.lock();
+
+	if (ttype != TRACE_TYPE_PERF && ftraceParsed[index]->valid)
+		stitchEvents(TRACE_TYPE_FTRACE, ftraceParsed[index]);
+	if (ttype != TRACE_TYPE_FTRACE && perfParsed[index]->valid)
+		stitchEvents(TRACE_TYPE_PERF, perfParsed[index]);
+
 	eof = tbuf->loadBuffer->isEOF();
 	tbuf->endConsumeBuffer();
 	return eof;
 }
 
-__always_inline bool TraceParser::parseLineFtrace(TraceLine &line,
-						  TraceEvent &event)
+/*
+ * This moves the events that a reader has parsed from a buffer to the list of
+ * events, so that they are committed in the order of the file.
+ */
+__always_inline void TraceParser::stitchEvents(tracetype_t ttype,
+					       ParsedBuffer *pbuf)
 {
-	if (ftraceGrammar->parseLine(line, event)) {
-		/* Check if the timestamp of this event is affected by
-		 * the infamous ftrace timestamp rollover bug and
-		 * try to correct it */
-		if (event.time < ftraceLineData.prevTime) {
-			if (!parseLineBugFixup(&event, ftraceLineData.prevTime))
-				return true;
-		}
-		ftraceLineData.prevTime = event.time;
-
-		ptrPool->commitN(event.argc);
-		ftraceEvents->commit();
+	vtl::TList<TraceEvent> *list;
+	SchedPayloads *payloads;
+	TraceLineData *lineData;
+	const SchedPayload *p;
+	const TString **argv;
+	int i, s;
 
-		event.postEventInfo = nullptr;
-		ftraceLineData.nrEvents++;
-		/* probably not necessary because ftrace traces doesn't
-		 * have backtraces and stuff but do it anyway */
-		ftraceLineData.prevLineIsEvent = true;
-		return true;
+	if (ttype == TRACE_TYPE_FTRACE) {
+		list = ftraceEvents;
+		payloads = &ftracePayloads;
+		lineData = &ftraceLineData;
+	} else {
+		list = perfEvents;
+		payloads = &perfPayloads;
+		lineData = &perfLineData;
 	}
-	return false;
-}
 
-__always_inline bool TraceParser::parseLinePerf(TraceLine &line,
-						TraceEvent &event)
-{
-	if (perfGrammar->parseLine(line, event)) {
+	s = pbuf->events.size();
+	for (i = 0; i < s; i++) {
+		const ParsedBuffer::Line &line = pbuf->lines.at(i);
+		TraceEvent &event = list->preAlloc();
+		event = pbuf->events.at(i);
+		if (pbuf->argvPool != nullptr && event.argc > 0) {
+			argv = (const TString**) ptrPool->allocN(event.argc);
+			memcpy(argv, event.argv,
+			       event.argc * sizeof(const TString*));
+			event.argv = argv;
+		}
+
+		/* Only perf traces have info lines, e.g. backtraces */
+		if (ttype == TRACE_TYPE_PERF && line.infoBegin >= 0 &&
+		    lineData->prevLineIsEvent) {
+			lineData->infoBegin = line.infoBegin;
+			lineData->prevLineIsEvent = false;
+		}
+
 		/* Check if the timestamp of this event is affected by
 		 * the infamous ftrace timestamp rollover bug and
 		 * try to correct it */
-		if (event.time < perfLineData.prevTime) {
-			if (!parseLineBugFixup(&event, perfLineData.prevTime))
-				return true;
+		if (event.getTime() < lineData->prevTime) {
+			if (!parseLineBugFixup(&event, lineData->prevTime))
+				continue;
 		}
-		perfLineData.prevTime = event.time;
-
-		ptrPool->commitN(event.argc);
-		perfEvents->commit();
-
-		if (perfLineData.prevLineIsEvent) {
-			perfLineData.prevEvent->postEventInfo = nullptr;
-		} else {
-			Chunk *chunk = (Chunk*) postEventPool->
-				allocObj();
-			chunk->offset = perfLineData.infoBegin;
-			chunk->len = line.begin - perfLineData.infoBegin;
-			perfLineData.prevEvent->postEventInfo = chunk;
-			perfLineData.prevLineIsEvent = true;
+		lineData->prevTime = event.getTime();
+
+		if (SchedPayloads::isDecoded(event.type)) {
+			p = event.payload == SCHED_PAYLOAD_NONE ? nullptr :
+				&pbuf->payloads.at(event.payload);
+			payloads->add(event, p);
 		}
-		perfLineData.prevEvent = &event;
-		perfLineData.nrEvents++;
-		return true;
-	} else {
-		if (perfLineData.prevLineIsEvent) {
-			perfLineData.infoBegin = line.begin;
-			perfLineData.prevLineIsEvent = false;
+		list->commit();
+
+		if (ttype == TRACE_TYPE_PERF) {
+			if (lineData->prevLineIsEvent) {
+				lineData->prevEvent->postEventInfo = nullptr;
+			} else {
+				Chunk *chunk = (Chunk*) postEventPool->
+					allocObj();
+				chunk->offset = lineData->infoBegin;
+				chunk->len = line.begin - lineData->infoBegin;
+				lineData->prevEvent->postEventInfo = chunk;
+				lineData->prevLineIsEvent = true;
+			}
+			lineData->prevEvent = &event;
 		}
-		return false;
+		lineData->nrEvents++;
+	}
+
+	if (ttype == TRACE_TYPE_PERF && pbuf->trailingInfo >= 0 &&
+	    lineData->prevLineIsEvent) {
+		lineData->infoBegin = pbuf->trailingInfo;
+		lineData->prevLineIsEvent = false;
 	}
 }
 
@@ -259,4 +449,9 @@ __always_inline vtl::TList<TraceEvent> *TraceParser::getEventsTList() const
 	return events;
 }
 
+__always_inline const SchedPayloads *TraceParser::getSchedPayloads() const
+{
+	return events == ftraceEvents ? &ftracePayloads : &perfPayloads;
+}
+
 #endif /* TRACEPARSER_H */
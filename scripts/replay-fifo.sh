@@ -0,0 +1,83 @@
+#!/bin/sh
+# SPDX-License-Identifier: (GPL-2.0-or-later OR BSD-2-Clause)
+#
+#  replay-fifo.sh - a script to replay a trace into a FIFO, for testing the
+#  follow mode of traceshark
+#  Copyright (C) 2026  Viktor Rosendahl <viktor.rosendahl@gmail.com>
+#
+#  This file is dual licensed: you can use it either under the terms of
+#  the GPL, or the BSD license, at your option.
+#
+#   a) This program is free software; you can redistribute it and/or
+#      modify it under the terms of the GNU General Public License as
+#      published by the Free Software Foundation; either version 2 of the
+#      License, or (at your option) any later version.
+#
+#      This program is distributed in the hope that it will be useful,
+#      but WITHOUT ANY WARRANTY; without even the implied warranty of
+#      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#      GNU General Public License for more details.
+#
+#      You should have received a copy of the GNU General Public
+#      License along with this library; if not, write to the Free
+#      Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+#      MA 02110-1301 USA
+#
+#  Alternatively,
+#
+#   b) Redistribution and use in source and binary forms, with or
+#      without modification, are permitted provided that the following
+#      conditions are met:
+#
+#      1. Redistributions of source code must retain the above
+#         copyright notice, this list of conditions and the following
+#         disclaimer.
+#      2. Redistributions in binary form must reproduce the above
+#         copyright notice, this list of conditions and the following
+#         disclaimer in the documentation and/or other materials
+#         provided with the distribution.
+#
+#      THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+#      CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+#      INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+#      MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+#      DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+#      CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+#      SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+#      NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+#      LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+#      HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+#      CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+#      OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+#      EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+# The trace is written to the FIFO in chunks of <lines per second> lines, one
+# chunk per second, while traceshark follows it with:
+#
+#     traceshark --follow <fifo>
+#
+# With a trace that has more events than FOLLOW_WINDOW_EVENTS, the oldest
+# events should disappear from the beginning of the trace while the new ones
+# are appended, without the trace being reopened.
+
+if [ $# -lt 2 ];then
+    echo "$0 <trace filename> <fifo> [<lines per second>]"
+    exit
+fi
+
+trace_name=$1
+fifo_name=$2
+rate=10000
+
+if [ $# -gt 2 ];then
+    rate=$3
+fi
+
+if [ ! -p $fifo_name ];then
+    mkfifo $fifo_name || exit 1
+fi
+
+# The FIFO stays open until the whole trace has been written, so traceshark
+# doesn't see EOF between the chunks.
+awk -v rate=$rate '{ print; } NR % rate == 0 { fflush(); system("sleep 1"); }' \
+    $trace_name > $fifo_name
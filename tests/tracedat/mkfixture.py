@@ -0,0 +1,212 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: (GPL-2.0-or-later OR BSD-2-Clause)
+#
+#  mkfixture.py - generates the trace.dat fixture of the tests
+#  Copyright (C) 2019  Viktor Rosendahl <viktor.rosendahl@gmail.com>
+#
+#  This file is dual licensed: you can use it either under the terms of
+#  the GPL, or the BSD license, at your option.
+#
+#   a) This program is free software; you can redistribute it and/or
+#      modify it under the terms of the GNU General Public License as
+#      published by the Free Software Foundation; either version 2 of the
+#      License, or (at your option) any later version.
+#
+#      This program is distributed in the hope that it will be useful,
+#      but WITHOUT ANY WARRANTY; without even the implied warranty of
+#      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#      GNU General Public License for more details.
+#
+#      You should have received a copy of the GNU General Public
+#      License along with this library; if not, write to the Free
+#      Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+#      MA 02110-1301 USA
+#
+#  Alternatively,
+#
+#   b) Redistribution and use in source and binary forms, with or
+#      without modification, are permitted provided that the following
+#      conditions are met:
+#
+#      1. Redistributions of source code must retain the above
+#         copyright notice, this list of conditions and the following
+#         disclaimer.
+#      2. Redistributions in binary form must reproduce the above
+#         copyright notice, this list of conditions and the following
+#         disclaimer in the documentation and/or other materials
+#         provided with the distribution.
+#
+#      THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+#      CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+#      INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+#      MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+#      DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+#      CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+#      SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+#      NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+#      LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+#      HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+#      CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+#      OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+#      EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#
+
+# This writes a small trace-cmd version 6 trace.dat file, with two CPUs and
+# the events that tst_tracedat.cpp expects. The file is committed, so this
+# only needs to be run if the test is changed:
+#
+#     ./mkfixture.py fixtures/sched.dat
+
+import struct
+import sys
+
+PAGE_SIZE = 4096
+
+COMMON = (
+    "\tfield:unsigned short common_type;\toffset:0;\tsize:2;\tsigned:0;\n"
+    "\tfield:unsigned char common_flags;\toffset:2;\tsize:1;\tsigned:0;\n"
+    "\tfield:unsigned char common_preempt_count;\toffset:3;\tsize:1;"
+    "\tsigned:0;\n"
+    "\tfield:int common_pid;\toffset:4;\tsize:4;\tsigned:1;\n\n")
+
+STATES = "0x0001 | 0x0002 | 0x0004 | 0x0008 | 0x0010 | 0x0020"
+FLAGS = ('{ 0x0001, "S" }, { 0x0002, "D" }, { 0x0004, "T" }, '
+         '{ 0x0008, "t" }, { 0x0010, "X" }, { 0x0020, "Z" }')
+
+SWITCH_ID = 316
+WAKEUP_ID = 318
+TEST_ID = 500
+
+SWITCH_FORMAT = (
+    "name: sched_switch\nID: %d\nformat:\n" % SWITCH_ID + COMMON +
+    "\tfield:char prev_comm[16];\toffset:8;\tsize:16;\tsigned:1;\n"
+    "\tfield:pid_t prev_pid;\toffset:24;\tsize:4;\tsigned:1;\n"
+    "\tfield:int prev_prio;\toffset:28;\tsize:4;\tsigned:1;\n"
+    "\tfield:long prev_state;\toffset:32;\tsize:8;\tsigned:1;\n"
+    "\tfield:char next_comm[16];\toffset:40;\tsize:16;\tsigned:1;\n"
+    "\tfield:pid_t next_pid;\toffset:56;\tsize:4;\tsigned:1;\n"
+    "\tfield:int next_prio;\toffset:60;\tsize:4;\tsigned:1;\n\n"
+    "print fmt: \"prev_comm=%%s prev_pid=%%d prev_prio=%%d "
+    "prev_state=%%s%%s ==> next_comm=%%s next_pid=%%d next_prio=%%d\", "
+    "REC->prev_comm, REC->prev_pid, REC->prev_prio, "
+    "(REC->prev_state & ((((0x0000 | %s) + 1) << 1) - 1)) ? "
+    "__print_flags(REC->prev_state & ((((0x0000 | %s) + 1) << 1) - 1), "
+    "\"|\", %s) : \"R\", REC->prev_state & (((0x0000 | %s) + 1) << 1) ? "
+    "\"+\" : \"\", REC->next_comm, REC->next_pid, REC->next_prio\n"
+    % (STATES, STATES, FLAGS, STATES))
+
+WAKEUP_FORMAT = (
+    "name: sched_wakeup\nID: %d\nformat:\n" % WAKEUP_ID + COMMON +
+    "\tfield:char comm[16];\toffset:8;\tsize:16;\tsigned:1;\n"
+    "\tfield:pid_t pid;\toffset:24;\tsize:4;\tsigned:1;\n"
+    "\tfield:int prio;\toffset:28;\tsize:4;\tsigned:1;\n"
+    "\tfield:int success;\toffset:32;\tsize:4;\tsigned:1;\n"
+    "\tfield:int target_cpu;\toffset:36;\tsize:4;\tsigned:1;\n\n"
+    "print fmt: \"comm=%s pid=%d prio=%d target_cpu=%03d\", "
+    "REC->comm, REC->pid, REC->prio, REC->target_cpu\n")
+
+TEST_FORMAT = (
+    "name: test_event\nID: %d\nformat:\n" % TEST_ID + COMMON +
+    "\tfield:int value;\toffset:8;\tsize:4;\tsigned:1;\n"
+    "\tfield:char label[8];\toffset:12;\tsize:8;\tsigned:1;\n\n"
+    "print fmt: \"value=%d label=%s\", REC->value, REC->label\n")
+
+HEADER_PAGE = (
+    "\tfield: u64 timestamp;\toffset:0;\tsize:8;\tsigned:0;\n"
+    "\tfield: local_t commit;\toffset:8;\tsize:8;\tsigned:1;\n"
+    "\tfield: int overwrite;\toffset:8;\tsize:1;\tsigned:1;\n"
+    "\tfield: char data;\toffset:16;\tsize:4080;\tsigned:1;\n")
+
+HEADER_EVENT = (
+    "# compressed entry header\n"
+    "\ttype_len    :    5 bits\n"
+    "\ttime_delta  :   27 bits\n"
+    "\tarray       :   32 bits\n")
+
+CMDLINES = "100 bash\n200 worker\n300 oldname\n"
+
+
+def comm(name):
+    return name.encode().ljust(16, b"\0")
+
+
+def common(type_id, pid):
+    return struct.pack("<HBBi", type_id, 0, 0, pid)
+
+
+def sched_switch(pid, prev, prev_pid, state, nxt, next_pid):
+    return (common(SWITCH_ID, pid) + comm(prev) +
+            struct.pack("<iiq", prev_pid, 120, state) + comm(nxt) +
+            struct.pack("<ii", next_pid, 120))
+
+
+def sched_wakeup(pid, name, wpid, cpu):
+    return (common(WAKEUP_ID, pid) + comm(name) +
+            struct.pack("<iiii", wpid, 120, 1, cpu))
+
+
+def test_event(pid, value, label):
+    return (common(TEST_ID, pid) + struct.pack("<i", value) +
+            label.encode().ljust(8, b"\0"))
+
+
+def page(events):
+    """events is a list of (timestamp, data), the first is the page time"""
+    base = events[0][0]
+    prev = base
+    data = b""
+    for ts, ev in events:
+        assert len(ev) % 4 == 0 and len(ev) <= 28 * 4
+        data += struct.pack("<I", (len(ev) // 4) | ((ts - prev) << 5)) + ev
+        prev = ts
+    header = struct.pack("<QQ", base, len(data))
+    return (header + data).ljust(PAGE_SIZE, b"\0")
+
+
+def string(s):
+    return s.encode() + b"\0"
+
+
+def sized64(text):
+    return struct.pack("<Q", len(text)) + text.encode()
+
+
+def main():
+    cpu0 = page([
+        (1000, sched_switch(100, "bash", 100, 0x0001, "worker", 200)),
+        (1500, test_event(200, -7, "hello")),
+        (2000, sched_wakeup(200, "bash", 100, 1)),
+        (3000, sched_switch(200, "worker", 200, 0x0040, "bash", 100)),
+    ])
+    cpu1 = page([
+        (2500, sched_switch(0, "swapper/1", 0, 0, "renamed", 300)),
+    ])
+
+    out = b"\x17\x08\x44tracing" + string("6") + b"\0\x08"
+    out += struct.pack("<I", PAGE_SIZE)
+    out += string("header_page") + sized64(HEADER_PAGE)
+    out += string("header_event") + sized64(HEADER_EVENT)
+    out += struct.pack("<I", 0)
+    out += struct.pack("<I", 2)
+    out += string("sched") + struct.pack("<I", 2)
+    out += sized64(SWITCH_FORMAT) + sized64(WAKEUP_FORMAT)
+    out += string("test") + struct.pack("<I", 1) + sized64(TEST_FORMAT)
+    out += struct.pack("<II", 0, 0)
+    out += sized64(CMDLINES)
+    out += struct.pack("<I", 2)
+    out += string("options  ") + struct.pack("<H", 0)
+    out += string("flyrecord")
+
+    # The pages start at the next page boundary after the CPU table
+    offset = len(out) + 2 * 16
+    offset = (offset + PAGE_SIZE - 1) // PAGE_SIZE * PAGE_SIZE
+    out += struct.pack("<QQ", offset, PAGE_SIZE)
+    out += struct.pack("<QQ", offset + PAGE_SIZE, PAGE_SIZE)
+    out = out.ljust(offset, b"\0") + cpu0 + cpu1
+
+    with open(sys.argv[1], "wb") as f:
+        f.write(out)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,262 @@
+// SPDX-License-Identifier: (GPL-2.0-or-later OR BSD-2-Clause)
+/*
+ * Traceshark - a visualizer for visualizing ftrace and perf traces
+ * Copyright (C) 2019  Viktor Rosendahl <viktor.rosendahl@gmail.com>
+ *
+ * This file is dual licensed: you can use it either under the terms of
+ * the GPL, or the BSD license, at your option.
+ *
+ *  a) This program is free software; you can redistribute it and/or
+ *     modify it under the terms of the GNU General Public License as
+ *     published by the Free Software Foundation; either version 2 of the
+ *     License, or (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public
+ *     License along with this library; if not, write to the Free
+ *     Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ *     MA 02110-1301 USA
+ *
+ * Alternatively,
+ *
+ *  b) Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *     1. Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *     2. Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *     CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *     INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *     MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *     DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *     CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *     NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *     LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *     HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *     CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ *     OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *     EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This decodes the trace.dat file in fixtures/sched.dat, which is generated
+ * by mkfixture.py, and checks that the scheduler events get their payloads
+ * and task names from the binary fields, without any formatted arguments.
+ */
+
+#include <cstdio>
+#include <cstring>
+
+extern "C" {
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+}
+
+#include "mm/mempool.h"
+#include "parser/ftrace/ftracegrammar.h"
+#include "parser/schedpayload.h"
+#include "parser/tracedat/tracedat.h"
+#include "parser/traceevent.h"
+#include "threads/indexwatcher.h"
+#include "vtl/tlist.h"
+
+#ifndef FIXTURE_DIR
+#define FIXTURE_DIR "fixtures"
+#endif
+
+static int nrFailures = 0;
+
+#define CHECK(COND)							\
+	do {								\
+		if (!(COND)) {						\
+			fprintf(stderr, "%s:%d: check failed: %s\n",	\
+				__FILE__, __LINE__, #COND);		\
+			nrFailures++;					\
+		}							\
+	} while (0)
+
+static bool nameIs(const SchedPayloads *payloads, int id, const char *name)
+{
+	const TString *str = payloads->getName(id);
+
+	return str != nullptr && str->len == (int) strlen(name) &&
+		memcmp(str->ptr, name, str->len) == 0;
+}
+
+static bool argsAre(const TraceDat *dat, const TraceEvent &event,
+		    const char *args)
+{
+	char buf[256];
+	int len;
+
+	len = dat->formatArgsAt(event.argOffset, buf, sizeof(buf));
+	if (strcmp(buf, args) != 0) {
+		fprintf(stderr, "got args \"%.*s\", expected \"%s\"\n", len,
+			buf, args);
+		return false;
+	}
+	return true;
+}
+
+static void checkEvents(const TraceDat *dat,
+			const vtl::TList<TraceEvent> &events,
+			const SchedPayloads &payloads)
+{
+	const SchedPayload *p;
+	int i;
+
+	CHECK(events.size() == 5);
+	if (events.size() != 5)
+		return;
+
+	/* The events of both CPUs are merged by time */
+	for (i = 0; i < events.size(); i++) {
+		CHECK(events[i].hasRawArgs());
+		CHECK(events[i].getTime().toNanoseconds() ==
+		      (vtl::Time::timeint_t) (1000 + i * 500));
+	}
+
+	const TraceEvent &sw0 = events[0];
+	CHECK(sw0.type == SCHED_SWITCH);
+	CHECK(sw0.cpu == 0);
+	CHECK(sw0.pid == 100);
+	p = payloads.get(sw0);
+	CHECK(p != nullptr);
+	if (p != nullptr) {
+		CHECK(p->sw.oldpid == 100);
+		CHECK(p->sw.newpid == 200);
+		CHECK(p->sw.state == TASK_FLAG_INTERRUPTIBLE);
+		CHECK(nameIs(&payloads, p->sw.oldname, "bash"));
+		CHECK(nameIs(&payloads, p->sw.newname, "worker"));
+	}
+	CHECK(argsAre(dat, sw0, "bash:100 [120] S ==> worker:200 [120]"));
+
+	/* An event that traceshark doesn't know */
+	const TraceEvent &test = events[1];
+	CHECK(test.type >= EVENT_UNKNOWN);
+	CHECK(test.pid == 200);
+	CHECK(argsAre(dat, test, "value=-7 label=hello"));
+
+	const TraceEvent &wakeup = events[2];
+	CHECK(wakeup.type == SCHED_WAKEUP);
+	p = payloads.get(wakeup);
+	CHECK(p != nullptr);
+	if (p != nullptr) {
+		CHECK(p->wakeup.pid == 100);
+		CHECK(p->wakeup.cpu == 1);
+		CHECK(p->wakeup.success);
+		CHECK(nameIs(&payloads, p->wakeup.name, "bash"));
+		CHECK(p->wakeup.name == payloads.get(sw0)->sw.oldname);
+	}
+
+	/* The name in the record wins over the saved cmdline */
+	const TraceEvent &sw1 = events[3];
+	CHECK(sw1.type == SCHED_SWITCH);
+	CHECK(sw1.cpu == 1);
+	p = payloads.get(sw1);
+	CHECK(p != nullptr);
+	if (p != nullptr) {
+		CHECK(p->sw.newpid == 300);
+		CHECK(p->sw.state == TASK_STATE_RUNNABLE);
+		CHECK(nameIs(&payloads, p->sw.newname, "renamed"));
+	}
+
+	const TraceEvent &sw2 = events[4];
+	p = payloads.get(sw2);
+	CHECK(p != nullptr);
+	if (p != nullptr) {
+		CHECK(p->sw.state == (TASK_STATE_RUNNABLE |
+				      TASK_FLAG_PREEMPT));
+		CHECK(p->sw.oldname == payloads.get(sw0)->sw.newname);
+	}
+	CHECK(argsAre(dat, sw2, "worker:200 [120] R+ ==> bash:100 [120]"));
+}
+
+/* This is what a trace index does when it restores the events */
+static void checkRedecode(TraceDat *dat, FtraceGrammar *grammar,
+			  const vtl::TList<TraceEvent> &events,
+			  const SchedPayloads &payloads)
+{
+	SchedPayloads restored;
+	const SchedPayload *p, *q;
+	TraceEvent event;
+	int i;
+
+	for (i = 0; i < events.size(); i++) {
+		event = events[i];
+		dat->decodeRecordAt(event.argOffset, grammar, &restored,
+				    event);
+		if (!SchedPayloads::isDecoded(event.type))
+			continue;
+		p = payloads.get(events[i]);
+		q = restored.get(event);
+		CHECK(q != nullptr);
+		if (p == nullptr || q == nullptr)
+			continue;
+		if (event.type == SCHED_SWITCH) {
+			CHECK(q->sw.oldpid == p->sw.oldpid);
+			CHECK(q->sw.newpid == p->sw.newpid);
+			CHECK(q->sw.state == p->sw.state);
+		} else {
+			CHECK(q->wakeup.pid == p->wakeup.pid);
+		}
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	const char *name = argc > 1 ? argv[1] : FIXTURE_DIR "/sched.dat";
+	vtl::TList<TraceEvent> events;
+	SchedPayloads payloads;
+	FtraceGrammar grammar;
+	MemPool ptrPool(16, sizeof(TString*));
+	IndexWatcher watcher;
+	struct stat st;
+	void *map;
+	int fd;
+	int rval;
+
+	fd = open(name, O_RDONLY);
+	if (fd < 0 || fstat(fd, &st) != 0) {
+		perror(name);
+		return 1;
+	}
+	map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		perror(name);
+		return 1;
+	}
+
+	TraceDat dat((const char*) map, st.st_size);
+	rval = dat.readHeaders();
+	CHECK(rval == 0);
+	if (rval == 0) {
+		dat.readEvents(&grammar, &events, &payloads, &ptrPool,
+			       &watcher);
+		checkEvents(&dat, events, payloads);
+		checkRedecode(&dat, &grammar, events, payloads);
+	}
+
+	munmap(map, st.st_size);
+	if (nrFailures > 0) {
+		fprintf(stderr, "%d checks failed\n", nrFailures);
+		return 1;
+	}
+	printf("All checks passed\n");
+	return 0;
+}
@@ -0,0 +1,152 @@
+// SPDX-License-Identifier: (GPL-2.0-or-later OR BSD-2-Clause)
+/*
+ * Traceshark - a visualizer for visualizing ftrace and perf traces
+ * Copyright (C) 2019  Viktor Rosendahl <viktor.rosendahl@gmail.com>
+ *
+ * This file is dual licensed: you can use it either under the terms of
+ * the GPL, or the BSD license, at your option.
+ *
+ *  a) This program is free software; you can redistribute it and/or
+ *     modify it under the terms of the GNU General Public License as
+ *     published by the Free Software Foundation; either version 2 of the
+ *     License, or (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public
+ *     License along with this library; if not, write to the Free
+ *     Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ *     MA 02110-1301 USA
+ *
+ * Alternatively,
+ *
+ *  b) Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *     1. Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *     2. Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *     CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *     INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *     MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *     DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *     CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *     NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *     LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *     HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *     CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ *     OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *     EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <climits>
+
+#include "threads/handoff.h"
+
+extern "C" {
+#include <sched.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+}
+
+#ifdef __linux__
+__always_inline static void futex_wait(int *addr, int value)
+{
+	syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, value, nullptr, nullptr,
+		0);
+}
+
+__always_inline static void futex_wake(int *addr)
+{
+	syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr,
+		0);
+}
+#else
+/* Without futexes we simply give up the CPU until the state changes */
+__always_inline static void futex_wait(int *addr, int value)
+{
+	(void) addr;
+	(void) value;
+	sched_yield();
+}
+
+__always_inline static void futex_wake(int *addr)
+{
+	(void) addr;
+}
+#endif
+
+Handoff::Handoff(int initial):
+	state(initial), sleepers(0), spinLimit(HANDOFF_SPIN_INIT)
+{
+	/* Spinning is pointless if the other thread cannot run meanwhile */
+	if (sysconf(_SC_NPROCESSORS_ONLN) <= 1)
+		spinLimit = 0;
+}
+
+void Handoff::waitSlow(int wanted, StallCounter *stall)
+{
+	int64_t start = 0;
+	int limit;
+	int i;
+
+	if (stall != nullptr)
+		start = StallCounter::now();
+
+	limit = __atomic_load_n(&spinLimit, __ATOMIC_RELAXED);
+	for (i = 0; i < limit; i++) {
+		handoff_cpu_relax();
+		if (get() == wanted) {
+			/* Spinning paid off, so allow some more of it */
+			if (limit < HANDOFF_SPIN_MAX)
+				__atomic_store_n(&spinLimit, limit + limit / 8 + 1,
+						 __ATOMIC_RELAXED);
+			goto out;
+		}
+	}
+	sleepFor(wanted);
+out:
+	if (stall != nullptr)
+		stall->add(StallCounter::now() - start);
+}
+
+/*
+ * The sleepers counter is incremented before the state is checked and set()
+ * checks the counter after changing the state, so either we see the new state
+ * here or set() sees us. If the state changes between the check and the
+ * futex_wait(), then the futex_wait() returns immediately.
+ */
+void Handoff::sleepFor(int wanted)
+{
+	int limit;
+	int cur;
+
+	/* Spinning did not help, so spin less the next time */
+	limit = __atomic_load_n(&spinLimit, __ATOMIC_RELAXED);
+	if (limit > HANDOFF_SPIN_MIN)
+		__atomic_store_n(&spinLimit, limit - limit / 4, __ATOMIC_RELAXED);
+
+	__atomic_fetch_add(&sleepers, 1, __ATOMIC_SEQ_CST);
+	while ((cur = __atomic_load_n(&state, __ATOMIC_SEQ_CST)) != wanted)
+		futex_wait(&state, cur);
+	__atomic_fetch_sub(&sleepers, 1, __ATOMIC_SEQ_CST);
+}
+
+void Handoff::wakeSleepers()
+{
+	futex_wake(&state);
+}
@@ -0,0 +1,125 @@
+// SPDX-License-Identifier: (GPL-2.0-or-later OR BSD-2-Clause)
+/*
+ * Traceshark - a visualizer for visualizing ftrace and perf traces
+ * Copyright (C) 2019  Viktor Rosendahl <viktor.rosendahl@gmail.com>
+ *
+ * This file is dual licensed: you can use it either under the terms of
+ * the GPL, or the BSD license, at your option.
+ *
+ *  a) This program is free software; you can redistribute it and/or
+ *     modify it under the terms of the GNU General Public License as
+ *     published by the Free Software Foundation; either version 2 of the
+ *     License, or (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public
+ *     License along with this library; if not, write to the Free
+ *     Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ *     MA 02110-1301 USA
+ *
+ * Alternatively,
+ *
+ *  b) Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *     1. Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *     2. Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *     CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *     INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *     MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *     DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *     CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *     NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *     LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *     HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *     CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ *     OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *     EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef HANDOFF_H
+#define HANDOFF_H
+
+#include "threads/stallstats.h"
+#include "vtl/compiler.h"
+
+/*
+ * The number of times that a waiting thread checks the state before it goes
+ * to sleep. The limit adapts between the minimum and the maximum, depending on
+ * whether spinning has recently been successful.
+ */
+#define HANDOFF_SPIN_MIN (64)
+#define HANDOFF_SPIN_INIT (2048)
+#define HANDOFF_SPIN_MAX (32768)
+
+#if defined(__x86_64__) || defined(__i386__)
+#define handoff_cpu_relax() __builtin_ia32_pause()
+#elif defined(__aarch64__) || defined(__arm__)
+#define handoff_cpu_relax() __asm__ __volatile__("yield" ::: "memory")
+#else
+#define handoff_cpu_relax() __asm__ __volatile__("" ::: "memory")
+#endif
+
+/*
+ * This class is the state of a buffer that is passed around between a fixed
+ * sequence of threads, where every state is only waited for by one thread at a
+ * time. The state is a single word that is changed without locks. A thread
+ * that waits for a state first spins for a while, since the other stages
+ * usually finish their buffers soon, and only then sleeps on a futex. The
+ * thread that changes the state only makes a system call if someone is
+ * sleeping.
+ */
+class Handoff
+{
+public:
+	Handoff(int initial = 0);
+	__always_inline int get() const;
+	__always_inline void waitFor(int wanted,
+				     StallCounter *stall = nullptr);
+	__always_inline void set(int newState);
+private:
+	void waitSlow(int wanted, StallCounter *stall);
+	void sleepFor(int wanted);
+	void wakeSleepers();
+	int state;
+	int sleepers;
+	int spinLimit;
+};
+
+__always_inline int Handoff::get() const
+{
+	return __atomic_load_n(&state, __ATOMIC_ACQUIRE);
+}
+
+/*
+ * If stall is not nullptr, then the time spent waiting is added to it. The
+ * clock is only read if the state is not already the wanted one.
+ */
+__always_inline void Handoff::waitFor(int wanted, StallCounter *stall)
+{
+	if (likely(get() == wanted))
+		return;
+	waitSlow(wanted, stall);
+}
+
+__always_inline void Handoff::set(int newState)
+{
+	__atomic_store_n(&state, newState, __ATOMIC_SEQ_CST);
+	if (unlikely(__atomic_load_n(&sleepers, __ATOMIC_SEQ_CST) > 0))
+		wakeSleepers();
+}
+
+#endif /* HANDOFF_H */
@@ -53,12 +53,20 @@
 #include "threads/indexwatcher.h"
 
 IndexWatcher::IndexWatcher(int bSize) :
-	batchSize(bSize), isEOF(false), postedIndex(0), receivedIndex(0)
+	batchSize(bSize), isEOF(false), postedIndex(0), receivedIndex(0),
+	stall(nullptr)
 {}
 
 void IndexWatcher::setBatchSize(int bSize)
 {
+	mutex.lock();
 	batchSize = bSize;
+	mutex.unlock();
+}
+
+void IndexWatcher::setStallCounter(StallCounter *counter)
+{
+	stall = counter;
 }
 
 void IndexWatcher::sendEOF()
@@ -77,3 +85,15 @@ void IndexWatcher::reset()
 	receivedIndex = 0;
 	mutex.unlock();
 }
+
+/*
+ * The producer has removed the first n elements, so the indices that have
+ * been posted and received are lowered accordingly.
+ */
+void IndexWatcher::removeFirst(int n)
+{
+	mutex.lock();
+	postedIndex = postedIndex > n ? postedIndex - n : 0;
+	receivedIndex = receivedIndex > n ? receivedIndex - n : 0;
+	mutex.unlock();
+}
@@ -56,15 +56,20 @@
 #include <QMutex>
 #include <QWaitCondition>
 
+#include "threads/stallstats.h"
+
 class IndexWatcher
 {
 public:
 	IndexWatcher(int bSize = 100);
 	void setBatchSize(int bSize);
+	void setStallCounter(StallCounter *counter);
 	__always_inline void waitForNextBatch(bool &eof, int &index);
+	__always_inline void pollNextBatch(bool &eof, int &index);
 	__always_inline void sendNextIndex(int index);
 	void sendEOF();
 	void reset();
+	void removeFirst(int n);
 private:
 	int batchSize;
 	bool isEOF;
@@ -72,15 +77,24 @@ private:
 	int postedIndex;
 	/* This is the higher index being received by the consumer */
 	int receivedIndex;
+	/* The time that the consumer waits is recorded here */
+	StallCounter *stall;
 	QMutex mutex;
 	QWaitCondition batchCompleted;
 };
 
 __always_inline void IndexWatcher::waitForNextBatch(bool &eof, int &index)
 {
+	int64_t start;
+
 	mutex.lock();
-	while(!isEOF && postedIndex - receivedIndex < batchSize) {
-		batchCompleted.wait(&mutex);
+	if (!isEOF && postedIndex - receivedIndex < batchSize) {
+		start = stall != nullptr ? StallCounter::now() : 0;
+		do {
+			batchCompleted.wait(&mutex);
+		} while (!isEOF && postedIndex - receivedIndex < batchSize);
+		if (stall != nullptr)
+			stall->add(StallCounter::now() - start);
 	}
 	receivedIndex = postedIndex;
 	index = postedIndex;
@@ -88,6 +102,19 @@ __always_inline void IndexWatcher::waitForNextBatch(bool &eof, int &index)
 	mutex.unlock();
 }
 
+/*
+ * This is the non blocking variant of waitForNextBatch(), it returns whatever
+ * has been posted, regardless of the batch size.
+ */
+__always_inline void IndexWatcher::pollNextBatch(bool &eof, int &index)
+{
+	mutex.lock();
+	receivedIndex = postedIndex;
+	index = postedIndex;
+	eof = isEOF;
+	mutex.unlock();
+}
+
 __always_inline void IndexWatcher::sendNextIndex(int index)
 {
 	mutex.lock();
@@ -55,6 +55,7 @@
 #include <cstdlib>
 #include <cstring>
 #include "misc/tstring.h"
+#include "parser/compressed/compressedfile.h"
 #include "threads/loadbuffer.h"
 #include "vtl/error.h"
 
@@ -64,15 +65,24 @@ extern "C" {
 #include <errno.h>
 }
 
-LoadBuffer::LoadBuffer(unsigned int size):
-	buffer(nullptr), bufSize(size), nRead(0), filePos(0),
-	IOerror(false), IOerrno(0), state(LOADSTATE_EMPTY), eof(false)
+LoadBuffer::LoadBuffer(unsigned int size, bool allocMemory):
+	buffer(nullptr), memory(nullptr), readBegin(nullptr), bufSize(size),
+	nRead(0), filePos(0), IOerror(false), IOerrno(0),
+	state(LOADSTATE_EMPTY), stallStats(nullptr), eof(false)
 {
 	/*
-	 * We need the extra byte to be able to set a null character in
-	 * TraceFile::ReadNextWord() one byte out of bounds.
+	 * If the trace file is memory mapped, then produceMappedBuffer() will
+	 * point directly into the mapping and we don't need any memory.
 	 */
-	memory = (char*) mmap(nullptr, 2 * size + 1, PROT_READ | PROT_WRITE,
+	if (!allocMemory)
+		return;
+	/*
+	 * We need the extra byte to be able to set a null character one byte
+	 * out of bounds, after the last line. The padding is for the
+	 * tokenizer.
+	 */
+	memory = (char*) mmap(nullptr, 2 * size + LOADBUFFER_PADDING,
+			      PROT_READ | PROT_WRITE,
 			      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
 	if (memory == MAP_FAILED)
 		mmap_err();
@@ -81,15 +91,30 @@ LoadBuffer::LoadBuffer(unsigned int size):
 
 LoadBuffer::~LoadBuffer()
 {
-	if (munmap(memory, bufSize * 2 + 1) != 0)
+	if (memory == nullptr)
+		return;
+	if (munmap(memory, bufSize * 2 + LOADBUFFER_PADDING) != 0)
 		munmap_err();
 }
 
+/*
+ * If stats is not nullptr, then the time that the threads spend waiting for
+ * this buffer is recorded there, for the stage that each thread belongs to.
+ */
+void LoadBuffer::setStallStats(StallStats *stats)
+{
+	stallStats = stats;
+}
+
 /*
  * This function should be called from the IO thread until the function returns
- * true.
+ * true. If follow is true, then a read() that returns zero is not treated as
+ * EOF but produces an empty buffer, and an incomplete last line is kept in
+ * lineBegin until the rest of it has been written to the file. If cfile is not
+ * nullptr, then the data is decompressed from it instead of being read from fd.
  */
-bool LoadBuffer::produceBuffer(int fd, int64_t *filePosPtr, TString *lineBegin)
+bool LoadBuffer::produceBuffer(int fd, int64_t *filePosPtr, TString *lineBegin,
+			       bool follow, CompressedFile *cfile)
 {
 	ssize_t nRawBytes;
 	char *c;
@@ -103,7 +128,10 @@ bool LoadBuffer::produceBuffer(int fd, int64_t *filePosPtr, TString *lineBegin)
 	strncpy(buffer, lineBegin->ptr, lineBegin->len);
 
 	filePos = *filePosPtr;
-	nRawBytes = read(fd, readBegin, bufSize);
+	if (cfile != nullptr)
+		nRawBytes = cfile->read(readBegin, bufSize);
+	else
+		nRawBytes = read(fd, readBegin, bufSize);
 
 	if (nRawBytes < 0) {
 		IOerrno = errno;
@@ -115,26 +143,39 @@ bool LoadBuffer::produceBuffer(int fd, int64_t *filePosPtr, TString *lineBegin)
 	}
 
 	if (nRawBytes == 0) {
-		eof = true;
+		eof = !follow || IOerror;
 	} else {
 		eof = false;
 	}
 
+	nRead += nRawBytes;
 	lineBegin->len = 0;
 
-	for (c = readBegin + nRawBytes - 1; c >= readBegin; c--) {
-		if (*c == '\n')
-			break;
-		lineBegin->len++;
-	}
-
-	if (lineBegin->len > 0) {
-		c++;
-		strncpy(lineBegin->ptr, c, lineBegin->len);
+	/*
+	 * At EOF, the last line is delivered even if it lacks a newline.
+	 * Otherwise, everything after the last newline, including what was
+	 * carried over from the previous buffer, is carried over to the next.
+	 */
+	if (!eof) {
+		for (c = buffer + nRead - 1; c >= buffer; c--) {
+			if (*c == '\n')
+				break;
+			lineBegin->len++;
+		}
+		if ((size_t) lineBegin->len >= bufSize)
+			abort();
+		if (lineBegin->len > 0) {
+			c++;
+			strncpy(lineBegin->ptr, c, lineBegin->len);
+		}
 	}
 
-	nRead += nRawBytes;
 	nRead -= lineBegin->len;
+	/*
+	 * The words are not null terminated, but make sure that nobody
+	 * reads stale data after the last line.
+	 */
+	buffer[nRead] = '\0';
 
 	completeLoading();
 
@@ -142,6 +183,68 @@ bool LoadBuffer::produceBuffer(int fd, int64_t *filePosPtr, TString *lineBegin)
 	return eof;
 }
 
+/*
+ * This function is the zero copy alternative to produceBuffer(). It should be
+ * called from the IO thread until the function returns true. The buffer will
+ * point directly into map, which is a read only mapping of the whole trace
+ * file.
+ */
+bool LoadBuffer::produceMappedBuffer(char *map, int64_t mapSize,
+				     int64_t *filePosPtr)
+{
+	int64_t remaining;
+	char *c;
+
+	waitForConsumptionComplete();
+
+	filePos = *filePosPtr;
+	buffer = map + filePos;
+	remaining = mapSize - filePos;
+	IOerror = false;
+	IOerrno = 0;
+
+	if (remaining <= (int64_t) bufSize) {
+		nRead = remaining;
+		eof = true;
+	} else {
+		eof = false;
+		for (c = buffer + bufSize - 1; c >= buffer; c--) {
+			if (*c == '\n')
+				break;
+		}
+		/*
+		 * If there is no newline, then we have a line that is longer
+		 * than the buffer. The read() path would abort() here but we
+		 * can simply split the line.
+		 */
+		if (c < buffer)
+			nRead = bufSize;
+		else
+			nRead = c - buffer + 1;
+	}
+
+	completeLoading();
+
+	*filePosPtr += nRead;
+	return eof;
+}
+
+/*
+ * This function should be called from the IO thread after produceBuffer() or
+ * produceMappedBuffer() has returned true, in order to let the tokenizer threads that are waiting for
+ * another buffer know that there will be no more data.
+ */
+void LoadBuffer::produceEOF(int64_t filePos)
+{
+	waitForConsumptionComplete();
+	nRead = 0;
+	this->filePos = filePos;
+	IOerror = false;
+	IOerrno = 0;
+	eof = true;
+	completeLoading();
+}
+
 /*
  * This should be called from the load thread before starting to process a
  * buffer.
@@ -55,25 +55,36 @@
 
 #include <cstdint>
 
-#include <QMutex>
-#include <QWaitCondition>
+#include "threads/handoff.h"
+#include "threads/stallstats.h"
 
 extern "C" {
 #include <unistd.h>
 }
 
+class CompressedFile;
 class TString;
 
+/*
+ * The tokenizer reads the buffer in blocks and may read up to this many bytes
+ * beyond the end of the data in the buffer.
+ */
+#define LOADBUFFER_PADDING (64)
+
 /*
  * This class is a load buffer for three threads where one is a loader, i.e.
  * IO thread, and the second is a tokenizer, and the third is a consumer, which
  * probably is a grammar processing thread. The synchronization functions have
- * not been designed for scenarios with more than one thread per category
+ * not been designed for scenarios with more than one thread per category and
+ * buffer. Several tokenizer threads may work in parallel, as long as each
+ * buffer is always tokenized by the same thread. The buffers of a TraceFile
+ * form a ring, where the state of each buffer is handed over from one stage to
+ * the next without taking any locks.
  */
 class LoadBuffer
 {
 public:
-	LoadBuffer(unsigned int size);
+	LoadBuffer(unsigned int size, bool allocMemory = true);
 	~LoadBuffer();
 	char *buffer;
 	char *memory;
@@ -83,7 +94,12 @@ public:
 	int64_t filePos;
 	bool IOerror;
 	int IOerrno;
-	bool produceBuffer(int fd, int64_t *filePosPtr, TString *lineBegin);
+	bool produceBuffer(int fd, int64_t *filePosPtr, TString *lineBegin,
+			   bool follow = false,
+			   CompressedFile *cfile = nullptr);
+	bool produceMappedBuffer(char *map, int64_t mapSize,
+				 int64_t *filePosPtr);
+	void produceEOF(int64_t filePos);
 	void beginProduceBuffer();
 	void endProduceBuffer();
 	void beginTokenizeBuffer();
@@ -91,7 +107,9 @@ public:
 	void beginConsumeBuffer();
 	void endConsumeBuffer();
 	__always_inline bool isEOF() const;
+	void setStallStats(StallStats *stats);
 private:
+	__always_inline StallCounter *stallCounter(stallstage_t stage);
 	__always_inline void waitForLoadingComplete();
 	__always_inline void completeLoading();
 	__always_inline void waitForTokenizationComplete();
@@ -103,64 +121,40 @@ private:
 		LOADSTATE_LOADED,
 		LOADSTATE_TOKENIZED
 	} loadbufferstate_t;
-	loadbufferstate_t state;
-	QMutex mutex;
-	QWaitCondition consumptionComplete;
-	QWaitCondition loadingComplete;
-	QWaitCondition parsingComplete;
+	Handoff state;
+	StallStats *stallStats;
 	bool eof;
 };
 
+__always_inline StallCounter *LoadBuffer::stallCounter(stallstage_t stage)
+{
+	if (stallStats == nullptr)
+		return nullptr;
+	return stallStats->getCounter(stage);
+}
+
 __always_inline void LoadBuffer::waitForLoadingComplete() {
-	mutex.lock();
-	while(state != LOADSTATE_LOADED) {
-		/*
-		 * Note that this implicitely unlocks the mutex while waiting
-		 * and relocks it when done waiting.
-		 */
-		loadingComplete.wait(&mutex);
-	}
+	state.waitFor(LOADSTATE_LOADED, stallCounter(STALL_TOKENIZE));
 }
 
 __always_inline void LoadBuffer::completeLoading() {
-	state = LOADSTATE_LOADED;
-	loadingComplete.wakeOne();
-	mutex.unlock();
+	state.set(LOADSTATE_LOADED);
 }
 
 __always_inline void LoadBuffer::waitForTokenizationComplete() {
-	mutex.lock();
-	while(state != LOADSTATE_TOKENIZED) {
-		/*
-		 * Note that this implicitely unlocks the mutex while waiting
-		 * and relocks it when done waiting.
-		 */
-		parsingComplete.wait(&mutex);
-	}
+	state.waitFor(LOADSTATE_TOKENIZED, stallCounter(STALL_PARSE));
 }
 
 __always_inline void LoadBuffer::completeTokenization() {
-	state = LOADSTATE_TOKENIZED;
-	parsingComplete.wakeOne();
-	mutex.unlock();
+	state.set(LOADSTATE_TOKENIZED);
 }
 
-
 __always_inline void LoadBuffer::waitForConsumptionComplete() {
-	mutex.lock();
-	while(state != LOADSTATE_EMPTY) {
-		/*
-		 * Note that this implicitely unlocks the mutex while waiting
-		 * and relocks it when done waiting.
-		 */
-		consumptionComplete.wait(&mutex);
-	}
+	state.waitFor(LOADSTATE_EMPTY, stallCounter(STALL_LOAD));
 }
 
 __always_inline void LoadBuffer::completeConsumption() {
-	state = LOADSTATE_EMPTY;
-	consumptionComplete.wakeOne();
-	mutex.unlock();
+	state.set(LOADSTATE_EMPTY);
 }
 
 __always_inline bool LoadBuffer::isEOF() const {
@@ -60,36 +60,163 @@
 #include "vtl/error.h"
 
 extern "C" {
+#include <errno.h>
+#include <poll.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 }
 
-LoadThread::LoadThread(LoadBuffer **buffers, unsigned int nBuf, int myfd)
+/* How long to sleep when a followed file has no new data */
+#define FOLLOW_POLL_MS (100)
+
+LoadThread::LoadThread(LoadBuffer **buffers, unsigned int nBuf,
+		       unsigned int nRead, int myfd)
 	: TThread(QString("LoadThread")), loadBuffers(buffers), nBuffers(nBuf),
-	  fd(myfd)
+	  nReaders(nRead), fd(myfd), mappedFile(nullptr), mappedSize(0),
+	  compressedFile(nullptr), follow(false), followRegular(false),
+	  startPos(0), stopFlag(0)
 {}
 
+/*
+ * If this is called before the thread is started, then the buffers will be
+ * produced from the mapping instead of being read from fd.
+ */
+void LoadThread::setMapping(char *map, int64_t size)
+{
+	mappedFile = map;
+	mappedSize = size;
+}
+
+/*
+ * If this is called before the thread is started, then the thread will not
+ * stop when it reaches the end of the file but keeps waiting for more data
+ * until stop() is called. The startPos is the offset in the file where fd is
+ * positioned, so that the file positions of the buffers are correct.
+ */
+void LoadThread::setFollow(int64_t pos)
+{
+	follow = true;
+	startPos = pos;
+}
+
+/*
+ * If this is called before the thread is started, then the buffers will be
+ * decompressed from cfile. The positions of the buffers will be offsets in the
+ * decompressed data.
+ */
+void LoadThread::setCompressedFile(CompressedFile *cfile)
+{
+	compressedFile = cfile;
+}
+
+/*
+ * This can be called from any thread, in order to make a following load
+ * thread produce EOF, instead of waiting for more data.
+ */
+void LoadThread::stop()
+{
+	stopFlag.storeRelease(1);
+}
+
+/*
+ * Waits until there is something to read from fd. Regular files are polled
+ * for a change in size, since poll() would always report them as readable.
+ * Returns false if stop() has been called.
+ */
+bool LoadThread::waitForData(int64_t readPos)
+{
+	struct stat sbuf;
+	struct pollfd pfd;
+	int r;
+
+	while (stopFlag.loadAcquire() == 0) {
+		if (followRegular) {
+			if (fstat(fd, &sbuf) != 0 || sbuf.st_size > readPos)
+				return true;
+			usleep(FOLLOW_POLL_MS * 1000);
+			continue;
+		}
+		pfd.fd = fd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		r = poll(&pfd, 1, FOLLOW_POLL_MS);
+		if (r < 0 && errno != EINTR)
+			return true;
+		if (r <= 0)
+			continue;
+		if (pfd.revents & (POLLIN | POLLERR | POLLNVAL))
+			return true;
+		/*
+		 * A FIFO without writers reports POLLHUP without waiting, so
+		 * we need to sleep until a new writer opens it.
+		 */
+		usleep(FOLLOW_POLL_MS * 1000);
+	}
+	return false;
+}
+
 void LoadThread::run()
 {
 	unsigned int i = 0;
+	unsigned int j;
 	bool eof;
-	int64_t filePos = 0;
+	struct stat sbuf;
+	int64_t filePos = startPos;
 	TString lineBegin;
 	size_t bufSize = loadBuffers[0]->bufSize;
 
-	lineBegin.ptr = (char*) mmap(nullptr, bufSize, PROT_READ|PROT_WRITE,
-			     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
-	if (lineBegin.ptr == MAP_FAILED)
-		mmap_err();
-	lineBegin.len = 0;
+	if (mappedFile != nullptr) {
+		do {
+			eof = loadBuffers[i]->produceMappedBuffer(mappedFile,
+								  mappedSize,
+								  &filePos);
+			i++;
+			if (i == nBuffers)
+				i = 0;
+		} while(!eof);
+	} else {
+		lineBegin.ptr = (char*) mmap(nullptr, bufSize,
+					     PROT_READ | PROT_WRITE,
+					     MAP_PRIVATE | MAP_ANONYMOUS, -1,
+					     0);
+		if (lineBegin.ptr == MAP_FAILED)
+			mmap_err();
+		lineBegin.len = 0;
+
+		if (follow)
+			followRegular = fstat(fd, &sbuf) == 0 &&
+				S_ISREG(sbuf.st_mode);
 
-	do {
-		eof = loadBuffers[i]->produceBuffer(fd, &filePos, &lineBegin);
+		do {
+			if (follow && !waitForData(filePos + lineBegin.len)) {
+				loadBuffers[i]->produceEOF(filePos);
+				eof = true;
+			} else {
+				eof = loadBuffers[i]->produceBuffer(fd,
+								    &filePos,
+								    &lineBegin,
+								    follow,
+								    compressedFile);
+			}
+			i++;
+			if (i == nBuffers)
+				i = 0;
+		} while(!eof);
+
+		if (munmap(lineBegin.ptr, bufSize) != 0)
+			munmap_err();
+	}
+
+	/*
+	 * Each tokenizer thread only handles every nReaders:th buffer, so the
+	 * threads that did not get the EOF buffer above are still waiting for
+	 * their next buffer. Give each of them an empty EOF buffer.
+	 */
+	for (j = 1; j < nReaders; j++) {
+		loadBuffers[i]->produceEOF(filePos);
 		i++;
 		if (i == nBuffers)
 			i = 0;
-	} while(!eof);
-
-	if (munmap(lineBegin.ptr, bufSize) != 0)
-		munmap_err();
+	}
 }
@@ -54,20 +54,39 @@
 #ifndef LOADTHREAD_H
 #define LOADTHREAD_H
 
+#include <cstdint>
+
+#include <QAtomicInt>
+
 #include "threads/tthread.h"
 
+class CompressedFile;
 class LoadBuffer;
 
 class LoadThread : public TThread
 {
 public:
-	LoadThread(LoadBuffer **buffers, unsigned int nBuf, int myfd);
+	LoadThread(LoadBuffer **buffers, unsigned int nBuf,
+		   unsigned int nReaders, int myfd);
+	void setMapping(char *map, int64_t size);
+	void setFollow(int64_t startPos);
+	void setCompressedFile(CompressedFile *cfile);
+	void stop();
 protected:
 	void run();
 private:
 	LoadBuffer **loadBuffers;
 	unsigned int nBuffers;
+	unsigned int nReaders;
 	int fd;
+	char *mappedFile;
+	int64_t mappedSize;
+	CompressedFile *compressedFile;
+	bool follow;
+	bool followRegular;
+	int64_t startPos;
+	QAtomicInt stopFlag;
+	bool waitForData(int64_t readPos);
 };
 
 #endif /* LOADTHREAD */
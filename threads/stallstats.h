@@ -0,0 +1,142 @@
+// SPDX-License-Identifier: (GPL-2.0-or-later OR BSD-2-Clause)
+/*
+ * Traceshark - a visualizer for visualizing ftrace and perf traces
+ * Copyright (C) 2019  Viktor Rosendahl <viktor.rosendahl@gmail.com>
+ *
+ * This file is dual licensed: you can use it either under the terms of
+ * the GPL, or the BSD license, at your option.
+ *
+ *  a) This program is free software; you can redistribute it and/or
+ *     modify it under the terms of the GNU General Public License as
+ *     published by the Free Software Foundation; either version 2 of the
+ *     License, or (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public
+ *     License along with this library; if not, write to the Free
+ *     Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ *     MA 02110-1301 USA
+ *
+ * Alternatively,
+ *
+ *  b) Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *     1. Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *     2. Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *     CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *     INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *     MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *     DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *     CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *     NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *     LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *     HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *     CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ *     OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *     EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef STALLSTATS_H
+#define STALLSTATS_H
+
+#include <cstdint>
+
+#include "vtl/compiler.h"
+
+extern "C" {
+#include <time.h>
+}
+
+/*
+ * These are the stages of the loading pipeline, in the order that the data
+ * flows through them. Each stage records the time that it spends waiting for
+ * its neighbours, so that we can tell which stage is the bottleneck.
+ */
+typedef enum : int {
+	STALL_LOAD = 0,
+	STALL_TOKENIZE,
+	STALL_PARSE,
+	STALL_ANALYZE,
+	NR_STALL_STAGES
+} stallstage_t;
+
+/*
+ * A StallCounter may be updated by several threads at the same time, e.g. by
+ * all the reader threads.
+ */
+class StallCounter
+{
+public:
+	StallCounter();
+	void reset();
+	__always_inline void add(int64_t nsecs);
+	__always_inline int64_t getNanoSecs() const;
+	__always_inline int64_t getCount() const;
+	static __always_inline int64_t now();
+private:
+	int64_t nanoSecs;
+	int64_t count;
+};
+
+class StallStats
+{
+public:
+	void reset();
+	__always_inline StallCounter *getCounter(stallstage_t stage);
+	__always_inline const StallCounter *getCounter(stallstage_t stage)
+		const;
+	static const char *getStageName(stallstage_t stage);
+private:
+	StallCounter counters[NR_STALL_STAGES];
+};
+
+__always_inline void StallCounter::add(int64_t nsecs)
+{
+	__atomic_fetch_add(&nanoSecs, nsecs, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&count, 1, __ATOMIC_RELAXED);
+}
+
+__always_inline int64_t StallCounter::getNanoSecs() const
+{
+	return __atomic_load_n(&nanoSecs, __ATOMIC_RELAXED);
+}
+
+__always_inline int64_t StallCounter::getCount() const
+{
+	return __atomic_load_n(&count, __ATOMIC_RELAXED);
+}
+
+__always_inline int64_t StallCounter::now()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+__always_inline StallCounter *StallStats::getCounter(stallstage_t stage)
+{
+	return &counters[stage];
+}
+
+__always_inline const StallCounter *StallStats::getCounter(stallstage_t stage)
+	const
+{
+	return &counters[stage];
+}
+
+#endif /* STALLSTATS_H */
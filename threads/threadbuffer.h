@@ -55,17 +55,20 @@
 
 #include <cstdint>
 
-#include <QMutex>
-#include <QWaitCondition>
 #include "misc/tstring.h"
 #include "mm/mempool.h"
+#include "threads/handoff.h"
+#include "threads/stallstats.h"
 #include "threads/loadbuffer.h"
 #include "vtl/tlist.h"
 
 /*
  * This class is a load buffer for two threads where one is a producer and the
  * other is a consumer. The synchronization functions have not been designed
- * for scenarios with multiple consumers or producers.
+ * for scenarios with multiple consumers or producers. There may be several
+ * producers working on different ThreadBuffers at the same time, which is why
+ * the tokenizer position is kept here and not in the TraceFile. Like with the
+ * LoadBuffer, the handover between the threads is lock free.
  */
 template<class T>
 class ThreadBuffer
@@ -81,58 +84,54 @@ public:
 	void beginConsumeBuffer();
 	void endConsumeBuffer();
 	LoadBuffer *loadBuffer;
+	unsigned int tokenPos;
+	bool bufferSwitch;
+	StallStats *stallStats;
 private:
+	__always_inline StallCounter *stallCounter(stallstage_t stage);
 	__always_inline void waitForProductionComplete();
 	__always_inline void completeProduction();
 	__always_inline void waitForConsumptionComplete();
 	__always_inline void completeConsumption();
-	bool isEmpty;
-	QMutex mutex;
-	QWaitCondition consumptionComplete;
-	QWaitCondition productionComplete;
+	enum : int {
+		TBUFSTATE_EMPTY = 0,
+		TBUFSTATE_PRODUCED
+	};
+	Handoff state;
 };
 
+template<class T>
+__always_inline StallCounter *ThreadBuffer<T>::stallCounter(stallstage_t stage)
+{
+	if (stallStats == nullptr)
+		return nullptr;
+	return stallStats->getCounter(stage);
+}
+
 template<class T>
 __always_inline void ThreadBuffer<T>::waitForProductionComplete() {
-	mutex.lock();
-	while(isEmpty) {
-		/*
-		 * Note that this implicitely unlocks the mutex while waiting
-		 * and relocks it when done waiting.
-		 */
-		productionComplete.wait(&mutex);
-	}
+	state.waitFor(TBUFSTATE_PRODUCED, stallCounter(STALL_PARSE));
 }
 
 template<class T>
 __always_inline void ThreadBuffer<T>::completeProduction() {
-	isEmpty = false;
-	productionComplete.wakeOne();
-	mutex.unlock();
+	state.set(TBUFSTATE_PRODUCED);
 }
 
 template<class T>
 __always_inline void ThreadBuffer<T>::waitForConsumptionComplete() {
-	mutex.lock();
-	while(!isEmpty) {
-		/*
-		 * Note that this implicitely unlocks the mutex while waiting
-		 * and relocks it when done waiting.
-		 */
-		consumptionComplete.wait(&mutex);
-	}
+	state.waitFor(TBUFSTATE_EMPTY, stallCounter(STALL_TOKENIZE));
 }
 
 template<class T>
 __always_inline void ThreadBuffer<T>::completeConsumption() {
-	isEmpty = true;
 	list.softclear();
-	consumptionComplete.wakeOne();
-	mutex.unlock();
+	state.set(TBUFSTATE_EMPTY);
 }
 
 template<class T>ThreadBuffer<T>::ThreadBuffer(unsigned int nr):
-nrBuffers(nr), loadBuffer(nullptr), isEmpty(true)
+nrBuffers(nr), loadBuffer(nullptr), tokenPos(0), bufferSwitch(false),
+stallStats(nullptr), state(TBUFSTATE_EMPTY)
 {
 	strPool = new MemPool(4096, sizeof(TString));
 }
@@ -151,6 +150,8 @@ template<class T>
 void ThreadBuffer<T>::beginProduceBuffer() {
 	waitForConsumptionComplete();
 	loadBuffer->beginTokenizeBuffer();
+	tokenPos = 0;
+	bufferSwitch = false;
 	strPool->reset();
 	list.softclear();
 }
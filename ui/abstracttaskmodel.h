@@ -54,9 +54,9 @@
 #define _ABSTRACTTASKMODEL_H
 
 #include <QAbstractTableModel>
-#include "vtl/avltree.h"
+#include "vtl/pidmap.h"
 
-class TaskHandle;
+class Task;
 
 class AbstractTaskModel : public QAbstractTableModel
 {
@@ -64,7 +64,7 @@ class AbstractTaskModel : public QAbstractTableModel
 public:
 	AbstractTaskModel(QObject *parent = 0);
 	virtual ~AbstractTaskModel() = 0;
-	virtual void setTaskMap(vtl::AVLTree<int, TaskHandle> *map,
+	virtual void setTaskMap(vtl::PidMap<Task> *map,
 				unsigned int nrcpus) = 0;
 	virtual void beginResetModel() = 0;
 	virtual void endResetModel() = 0;
@@ -56,6 +56,7 @@
 #include <QColor>
 
 #include "misc/traceshark.h"
+#include "ui/qtwidgets.h"
 #include "qcustomplot/qcustomplot.h"
 #include "vtl/time.h"
 
@@ -63,6 +63,7 @@
 #include "ui/cursorinfo.h"
 #include "misc/resources.h"
 #include "misc/traceshark.h"
+#include "ui/qtwidgets.h"
 
 #define RED_CURSOR_TOOLTIP "Move the red cursor to the specified time"
 #define BLUE_CURSOR_TOOLTIP "Move the blue cursor to the specified time"
@@ -57,6 +57,7 @@
 #include "misc/errors.h"
 #include "misc/resources.h"
 #include "misc/traceshark.h"
+#include "ui/qtwidgets.h"
 #include "threads/tthread.h"
 #include "ui/errordialog.h"
 
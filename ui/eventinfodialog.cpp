@@ -53,6 +53,7 @@
 #include "misc/chunk.h"
 #include "misc/errors.h"
 #include "misc/traceshark.h"
+#include "ui/qtwidgets.h"
 #include "ui/eventinfodialog.h"
 #include "parser/traceevent.h"
 #include "parser/tracefile.h"
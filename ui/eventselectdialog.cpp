@@ -60,6 +60,7 @@
 #include "ui/eventselectmodel.h"
 #include "ui/eventselectview.h"
 #include "misc/traceshark.h"
+#include "ui/qtwidgets.h"
 
 #define CBOX_INDEX_AND 0
 #define CBOX_INDEX_OR  1
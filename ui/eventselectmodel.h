@@ -60,7 +60,6 @@ namespace vtl {
 	template<class T> class TList;
 }
 class Task;
-class TaskHandle;
 class StringTree;
 
 QT_BEGIN_NAMESPACE
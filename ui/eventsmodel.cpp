@@ -53,8 +53,10 @@
 #include <QVariant>
 #include <QString>
 #include "ui/eventsmodel.h"
+#include "parser/eventargs.h"
 #include "parser/traceevent.h"
 #include "misc/traceshark.h"
+#include "ui/qtwidgets.h"
 #include "vtl/tlist.h"
 
 
@@ -118,7 +120,7 @@ QVariant EventsModel::data(const QModelIndex &index, int role) const
 		const TraceEvent &event = *getEventAt(row);
 		switch(column) {
 		case 0:
-			return event.time.toQString();
+			return event.getTime().toQString();
 		case 1:
 			return QString(event.taskName->ptr);
 		case 2:
@@ -128,7 +130,8 @@ QVariant EventsModel::data(const QModelIndex &index, int role) const
 				QString("]");
 		case 4:
 			return QString(event.getEventName()->ptr);
-		case 5:
+		case 5: {
+			EventArgs args(event);
 			/*
 			 * If there was an integer before the event name, then
 			 * we will display that as if it had been the first 
@@ -136,15 +139,16 @@ QVariant EventsModel::data(const QModelIndex &index, int role) const
 			 */
 			if (event.intArg != 0) {
 				str += QString::number(event.intArg);
-				if (event.argc > 0)
+				if (args.argc > 0)
 					str += QString(tr(" "));
 			}
-			for (i = 0; i < event.argc; i++) {
-				str += QString(event.argv[i]->ptr);
-				if (i < event.argc - 1)
+			for (i = 0; i < args.argc; i++) {
+				str += QString(args.argv[i]->ptr);
+				if (i < args.argc - 1)
 					str += QString(tr(" "));
 			}
 			return str;
+		}
 		default:
 			break;
 		}
@@ -57,6 +57,7 @@
 #include "ui/eventswidget.h"
 #include "ui/tableview.h"
 #include "misc/traceshark.h"
+#include "ui/qtwidgets.h"
 #include "parser/traceevent.h"
 
 EventsWidget::EventsWidget(QWidget *parent):
@@ -164,7 +165,7 @@ void EventsWidget::scrollTo(int n)
 	if (index < getSize()) {
 		tableView->selectRow(index);
 		resizeColumnsToContents();
-		scrollTime = getEventAt(index)->time;
+		scrollTime = getEventAt(index)->getTime();
 		saveScrollTime = true;
 	}
 }
@@ -198,7 +199,7 @@ int EventsWidget::findBestMatch(const vtl::Time &time)
 	c =  binarySearch(time, 0, end);
 
 	cand[n] = c;
-	diffs[n] = (getEventAt(c)->time - time).fabs();
+	diffs[n] = (getEventAt(c)->getTime() - time).fabs();
 	bestN = c;
 	best = diffs[n];
 	n++;
@@ -208,13 +209,13 @@ int EventsWidget::findBestMatch(const vtl::Time &time)
 
 	if (next <= end) {
 		cand[n] = next;
-		diffs[n] = (getEventAt(next)->time - time).fabs();
+		diffs[n] = (getEventAt(next)->getTime() - time).fabs();
 		n++;
 	}
 
 	if (prev >= 0) {
 		cand[n] = prev;
-		diffs[n] = (getEventAt(prev)->time - time).fabs();
+		diffs[n] = (getEventAt(prev)->getTime() - time).fabs();
 		n++;
 	}
 
@@ -227,9 +228,9 @@ int EventsWidget::findBestMatch(const vtl::Time &time)
 
 	/* Basic sanity in case the beginning or end has multiple events
 	 * with the same time */
-	if (time > getEventAt(end)->time)
+	if (time > getEventAt(end)->getTime())
 		bestN = end;
-	if (time < getEventAt(0)->time)
+	if (time < getEventAt(0)->getTime())
 		bestN = 0;
 
 	return bestN;
@@ -240,7 +241,7 @@ int EventsWidget::binarySearch(const vtl::Time &time, int start, int end)
 	int pivot = (end + start) / 2;
 	if (pivot == start)
 		return pivot;
-	if (time < getEventAt(pivot)->time)
+	if (time < getEventAt(pivot)->getTime())
 		return binarySearch(time, start, pivot);
 	else
 		return binarySearch(time, pivot, end);
@@ -249,7 +250,7 @@ int EventsWidget::binarySearch(const vtl::Time &time, int start, int end)
 void EventsWidget::handleClick(const QModelIndex &index)
 {
 	if (index.column() == 0) {
-		vtl::Time time = getEventAt(index.row())->time;
+		vtl::Time time = getEventAt(index.row())->getTime();
 		emit timeSelected(time);
 	}
 }
@@ -269,7 +270,7 @@ void EventsWidget::handleSelectionChanged(const QItemSelection &/*selected*/,
 
 	if (event != selectedEvent) {
 		if (event != nullptr) {
-			scrollTime = event->time;
+			scrollTime = event->getTime();
 			saveScrollTime = true;
 		}
 		selectedEvent = event;
@@ -52,6 +52,7 @@
 
 #include "misc/setting.h"
 #include "misc/traceshark.h"
+#include "ui/qtwidgets.h"
 #include "ui/graphenabledialog.h"
 #include "ui/tcheckbox.h"
 #include "vtl/error.h"
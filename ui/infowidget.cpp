@@ -53,6 +53,7 @@
 #include "ui/infowidget.h"
 #include "ui/cursorinfo.h"
 #include "misc/traceshark.h"
+#include "ui/qtwidgets.h"
 #include "vtl/time.h"
 #include <QComboBox>
 #include <QHBoxLayout>
@@ -55,6 +55,7 @@
 
 #include <QDockWidget>
 #include "misc/traceshark.h"
+#include "ui/qtwidgets.h"
 #include "vtl/time.h"
 
 QT_BEGIN_NAMESPACE
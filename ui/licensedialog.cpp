@@ -60,6 +60,7 @@
 
 #include "misc/resources.h"
 #include "misc/traceshark.h"
+#include "ui/qtwidgets.h"
 #include "ui/licensedialog.h"
 #include "vtl/error.h"
 
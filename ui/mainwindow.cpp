@@ -55,6 +55,7 @@
 #include <QApplication>
 #include <QDateTime>
 #include <QList>
+#include <QTimer>
 #include <QToolBar>
 
 #include "ui/cursor.h"
@@ -66,6 +67,7 @@
 #include "ui/infowidget.h"
 #include "ui/licensedialog.h"
 #include "ui/mainwindow.h"
+#include "ui/migrationarrow.h"
 #include "ui/migrationline.h"
 #include "ui/taskgraph.h"
 #include "ui/taskrangeallocator.h"
@@ -78,8 +80,11 @@
 #include "misc/errors.h"
 #include "misc/resources.h"
 #include "misc/traceshark.h"
+#include "misc/version.h"
+#include "ui/qtwidgets.h"
 #include "threads/workqueue.h"
 #include "threads/workitem.h"
+#include "threads/stallstats.h"
 #include "qcustomplot/qcustomplot.h"
 #include "vtl/compiler.h"
 #include "vtl/error.h"
@@ -88,6 +93,9 @@
 #define TOOLTIP_OPEN			\
 "Open a new trace file"
 
+#define TOOLTIP_FOLLOW			\
+"Open a trace file or a pipe and keep reading it as it grows"
+
 #define TOOLTIP_CLOSE			\
 "Close the currently open tracefile"
 
@@ -175,6 +183,12 @@
 #define SHOW_LICENSE_TOOLTIP		\
 "Show the license of Traceshark"
 
+/* How often the display is refreshed while a trace is followed */
+#define FOLLOW_INTERVAL_MS (1000)
+
+/* How often the preview is refreshed while a trace is processed */
+#define PROCESS_INTERVAL_MS (500)
+
 const double MainWindow::bugWorkAroundOffset = 100;
 const double MainWindow::schedSectionOffset = 100;
 const double MainWindow::schedSpacing = 250;
@@ -209,12 +223,15 @@ const QColor MainWindow::PREEMPTED_COLOR = Qt::red;
 const QColor MainWindow::UNINT_COLOR = QColor(205, 0, 205);
 
 MainWindow::MainWindow():
-	tracePlot(nullptr), graphEnableDialog(nullptr), filterActive(false)
+	tracePlot(nullptr), graphEnableDialog(nullptr), migrationOffset(0),
+	migrationScale(0), filterActive(false)
 {
 	Setting::setupSettings();
 	loadSettings();
 
 	analyzer = new TraceAnalyzer;
+	followTimer = new QTimer(this);
+	processTimer = new QTimer(this);
 
 	infoWidget = new InfoWidget(this);
 	infoWidget->setAllowedAreas(Qt::TopDockWidgetArea |
@@ -222,6 +239,8 @@ MainWindow::MainWindow():
 	addDockWidget(Qt::TopDockWidgetArea, infoWidget);
 
 	createActions();
+	tsconnect(followTimer, timeout(), this, followTimeout());
+	tsconnect(processTimer, timeout(), this, processTimeout());
 	createToolBars();
 	createMenus();
 	createStatusBar();
@@ -283,8 +302,6 @@ void MainWindow::createTracePlot()
 	tracePlot->setInteractions(QCP::iRangeDrag | QCP::iRangeZoom |
 				   QCP::iSelectAxes | QCP::iSelectLegend |
 				   QCP::iSelectPlottables);
-
-	analyzer->setQCustomPlot(tracePlot);
 }
 
 MainWindow::~MainWindow()
@@ -351,90 +368,305 @@ void MainWindow::openFile(const QString &name)
 	}
 
 	if (analyzer->isOpen()) {
-		quint64 start, process, layout, rescale, showt, eventsw;
-		quint64 scursor, tshow;
-
 		clearPlot();
 		setupOpenGL();
+		processName = name;
+		processStart =
+			QDateTime::currentDateTimeUtc().toMSecsSinceEpoch();
+		analyzer->startProcessing();
+		setStatus(STATUS_PROCESSING, &name);
+		analyzer->requestPreview();
+		processTimer->start(PROCESS_INTERVAL_MS);
+	} else {
+		setStatus(STATUS_ERROR);
+		vtl::warnx("Unknown error when opening trace!");
+	}
+}
 
-		start = QDateTime::currentDateTimeUtc().toMSecsSinceEpoch();
+/*
+ * The trace is processed by the analyzer in the background, until then only
+ * the cpufreq and cpuidle graphs of the events processed so far are shown.
+ */
+void MainWindow::processTimeout()
+{
+	AnalysisPreview preview;
 
-		processTrace();
-		process = QDateTime::currentDateTimeUtc().toMSecsSinceEpoch();
+	if (analyzer->processingFinished()) {
+		processTimer->stop();
+		finishOpen();
+		return;
+	}
 
-		computeLayout();
-		layout = QDateTime::currentDateTimeUtc().toMSecsSinceEpoch();
+	if (analyzer->takePreview(preview))
+		showPreview(preview);
+	analyzer->requestPreview();
+}
 
-		eventsWidget->beginResetModel();
-		eventsWidget->setEvents(analyzer->events);
-		eventsWidget->endResetModel();
+void MainWindow::finishOpen()
+{
+	quint64 start, process, layout, rescale, showt, eventsw;
+	quint64 scursor, tshow;
 
-		taskSelectDialog->beginResetModel();
-		taskSelectDialog->setTaskMap(&analyzer->taskMap,
-					     analyzer->getNrCPUs());
-		taskSelectDialog->endResetModel();
+	start = processStart;
 
-		eventSelectDialog->beginResetModel();
-		eventSelectDialog->setStringTree(TraceEvent::getStringTree());
-		eventSelectDialog->endResetModel();
+	processTrace();
+	process = QDateTime::currentDateTimeUtc().toMSecsSinceEpoch();
 
-		eventsw = QDateTime::currentDateTimeUtc().toMSecsSinceEpoch();
+	/* Remove the preview */
+	clearPlot();
 
-		setupCursors();
-		scursor = QDateTime::currentDateTimeUtc().toMSecsSinceEpoch();
+	computeLayout();
+	layout = QDateTime::currentDateTimeUtc().toMSecsSinceEpoch();
 
-		rescaleTrace();
-		rescale = QDateTime::currentDateTimeUtc().toMSecsSinceEpoch();
+	eventsWidget->beginResetModel();
+	eventsWidget->setEvents(analyzer->events);
+	eventsWidget->endResetModel();
 
-		computeStats();
-		statsDialog->beginResetModel();
-		statsDialog->setTaskMap(&analyzer->taskMap,
-					analyzer->getNrCPUs());
-		statsDialog->endResetModel();
+	taskSelectDialog->beginResetModel();
+	taskSelectDialog->setTaskMap(&analyzer->taskMap,
+				     analyzer->getNrCPUs());
+	taskSelectDialog->endResetModel();
 
-		statsLimitedDialog->beginResetModel();
-		statsLimitedDialog->setTaskMap(&analyzer->taskMap,
-					       analyzer->getNrCPUs());
-		statsLimitedDialog->endResetModel();
+	eventSelectDialog->beginResetModel();
+	eventSelectDialog->setStringTree(TraceEvent::getStringTree());
+	eventSelectDialog->endResetModel();
 
-		showTrace();
-		showt = QDateTime::currentDateTimeUtc().toMSecsSinceEpoch();
+	eventsw = QDateTime::currentDateTimeUtc().toMSecsSinceEpoch();
+
+	setupCursors();
+	scursor = QDateTime::currentDateTimeUtc().toMSecsSinceEpoch();
+
+	rescaleTrace();
+	rescale = QDateTime::currentDateTimeUtc().toMSecsSinceEpoch();
+
+	computeStats();
+	statsDialog->beginResetModel();
+	statsDialog->setTaskMap(&analyzer->taskMap,
+				analyzer->getNrCPUs());
+	statsDialog->endResetModel();
 
+	statsLimitedDialog->beginResetModel();
+	statsLimitedDialog->setTaskMap(&analyzer->taskMap,
+				       analyzer->getNrCPUs());
+	statsLimitedDialog->endResetModel();
+
+	showTrace();
+	showt = QDateTime::currentDateTimeUtc().toMSecsSinceEpoch();
+
+	tracePlot->show();
+	tshow = QDateTime::currentDateTimeUtc().toMSecsSinceEpoch();
+
+	setStatus(STATUS_FILE, &processName);
+
+	printf("processTrace() took %.6lf s\n"
+	       "computeLayout() took %.6lf s\n"
+	       "updating EventsWidget took %.6lf s\n"
+	       "setupCursors() took %.6lf s\n"
+	       "rescaleTrace() took %.6lf s\n"
+	       "showTrace() took %.6lf s\n"
+	       "tracePlot->show() took %.6lf s\n",
+	       (double) (process - start) / 1000,
+	       (double) (layout - process) / 1000,
+	       (double) (eventsw - layout) / 1000,
+	       (double) (scursor - eventsw) / 1000,
+	       (double) (rescale - scursor) / 1000,
+	       (double) (showt - rescale) / 1000,
+	       (double) (tshow - showt) / 1000);
+	printStallStats();
+	fflush(stdout);
+	tracePlot->legend->setVisible(true);
+	setCloseActionsEnabled(true);
+	if (analyzer->events->size() <= 0)
+		vtl::warnx("You have opened an empty trace!");
+	else
+		setTraceActionsEnabled(true);
+}
+
+/*
+ * The preview uses the same layout as the cpufreq and cpuidle section of the
+ * full trace, with the CPUs that have been seen so far.
+ */
+void MainWindow::showPreview(AnalysisPreview &preview)
+{
+	unsigned int cpu;
+	double offset = bugWorkAroundOffset + cpuSectionOffset;
+	double start = preview.startTime.toDouble();
+	double end = preview.endTime.toDouble();
+	bool showIdle = Setting::isEnabled(Setting::SHOW_CPUIDLE_GRAPHS) &&
+		preview.maxIdleState > 0;
+	bool showFreq = Setting::isEnabled(Setting::SHOW_CPUFREQ_GRAPHS) &&
+		preview.maxFreq > 0;
+	QString label;
+	QString status;
+
+	status = *statusStrings[STATUS_PROCESSING] + processName +
+		QString(tr(", %1 events")).arg(preview.nrEvents);
+	statusLabel->setText(status);
+
+	if ((!showIdle && !showFreq) || end <= start)
+		return;
+
+	tracePlot->clearPlottables();
+	ticks.resize(0);
+	tickLabels.resize(0);
+
+	for (cpu = 0; cpu < preview.nrCPUs; cpu++) {
+		if (showIdle) {
+			CpuIdle &idle = preview.cpuIdle[cpu];
+			idle.offset = offset;
+			idle.scale = cpuHeight / preview.maxIdleState;
+			idle.doScale();
+			addCpuIdleGraph(cpu, idle);
+		}
+		if (showFreq) {
+			CpuFreq &freq = preview.cpuFreq[cpu];
+			freq.offset = offset;
+			freq.scale = cpuHeight / preview.maxFreq;
+			freq.doScale();
+			addCpuFreqGraph(cpu, freq);
+		}
+		label = QString("cpu") + QString::number(cpu);
+		ticks.append(offset);
+		tickLabels.append(label);
+		offset += cpuHeight + cpuSpacing;
+	}
+
+	tracePlot->yAxis->setRange(QCPRange(bugWorkAroundOffset, offset));
+	tracePlot->xAxis->setRange(QCPRange(start, end));
+	tracePlot->yAxis->setTicks(false);
+	yaxisTicker->setTickVector(ticks);
+	yaxisTicker->setTickVectorLabels(tickLabels);
+	tracePlot->yAxis->setTicks(true);
+	tracePlot->replot();
+	tracePlot->show();
+}
+
+void MainWindow::followTrace()
+{
+	QString name;
+	QString caption = tr("Follow a trace file or a pipe");
+	QFileDialog::Options options = QFileDialog::DontUseNativeDialog |
+		QFileDialog::DontUseSheet;
+
+	name = QFileDialog::getOpenFileName(this, caption, QString(),
+					    tr("All files (*)"), nullptr,
+					    options);
+	if (!name.isEmpty()) {
+		followFile(name);
+	}
+}
+
+void MainWindow::followFile(const QString &name)
+{
+	int ts_errno;
+
+	if (analyzer->isOpen())
+		closeTrace();
+	ts_errno = loadTraceFile(name, true);
+
+	if (ts_errno != 0) {
+		vtl::warn(ts_errno, "Failed to follow trace file %s",
+			  name.toLocal8Bit().data());
+		return;
+	}
+	startFollow(name);
+}
+
+/*
+ * Nothing is shown until followTimeout() finds the first events.
+ */
+void MainWindow::startFollow(const QString &name)
+{
+	clearPlot();
+	setupOpenGL();
+	setCloseActionsEnabled(true);
+	setStatus(STATUS_FOLLOW, &name);
+	followTimer->start(FOLLOW_INTERVAL_MS);
+}
+
+/*
+ * When the window is full, the oldest events are evicted. If the trace is
+ * shown, this is done by redrawTrace(), after it has deleted the graphs of
+ * the tasks.
+ */
+void MainWindow::followTimeout()
+{
+	bool keepZoom;
+	int window = Setting::getFollowWindow();
+	int nrEvict = 0;
+	double end = analyzer->getEndTime().toDouble();
+
+	if (!analyzer->updateTrace())
+		return;
+
+	if (analyzer->events->size() >= window)
+		nrEvict = analyzer->events->size() - FOLLOW_WINDOW_KEEP(window);
+
+	/* There are no cursors if nothing has been shown yet */
+	if (cursors[TShark::RED_CURSOR] == nullptr) {
+		if (nrEvict > 0)
+			analyzer->slideWindow(nrEvict);
+		computeLayout();
+		setupCursors();
+		rescaleTrace();
+		showTrace();
 		tracePlot->show();
-		tshow = QDateTime::currentDateTimeUtc().toMSecsSinceEpoch();
-
-		setStatus(STATUS_FILE, &name);
-
-		printf("processTrace() took %.6lf s\n"
-		       "computeLayout() took %.6lf s\n"
-		       "updating EventsWidget took %.6lf s\n"
-		       "setupCursors() took %.6lf s\n"
-		       "rescaleTrace() took %.6lf s\n"
-		       "showTrace() took %.6lf s\n"
-		       "tracePlot->show() took %.6lf s\n",
-		       (double) (process - start) / 1000,
-		       (double) (layout - process) / 1000,
-		       (double) (eventsw - layout) / 1000,
-		       (double) (scursor - eventsw) / 1000,
-		       (double) (rescale - scursor) / 1000,
-		       (double) (showt - rescale) / 1000,
-		       (double) (tshow - showt) / 1000);
-		fflush(stdout);
 		tracePlot->legend->setVisible(true);
-		setCloseActionsEnabled(true);
-		if (analyzer->events->size() <= 0)
-			vtl::warnx("You have opened an empty trace!");
-		else
-			setTraceActionsEnabled(true);
+		setTraceActionsEnabled(true);
 	} else {
-		setStatus(STATUS_ERROR);
-		vtl::warnx("Unknown error when opening trace!");
+		/* Only follow the end if the user hasn't zoomed in */
+		keepZoom = tracePlot->xAxis->range().upper < end;
+		redrawTrace(keepZoom, nrEvict);
 	}
+
+	eventsWidget->beginResetModel();
+	setEventsWidgetEvents();
+	eventsWidget->endResetModel();
+
+	taskSelectDialog->beginResetModel();
+	taskSelectDialog->setTaskMap(&analyzer->taskMap,
+				     analyzer->getNrCPUs());
+	taskSelectDialog->endResetModel();
+
+	eventSelectDialog->beginResetModel();
+	eventSelectDialog->setStringTree(TraceEvent::getStringTree());
+	eventSelectDialog->endResetModel();
+
+	computeStats();
+	statsDialog->beginResetModel();
+	statsDialog->setTaskMap(&analyzer->taskMap, analyzer->getNrCPUs());
+	statsDialog->endResetModel();
+
+	statsLimitedDialog->beginResetModel();
+	statsLimitedDialog->setTaskMap(&analyzer->taskMap,
+				       analyzer->getNrCPUs());
+	statsLimitedDialog->endResetModel();
 }
 
+/* Waits for the processing that was started by openFile() */
 void MainWindow::processTrace()
 {
-	analyzer->processTrace();
+	analyzer->waitProcessing();
+}
+
+/*
+ * Prints how long each stage of the loading pipeline was blocked, waiting for
+ * its neighbours. The stage that waited the least is the one that limits the
+ * throughput. The tokenize time is the sum over all reader threads.
+ */
+void MainWindow::printStallStats()
+{
+	const StallStats &stats = analyzer->getStallStats();
+	const StallCounter *counter;
+	int i;
+
+	for (i = 0; i < NR_STALL_STAGES; i++) {
+		counter = stats.getCounter((stallstage_t) i);
+		printf("%s stage was blocked %.6lf s in %lld waits\n",
+		       StallStats::getStageName((stallstage_t) i),
+		       (double) counter->getNanoSecs() / 1000000000,
+		       (long long) counter->getCount());
+	}
 }
 
 void MainWindow::computeLayout()
@@ -456,12 +688,12 @@ void MainWindow::computeLayout()
 	ticks.resize(0);
 	tickLabels.resize(0);
 
-	if (analyzer->enableMigrations()) {
+	if (enableMigrations()) {
 		offset += migrateSectionOffset;
 
-		analyzer->setMigrationOffset(offset);
+		migrationOffset = offset;
 		inc = nrCPUs * 315 + 67.5;
-		analyzer->setMigrationScale(inc);
+		migrationScale = inc;
 
 		/* add labels and lines here for the migration graph */
 		color = QColor(135, 206, 250); /* Light sky blue */
@@ -516,9 +748,47 @@ void MainWindow::computeLayout()
 	top = offset;
 }
 
+bool MainWindow::enableMigrations()
+{
+	return (Setting::isEnabled(Setting::SHOW_MIGRATION_GRAPHS) &&
+		(Setting::isEnabled(Setting::SHOW_MIGRATION_UNLIMITED) ||
+		 analyzer->migrations.size() < MAX_NR_MIGRATIONS));
+}
+
+/*
+ * This function must be called from the application mainthread because it
+ * creates objects that are children of tracePlot, which is created by the
+ * mainthread
+ */
+void MainWindow::scaleMigration()
+{
+	QList<Migration>::iterator iter;
+	double unit = migrationScale / analyzer->getNrCPUs();
+	for (iter = analyzer->migrations.begin();
+	     iter != analyzer->migrations.end(); iter++) {
+		Migration &m = *iter;
+		double s = migrationOffset + (m.oldcpu + 1) * unit;
+		double e = migrationOffset + (m.newcpu + 1) * unit;
+		QColor color = analyzer->getTaskColor(m.pid);
+		/*
+		 * The constructor will save a pointer to the MigrationArrow
+		 * object in the tracePlot object.
+		 */
+		new MigrationArrow(s, e, m.time.toDouble(), color, tracePlot);
+	}
+}
+
 void MainWindow::rescaleTrace()
 {
-	analyzer->doScale();
+	analyzer->startScale(Setting::isEnabled(Setting::SHOW_CPUFREQ_GRAPHS),
+			     Setting::isEnabled(Setting::SHOW_CPUIDLE_GRAPHS),
+			     Setting::isEnabled(Setting::SHOW_SCHED_GRAPHS));
+
+	/* Migration scaling is done from the mainthread */
+	if (enableMigrations())
+		scaleMigration();
+
+	analyzer->waitScale();
 }
 
 void MainWindow::computeStats()
@@ -570,45 +840,10 @@ void MainWindow::showTrace()
 
 	/* Show CPU frequency and idle graphs */
 	for (cpu = 0; cpu <= analyzer->getMaxCPU(); cpu++) {
-		QPen pen = QPen();
-		QPen penF = QPen();
-
-		QCPGraph *graph;
-		QString name;
-		QCPScatterStyle style;
-
-		if (Setting::isEnabled(Setting::SHOW_CPUIDLE_GRAPHS)) {
-			graph = tracePlot->addGraph(tracePlot->xAxis,
-						    tracePlot->yAxis);
-			graph->setSelectable(QCP::stNone);
-			name = QString(tr("cpuidle")) + QString::number(cpu);
-			style = QCPScatterStyle(QCPScatterStyle::ssCircle, 5);
-			pen.setColor(Qt::red);
-			style.setPen(pen);
-			graph->setScatterStyle(style);
-			pen.setColor(Qt::green);
-			graph->setPen(pen);
-			graph->setName(name);
-			graph->setAdaptiveSampling(true);
-			graph->setLineStyle(QCPGraph::lsStepLeft);
-			graph->setData(analyzer->cpuIdle[cpu].timev,
-				       analyzer->cpuIdle[cpu].scaledData);
-		}
-
-		if (Setting::isEnabled(Setting::SHOW_CPUFREQ_GRAPHS)) {
-			graph = tracePlot->addGraph(tracePlot->xAxis,
-						    tracePlot->yAxis);
-			graph->setSelectable(QCP::stNone);
-			name = QString(tr("cpufreq")) + QString::number(cpu);
-			penF.setColor(Qt::blue);
-			penF.setWidth(2);
-			graph->setPen(penF);
-			graph->setName(name);
-			graph->setAdaptiveSampling(true);
-			graph->setLineStyle(QCPGraph::lsStepLeft);
-			graph->setData(analyzer->cpuFreq[cpu].timev,
-				       analyzer->cpuFreq[cpu].scaledData);
-		}
+		if (Setting::isEnabled(Setting::SHOW_CPUIDLE_GRAPHS))
+			addCpuIdleGraph(cpu, analyzer->cpuIdle[cpu]);
+		if (Setting::isEnabled(Setting::SHOW_CPUFREQ_GRAPHS))
+			addCpuFreqGraph(cpu, analyzer->cpuFreq[cpu]);
 	}
 
 skipIdleFreqGraphs:
@@ -635,6 +870,46 @@ skipIdleFreqGraphs:
 	tracePlot->replot();
 }
 
+void MainWindow::addCpuIdleGraph(unsigned int cpu, const CpuIdle &idle)
+{
+	QPen pen = QPen();
+	QCPGraph *graph;
+	QString name;
+	QCPScatterStyle style;
+
+	graph = tracePlot->addGraph(tracePlot->xAxis, tracePlot->yAxis);
+	graph->setSelectable(QCP::stNone);
+	name = QString(tr("cpuidle")) + QString::number(cpu);
+	style = QCPScatterStyle(QCPScatterStyle::ssCircle, 5);
+	pen.setColor(Qt::red);
+	style.setPen(pen);
+	graph->setScatterStyle(style);
+	pen.setColor(Qt::green);
+	graph->setPen(pen);
+	graph->setName(name);
+	graph->setAdaptiveSampling(true);
+	graph->setLineStyle(QCPGraph::lsStepLeft);
+	graph->setData(idle.timev, idle.scaledData);
+}
+
+void MainWindow::addCpuFreqGraph(unsigned int cpu, const CpuFreq &freq)
+{
+	QPen penF = QPen();
+	QCPGraph *graph;
+	QString name;
+
+	graph = tracePlot->addGraph(tracePlot->xAxis, tracePlot->yAxis);
+	graph->setSelectable(QCP::stNone);
+	name = QString(tr("cpufreq")) + QString::number(cpu);
+	penF.setColor(Qt::blue);
+	penF.setWidth(2);
+	graph->setPen(penF);
+	graph->setName(name);
+	graph->setAdaptiveSampling(true);
+	graph->setLineStyle(QCPGraph::lsStepLeft);
+	graph->setData(freq.timev, freq.scaledData);
+}
+
 void MainWindow::loadSettings()
 {
 	int ts_errno;
@@ -713,7 +988,8 @@ void MainWindow::addSchedGraph(CPUTask &cpuTask)
 	graph->setPen(pen);
 	graph->setTask(task);
 	if (Setting::isEnabled(Setting::SHOW_SCHED_GRAPHS))
-		graph->setData(cpuTask.schedTimev, cpuTask.scaledSchedData);
+		graph->setData(cpuTask.schedTimev.toDoubleVector(),
+			       cpuTask.scaledSchedData);
 	/*
 	 * Save a pointer to the graph object in the task. The destructor of
 	 * AbstractClass will delete this when it is destroyed.
@@ -741,7 +1017,7 @@ void MainWindow::addHorizontalWakeupGraph(CPUTask &task)
 	graph->setScatterStyle(style);
 	graph->setLineStyle(QCPGraph::lsNone);
 	graph->setAdaptiveSampling(true);
-	graph->setData(task.wakeTimev, task.wakeHeight);
+	graph->setData(task.wakeTimev.toDoubleVector(), task.wakeHeight);
 	errorBars->setData(task.wakeDelay, task.wakeZero);
 	errorBars->setErrorType(QCPErrorBars::etKeyError);
 	errorBars->setPen(pen);
@@ -771,7 +1047,7 @@ void MainWindow::addWakeupGraph(CPUTask &task)
 	graph->setScatterStyle(style);
 	graph->setLineStyle(QCPGraph::lsNone);
 	graph->setAdaptiveSampling(true);
-	graph->setData(task.wakeTimev, task.wakeHeight);
+	graph->setData(task.wakeTimev.toDoubleVector(), task.wakeHeight);
 	errorBars->setData(task.wakeZero, task.verticalDelay);
 	errorBars->setErrorType(QCPErrorBars::etValueError);
 	errorBars->setPen(pen);
@@ -897,6 +1173,11 @@ void MainWindow::setTaskGraphClearActionEnabled(bool e)
 void MainWindow::closeTrace()
 {
 	int ts_errno = 0;
+	followTimer->stop();
+	if (processTimer->isActive()) {
+		processTimer->stop();
+		analyzer->waitProcessing();
+	}
 	resetFilters();
 
 	eventsWidget->beginResetModel();
@@ -921,6 +1202,7 @@ void MainWindow::closeTrace()
 	eventSelectDialog->endResetModel();
 
 	clearPlot();
+	deleteTaskGraphs();
 	if(analyzer->isOpen()) {
 		analyzer->close(&ts_errno);
 	}
@@ -1266,6 +1548,10 @@ void MainWindow::createActions()
 	openAction->setToolTip(tr(TOOLTIP_OPEN));
 	tsconnect(openAction, triggered(), this, openTrace());
 
+	followAction = new QAction(tr("&Follow..."), this);
+	followAction->setToolTip(tr(TOOLTIP_FOLLOW));
+	tsconnect(followAction, triggered(), this, followTrace());
+
 	closeAction = new QAction(tr("&Close"), this);
 	closeAction->setIcon(QIcon(RESSRC_PNG_CLOSE));
 	closeAction->setShortcuts(QKeySequence::Close);
@@ -1491,6 +1777,7 @@ void MainWindow::createMenus()
 {
 	fileMenu = menuBar()->addMenu(tr("&File"));
 	fileMenu->addAction(openAction);
+	fileMenu->addAction(followAction);
 	fileMenu->addAction(closeAction);
 	fileMenu->addAction(saveAction);
 	fileMenu->addSeparator();
@@ -1539,6 +1826,8 @@ void MainWindow::createStatusBar()
 
 	statusStrings[STATUS_NOFILE] = new QString(tr("No file loaded"));
 	statusStrings[STATUS_FILE] = new QString(tr("Loaded file "));
+	statusStrings[STATUS_FOLLOW] = new QString(tr("Following file "));
+	statusStrings[STATUS_PROCESSING] = new QString(tr("Processing file "));
 	statusStrings[STATUS_ERROR] = new QString(tr("An error has occured"));
 
 	setStatus(STATUS_NOFILE);
@@ -1667,15 +1956,19 @@ void MainWindow::setStatus(status_t status, const QString *fileName)
 	statusLabel->setText(string);
 }
 
-int MainWindow::loadTraceFile(const QString &fileName)
+int MainWindow::loadTraceFile(const QString &fileName, bool follow)
 {
 	qint64 start, stop;
         int rval;
 
 	printf("opening %s\n", fileName.toLocal8Bit().data());
-	
+
+	analyzer->setPipelineConfig(Setting::getLoadBufferKB() * 1024,
+				    Setting::getLoadBuffers(),
+				    Setting::getEventBatchSize());
+
 	start = QDateTime::currentDateTimeUtc().toMSecsSinceEpoch();
-	rval = analyzer->open(fileName);
+	rval = analyzer->open(fileName, follow);
 	stop = QDateTime::currentDateTimeUtc().toMSecsSinceEpoch();
 
 	stop = stop - start;
@@ -1905,7 +2198,7 @@ void MainWindow::resetFilters()
 	const TraceEvent *event = eventsWidget->getSelectedEvent();
 
 	if (event != nullptr) {
-		saved = event->time;
+		saved = event->getTime();
 	} else {
 		saved = eventsWidget->getSavedScroll();
 	}
@@ -1974,37 +2267,25 @@ void MainWindow::exportEventsTriggered()
 
 void MainWindow::consumeSettings()
 {
-	unsigned int cpu;
-	QList<int> taskGraphs;
-	QList<int> legendPids;
-	vtl::Time redtime, bluetime;
-
-	if (!analyzer->isOpen()) {
+	/* A followed trace may not have been shown yet */
+	if (!analyzer->isOpen() || cursors[TShark::RED_CURSOR] == nullptr) {
 		setupOpenGL();
 		return;
 	}
 
-	/* Save the PIDs of the tasks that have a task graph */
-	taskGraphs = taskRangeAllocator->getPidList();
-
-	/* Save the Pids of the tasks that have a legend */
-	legendPids = taskToolBar->legendPidList();
-
-	/* Save the cursor time */
-	Cursor *redCursor = cursors[TShark::RED_CURSOR];
-	Cursor *blueCursor = cursors[TShark::BLUE_CURSOR];
-
-	if (redCursor != nullptr)
-		redtime = redCursor->getTime();
-	if (blueCursor != nullptr)
-		bluetime = blueCursor->getTime();
+	redrawTrace(true);
+}
 
-	/* Save the zoom */
-	QCPRange savedRangeX = tracePlot->xAxis->range();
+/*
+ * Deletes the TaskGraph objects of all tasks. The QCPGraph objects must
+ * already have been deleted by clearPlot().
+ */
+void MainWindow::deleteTaskGraphs()
+{
+	unsigned int cpu;
 
-	clearPlot();
-	setupOpenGL();
-	taskToolBar->clear();
+	if (analyzer->cpuTaskMaps == nullptr)
+		return;
 
 	for (cpu = 0; cpu <= analyzer->getMaxCPU(); cpu++) {
 		DEFINE_CPUTASKMAP_ITERATOR(iter);
@@ -2021,7 +2302,7 @@ void MainWindow::consumeSettings()
 	for (iter = analyzer->taskMap.begin();
 	     iter != analyzer->taskMap.end();
 	     iter++) {
-		Task *task = iter.value().task;
+		Task *task = &iter.value();
 		if (task->graph != nullptr) {
 			/*
 			 * This implies that the task had a task graph added.
@@ -2037,6 +2318,46 @@ void MainWindow::consumeSettings()
 			task->uninterruptibleGraph = nullptr;
 		}
 	}
+}
+
+/*
+ * Recreates all graphs, while keeping the task graphs, the legend and the
+ * cursors. This is needed when the settings have changed or when more events
+ * have been processed. If nrEvict is larger than zero, that many events are
+ * evicted from the beginning of a followed trace, after the graphs of the
+ * tasks have been deleted.
+ */
+void MainWindow::redrawTrace(bool keepZoom, int nrEvict)
+{
+	QList<int> taskGraphs;
+	QList<int> legendPids;
+	vtl::Time redtime, bluetime;
+
+	/* Save the PIDs of the tasks that have a task graph */
+	taskGraphs = taskRangeAllocator->getPidList();
+
+	/* Save the Pids of the tasks that have a legend */
+	legendPids = taskToolBar->legendPidList();
+
+	/* Save the cursor time */
+	Cursor *redCursor = cursors[TShark::RED_CURSOR];
+	Cursor *blueCursor = cursors[TShark::BLUE_CURSOR];
+
+	if (redCursor != nullptr)
+		redtime = redCursor->getTime();
+	if (blueCursor != nullptr)
+		bluetime = blueCursor->getTime();
+
+	/* Save the zoom */
+	QCPRange savedRangeX = tracePlot->xAxis->range();
+
+	clearPlot();
+	setupOpenGL();
+	taskToolBar->clear();
+
+	deleteTaskGraphs();
+	if (nrEvict > 0)
+		analyzer->slideWindow(nrEvict);
 
 	computeLayout();
 	setupCursors(redtime, bluetime);
@@ -2044,7 +2365,8 @@ void MainWindow::consumeSettings()
 	showTrace();
 	tracePlot->show();
 
-	tracePlot->xAxis->setRange(savedRangeX);
+	if (keepZoom)
+		tracePlot->xAxis->setRange(savedRangeX);
 	/* Restore the task graphs from the list */
 	QList<int>::const_iterator j;
 	for (j = taskGraphs.begin(); j != taskGraphs.end(); j++)
@@ -2108,7 +2430,8 @@ void MainWindow::addTaskGraph(int pid)
 	task->doScalePreempted();
 	task->doScaleUnint();
 
-	taskGraph->setData(task->schedTimev, task->scaledSchedData);
+	taskGraph->setData(task->schedTimev.toDoubleVector(),
+			   task->scaledSchedData);
 	task->graph = taskGraph;
 
 	/* Add the horizontal wakeup graph as well */
@@ -2122,7 +2445,7 @@ void MainWindow::addTaskGraph(int pid)
 	graph->setScatterStyle(style);
 	graph->setLineStyle(QCPGraph::lsNone);
 	graph->setAdaptiveSampling(true);
-	graph->setData(task->wakeTimev, task->wakeHeight);
+	graph->setData(task->wakeTimev.toDoubleVector(), task->wakeHeight);
 	errorBars->setData(task->wakeDelay, task->wakeZero);
 	errorBars->setErrorType(QCPErrorBars::etKeyError);
 	errorBars->setPen(pen);
@@ -2424,7 +2747,7 @@ void MainWindow::showWakeupOrWaking(int pid, event_t wakevent)
 		return;
 
 	const TraceEvent *wakeupevent = analyzer->
-		findPreviousWakEvent(schedIndex, pid, wakevent, &wakeUpIndex);
+		findSchedCause(schedIndex, wakevent, &wakeUpIndex);
 	if (wakeupevent == nullptr)
 		return;
 	/*
@@ -2434,13 +2757,13 @@ void MainWindow::showWakeupOrWaking(int pid, event_t wakevent)
 	 * the task that was doing the wakeup. This way we can push the button
 	 * again to see who woke up the task that was doing the wakeup
 	 */
-	activeCursor->setPosition(wakeupevent->time);
-	inactiveCursor->setPosition(schedevent->time);
+	activeCursor->setPosition(wakeupevent->getTime());
+	inactiveCursor->setPosition(schedevent->getTime());
 	checkStatsTimeLimited();
-	infoWidget->setTime(wakeupevent->time, activeIdx);
-	infoWidget->setTime(schedevent->time, inactiveIdx);
-	cursorPos[activeIdx] = wakeupevent->time.toDouble();
-	cursorPos[inactiveIdx] = schedevent->time.toDouble();
+	infoWidget->setTime(wakeupevent->getTime(), activeIdx);
+	infoWidget->setTime(schedevent->getTime(), inactiveIdx);
+	cursorPos[activeIdx] = wakeupevent->getTime().toDouble();
+	cursorPos[inactiveIdx] = schedevent->getTime().toDouble();
 
 	if (!analyzer->isFiltered()) {
 		eventsWidget->scrollTo(wakeUpIndex);
@@ -2455,9 +2778,10 @@ void MainWindow::showWakeupOrWaking(int pid, event_t wakevent)
 			eventsWidget->scrollTo(filterIndex);
 	}
 
-	unsigned int wcpu = wakeupevent->cpu;
-	int wpid = wakeupevent->pid;
+	unsigned int wcpu;
+	int wpid;
 
+	analyzer->findWaker(wakeUpIndex, &wpid, &wcpu);
 	selectTaskByPid(wpid, &wcpu);
 }
 
@@ -2481,10 +2805,10 @@ void MainWindow::showWaking(const TraceEvent *wakeupevent)
 	if (wakingevent == nullptr)
 		return;
 
-	activeCursor->setPosition(wakingevent->time);
-	infoWidget->setTime(wakingevent->time, activeIdx);
+	activeCursor->setPosition(wakingevent->getTime());
+	infoWidget->setTime(wakingevent->getTime(), activeIdx);
 	checkStatsTimeLimited();
-	cursorPos[activeIdx] = wakingevent->time.toDouble();
+	cursorPos[activeIdx] = wakingevent->getTime().toDouble();
 
 	if (!analyzer->isFiltered()) {
 		eventsWidget->scrollTo(wakingIndex);
@@ -2722,10 +3046,10 @@ void MainWindow::findSleepTriggered()
 	if (schedevent == nullptr)
 		return;
 
-	activeCursor->setPosition(schedevent->time);
+	activeCursor->setPosition(schedevent->getTime());
 	checkStatsTimeLimited();
-	infoWidget->setTime(schedevent->time, activeIdx);
-	cursorPos[activeIdx] = schedevent->time.toDouble();
+	infoWidget->setTime(schedevent->getTime(), activeIdx);
+	cursorPos[activeIdx] = schedevent->getTime().toDouble();
 
 	if (!analyzer->isFiltered()) {
 		eventsWidget->scrollTo(schedIndex);
@@ -60,6 +60,7 @@
 #include "analyzer/traceanalyzer.h"
 #include "misc/setting.h"
 #include "misc/traceshark.h"
+#include "ui/qtwidgets.h"
 #include "parser/traceevent.h"
 #include "threads/workitem.h"
 
@@ -69,6 +70,7 @@ class QLabel;
 class QMenu;
 class QPlainTextEdit;
 class QMouseEvent;
+class QTimer;
 class QToolBar;
 template<class T, class U> class QMap;
 QT_END_NAMESPACE
@@ -104,11 +106,15 @@ public:
 	MainWindow();
 	virtual ~MainWindow();
 	void openFile(const QString &name);
+	void followFile(const QString &name);
 protected:
 	void closeEvent(QCloseEvent *event);
 
 private slots:
 	void openTrace();
+	void followTrace();
+	void followTimeout();
+	void processTimeout();
 	void closeTrace();
 	void saveScreenshot();
 	void about();
@@ -169,16 +175,28 @@ private:
 	typedef enum {
 		STATUS_NOFILE = 0,
 		STATUS_FILE,
+		STATUS_FOLLOW,
+		STATUS_PROCESSING,
 		STATUS_ERROR,
 		STATUS_NR
 	} status_t;
 
 	void processTrace();
+	void finishOpen();
+	void showPreview(AnalysisPreview &preview);
+	void addCpuIdleGraph(unsigned int cpu, const CpuIdle &idle);
+	void addCpuFreqGraph(unsigned int cpu, const CpuFreq &freq);
+	void printStallStats();
 	void computeLayout();
 	void computeStats();
+	bool enableMigrations();
+	void scaleMigration();
+	void deleteTaskGraphs();
 	void rescaleTrace();
 	void clearPlot();
 	void showTrace();
+	void redrawTrace(bool keepZoom, int nrEvict = 0);
+	void startFollow(const QString &name);
 	void loadSettings();
 	void setupCursors();
 	void setupCursors(const double &red, const double &blue);
@@ -252,7 +270,7 @@ private:
 	void dialogConnections();
 
 	void setStatus(status_t status, const QString *fileName = nullptr);
-	int loadTraceFile(const QString &);
+	int loadTraceFile(const QString &, bool follow = false);
 
 	QMenu *fileMenu;
 	QMenu *viewMenu;
@@ -267,6 +285,7 @@ private:
 	QString *statusStrings[STATUS_NR];
 
 	QAction *openAction;
+	QAction *followAction;
 	QAction *closeAction;
 	QAction *saveAction;
 	QAction *exitAction;
@@ -299,6 +318,12 @@ private:
 	QAction *taskFilterLimitedAction;
 
 	TraceAnalyzer *analyzer;
+	/* Refreshes the display while a trace is followed */
+	QTimer *followTimer;
+	/* Shows the progress while a trace is processed */
+	QTimer *processTimer;
+	QString processName;
+	quint64 processStart;
 
 	ErrorDialog *errorDialog;
 	LicenseDialog *licenseDialog;
@@ -341,6 +366,8 @@ private:
 
 	double bottom;
 	double top;
+	double migrationOffset;
+	double migrationScale;
 	QVector<double> ticks;
 	QVector<QString> tickLabels;
 	Cursor *cursors[TShark::NR_CURSORS];
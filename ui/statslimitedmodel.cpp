@@ -50,12 +50,13 @@
  *     EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
-#include "vtl/avltree.h"
+#include "vtl/pidmap.h"
 #include "vtl/heapsort.h"
 #include "vtl/tlist.h"
 
 #include "ui/statslimitedmodel.h"
 #include "misc/traceshark.h"
+#include "ui/qtwidgets.h"
 #include "analyzer/task.h"
 
 static const char swappername[] = "swapper";
@@ -78,7 +79,7 @@ StatsLimitedModel::~StatsLimitedModel()
 	delete idleTask;
 }
 
-void StatsLimitedModel::setTaskMap(vtl::AVLTree<int, TaskHandle> *map,
+void StatsLimitedModel::setTaskMap(vtl::PidMap<Task> *map,
 				   unsigned int nrcpus)
 {
 	vtl::Time delta =
@@ -93,7 +94,7 @@ void StatsLimitedModel::setTaskMap(vtl::AVLTree<int, TaskHandle> *map,
 
 	DEFINE_TASKMAP_ITERATOR(iter) = map->begin();
 	while (iter != map->end()) {
-		Task *task = iter.value().task;
+		Task *task = &iter.value();
 		if (!task->cursorTime.isZero()) {
 			taskList->append(task);
 			idleTask->cursorTime -= task->cursorTime;
@@ -50,12 +50,13 @@
  *     EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
-#include "vtl/avltree.h"
+#include "vtl/pidmap.h"
 #include "vtl/heapsort.h"
 #include "vtl/tlist.h"
 
 #include "ui/statsmodel.h"
 #include "misc/traceshark.h"
+#include "ui/qtwidgets.h"
 #include "analyzer/task.h"
 
 static const char swappername[] = "swapper";
@@ -78,7 +79,7 @@ StatsModel::~StatsModel()
 	delete idleTask;
 }
 
-void StatsModel::setTaskMap(vtl::AVLTree<int, TaskHandle> *map,
+void StatsModel::setTaskMap(vtl::PidMap<Task> *map,
 			    unsigned int nrcpus)
 {
 	vtl::Time delta = AbstractTask::endTime - AbstractTask::startTime;
@@ -92,7 +93,7 @@ void StatsModel::setTaskMap(vtl::AVLTree<int, TaskHandle> *map,
 
 	DEFINE_TASKMAP_ITERATOR(iter) = map->begin();
 	while (iter != map->end()) {
-		Task *task = iter.value().task;
+		Task *task = &iter.value();
 		taskList->append(task);
 		idleTask->accTime -= task->accTime;
 		iter++;
@@ -50,12 +50,13 @@
  *     EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
-#include "vtl/avltree.h"
+#include "vtl/pidmap.h"
 #include "vtl/heapsort.h"
 #include "vtl/tlist.h"
 
 #include "ui/taskmodel.h"
 #include "misc/traceshark.h"
+#include "ui/qtwidgets.h"
 #include "analyzer/task.h"
 
 static const char swappername[] = "swapper";
@@ -78,7 +79,7 @@ TaskModel::~TaskModel()
 	delete idleTask;
 }
 
-void TaskModel::setTaskMap(vtl::AVLTree<int, TaskHandle> *map,
+void TaskModel::setTaskMap(vtl::PidMap<Task> *map,
 			   unsigned int /*nrcpus*/)
 {
 	taskList->clear();
@@ -88,7 +89,7 @@ void TaskModel::setTaskMap(vtl::AVLTree<int, TaskHandle> *map,
 
 	DEFINE_TASKMAP_ITERATOR(iter) = map->begin();
 	while (iter != map->end()) {
-		Task *task = iter.value().task;
+		Task *task = &iter.value();
 		taskList->append(task);
 		iter++;
 	}
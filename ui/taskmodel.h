@@ -54,8 +54,9 @@
 #define TASKMODEL_H
 
 #include "abstracttaskmodel.h"
-#include "vtl/avltree.h"
+#include "vtl/pidmap.h"
 #include "misc/traceshark.h"
+#include "ui/qtwidgets.h"
 
 namespace vtl {
        template<class T> class TList;
@@ -63,7 +64,6 @@ namespace vtl {
 
 
 class Task;
-class TaskHandle;
 
 QT_BEGIN_NAMESPACE
 class QStringList;
@@ -75,7 +75,7 @@ class TaskModel : public AbstractTaskModel
 public:
 	TaskModel(QObject *parent = 0);
 	~TaskModel();
-	void setTaskMap(vtl::AVLTree<int, TaskHandle> *map,
+	void setTaskMap(vtl::PidMap<Task> *map,
 			unsigned int nrcpus);
 	int rowCount(const QModelIndex &parent) const;
 	int columnCount(const QModelIndex &parent) const;
@@ -59,7 +59,7 @@
 #include <QHBoxLayout>
 #include <QWidget>
 
-#include "vtl/avltree.h"
+#include "vtl/pidmap.h"
 #include "vtl/error.h"
 
 #include "ui/taskselectdialog.h"
@@ -68,6 +68,7 @@
 #include "ui/statslimitedmodel.h"
 #include "ui/taskview.h"
 #include "misc/traceshark.h"
+#include "ui/qtwidgets.h"
 
 #define CBOX_INDEX_AND 0
 #define CBOX_INDEX_OR  1
@@ -157,7 +158,7 @@ TaskSelectDialog::~TaskSelectDialog()
 	delete filterMap;
 }
 
-void TaskSelectDialog::setTaskMap(vtl::AVLTree<int, TaskHandle> *map,
+void TaskSelectDialog::setTaskMap(vtl::PidMap<Task> *map,
 				  unsigned int nrcpus)
 {
 	taskModel->setTaskMap(map, nrcpus);
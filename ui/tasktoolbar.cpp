@@ -67,6 +67,7 @@
 #include "misc/maplist.h"
 #include "misc/resources.h"
 #include "misc/traceshark.h"
+#include "ui/qtwidgets.h"
 #include "qcustomplot/qcustomplot.h"
 #include "vtl/error.h"
 
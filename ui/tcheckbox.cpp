@@ -55,6 +55,7 @@
 #include <QLabel>
 
 #include "misc/traceshark.h"
+#include "ui/qtwidgets.h"
 #include "tcheckbox.h"
 
 TCheckBox::TCheckBox(int id_arg, bool checked, QWidget *parent):
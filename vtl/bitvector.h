@@ -65,6 +65,7 @@ public:
 	__always_inline void appendbool(bool value);
 	__always_inline unsigned int read(unsigned int index) const;
 	__always_inline void append(unsigned int value);
+	__always_inline void removeLast();
 	__always_inline unsigned int size() const;
 	void clear();
 	void softclear();
@@ -139,6 +140,12 @@ __always_inline void BitVector::append(unsigned int value)
 	nrElements++;
 }
 
+__always_inline void BitVector::removeLast()
+{
+	if (nrElements > 0)
+		nrElements--;
+}
+
 __always_inline unsigned int BitVector::size() const
 {
 	return nrElements;
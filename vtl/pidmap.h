@@ -0,0 +1,381 @@
+// SPDX-License-Identifier: (GPL-2.0-or-later OR BSD-2-Clause)
+/*
+ * Traceshark - a visualizer for visualizing ftrace and perf traces
+ * Copyright (C) 2019  Viktor Rosendahl <viktor.rosendahl@gmail.com>
+ *
+ * This file is dual licensed: you can use it either under the terms of
+ * the GPL, or the BSD license, at your option.
+ *
+ *  a) This program is free software; you can redistribute it and/or
+ *     modify it under the terms of the GNU General Public License as
+ *     published by the Free Software Foundation; either version 2 of the
+ *     License, or (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public
+ *     License along with this library; if not, write to the Free
+ *     Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ *     MA 02110-1301 USA
+ *
+ * Alternatively,
+ *
+ *  b) Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *     1. Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *     2. Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *     CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *     INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *     MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *     DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *     CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *     NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *     LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *     HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *     CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ *     OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *     EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _VTL_PIDMAP_H
+#define _VTL_PIDMAP_H
+
+#include <new>
+
+#include "vtl/compiler.h"
+
+namespace vtl {
+
+/* The values are allocated in blocks of this many */
+#define PIDMAP_BLOCK_SHIFT (8)
+#define PIDMAP_BLOCK_SIZE (1 << PIDMAP_BLOCK_SHIFT)
+#define PIDMAP_BLOCK_MASK (PIDMAP_BLOCK_SIZE - 1)
+
+/* The number of slots when the first pid is inserted, must be a power of 2 */
+#define PIDMAP_INITIAL_SLOTS (64)
+
+/*
+ * A map from pids to values of type T. The values are kept in an arena of
+ * fixed size blocks, so they never move once they have been created and the
+ * map can be iterated in the order that the pids were inserted. The pids are
+ * looked up in an open addressing table with linear probing, which holds the
+ * pid and the index of the value in the arena, so that a lookup usually only
+ * touches a single cache line of the table. Nothing is allocated before the
+ * first pid is inserted, so it's cheap to have an array of mostly empty maps.
+ */
+template<class T>
+class PidMap {
+public:
+	class iterator {
+		friend class PidMap<T>;
+	public:
+		iterator();
+		__always_inline int key() const;
+		__always_inline T &value() const;
+		__always_inline iterator &operator++();
+		__always_inline iterator operator++(int);
+		__always_inline bool operator!=(const iterator &other) const;
+		__always_inline bool operator==(const iterator &other) const;
+	private:
+		iterator(const PidMap<T> *m, int i);
+		const PidMap<T> *map;
+		int idx;
+	};
+
+	PidMap();
+	~PidMap();
+	__always_inline T &operator[](int pid);
+	__always_inline T *findValue(int pid) const;
+	__always_inline bool contains(int pid) const;
+	__always_inline iterator find(int pid) const;
+	__always_inline iterator begin() const;
+	__always_inline iterator end() const;
+	__always_inline int size() const;
+	__always_inline bool isEmpty() const;
+	void clear();
+private:
+	class Slot {
+	public:
+		int pid;
+		/* Index of the value in the arena, -1 if the slot is empty */
+		int idx;
+	};
+	class Entry {
+	public:
+		T value;
+		int pid;
+	};
+	PidMap(const PidMap<T> &other);
+	PidMap<T> &operator=(const PidMap<T> &other);
+	__always_inline static unsigned int hash(int pid);
+	__always_inline int lookup(int pid) const;
+	__always_inline Entry &entry(int idx) const;
+	__always_inline void place(int pid, int idx);
+	int insert(int pid);
+	void grow();
+	void addBlock();
+	Slot *table;
+	unsigned int slotMask;
+	Entry **blocks;
+	int nrBlocks;
+	int maxBlocks;
+	int nrEntries;
+};
+
+template<class T>
+PidMap<T>::iterator::iterator():
+	map(nullptr), idx(0) {}
+
+template<class T>
+PidMap<T>::iterator::iterator(const PidMap<T> *m, int i):
+	map(m), idx(i) {}
+
+template<class T>
+__always_inline int PidMap<T>::iterator::key() const
+{
+	return map->entry(idx).pid;
+}
+
+template<class T>
+__always_inline T &PidMap<T>::iterator::value() const
+{
+	return map->entry(idx).value;
+}
+
+template<class T>
+__always_inline typename PidMap<T>::iterator &
+PidMap<T>::iterator::operator++()
+{
+	idx++;
+	return *this;
+}
+
+template<class T>
+__always_inline typename PidMap<T>::iterator
+PidMap<T>::iterator::operator++(int)
+{
+	iterator old = *this;
+	idx++;
+	return old;
+}
+
+template<class T>
+__always_inline bool
+PidMap<T>::iterator::operator!=(const iterator &other) const
+{
+	return idx != other.idx;
+}
+
+template<class T>
+__always_inline bool
+PidMap<T>::iterator::operator==(const iterator &other) const
+{
+	return idx == other.idx;
+}
+
+template<class T>
+PidMap<T>::PidMap():
+	table(nullptr), slotMask(0), blocks(nullptr), nrBlocks(0),
+	maxBlocks(0), nrEntries(0) {}
+
+template<class T>
+PidMap<T>::~PidMap()
+{
+	clear();
+}
+
+template<class T>
+__always_inline unsigned int PidMap<T>::hash(int pid)
+{
+	unsigned int h = (unsigned int) pid * 0x9e3779b1U;
+
+	return h ^ (h >> 16);
+}
+
+template<class T>
+__always_inline typename PidMap<T>::Entry &PidMap<T>::entry(int idx) const
+{
+	return blocks[idx >> PIDMAP_BLOCK_SHIFT][idx & PIDMAP_BLOCK_MASK];
+}
+
+template<class T>
+__always_inline int PidMap<T>::lookup(int pid) const
+{
+	unsigned int i;
+
+	if (table == nullptr)
+		return -1;
+
+	i = hash(pid) & slotMask;
+	while (table[i].idx >= 0) {
+		if (table[i].pid == pid)
+			return table[i].idx;
+		i = (i + 1) & slotMask;
+	}
+	return -1;
+}
+
+template<class T>
+__always_inline void PidMap<T>::place(int pid, int idx)
+{
+	unsigned int i = hash(pid) & slotMask;
+
+	while (table[i].idx >= 0)
+		i = (i + 1) & slotMask;
+	table[i].pid = pid;
+	table[i].idx = idx;
+}
+
+template<class T>
+__always_inline T &PidMap<T>::operator[](int pid)
+{
+	int idx = lookup(pid);
+
+	if (idx < 0)
+		idx = insert(pid);
+	return entry(idx).value;
+}
+
+template<class T>
+__always_inline T *PidMap<T>::findValue(int pid) const
+{
+	int idx = lookup(pid);
+
+	if (idx < 0)
+		return nullptr;
+	return &entry(idx).value;
+}
+
+template<class T>
+__always_inline bool PidMap<T>::contains(int pid) const
+{
+	return lookup(pid) >= 0;
+}
+
+template<class T>
+__always_inline typename PidMap<T>::iterator PidMap<T>::find(int pid) const
+{
+	int idx = lookup(pid);
+
+	if (idx < 0)
+		return end();
+	return iterator(this, idx);
+}
+
+template<class T>
+__always_inline typename PidMap<T>::iterator PidMap<T>::begin() const
+{
+	return iterator(this, 0);
+}
+
+template<class T>
+__always_inline typename PidMap<T>::iterator PidMap<T>::end() const
+{
+	return iterator(this, nrEntries);
+}
+
+template<class T>
+__always_inline int PidMap<T>::size() const
+{
+	return nrEntries;
+}
+
+template<class T>
+__always_inline bool PidMap<T>::isEmpty() const
+{
+	return nrEntries == 0;
+}
+
+/* The caller must have checked that pid is not in the map */
+template<class T>
+int PidMap<T>::insert(int pid)
+{
+	int idx = nrEntries;
+	Entry *e;
+
+	/* Keep the table at most half full */
+	if (table == nullptr || (unsigned int) (nrEntries + 1) * 2 > slotMask)
+		grow();
+	if ((idx >> PIDMAP_BLOCK_SHIFT) == nrBlocks)
+		addBlock();
+
+	e = new (&entry(idx)) Entry();
+	e->pid = pid;
+	nrEntries++;
+	place(pid, idx);
+	return idx;
+}
+
+template<class T>
+void PidMap<T>::grow()
+{
+	unsigned int n = table == nullptr ? PIDMAP_INITIAL_SLOTS :
+		(slotMask + 1) * 2;
+	unsigned int i;
+	int idx;
+
+	delete[] table;
+	table = new Slot[n];
+	slotMask = n - 1;
+	for (i = 0; i < n; i++)
+		table[i].idx = -1;
+	for (idx = 0; idx < nrEntries; idx++)
+		place(entry(idx).pid, idx);
+}
+
+template<class T>
+void PidMap<T>::addBlock()
+{
+	Entry **newBlocks;
+	int i;
+
+	if (nrBlocks == maxBlocks) {
+		maxBlocks = maxBlocks == 0 ? 16 : maxBlocks * 2;
+		newBlocks = new Entry*[maxBlocks];
+		for (i = 0; i < nrBlocks; i++)
+			newBlocks[i] = blocks[i];
+		delete[] blocks;
+		blocks = newBlocks;
+	}
+	/* The values are constructed by insert(), when they are needed */
+	blocks[nrBlocks] = static_cast<Entry*>(
+		::operator new(sizeof(Entry) * PIDMAP_BLOCK_SIZE));
+	nrBlocks++;
+}
+
+template<class T>
+void PidMap<T>::clear()
+{
+	int idx;
+	int i;
+
+	for (idx = 0; idx < nrEntries; idx++)
+		entry(idx).~Entry();
+	for (i = 0; i < nrBlocks; i++)
+		::operator delete(blocks[i]);
+	delete[] blocks;
+	delete[] table;
+	table = nullptr;
+	slotMask = 0;
+	blocks = nullptr;
+	nrBlocks = 0;
+	maxBlocks = 0;
+	nrEntries = 0;
+}
+
+}
+
+#endif /* _VTL_PIDMAP_H */
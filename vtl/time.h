@@ -136,6 +136,7 @@ namespace vtl {
 		__always_inline QString toQString() const;
 		__always_inline bool sprint(char *buf) const;
 		__always_inline double toDouble() const;
+		__always_inline timeint_t toNanoseconds() const;
 		__always_inline Time fabs() const;
 		__always_inline unsigned int getPrecision() const;
 		__always_inline void setPrecision(unsigned int p);
@@ -413,6 +414,11 @@ namespace vtl {
 		return r;
 	}
 
+	__always_inline Time::timeint_t Time::toNanoseconds() const
+	{
+		return time;
+	}
+
 	__always_inline Time Time::fabs() const
 	{
 		Time r;
@@ -0,0 +1,305 @@
+// SPDX-License-Identifier: (GPL-2.0-or-later OR BSD-2-Clause)
+/*
+ * Traceshark - a visualizer for visualizing ftrace and perf traces
+ * Copyright (C) 2019  Viktor Rosendahl <viktor.rosendahl@gmail.com>
+ *
+ * This file is dual licensed: you can use it either under the terms of
+ * the GPL, or the BSD license, at your option.
+ *
+ *  a) This program is free software; you can redistribute it and/or
+ *     modify it under the terms of the GNU General Public License as
+ *     published by the Free Software Foundation; either version 2 of the
+ *     License, or (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public
+ *     License along with this library; if not, write to the Free
+ *     Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ *     MA 02110-1301 USA
+ *
+ * Alternatively,
+ *
+ *  b) Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *     1. Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *     2. Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *     CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *     INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *     MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *     DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *     CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *     NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *     LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *     HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *     CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ *     OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *     EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _VTL_TIMEVECTOR_H
+#define _VTL_TIMEVECTOR_H
+
+#include <cstdint>
+#include <QVector>
+
+#include "vtl/compiler.h"
+#include "vtl/time.h"
+
+namespace vtl {
+
+#define TIMEVECTOR_PAGE_SHIFT (8)
+#define TIMEVECTOR_PAGE_SIZE (1 << TIMEVECTOR_PAGE_SHIFT)
+#define TIMEVECTOR_PAGE_MASK (TIMEVECTOR_PAGE_SIZE - 1)
+
+/*
+ * This stores a sequence of nanosecond times. The times are divided into
+ * blocks, each of which has a 64-bit base, which is the first time of the
+ * block, and the index of its first time. Every time is stored as a signed
+ * 32-bit delta from the base of its block. This needs a little more than four
+ * bytes per time, instead of eight.
+ *
+ * A new block is started at every page of TIMEVECTOR_PAGE_SIZE times and
+ * whenever a time is too far from the base of the current block, which is
+ * about two seconds. For every page, the index of the block that holds its
+ * first time is kept, so finding the block of a time only needs to step over
+ * the blocks that were started inside the page. Usually there are none.
+ *
+ * V is the container used for the storage, i.e. QVector or vtl::TList. The
+ * times only need to be sorted for lowerBound() and upperBound(), which first
+ * search the bases and then the deltas of a single block.
+ */
+template<template<class> class V>
+class TimeVector
+{
+public:
+	typedef Time::timeint_t timeint_t;
+	__always_inline void append(timeint_t t);
+	__always_inline void append(const Time &time);
+	__always_inline timeint_t at(int index) const;
+	__always_inline timeint_t operator[](int index) const;
+	__always_inline timeint_t last() const;
+	__always_inline int size() const;
+	__always_inline bool isEmpty() const;
+	void removeLast();
+	void clear();
+	int lowerBound(timeint_t t) const;
+	int upperBound(timeint_t t) const;
+	QVector<double> toDoubleVector() const;
+private:
+	class Block {
+	public:
+		timeint_t base;
+		int start;
+	};
+	__always_inline void newBlock(timeint_t t, int n);
+	__always_inline int blockOf(int index) const;
+	__always_inline int blockEnd(int b) const;
+	__always_inline int search(timeint_t t, bool upper) const;
+	__always_inline static bool isBefore(timeint_t a, timeint_t t,
+					     bool upper);
+	V<Block> blocks;
+	/* The block of the first time of each page */
+	V<int> pages;
+	V<int32_t> deltas;
+};
+
+template<template<class> class V>
+__always_inline void TimeVector<V>::newBlock(timeint_t t, int n)
+{
+	Block b;
+
+	b.base = t;
+	b.start = n;
+	blocks.append(b);
+	deltas.append(0);
+}
+
+template<template<class> class V>
+__always_inline void TimeVector<V>::append(timeint_t t)
+{
+	int n = deltas.size();
+	timeint_t d;
+
+	if ((n & TIMEVECTOR_PAGE_MASK) == 0) {
+		pages.append(blocks.size());
+		newBlock(t, n);
+		return;
+	}
+	d = t - blocks.last().base;
+	if (unlikely(d > INT32_MAX || d < INT32_MIN)) {
+		newBlock(t, n);
+		return;
+	}
+	deltas.append((int32_t) d);
+}
+
+template<template<class> class V>
+__always_inline void TimeVector<V>::append(const Time &time)
+{
+	append(time.toNanoseconds());
+}
+
+template<template<class> class V>
+__always_inline int TimeVector<V>::blockOf(int index) const
+{
+	int b = pages.at(index >> TIMEVECTOR_PAGE_SHIFT);
+	int s = blocks.size();
+
+	while (unlikely(b + 1 < s && blocks.at(b + 1).start <= index))
+		b++;
+	return b;
+}
+
+/* Returns the index after the last time of block b */
+template<template<class> class V>
+__always_inline int TimeVector<V>::blockEnd(int b) const
+{
+	return b + 1 < blocks.size() ? blocks.at(b + 1).start : deltas.size();
+}
+
+template<template<class> class V>
+__always_inline typename TimeVector<V>::timeint_t TimeVector<V>::at(int index)
+	const
+{
+	return blocks.at(blockOf(index)).base + deltas.at(index);
+}
+
+template<template<class> class V>
+__always_inline typename TimeVector<V>::timeint_t
+TimeVector<V>::operator[](int index) const
+{
+	return at(index);
+}
+
+template<template<class> class V>
+__always_inline typename TimeVector<V>::timeint_t TimeVector<V>::last() const
+{
+	return blocks.at(blocks.size() - 1).base + deltas.at(deltas.size() - 1);
+}
+
+template<template<class> class V>
+__always_inline int TimeVector<V>::size() const
+{
+	return deltas.size();
+}
+
+template<template<class> class V>
+__always_inline bool TimeVector<V>::isEmpty() const
+{
+	return deltas.size() == 0;
+}
+
+template<template<class> class V>
+void TimeVector<V>::removeLast()
+{
+	int n = deltas.size() - 1;
+
+	if (blocks.last().start == n)
+		blocks.removeLast();
+	if ((n & TIMEVECTOR_PAGE_MASK) == 0)
+		pages.removeLast();
+	deltas.removeLast();
+}
+
+template<template<class> class V>
+void TimeVector<V>::clear()
+{
+	blocks.clear();
+	pages.clear();
+	deltas.clear();
+}
+
+template<template<class> class V>
+__always_inline bool TimeVector<V>::isBefore(timeint_t a, timeint_t t,
+					     bool upper)
+{
+	return upper ? a <= t : a < t;
+}
+
+template<template<class> class V>
+__always_inline int TimeVector<V>::search(timeint_t t, bool upper) const
+{
+	int low = 0;
+	int high = blocks.size();
+	int pivot;
+	timeint_t base;
+
+	/* Find the first block that does not start before t */
+	while (low < high) {
+		pivot = low + (high - low) / 2;
+		if (isBefore(blocks.at(pivot).base, t, upper))
+			low = pivot + 1;
+		else
+			high = pivot;
+	}
+	if (low == 0)
+		return 0;
+
+	/* The index that we want is in the previous block or just after it */
+	base = blocks.at(low - 1).base;
+	high = blockEnd(low - 1);
+	low = blocks.at(low - 1).start;
+	while (low < high) {
+		pivot = low + (high - low) / 2;
+		if (isBefore(base + deltas.at(pivot), t, upper))
+			low = pivot + 1;
+		else
+			high = pivot;
+	}
+	return low;
+}
+
+/* Returns the index of the first time that is t or later */
+template<template<class> class V>
+int TimeVector<V>::lowerBound(timeint_t t) const
+{
+	return search(t, false);
+}
+
+/* Returns the index of the first time that is later than t */
+template<template<class> class V>
+int TimeVector<V>::upperBound(timeint_t t) const
+{
+	return search(t, true);
+}
+
+/*
+ * Returns the times in seconds, with the same conversion as Time::toDouble(),
+ * e.g. for the plotting functions that want a QVector<double>.
+ */
+template<template<class> class V>
+QVector<double> TimeVector<V>::toDoubleVector() const
+{
+	QVector<double> v;
+	int s = blocks.size();
+	int b, i, end;
+	timeint_t base;
+
+	v.reserve(deltas.size());
+	for (b = 0; b < s; b++) {
+		base = blocks.at(b).base;
+		end = blockEnd(b);
+		for (i = blocks.at(b).start; i < end; i++)
+			v.append(((double) (base + deltas.at(i))) /
+				 NSECS_PER_SEC);
+	}
+	return v;
+}
+
+}
+
+#endif /* _VTL_TIMEVECTOR_H */
@@ -112,6 +112,7 @@ public:
 	__always_inline int size() const;
 	void clear();
 	void softclear();
+	void removeFirst(int n);
 	__always_inline T& operator[](int index);
 	__always_inline const T& operator[](int index) const;
 	__always_inline void swap(int a, int b);
@@ -293,6 +294,23 @@ void TList<T>::softclear()
 	nrElements = 0;
 }
 
+/*
+ * Removes the first n elements by moving the others to the front. The maps
+ * that are no longer needed are unmapped.
+ */
+template<class T>
+void TList<T>::removeFirst(int n)
+{
+	int s = nrElements - n;
+	int i;
+
+	for (i = 0; i < s; i++)
+		subscript(i) = subscript(i + n);
+	nrElements = s;
+	while (nrMaps - 1 > mapFromIndex(nrElements))
+		decMem();
+}
+
 template<class T>
 __always_inline void TList<T>::swap(int a, int b)
 {